@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_BATCH_ALLOCS 1000
+
+static void
+benchmark_malloc(size_t nb_ops) {
+    void *ptrs[NB_BATCH_ALLOCS];
+    uint64_t rng, start;
+
+    rng = 42;
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i += NB_BATCH_ALLOCS) {
+        for (size_t j = 0; j < NB_BATCH_ALLOCS; j++) {
+            ptrs[j] = c_malloc(benchmark_random(&rng) % 128 + 1);
+            if (!ptrs[j])
+                die("%s", c_get_error());
+        }
+
+        for (size_t j = 0; j < NB_BATCH_ALLOCS; j++)
+            c_free(ptrs[j]);
+    }
+
+    benchmark_report("malloc", benchmark_now() - start, nb_ops);
+}
+
+static void
+benchmark_arena(size_t nb_ops) {
+    struct c_arena *arena;
+    uint64_t rng, start;
+
+    arena = c_arena_new(0);
+    if (!arena)
+        die("%s", c_get_error());
+
+    rng = 42;
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i += NB_BATCH_ALLOCS) {
+        for (size_t j = 0; j < NB_BATCH_ALLOCS; j++) {
+            if (!c_arena_alloc(arena, benchmark_random(&rng) % 128 + 1))
+                die("%s", c_get_error());
+        }
+
+        c_arena_clear(arena);
+    }
+
+    benchmark_report("arena", benchmark_now() - start, nb_ops);
+
+    c_arena_delete(arena);
+}
+
+int
+main(int argc, char **argv) {
+    size_t nb_ops = 10000000;
+
+    printf("%zu allocations of 1 to 128 bytes\n", nb_ops);
+
+    benchmark_malloc(nb_ops);
+    benchmark_arena(nb_ops);
+
+    return 0;
+}
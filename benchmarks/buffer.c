@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <inttypes.h>
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define TOTAL_SIZE   ((size_t)1024 * 1024 * 1024)
+#define CHUNK_SIZE   4096
+
+struct counting_allocator {
+    size_t nb_reallocs;
+};
+
+static void *counting_malloc(void *, size_t);
+static void counting_free(void *, void *, size_t);
+static void *counting_realloc(void *, void *, size_t, size_t);
+
+static void
+benchmark_printf(const char *name, double factor, size_t max_growth) {
+    struct counting_allocator data;
+    struct c_allocator allocator;
+    struct c_buffer *buf;
+    uint64_t rng, start;
+    size_t nb_ops;
+
+    data.nb_reallocs = 0;
+
+    allocator.malloc = counting_malloc;
+    allocator.free = counting_free;
+    allocator.realloc = counting_realloc;
+    allocator.aligned_alloc = NULL;
+    allocator.aligned_free = NULL;
+    allocator.data = &data;
+
+    buf = c_buffer_new_with_allocator(&allocator);
+    if (!buf)
+        die("%s", c_get_error());
+
+    if (c_buffer_set_growth_policy(buf, factor, max_growth) == -1)
+        die("%s", c_get_error());
+
+    rng = 42;
+    nb_ops = 0;
+
+    start = benchmark_now();
+    while (c_buffer_length(buf) < TOTAL_SIZE) {
+        uint64_t r;
+
+        r = benchmark_random(&rng);
+
+        if (c_buffer_add_printf(buf, "2015-03-01T12:%02u:%02u.%06uZ info "
+                                "request %016"PRIx64" handled in %u us\n",
+                                (unsigned int)(r % 60),
+                                (unsigned int)((r >> 8) % 60),
+                                (unsigned int)((r >> 16) % 1000000), r,
+                                (unsigned int)((r >> 32) % 10000)) == -1) {
+            die("%s", c_get_error());
+        }
+
+        nb_ops++;
+    }
+
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+    printf("%-32s %10zu reallocations\n", "", data.nb_reallocs);
+
+    c_buffer_delete(buf);
+}
+
+static void
+benchmark_reserve(const char *name) {
+    struct c_buffer *buf;
+    uint64_t start;
+    size_t nb_ops;
+
+    buf = c_buffer_new();
+    if (!buf)
+        die("%s", c_get_error());
+
+    nb_ops = 0;
+
+    start = benchmark_now();
+    while (c_buffer_length(buf) < TOTAL_SIZE) {
+        char *ptr;
+
+        ptr = c_buffer_reserve(buf, CHUNK_SIZE);
+        if (!ptr)
+            die("%s", c_get_error());
+
+        memset(ptr, 'a', CHUNK_SIZE);
+        c_buffer_increase_length(buf, CHUNK_SIZE);
+
+        nb_ops++;
+    }
+
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    c_buffer_delete(buf);
+}
+
+int
+main(int argc, char **argv) {
+    printf("appending %zu MB\n", TOTAL_SIZE / (1024 * 1024));
+
+    benchmark_printf("printf (x2)", 2.0, 0);
+    benchmark_printf("printf (x1.5)", 1.5, 0);
+    benchmark_printf("printf (x2, max 64MB)", 2.0, 64 * 1024 * 1024);
+    benchmark_reserve("reserve 4KB");
+
+    return 0;
+}
+
+static void *
+counting_malloc(void *arg, size_t sz) {
+    return malloc(sz);
+}
+
+static void
+counting_free(void *arg, void *ptr, size_t sz) {
+    free(ptr);
+}
+
+static void *
+counting_realloc(void *arg, void *ptr, size_t old_sz, size_t sz) {
+    struct counting_allocator *data;
+
+    data = arg;
+    data->nb_reallocs++;
+
+    return realloc(ptr, sz);
+}
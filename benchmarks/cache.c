@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+static void
+benchmark_cache(enum c_cache_policy policy, const char *name,
+                size_t nb_entries, size_t nb_keys, size_t nb_ops) {
+    struct c_cache *cache;
+    struct c_cache_stats stats;
+    uint64_t rng, start;
+
+    cache = c_cache_new(c_hash_int32, c_equal_int32, policy);
+    if (!cache)
+        die("%s", c_get_error());
+
+    c_cache_set_max_entries(cache, nb_entries);
+
+    rng = 42;
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i++) {
+        uint64_t r;
+        void *key;
+
+        /* Half of the accesses target 1/8 of the keys */
+        r = benchmark_random(&rng);
+        if (r & 1) {
+            key = C_INT32_TO_POINTER((r >> 1) % (nb_keys / 8));
+        } else {
+            key = C_INT32_TO_POINTER((r >> 1) % nb_keys);
+        }
+
+        if (c_cache_get(cache, key, NULL) == 0) {
+            if (c_cache_insert(cache, key, NULL, 0) == -1)
+                die("%s", c_get_error());
+        }
+    }
+
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    c_cache_stats(cache, &stats);
+    printf("%-32s %10.2f%% hits\n", "",
+           (double)stats.nb_hits * 100.0
+           / (double)(stats.nb_hits + stats.nb_misses));
+
+    c_cache_delete(cache);
+}
+
+int
+main(int argc, char **argv) {
+    size_t sizes[] = {1000, 100000, 1000000};
+    size_t nb_ops = 10000000;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t nb_entries, nb_keys;
+
+        nb_entries = sizes[i];
+        nb_keys = nb_entries * 4;
+
+        printf("%zu entries, %zu keys, %zu operations\n",
+               nb_entries, nb_keys, nb_ops);
+
+        benchmark_cache(C_CACHE_LRU, "lru", nb_entries, nb_keys, nb_ops);
+        benchmark_cache(C_CACHE_CLOCK, "clock", nb_entries, nb_keys, nb_ops);
+
+        putchar('\n');
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_ENTRIES          1000000
+#define NB_OPS_PER_THREAD   1000000
+#define MAX_NB_THREADS      64
+
+/* Percentage of operations which are insertions; the others are lookups. */
+#define WRITE_RATIO         10
+
+struct benchmark_thread {
+    size_t index;
+
+    struct c_hash_table *table;
+    pthread_mutex_t *mutex;
+
+    struct c_concurrent_hash_table *ctable;
+};
+
+static void benchmark_run(const char *, struct c_hash_table *,
+                          pthread_mutex_t *, struct c_concurrent_hash_table *,
+                          size_t);
+static void *benchmark_mutex_main(void *);
+static void *benchmark_concurrent_main(void *);
+
+int
+main(int argc, char **argv) {
+    struct c_concurrent_hash_table *ctable;
+    struct c_hash_table *table;
+    pthread_mutex_t mutex;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+    if (!table)
+        die("%s", c_get_error());
+
+    ctable = c_concurrent_hash_table_new(c_hash_int32, c_equal_int32, 0);
+    if (!ctable)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < NB_ENTRIES; i++) {
+        void *key;
+
+        key = C_INT32_TO_POINTER(i);
+
+        if (c_hash_table_insert(table, key, key) == -1)
+            die("%s", c_get_error());
+        if (c_concurrent_hash_table_insert(ctable, key, key) == -1)
+            die("%s", c_get_error());
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+
+    printf("%d entries, %d operations per thread, %d%% insertions\n\n",
+           NB_ENTRIES, NB_OPS_PER_THREAD, WRITE_RATIO);
+
+    for (size_t nb_threads = 1; nb_threads <= MAX_NB_THREADS; nb_threads *= 2) {
+        printf("%zu threads\n", nb_threads);
+
+        benchmark_run("c_hash_table + mutex", table, &mutex, NULL, nb_threads);
+        benchmark_run("c_concurrent_hash_table", NULL, NULL, ctable,
+                      nb_threads);
+
+        putchar('\n');
+    }
+
+    pthread_mutex_destroy(&mutex);
+
+    c_concurrent_hash_table_delete(ctable);
+    c_hash_table_delete(table);
+    return 0;
+}
+
+static void
+benchmark_run(const char *name,
+              struct c_hash_table *table, pthread_mutex_t *mutex,
+              struct c_concurrent_hash_table *ctable, size_t nb_threads) {
+    struct benchmark_thread threads[MAX_NB_THREADS];
+    pthread_t thread_ids[MAX_NB_THREADS];
+    void *(*thread_main)(void *);
+    uint64_t start;
+
+    thread_main = ctable ? benchmark_concurrent_main : benchmark_mutex_main;
+
+    start = benchmark_now();
+
+    for (size_t i = 0; i < nb_threads; i++) {
+        threads[i].index = i;
+        threads[i].table = table;
+        threads[i].mutex = mutex;
+        threads[i].ctable = ctable;
+
+        if (pthread_create(&thread_ids[i], NULL, thread_main,
+                           &threads[i]) != 0) {
+            die("cannot create thread");
+        }
+    }
+
+    for (size_t i = 0; i < nb_threads; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    benchmark_report(name, benchmark_now() - start,
+                     nb_threads * NB_OPS_PER_THREAD);
+}
+
+static void *
+benchmark_mutex_main(void *arg) {
+    struct benchmark_thread *thread;
+    uint64_t rng;
+
+    thread = arg;
+    rng = thread->index + 1;
+
+    for (size_t i = 0; i < NB_OPS_PER_THREAD; i++) {
+        uint64_t r;
+        void *key;
+
+        r = benchmark_random(&rng);
+        key = C_INT32_TO_POINTER((r >> 8) % NB_ENTRIES);
+
+        pthread_mutex_lock(thread->mutex);
+
+        if (r % 100 < WRITE_RATIO) {
+            if (c_hash_table_insert(thread->table, key, key) == -1)
+                die("%s", c_get_error());
+        } else {
+            void *value;
+
+            if (c_hash_table_get(thread->table, key, &value) == 0)
+                die("key not found");
+        }
+
+        pthread_mutex_unlock(thread->mutex);
+    }
+
+    return NULL;
+}
+
+static void *
+benchmark_concurrent_main(void *arg) {
+    struct benchmark_thread *thread;
+    uint64_t rng;
+
+    thread = arg;
+    rng = thread->index + 1;
+
+    for (size_t i = 0; i < NB_OPS_PER_THREAD; i++) {
+        uint64_t r;
+        void *key;
+
+        r = benchmark_random(&rng);
+        key = C_INT32_TO_POINTER((r >> 8) % NB_ENTRIES);
+
+        if (r % 100 < WRITE_RATIO) {
+            if (c_concurrent_hash_table_insert(thread->ctable, key, key) == -1)
+                die("%s", c_get_error());
+        } else {
+            void *value;
+
+            if (c_concurrent_hash_table_get(thread->ctable, key, &value) == 0)
+                die("key not found");
+        }
+    }
+
+    return NULL;
+}
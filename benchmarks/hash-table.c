@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_BATCH_KEYS 256
+
+static void
+benchmark_lookups(size_t nb_entries, size_t nb_lookups) {
+    struct c_hash_table *table;
+    const void **keys;
+    void *values[NB_BATCH_KEYS];
+    uint64_t rng, start;
+    size_t nb_found;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+    if (!table)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        if (c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                C_INT32_TO_POINTER(i)) == -1) {
+            die("%s", c_get_error());
+        }
+    }
+
+    keys = c_calloc(nb_lookups, sizeof(void *));
+    if (!keys)
+        die("%s", c_get_error());
+
+    rng = 42;
+    for (size_t i = 0; i < nb_lookups; i++)
+        keys[i] = C_INT32_TO_POINTER(benchmark_random(&rng) % nb_entries);
+
+    printf("%zu entries, %zu lookups\n", nb_entries, nb_lookups);
+
+    /* Single key lookups */
+    nb_found = 0;
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_lookups; i++) {
+        void *value;
+
+        nb_found += (size_t)c_hash_table_get(table, keys[i], &value);
+    }
+    benchmark_report("c_hash_table_get", benchmark_now() - start, nb_lookups);
+
+    if (nb_found != nb_lookups)
+        die("%zu keys not found", nb_lookups - nb_found);
+
+    /* Single key lookups with precomputed hashes */
+    nb_found = 0;
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_lookups; i++) {
+        uint32_t hash;
+        void *value;
+
+        hash = c_hash_int32(keys[i]);
+        nb_found += (size_t)c_hash_table_get_with_hash(table, keys[i], hash,
+                                                       &value);
+    }
+    benchmark_report("c_hash_table_get_with_hash",
+                     benchmark_now() - start, nb_lookups);
+
+    /* Batch lookups */
+    nb_found = 0;
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_lookups; i += NB_BATCH_KEYS) {
+        size_t nb_keys;
+
+        nb_keys = nb_lookups - i;
+        if (nb_keys > NB_BATCH_KEYS)
+            nb_keys = NB_BATCH_KEYS;
+
+        nb_found += c_hash_table_get_many(table, keys + i, nb_keys,
+                                          values, NULL);
+    }
+    benchmark_report("c_hash_table_get_many", benchmark_now() - start,
+                     nb_lookups);
+
+    if (nb_found != nb_lookups)
+        die("%zu keys not found", nb_lookups - nb_found);
+
+    putchar('\n');
+
+    c_free(keys);
+    c_hash_table_delete(table);
+}
+
+static void
+benchmark_inserts(size_t nb_entries) {
+    struct c_hash_table *table;
+    uint64_t start;
+
+    printf("%zu insertions\n", nb_entries);
+
+    /* Growing from an empty table */
+    start = benchmark_now();
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+    if (!table)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        if (c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                C_INT32_TO_POINTER(i)) == -1) {
+            die("%s", c_get_error());
+        }
+    }
+
+    benchmark_report("c_hash_table_new", benchmark_now() - start, nb_entries);
+    c_hash_table_delete(table);
+
+    /* Pre-sized table */
+    start = benchmark_now();
+
+    table = c_hash_table_new_with_capacity(c_hash_int32, c_equal_int32,
+                                           nb_entries);
+    if (!table)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        if (c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                C_INT32_TO_POINTER(i)) == -1) {
+            die("%s", c_get_error());
+        }
+    }
+
+    benchmark_report("c_hash_table_new_with_capacity",
+                     benchmark_now() - start, nb_entries);
+    c_hash_table_delete(table);
+
+    putchar('\n');
+}
+
+int
+main(int argc, char **argv) {
+    size_t sizes[] = {1000, 100000, 1000000, 10000000};
+    size_t nb_lookups = 10000000;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        benchmark_inserts(sizes[i]);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        benchmark_lookups(sizes[i], nb_lookups);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+/* The hash functions used before the introduction of c_hash_memory() */
+static uint32_t
+djb2_hash_string(const void *key) {
+    const unsigned char *str;
+    uint32_t hash;
+
+    hash = 5381;
+    for (str = key; *str; str++)
+        hash = ((hash << 5) + hash) ^ *str;
+
+    return hash;
+}
+
+static uint32_t
+djb2_hash_int32(const void *key) {
+    int32_t integer;
+    unsigned char *bytes;
+    uint32_t hash;
+
+    integer = C_POINTER_TO_INT32(key);
+    bytes = (unsigned char *)&integer;
+
+    hash = 5381;
+    for (int i = 0; i < 4; i++)
+        hash = ((hash << 5) + hash) ^ bytes[i];
+
+    return hash;
+}
+
+static void
+benchmark_throughput(size_t len) {
+    char *str;
+    uint64_t start;
+    uint32_t sum;
+    size_t nb_ops;
+    char name[64];
+
+    str = c_malloc(len + 1);
+    if (!str)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < len; i++)
+        str[i] = (char)('a' + i % 26);
+    str[len] = '\0';
+
+    nb_ops = ((size_t)1 << 30) / (len + 16);
+
+    sum = 0;
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i++) {
+        str[0] = (char)('a' + i % 26);
+        sum += djb2_hash_string(str);
+    }
+    snprintf(name, sizeof(name), "djb2 %zu bytes", len);
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i++) {
+        str[0] = (char)('a' + i % 26);
+        sum += c_hash_string(str);
+    }
+    snprintf(name, sizeof(name), "c_hash_string %zu bytes", len);
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i++) {
+        str[0] = (char)('a' + i % 26);
+        sum += c_hash_memory(str, len);
+    }
+    snprintf(name, sizeof(name), "c_hash_memory %zu bytes", len);
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    /* Make sure the hash computations are not optimized out */
+    if (sum == 42)
+        putchar(' ');
+
+    c_free(str);
+}
+
+static void
+benchmark_chains(const char *name, c_hash_func hash_func,
+                 void **keys, size_t nb_keys) {
+    size_t *chains, nb_buckets, nb_used, max_length;
+
+    /* Simulate a chained table with one bucket per key, using a power of
+     * two number of buckets and hash % nb_buckets as bucket index. */
+    nb_buckets = 1;
+    while (nb_buckets < nb_keys)
+        nb_buckets *= 2;
+
+    chains = c_calloc(nb_buckets, sizeof(size_t));
+    if (!chains)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_keys; i++)
+        chains[hash_func(keys[i]) % nb_buckets]++;
+
+    nb_used = 0;
+    max_length = 0;
+    for (size_t i = 0; i < nb_buckets; i++) {
+        if (chains[i] > 0)
+            nb_used++;
+        if (chains[i] > max_length)
+            max_length = chains[i];
+    }
+
+    printf("%-32s %10zu buckets %10zu used %8.2f mean %8zu max\n",
+           name, nb_buckets, nb_used, (double)nb_keys / (double)nb_used,
+           max_length);
+
+    c_free(chains);
+}
+
+int
+main(int argc, char **argv) {
+    size_t lengths[] = {4, 8, 16, 32, 64, 256, 1024, 4096};
+    size_t nb_keys = 1000000;
+    void **keys;
+
+    /* Throughput */
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        benchmark_throughput(lengths[i]);
+        putchar('\n');
+    }
+
+    /* Chain lengths */
+    keys = c_calloc(nb_keys, sizeof(void *));
+    if (!keys)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_keys; i++) {
+        char tmp[128];
+
+        snprintf(tmp, sizeof(tmp),
+                 "https://www.example.com/api/v1/users/%zu/sessions?page=%zu",
+                 i / 16, i % 16);
+
+        keys[i] = c_strdup(tmp);
+        if (!keys[i])
+            die("%s", c_get_error());
+    }
+
+    benchmark_chains("djb2 url", djb2_hash_string, keys, nb_keys);
+    benchmark_chains("c_hash_string url", c_hash_string, keys, nb_keys);
+
+    for (size_t i = 0; i < nb_keys; i++)
+        c_free(keys[i]);
+
+    for (size_t i = 0; i < nb_keys; i++)
+        keys[i] = C_INT32_TO_POINTER(i);
+
+    benchmark_chains("djb2 int32", djb2_hash_int32, keys, nb_keys);
+    benchmark_chains("c_hash_int32 int32", c_hash_int32, keys, nb_keys);
+
+    c_free(keys);
+    return 0;
+}
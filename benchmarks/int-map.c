@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+static void
+benchmark_int64(size_t nb_entries, size_t nb_lookups) {
+    struct c_hash_table *table;
+    struct c_int64_map *map;
+    int64_t *keys, *lookup_keys;
+    uint64_t rng, start, sum;
+
+    /* Generic hash tables store pointers to keys */
+    keys = c_calloc(nb_entries, sizeof(int64_t));
+    if (!keys)
+        die("%s", c_get_error());
+
+    lookup_keys = c_calloc(nb_lookups, sizeof(int64_t));
+    if (!lookup_keys)
+        die("%s", c_get_error());
+
+    rng = 42;
+    for (size_t i = 0; i < nb_entries; i++)
+        keys[i] = (int64_t)(benchmark_random(&rng) >> 1);
+    for (size_t i = 0; i < nb_lookups; i++)
+        lookup_keys[i] = keys[benchmark_random(&rng) % nb_entries];
+
+    printf("%zu entries, %zu lookups\n", nb_entries, nb_lookups);
+
+    /* Generic hash table */
+    start = benchmark_now();
+
+    table = c_hash_table_new(c_hash_int64, c_equal_int64);
+    if (!table)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        if (c_hash_table_insert(table, keys + i, keys + i) == -1)
+            die("%s", c_get_error());
+    }
+
+    benchmark_report("c_hash_table_insert", benchmark_now() - start,
+                     nb_entries);
+
+    sum = 0;
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_lookups; i++) {
+        void *value;
+
+        if (c_hash_table_get(table, lookup_keys + i, &value) == 1)
+            sum += (uint64_t)*(int64_t *)value;
+    }
+    benchmark_report("c_hash_table_get", benchmark_now() - start, nb_lookups);
+
+    c_hash_table_delete(table);
+
+    /* Integer map */
+    start = benchmark_now();
+
+    map = c_int64_map_new(sizeof(int64_t));
+    if (!map)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        if (c_int64_map_insert(map, keys[i], keys + i) == -1)
+            die("%s", c_get_error());
+    }
+
+    benchmark_report("c_int64_map_insert", benchmark_now() - start,
+                     nb_entries);
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_lookups; i++) {
+        int64_t *value;
+
+        value = c_int64_map_get(map, lookup_keys[i]);
+        if (value)
+            sum -= (uint64_t)*value;
+    }
+    benchmark_report("c_int64_map_get", benchmark_now() - start, nb_lookups);
+
+    if (sum != 0)
+        die("inconsistent lookup results");
+
+    c_int64_map_delete(map);
+
+    putchar('\n');
+
+    c_free(lookup_keys);
+    c_free(keys);
+}
+
+int
+main(int argc, char **argv) {
+    size_t sizes[] = {1000, 100000, 1000000, 10000000};
+    size_t nb_lookups = 10000000;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        benchmark_int64(sizes[i], nb_lookups);
+
+    return 0;
+}
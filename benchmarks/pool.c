@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_QUEUED_VALUES 100
+
+static void
+benchmark_queue(const char *name, const struct c_allocator *allocator,
+                size_t nb_ops) {
+    struct c_queue *queue;
+    uint64_t start;
+
+    queue = c_queue_new_with_allocator(allocator);
+    if (!queue)
+        die("%s", c_get_error());
+
+    start = benchmark_now();
+    for (size_t i = 0; i < nb_ops; i += NB_QUEUED_VALUES) {
+        for (size_t j = 0; j < NB_QUEUED_VALUES; j++) {
+            if (c_queue_push(queue, C_INT32_TO_POINTER(j)) == -1)
+                die("%s", c_get_error());
+        }
+
+        for (size_t j = 0; j < NB_QUEUED_VALUES; j++)
+            c_queue_pop(queue);
+    }
+
+    benchmark_report(name, benchmark_now() - start, nb_ops);
+
+    c_queue_delete(queue);
+}
+
+int
+main(int argc, char **argv) {
+    struct c_allocator allocator;
+    struct c_pool *pool, *concurrent_pool;
+    size_t nb_ops = 10000000;
+
+    pool = c_pool_new(c_queue_entry_size());
+    if (!pool)
+        die("%s", c_get_error());
+
+    concurrent_pool = c_pool_new_concurrent(c_queue_entry_size());
+    if (!concurrent_pool)
+        die("%s", c_get_error());
+
+    printf("%zu queue push/pop operations\n", nb_ops);
+
+    benchmark_queue("malloc", NULL, nb_ops);
+
+    c_pool_init_allocator(pool, &allocator);
+    benchmark_queue("pool", &allocator, nb_ops);
+
+    c_pool_init_allocator(concurrent_pool, &allocator);
+    benchmark_queue("concurrent pool", &allocator, nb_ops);
+
+    c_pool_delete(concurrent_pool);
+    c_pool_delete(pool);
+
+    return 0;
+}
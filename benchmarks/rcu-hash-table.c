@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_ENTRIES          100000
+#define NB_OPS_PER_THREAD   1000000
+#define MAX_NB_THREADS      64
+
+/* Interval between two updates performed by the writer thread. */
+#define UPDATE_INTERVAL     100000 /* nanoseconds */
+
+struct benchmark_thread {
+    size_t index;
+
+    struct c_concurrent_hash_table *ctable;
+    struct c_rcu_hash_table *rtable;
+
+    bool stop;
+};
+
+static void benchmark_run(const char *, struct c_concurrent_hash_table *,
+                          struct c_rcu_hash_table *, size_t);
+static void *benchmark_writer_main(void *);
+static void *benchmark_concurrent_main(void *);
+static void *benchmark_rcu_main(void *);
+
+int
+main(int argc, char **argv) {
+    struct c_concurrent_hash_table *ctable;
+    struct c_rcu_hash_table *rtable;
+
+    ctable = c_concurrent_hash_table_new(c_hash_int32, c_equal_int32, 0);
+    if (!ctable)
+        die("%s", c_get_error());
+
+    rtable = c_rcu_hash_table_new(c_hash_int32, c_equal_int32);
+    if (!rtable)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < NB_ENTRIES; i++) {
+        void *key;
+
+        key = C_INT32_TO_POINTER(i);
+
+        if (c_concurrent_hash_table_insert(ctable, key, key) == -1)
+            die("%s", c_get_error());
+        if (c_rcu_hash_table_insert(rtable, key, key) == -1)
+            die("%s", c_get_error());
+    }
+
+    printf("%d entries, %d lookups per thread, one update every %d us\n\n",
+           NB_ENTRIES, NB_OPS_PER_THREAD, UPDATE_INTERVAL / 1000);
+
+    for (size_t nb_threads = 1; nb_threads <= MAX_NB_THREADS; nb_threads *= 2) {
+        printf("%zu reader threads\n", nb_threads);
+
+        benchmark_run("c_concurrent_hash_table", ctable, NULL, nb_threads);
+        benchmark_run("c_rcu_hash_table", NULL, rtable, nb_threads);
+
+        putchar('\n');
+    }
+
+    c_rcu_hash_table_delete(rtable);
+    c_concurrent_hash_table_delete(ctable);
+    return 0;
+}
+
+static void
+benchmark_run(const char *name, struct c_concurrent_hash_table *ctable,
+              struct c_rcu_hash_table *rtable, size_t nb_threads) {
+    struct benchmark_thread threads[MAX_NB_THREADS];
+    pthread_t thread_ids[MAX_NB_THREADS];
+    struct benchmark_thread writer;
+    pthread_t writer_id;
+    void *(*thread_main)(void *);
+    uint64_t start, duration;
+
+    thread_main = ctable ? benchmark_concurrent_main : benchmark_rcu_main;
+
+    memset(&writer, 0, sizeof(struct benchmark_thread));
+    writer.ctable = ctable;
+    writer.rtable = rtable;
+
+    if (pthread_create(&writer_id, NULL, benchmark_writer_main, &writer) != 0)
+        die("cannot create thread");
+
+    start = benchmark_now();
+
+    for (size_t i = 0; i < nb_threads; i++) {
+        memset(&threads[i], 0, sizeof(struct benchmark_thread));
+        threads[i].index = i;
+        threads[i].ctable = ctable;
+        threads[i].rtable = rtable;
+
+        if (pthread_create(&thread_ids[i], NULL, thread_main,
+                           &threads[i]) != 0) {
+            die("cannot create thread");
+        }
+    }
+
+    for (size_t i = 0; i < nb_threads; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    duration = benchmark_now() - start;
+
+    __atomic_store_n(&writer.stop, true, __ATOMIC_RELAXED);
+    pthread_join(writer_id, NULL);
+
+    benchmark_report(name, duration, nb_threads * NB_OPS_PER_THREAD);
+}
+
+static void *
+benchmark_writer_main(void *arg) {
+    struct benchmark_thread *thread;
+    struct timespec interval;
+    uint64_t rng;
+
+    thread = arg;
+    rng = 42;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = UPDATE_INTERVAL;
+
+    while (!__atomic_load_n(&thread->stop, __ATOMIC_RELAXED)) {
+        void *key;
+
+        key = C_INT32_TO_POINTER(benchmark_random(&rng) % NB_ENTRIES);
+
+        if (thread->ctable) {
+            if (c_concurrent_hash_table_insert(thread->ctable, key, key) == -1)
+                die("%s", c_get_error());
+        } else {
+            if (c_rcu_hash_table_insert(thread->rtable, key, key) == -1)
+                die("%s", c_get_error());
+        }
+
+        nanosleep(&interval, NULL);
+    }
+
+    return NULL;
+}
+
+static void *
+benchmark_concurrent_main(void *arg) {
+    struct benchmark_thread *thread;
+    uint64_t rng;
+
+    thread = arg;
+    rng = thread->index + 1;
+
+    for (size_t i = 0; i < NB_OPS_PER_THREAD; i++) {
+        void *key, *value;
+
+        key = C_INT32_TO_POINTER(benchmark_random(&rng) % NB_ENTRIES);
+
+        if (c_concurrent_hash_table_get(thread->ctable, key, &value) == 0)
+            die("key not found");
+    }
+
+    return NULL;
+}
+
+static void *
+benchmark_rcu_main(void *arg) {
+    struct c_rcu_hash_table_reader *reader;
+    struct benchmark_thread *thread;
+    uint64_t rng;
+
+    thread = arg;
+    rng = thread->index + 1;
+
+    reader = c_rcu_hash_table_register_reader(thread->rtable);
+    if (!reader)
+        die("%s", c_get_error());
+
+    for (size_t i = 0; i < NB_OPS_PER_THREAD; i++) {
+        void *key, *value;
+
+        key = C_INT32_TO_POINTER(benchmark_random(&rng) % NB_ENTRIES);
+
+        if (c_rcu_hash_table_get(reader, key, &value) == 0)
+            die("key not found");
+    }
+
+    c_rcu_hash_table_unregister_reader(reader);
+    return NULL;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define NB_OPS         10000000
+#define BUFFER_SIZE    ((size_t)256 * 1024)
+#define MAX_CHUNK_SIZE ((size_t)16 * 1024)
+#define MAX_BACKLOG    ((size_t)64 * 1024)
+
+/* Each operation simulates a read of up to 16KB on a connection followed
+ * by the processing of all complete messages, leaving an incomplete
+ * message of up to 64KB in the buffer. */
+
+static char chunk[MAX_CHUNK_SIZE];
+
+static void
+benchmark_buffer(void) {
+    struct c_buffer *buf;
+    uint64_t rng, start;
+
+    buf = c_buffer_new();
+    if (!buf)
+        die("%s", c_get_error());
+
+    if (c_buffer_reserve_capacity(buf, BUFFER_SIZE) == -1)
+        die("%s", c_get_error());
+
+    rng = 42;
+
+    start = benchmark_now();
+    for (size_t i = 0; i < NB_OPS; i++) {
+        size_t chunk_sz, backlog;
+        uint64_t r;
+
+        r = benchmark_random(&rng);
+        chunk_sz = 1 + (size_t)(r % MAX_CHUNK_SIZE);
+        backlog = (size_t)((r >> 32) % MAX_BACKLOG);
+
+        if (c_buffer_add(buf, chunk, chunk_sz) == -1)
+            die("%s", c_get_error());
+
+        if (c_buffer_length(buf) > backlog)
+            c_buffer_skip(buf, c_buffer_length(buf) - backlog);
+    }
+
+    benchmark_report("buffer", benchmark_now() - start, NB_OPS);
+
+    c_buffer_delete(buf);
+}
+
+static void
+benchmark_ring_buffer(void) {
+    struct c_ring_buffer *buf;
+    uint64_t rng, start;
+
+    buf = c_ring_buffer_new(BUFFER_SIZE);
+    if (!buf)
+        die("%s", c_get_error());
+
+    rng = 42;
+
+    start = benchmark_now();
+    for (size_t i = 0; i < NB_OPS; i++) {
+        size_t chunk_sz, backlog;
+        uint64_t r;
+
+        r = benchmark_random(&rng);
+        chunk_sz = 1 + (size_t)(r % MAX_CHUNK_SIZE);
+        backlog = (size_t)((r >> 32) % MAX_BACKLOG);
+
+        if (c_ring_buffer_add(buf, chunk, chunk_sz) == -1)
+            die("%s", c_get_error());
+
+        if (c_ring_buffer_length(buf) > backlog)
+            c_ring_buffer_skip(buf, c_ring_buffer_length(buf) - backlog);
+    }
+
+    benchmark_report("ring buffer", benchmark_now() - start, NB_OPS);
+
+    c_ring_buffer_delete(buf);
+}
+
+int
+main(int argc, char **argv) {
+    memset(chunk, 'a', sizeof(chunk));
+
+    benchmark_buffer();
+    benchmark_ring_buffer();
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <sys/socket.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../src/internal.h"
+
+#include "benchmark.h"
+
+#define FILE_SIZE   ((size_t)256 * 1024 * 1024)
+#define CHUNK_SIZE  ((size_t)64 * 1024)
+
+static void *reader_main(void *);
+static int create_file(void);
+static void run(const char *, void (*)(int, int), int);
+
+static void
+transfer_buffered(int out_fd, int in_fd) {
+    struct c_buffer *buf;
+
+    buf = c_buffer_new();
+    if (!buf)
+        die("%s", c_get_error());
+
+    for (;;) {
+        ssize_t ret;
+
+        ret = c_buffer_read(buf, in_fd, CHUNK_SIZE);
+        if (ret == -1)
+            die("cannot read file: %s", c_get_error());
+        if (ret == 0)
+            break;
+
+        while (c_buffer_length(buf) > 0) {
+            if (c_buffer_write(buf, out_fd) == -1)
+                die("cannot write socket: %s", c_get_error());
+        }
+    }
+
+    c_buffer_delete(buf);
+}
+
+static void
+transfer_zero_copy(int out_fd, int in_fd) {
+    for (;;) {
+        ssize_t ret;
+
+        ret = c_transfer(out_fd, in_fd, NULL, CHUNK_SIZE);
+        if (ret == -1)
+            die("cannot transfer data: %s", c_get_error());
+        if (ret == 0)
+            break;
+    }
+}
+
+int
+main(int argc, char **argv) {
+    int fd;
+
+    fd = create_file();
+
+    printf("transferring %zu MB in chunks of %zu KB\n",
+           FILE_SIZE / (1024 * 1024), CHUNK_SIZE / 1024);
+
+    run("buffered", transfer_buffered, fd);
+    run("c_transfer", transfer_zero_copy, fd);
+
+    close(fd);
+    return 0;
+}
+
+static void *
+reader_main(void *arg) {
+    static char buf[CHUNK_SIZE];
+    int fd;
+
+    fd = *(int *)arg;
+
+    for (;;) {
+        ssize_t ret;
+
+        ret = read(fd, buf, sizeof(buf));
+        if (ret == -1)
+            die("cannot read socket: %s", strerror(errno));
+        if (ret == 0)
+            break;
+    }
+
+    return NULL;
+}
+
+static int
+create_file(void) {
+    char path[] = "/tmp/libcore-benchmark-XXXXXX";
+    char *chunk;
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd == -1)
+        die("cannot create file: %s", strerror(errno));
+    unlink(path);
+
+    chunk = c_malloc(CHUNK_SIZE);
+    if (!chunk)
+        die("%s", c_get_error());
+    memset(chunk, 'a', CHUNK_SIZE);
+
+    for (size_t i = 0; i < FILE_SIZE / CHUNK_SIZE; i++) {
+        if (write(fd, chunk, CHUNK_SIZE) != (ssize_t)CHUNK_SIZE)
+            die("cannot write file: %s", strerror(errno));
+    }
+
+    c_free(chunk);
+    return fd;
+}
+
+static void
+run(const char *name, void (*func)(int, int), int fd) {
+    pthread_t thread;
+    uint64_t start, duration;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        die("cannot create sockets: %s", strerror(errno));
+
+    if (pthread_create(&thread, NULL, reader_main, &fds[1]) != 0)
+        die("cannot create thread");
+
+    if (lseek(fd, 0, SEEK_SET) == -1)
+        die("cannot seek file: %s", strerror(errno));
+
+    start = benchmark_now();
+    func(fds[0], fd);
+    close(fds[0]);
+    pthread_join(thread, NULL);
+    duration = benchmark_now() - start;
+
+    benchmark_report(name, duration, FILE_SIZE / CHUNK_SIZE);
+    printf("%-32s %10.1f MB/s\n", "",
+           (double)FILE_SIZE / (1024 * 1024) / ((double)duration / 1e9));
+
+    close(fds[1]);
+}
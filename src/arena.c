@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+
+/*
+ * An arena allocates memory in large chunks, each allocation simply moving
+ * forward the offset of the first free byte of the current chunk. Memory is
+ * never released individually: the whole arena is cleared at once, or
+ * rewound to a previously recorded position.
+ *
+ * Chunks are linked from the oldest to the newest one. Chunks following the
+ * current chunk are free: they were used before the arena was cleared or
+ * rewound, and are reused before any new chunk is allocated.
+ *
+ * Allocations larger than the chunk size get a chunk of their own. These
+ * chunks are released when the arena is cleared, so that a single large
+ * allocation does not increase the memory usage of the arena forever.
+ */
+
+#define C_ARENA_CHUNK_HEADER_SZ \
+    ((sizeof(struct c_arena_chunk) + C_ARENA_DEFAULT_ALIGNMENT - 1) \
+     & ~(C_ARENA_DEFAULT_ALIGNMENT - 1))
+
+struct c_arena_chunk {
+    struct c_arena_chunk *next;
+    size_t size;
+    size_t used;
+};
+
+struct c_arena {
+    struct c_arena_chunk *chunks;
+    struct c_arena_chunk *current;
+
+    size_t chunk_sz;
+};
+
+static void *c_arena_chunk_alloc(struct c_arena_chunk *, size_t, size_t);
+static struct c_arena_chunk *c_arena_next_chunk(struct c_arena *, size_t,
+                                                size_t);
+static struct c_arena_chunk *c_arena_chunk_new(size_t);
+
+static void *c_arena_allocator_malloc(void *, size_t);
+static void c_arena_allocator_free(void *, void *, size_t);
+static void *c_arena_allocator_realloc(void *, void *, size_t, size_t);
+static void *c_arena_allocator_aligned_alloc(void *, size_t, size_t);
+
+struct c_arena *
+c_arena_new(size_t chunk_sz) {
+    struct c_arena *arena;
+
+    if (chunk_sz == 0)
+        chunk_sz = C_ARENA_DEFAULT_CHUNK_SIZE;
+
+    if (chunk_sz <= C_ARENA_CHUNK_HEADER_SZ) {
+        c_set_error("chunk size too small");
+        return NULL;
+    }
+
+    arena = c_malloc0(sizeof(struct c_arena));
+    if (!arena) {
+        c_set_error("cannot allocate arena: %m");
+        return NULL;
+    }
+
+    arena->chunk_sz = chunk_sz;
+
+    return arena;
+}
+
+void
+c_arena_delete(struct c_arena *arena) {
+    if (!arena)
+        return;
+
+    c_arena_reset(arena);
+
+    c_free0(arena, sizeof(struct c_arena));
+}
+
+void
+c_arena_clear(struct c_arena *arena) {
+    struct c_arena_chunk **pchunk;
+
+    /* Release chunks which were allocated for large allocations */
+    pchunk = &arena->chunks;
+    while (*pchunk) {
+        struct c_arena_chunk *chunk;
+
+        chunk = *pchunk;
+
+        if (chunk->size > arena->chunk_sz) {
+            *pchunk = chunk->next;
+            c_free(chunk);
+        } else {
+            chunk->used = C_ARENA_CHUNK_HEADER_SZ;
+            pchunk = &chunk->next;
+        }
+    }
+
+    arena->current = arena->chunks;
+}
+
+void
+c_arena_reset(struct c_arena *arena) {
+    struct c_arena_chunk *chunk;
+
+    chunk = arena->chunks;
+    while (chunk) {
+        struct c_arena_chunk *next;
+
+        next = chunk->next;
+        c_free(chunk);
+        chunk = next;
+    }
+
+    arena->chunks = NULL;
+    arena->current = NULL;
+}
+
+void *
+c_arena_alloc(struct c_arena *arena, size_t sz) {
+    return c_arena_alloc_aligned(arena, sz, C_ARENA_DEFAULT_ALIGNMENT);
+}
+
+void *
+c_arena_alloc_aligned(struct c_arena *arena, size_t sz, size_t alignment) {
+    struct c_arena_chunk *chunk;
+    void *ptr;
+
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (arena->current) {
+        ptr = c_arena_chunk_alloc(arena->current, sz, alignment);
+        if (ptr)
+            return ptr;
+    }
+
+    chunk = c_arena_next_chunk(arena, sz, alignment);
+    if (!chunk)
+        return NULL;
+
+    ptr = c_arena_chunk_alloc(chunk, sz, alignment);
+    assert(ptr);
+
+    return ptr;
+}
+
+void *
+c_arena_calloc(struct c_arena *arena, size_t nb, size_t sz) {
+    void *ptr;
+
+    if (sz > 0 && nb > SIZE_MAX / sz) {
+        c_set_error("cannot allocate %zux%zu bytes: size too large", nb, sz);
+        return NULL;
+    }
+
+    ptr = c_arena_alloc(arena, nb * sz);
+    if (!ptr)
+        return NULL;
+
+    memset(ptr, 0, nb * sz);
+    return ptr;
+}
+
+void *
+c_arena_realloc(struct c_arena *arena, void *ptr,
+                size_t old_sz, size_t sz) {
+    struct c_arena_chunk *chunk;
+    void *nptr;
+
+    if (!ptr)
+        return c_arena_alloc(arena, sz);
+
+    /* The last allocation of the current chunk can be resized in place */
+    chunk = arena->current;
+    if (chunk && (uint8_t *)ptr + old_sz == (uint8_t *)chunk + chunk->used) {
+        size_t offset;
+
+        offset = (size_t)((uint8_t *)ptr - (uint8_t *)chunk);
+
+        if (sz <= chunk->size - offset) {
+            chunk->used = offset + sz;
+            return ptr;
+        }
+    }
+
+    if (sz <= old_sz)
+        return ptr;
+
+    nptr = c_arena_alloc(arena, sz);
+    if (!nptr)
+        return NULL;
+
+    memcpy(nptr, ptr, old_sz);
+    return nptr;
+}
+
+char *
+c_arena_strdup(struct c_arena *arena, const char *str) {
+    return c_arena_strndup(arena, str, strlen(str));
+}
+
+char *
+c_arena_strndup(struct c_arena *arena, const char *str, size_t len) {
+    char *nstr;
+
+    nstr = c_arena_alloc_aligned(arena, len + 1, 1);
+    if (!nstr)
+        return NULL;
+
+    memcpy(nstr, str, len);
+    nstr[len] = '\0';
+
+    return nstr;
+}
+
+void *
+c_arena_memdup(struct c_arena *arena, const void *ptr, size_t sz) {
+    void *nptr;
+
+    nptr = c_arena_alloc(arena, sz);
+    if (!nptr)
+        return NULL;
+
+    memcpy(nptr, ptr, sz);
+    return nptr;
+}
+
+void
+c_arena_mark(const struct c_arena *arena, struct c_arena_mark *mark) {
+    mark->chunk = arena->current;
+    mark->used = arena->current ? arena->current->used : 0;
+}
+
+void
+c_arena_rewind(struct c_arena *arena, const struct c_arena_mark *mark) {
+    if (!mark->chunk) {
+        /* The arena was empty when the mark was recorded */
+        arena->current = arena->chunks;
+        if (arena->current)
+            arena->current->used = C_ARENA_CHUNK_HEADER_SZ;
+
+        return;
+    }
+
+    arena->current = mark->chunk;
+    arena->current->used = mark->used;
+}
+
+void
+c_arena_stats(const struct c_arena *arena, struct c_arena_stats *stats) {
+    const struct c_arena_chunk *chunk;
+    bool free_chunk;
+
+    memset(stats, 0, sizeof(struct c_arena_stats));
+
+    stats->memory_size = sizeof(struct c_arena);
+
+    free_chunk = false;
+
+    for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+        stats->nb_chunks++;
+        stats->memory_size += chunk->size;
+
+        if (!free_chunk)
+            stats->used_size += chunk->used - C_ARENA_CHUNK_HEADER_SZ;
+
+        if (chunk == arena->current)
+            free_chunk = true;
+    }
+}
+
+void
+c_arena_init_allocator(struct c_arena *arena, struct c_allocator *allocator) {
+    allocator->malloc = c_arena_allocator_malloc;
+    allocator->free = c_arena_allocator_free;
+    allocator->realloc = c_arena_allocator_realloc;
+    allocator->aligned_alloc = c_arena_allocator_aligned_alloc;
+    allocator->aligned_free = c_arena_allocator_free;
+
+    allocator->data = arena;
+}
+
+static void *
+c_arena_chunk_alloc(struct c_arena_chunk *chunk, size_t sz,
+                    size_t alignment) {
+    uintptr_t start, ptr;
+    size_t offset;
+
+    start = (uintptr_t)chunk;
+
+    ptr = (start + chunk->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    offset = (size_t)(ptr - start);
+
+    if (offset > chunk->size || sz > chunk->size - offset)
+        return NULL;
+
+    chunk->used = offset + sz;
+
+    return (void *)ptr;
+}
+
+static struct c_arena_chunk *
+c_arena_next_chunk(struct c_arena *arena, size_t sz, size_t alignment) {
+    struct c_arena_chunk *chunk, *next;
+    size_t chunk_sz;
+
+    if (sz > SIZE_MAX - C_ARENA_CHUNK_HEADER_SZ - alignment) {
+        c_set_error("cannot allocate %zu bytes: size too large", sz);
+        return NULL;
+    }
+
+    /* Reuse the next free chunk if the allocation fits in it */
+    next = arena->current ? arena->current->next : arena->chunks;
+    if (next) {
+        next->used = C_ARENA_CHUNK_HEADER_SZ;
+
+        if (c_arena_chunk_alloc(next, sz, alignment)) {
+            next->used = C_ARENA_CHUNK_HEADER_SZ;
+            arena->current = next;
+            return next;
+        }
+
+        next->used = C_ARENA_CHUNK_HEADER_SZ;
+    }
+
+    chunk_sz = C_ARENA_CHUNK_HEADER_SZ + sz + alignment;
+    if (chunk_sz < arena->chunk_sz)
+        chunk_sz = arena->chunk_sz;
+
+    chunk = c_arena_chunk_new(chunk_sz);
+    if (!chunk)
+        return NULL;
+
+    /* Insert the chunk right after the current one */
+    if (arena->current) {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    } else {
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    arena->current = chunk;
+    return chunk;
+}
+
+static struct c_arena_chunk *
+c_arena_chunk_new(size_t sz) {
+    struct c_arena_chunk *chunk;
+
+    chunk = c_malloc(sz);
+    if (!chunk) {
+        c_set_error("cannot allocate chunk: %m");
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    chunk->size = sz;
+    chunk->used = C_ARENA_CHUNK_HEADER_SZ;
+
+    return chunk;
+}
+
+static void *
+c_arena_allocator_malloc(void *arena, size_t sz) {
+    return c_arena_alloc(arena, sz);
+}
+
+static void
+c_arena_allocator_free(void *arena, void *ptr, size_t sz) {
+    /* Memory is released when the arena is cleared */
+}
+
+static void *
+c_arena_allocator_realloc(void *arena, void *ptr, size_t old_sz, size_t sz) {
+    return c_arena_realloc(arena, ptr, old_sz, sz);
+}
+
+static void *
+c_arena_allocator_aligned_alloc(void *arena, size_t alignment, size_t sz) {
+    return c_arena_alloc_aligned(arena, sz, alignment);
+}
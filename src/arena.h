@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_ARENA_H
+#define LIBCORE_ARENA_H
+
+#include <stdlib.h>
+
+#define C_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define C_ARENA_DEFAULT_ALIGNMENT  (2 * sizeof(void *))
+
+/* The content of this structure is private. Its definition is public so that
+ * marks can be allocated by the caller. */
+struct c_arena_mark {
+    struct c_arena_chunk *chunk;
+    size_t used;
+};
+
+struct c_arena_stats {
+    size_t nb_chunks;
+    size_t memory_size;
+    size_t used_size;
+};
+
+struct c_arena *c_arena_new(size_t);
+void c_arena_delete(struct c_arena *);
+
+void c_arena_clear(struct c_arena *);
+void c_arena_reset(struct c_arena *);
+
+void *c_arena_alloc(struct c_arena *, size_t);
+void *c_arena_alloc_aligned(struct c_arena *, size_t, size_t);
+void *c_arena_calloc(struct c_arena *, size_t, size_t);
+void *c_arena_realloc(struct c_arena *, void *, size_t, size_t);
+
+char *c_arena_strdup(struct c_arena *, const char *);
+char *c_arena_strndup(struct c_arena *, const char *, size_t);
+void *c_arena_memdup(struct c_arena *, const void *, size_t);
+
+void c_arena_mark(const struct c_arena *, struct c_arena_mark *);
+void c_arena_rewind(struct c_arena *, const struct c_arena_mark *);
+
+void c_arena_stats(const struct c_arena *, struct c_arena_stats *);
+
+void c_arena_init_allocator(struct c_arena *, struct c_allocator *);
+
+#endif
@@ -18,9 +18,11 @@
 
 #include "internal.h"
 
+#define C_BUFFER_DEFAULT_GROWTH_FACTOR 2.0
+
 static void c_buffer_repack(struct c_buffer *);
 static int c_buffer_resize(struct c_buffer *, size_t);
-static int c_buffer_grow(struct c_buffer *, size_t);
+static size_t c_buffer_next_size(const struct c_buffer *, size_t);
 static int c_buffer_ensure_free_space(struct c_buffer *, size_t);
 
 /*
@@ -40,16 +42,31 @@ struct c_buffer {
     size_t sz;
     size_t skip;
     size_t len;
+
+    const struct c_allocator *allocator;
+    size_t alignment; /* 0 if data are not aligned */
+
+    double growth_factor;
+    size_t max_growth; /* 0 if unlimited */
 };
 
 struct c_buffer *
 c_buffer_new(void) {
+    return c_buffer_new_with_allocator(NULL);
+}
+
+struct c_buffer *
+c_buffer_new_with_allocator(const struct c_allocator *allocator) {
     struct c_buffer *buf;
 
-    buf = c_malloc0(sizeof(struct c_buffer));
+    buf = c_allocator_malloc0(allocator, sizeof(struct c_buffer));
     if (!buf)
         return NULL;
 
+    buf->allocator = allocator;
+
+    buf->growth_factor = C_BUFFER_DEFAULT_GROWTH_FACTOR;
+
     return buf;
 }
 
@@ -58,10 +75,77 @@ c_buffer_delete(struct c_buffer *buf) {
     if (!buf)
         return;
 
-    c_free(buf->data);
+    c_allocator_aligned_free(buf->allocator, buf->alignment,
+                             buf->data, buf->sz);
     buf->data = NULL;
 
-    c_free(buf);
+    c_allocator_free(buf->allocator, buf, sizeof(struct c_buffer));
+}
+
+int
+c_buffer_set_alignment(struct c_buffer *buf, size_t alignment) {
+    char *data;
+
+    if ((alignment & (alignment - 1)) != 0) {
+        c_set_error("invalid alignment %zu", alignment);
+        return -1;
+    }
+
+    if (alignment == buf->alignment)
+        return 0;
+
+    if (buf->data) {
+        data = c_allocator_aligned_alloc(buf->allocator, alignment, buf->sz);
+        if (!data)
+            return -1;
+
+        memcpy(data, buf->data + buf->skip, buf->len);
+
+        c_allocator_aligned_free(buf->allocator, buf->alignment,
+                                 buf->data, buf->sz);
+        buf->data = data;
+        buf->skip = 0;
+    }
+
+    buf->alignment = alignment;
+    return 0;
+}
+
+int
+c_buffer_set_growth_policy(struct c_buffer *buf, double factor,
+                           size_t max_growth) {
+    if (!(factor > 1.0)) {
+        c_set_error("invalid growth factor");
+        return -1;
+    }
+
+    buf->growth_factor = factor;
+    buf->max_growth = max_growth;
+
+    return 0;
+}
+
+int
+c_buffer_reserve_capacity(struct c_buffer *buf, size_t capacity) {
+    if (capacity <= buf->sz)
+        return 0;
+
+    return c_buffer_resize(buf, capacity);
+}
+
+int
+c_buffer_shrink_to_fit(struct c_buffer *buf) {
+    if (buf->len == 0) {
+        c_buffer_reset(buf);
+        return 0;
+    }
+
+    c_buffer_repack(buf);
+
+    if (buf->len == buf->sz)
+        return 0;
+
+    return c_buffer_resize(buf, buf->len);
 }
 
 void *
@@ -86,7 +170,8 @@ c_buffer_free_space(const struct c_buffer *buf) {
 
 void
 c_buffer_reset(struct c_buffer *buf) {
-    c_free(buf->data);
+    c_allocator_aligned_free(buf->allocator, buf->alignment,
+                             buf->data, buf->sz);
     buf->data = NULL;
 
     buf->sz = 0;
@@ -134,7 +219,6 @@ int
 c_buffer_insert(struct c_buffer *buf, size_t offset, const void *data,
                  size_t sz) {
     char *ndata;
-    size_t nsz;
 
     if (sz == 0)
         return 0;
@@ -144,29 +228,8 @@ c_buffer_insert(struct c_buffer *buf, size_t offset, const void *data,
         return -1;
     }
 
-    if (!buf->data) {
-        nsz = sz;
-        if (nsz < C_BUFFER_MIN_SIZE)
-            nsz = C_BUFFER_MIN_SIZE;
-
-        buf->sz = nsz;
-        buf->data = c_malloc(buf->sz);
-        if (!buf->data)
-            return -1;
-    } else if (c_buffer_free_space(buf) < sz) {
-        c_buffer_repack(buf);
-
-        if (c_buffer_free_space(buf) < sz) {
-            if (sz > buf->sz) {
-                nsz = buf->sz + sz;
-            } else {
-                nsz = buf->sz * 2;
-            }
-
-            if (c_buffer_resize(buf, nsz) == -1)
-                return -1;
-        }
-    }
+    if (c_buffer_ensure_free_space(buf, sz) == -1)
+        return -1;
 
     ndata = buf->data + buf->skip + offset;
 
@@ -209,7 +272,8 @@ c_buffer_add_vprintf(struct c_buffer *buf, const char *fmt, va_list ap) {
 
     /* We need to make space for \0 because vsnprintf() needs it, even
      * though we will ignore it. */
-    c_buffer_ensure_free_space(buf, fmt_len + 1);
+    if (c_buffer_ensure_free_space(buf, fmt_len + 1) == -1)
+        return -1;
 
     for (;;) {
         int ret;
@@ -232,7 +296,8 @@ c_buffer_add_vprintf(struct c_buffer *buf, const char *fmt, va_list ap) {
             return 0;
         }
 
-        c_buffer_ensure_free_space(buf, (size_t)ret + 1);
+        if (c_buffer_ensure_free_space(buf, (size_t)ret + 1) == -1)
+            return -1;
     }
 }
 
@@ -326,9 +391,20 @@ c_buffer_extract(struct c_buffer *buf, size_t *plen) {
 
     c_buffer_repack(buf);
 
-    data = c_realloc(buf->data, buf->len);
-    if (!data)
-        return NULL;
+    if (buf->allocator || buf->alignment > 0) {
+        /* The caller will release the data with c_free() */
+        data = c_malloc(buf->len);
+        if (!data)
+            return NULL;
+
+        memcpy(data, buf->data, buf->len);
+        c_allocator_aligned_free(buf->allocator, buf->alignment,
+                                 buf->data, buf->sz);
+    } else {
+        data = c_realloc(buf->data, buf->len);
+        if (!data)
+            return NULL;
+    }
 
     if (plen)
         *plen = buf->len;
@@ -442,9 +518,11 @@ c_buffer_resize(struct c_buffer *buf, size_t sz) {
     char *ndata;
 
     if (buf->data) {
-        ndata = c_realloc(buf->data, sz);
+        ndata = c_allocator_aligned_realloc(buf->allocator, buf->alignment,
+                                            buf->data, buf->sz, sz);
     } else {
-        ndata = c_malloc(sz);
+        ndata = c_allocator_aligned_alloc(buf->allocator, buf->alignment,
+                                          sz);
     }
 
     if (!ndata)
@@ -455,18 +533,44 @@ c_buffer_resize(struct c_buffer *buf, size_t sz) {
     return 0;
 }
 
-static int
-c_buffer_grow(struct c_buffer *buf, size_t sz) {
-    return c_buffer_resize(buf, buf->sz + sz);
+static size_t
+c_buffer_next_size(const struct c_buffer *buf, size_t min_sz) {
+    size_t sz, growth;
+    double fgrowth;
+
+    /* The size grows geometrically so that appending n bytes costs O(n)
+     * copies in total; the increment can be capped to limit the memory
+     * wasted by very large buffers. */
+    fgrowth = (double)buf->sz * (buf->growth_factor - 1.0);
+    growth = (fgrowth >= (double)SIZE_MAX) ? SIZE_MAX : (size_t)fgrowth;
+
+    if (buf->max_growth > 0 && growth > buf->max_growth)
+        growth = buf->max_growth;
+
+    sz = (growth > SIZE_MAX - buf->sz) ? SIZE_MAX : buf->sz + growth;
+
+    if (sz < min_sz)
+        sz = min_sz;
+    if (sz < C_BUFFER_MIN_SIZE)
+        sz = C_BUFFER_MIN_SIZE;
+
+    return sz;
 }
 
 static int
 c_buffer_ensure_free_space(struct c_buffer *buf, size_t sz) {
-    size_t free_space;
+    if (c_buffer_free_space(buf) >= sz)
+        return 0;
 
-    free_space = c_buffer_free_space(buf);
-    if (free_space < sz)
-        return c_buffer_grow(buf, sz - free_space);
+    c_buffer_repack(buf);
 
-    return 0;
+    if (c_buffer_free_space(buf) >= sz)
+        return 0;
+
+    if (sz > SIZE_MAX - buf->len) {
+        c_set_error("buffer size too large");
+        return -1;
+    }
+
+    return c_buffer_resize(buf, c_buffer_next_size(buf, buf->len + sz));
 }
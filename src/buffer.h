@@ -24,8 +24,14 @@
 #define C_BUFFER_MIN_SIZE 32
 
 struct c_buffer *c_buffer_new(void);
+struct c_buffer *c_buffer_new_with_allocator(const struct c_allocator *);
 void c_buffer_delete(struct c_buffer *);
 
+int c_buffer_set_alignment(struct c_buffer *, size_t);
+int c_buffer_set_growth_policy(struct c_buffer *, double, size_t);
+int c_buffer_reserve_capacity(struct c_buffer *, size_t);
+int c_buffer_shrink_to_fit(struct c_buffer *);
+
 void *c_buffer_data(const struct c_buffer *);
 size_t c_buffer_length(const struct c_buffer *);
 size_t c_buffer_size(const struct c_buffer *);
@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+
+/*
+ * Entries are found with a hash table, and linked in a circular doubly linked
+ * list whose sentinel is stored in the cache.
+ *
+ * With the LRU policy, the list is ordered from the most recently used entry
+ * to the least recently used one. Each hit moves the entry to the front of
+ * the list, and entries are evicted from the back.
+ *
+ * With the CLOCK policy, hits only set the reference bit of the entry and
+ * never modify the list. The clock hand walks the list to find an entry to
+ * evict: entries whose reference bit is set get a second chance, their bit
+ * being cleared. New entries are inserted right behind the hand once
+ * entries have been evicted, so that they are the last ones to be
+ * examined.
+ *
+ * Entries released by evictions are kept in a small free list, so that a
+ * full cache does not allocate memory for each insertion.
+ */
+
+#define C_CACHE_MAX_FREE_ENTRIES 64
+
+struct c_cache_entry {
+    struct c_cache_entry *prev;
+    struct c_cache_entry *next;
+
+    void *key;
+    void *value;
+    size_t cost;
+
+    bool referenced;
+};
+
+struct c_cache {
+    enum c_cache_policy policy;
+
+    struct c_hash_table *table;
+
+    struct c_cache_entry list;
+    struct c_cache_entry *hand;
+
+    struct c_cache_entry *free_entries;
+    size_t nb_free_entries;
+
+    size_t nb_entries;
+    size_t cost;
+
+    size_t max_entries;
+    size_t max_cost;
+
+    c_cache_evict_func evict_func;
+    void *evict_func_arg;
+
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    uint64_t nb_insertions;
+    uint64_t nb_evictions;
+};
+
+static struct c_cache_entry *c_cache_entry_new(struct c_cache *);
+static void c_cache_entry_delete(struct c_cache *, struct c_cache_entry *);
+static void c_cache_link(struct c_cache *, struct c_cache_entry *);
+static void c_cache_unlink(struct c_cache *, struct c_cache_entry *);
+static void c_cache_insert_before(struct c_cache_entry *,
+                                  struct c_cache_entry *);
+static void c_cache_touch(struct c_cache *, struct c_cache_entry *);
+static void c_cache_evict(struct c_cache *, const struct c_cache_entry *);
+static struct c_cache_entry *c_cache_victim(struct c_cache *,
+                                            const struct c_cache_entry *);
+static bool c_cache_is_full(const struct c_cache *);
+
+struct c_cache *
+c_cache_new(c_hash_func hash_func, c_equal_func equal_func,
+            enum c_cache_policy policy) {
+    struct c_cache *cache;
+
+    cache = c_malloc0(sizeof(struct c_cache));
+    if (!cache) {
+        c_set_error("cannot allocate cache: %m");
+        return NULL;
+    }
+
+    cache->policy = policy;
+
+    cache->table = c_hash_table_new(hash_func, equal_func);
+    if (!cache->table) {
+        c_free(cache);
+        return NULL;
+    }
+
+    cache->list.prev = &cache->list;
+    cache->list.next = &cache->list;
+    cache->hand = &cache->list;
+
+    return cache;
+}
+
+void
+c_cache_delete(struct c_cache *cache) {
+    if (!cache)
+        return;
+
+    c_cache_clear(cache);
+
+    while (cache->free_entries) {
+        struct c_cache_entry *next;
+
+        next = cache->free_entries->next;
+        c_free(cache->free_entries);
+        cache->free_entries = next;
+    }
+
+    c_hash_table_delete(cache->table);
+
+    c_free0(cache, sizeof(struct c_cache));
+}
+
+size_t
+c_cache_nb_entries(const struct c_cache *cache) {
+    return cache->nb_entries;
+}
+
+size_t
+c_cache_cost(const struct c_cache *cache) {
+    return cache->cost;
+}
+
+bool
+c_cache_is_empty(const struct c_cache *cache) {
+    return cache->nb_entries == 0;
+}
+
+void
+c_cache_clear(struct c_cache *cache) {
+    struct c_cache_entry *entry;
+
+    entry = cache->list.next;
+    while (entry != &cache->list) {
+        struct c_cache_entry *next;
+
+        next = entry->next;
+
+        if (cache->evict_func)
+            cache->evict_func(entry->key, entry->value, cache->evict_func_arg);
+
+        c_cache_entry_delete(cache, entry);
+        entry = next;
+    }
+
+    cache->list.prev = &cache->list;
+    cache->list.next = &cache->list;
+    cache->hand = &cache->list;
+
+    c_hash_table_clear(cache->table);
+
+    cache->nb_entries = 0;
+    cache->cost = 0;
+}
+
+void
+c_cache_set_evict_func(struct c_cache *cache, c_cache_evict_func func,
+                       void *arg) {
+    cache->evict_func = func;
+    cache->evict_func_arg = arg;
+}
+
+void
+c_cache_set_max_entries(struct c_cache *cache, size_t max_entries) {
+    cache->max_entries = max_entries;
+    c_cache_evict(cache, NULL);
+}
+
+void
+c_cache_set_max_cost(struct c_cache *cache, size_t max_cost) {
+    cache->max_cost = max_cost;
+    c_cache_evict(cache, NULL);
+}
+
+int
+c_cache_insert(struct c_cache *cache, void *key, void *value, size_t cost) {
+    return c_cache_insert2(cache, key, value, cost, NULL, NULL);
+}
+
+int
+c_cache_insert2(struct c_cache *cache, void *key, void *value, size_t cost,
+                void **old_key, void **old_value) {
+    struct c_cache_entry *entry;
+    void *ptr;
+
+    if (c_hash_table_get(cache->table, key, &ptr) == 1) {
+        entry = ptr;
+
+        if (old_key)
+            *old_key = entry->key;
+        if (old_value)
+            *old_value = entry->value;
+
+        /* The table must reference the new key */
+        if (c_hash_table_insert(cache->table, key, entry) == -1)
+            return -1;
+
+        entry->key = key;
+        entry->value = value;
+
+        cache->cost = cache->cost - entry->cost + cost;
+        entry->cost = cost;
+
+        c_cache_touch(cache, entry);
+        c_cache_evict(cache, entry);
+
+        return 0;
+    }
+
+    if (old_key)
+        *old_key = NULL;
+    if (old_value)
+        *old_value = NULL;
+
+    entry = c_cache_entry_new(cache);
+    if (!entry)
+        return -1;
+
+    entry->key = key;
+    entry->value = value;
+    entry->cost = cost;
+    entry->referenced = false;
+
+    if (c_hash_table_insert(cache->table, key, entry) == -1) {
+        c_cache_entry_delete(cache, entry);
+        return -1;
+    }
+
+    c_cache_link(cache, entry);
+
+    cache->nb_entries++;
+    cache->cost += cost;
+
+    cache->nb_insertions++;
+
+    c_cache_evict(cache, entry);
+
+    if (cache->policy == C_CACHE_CLOCK) {
+        /* The new entry takes the place of the entries which were evicted,
+         * right behind the hand. */
+        c_cache_unlink(cache, entry);
+        c_cache_insert_before(entry, cache->hand);
+    }
+
+    return 1;
+}
+
+int
+c_cache_remove(struct c_cache *cache, const void *key) {
+    return c_cache_remove2(cache, key, NULL, NULL);
+}
+
+int
+c_cache_remove2(struct c_cache *cache, const void *key,
+                void **old_key, void **old_value) {
+    struct c_cache_entry *entry;
+    void *ptr;
+
+    if (c_hash_table_remove2(cache->table, key, NULL, &ptr) == 0)
+        return 0;
+
+    entry = ptr;
+
+    if (old_key)
+        *old_key = entry->key;
+    if (old_value)
+        *old_value = entry->value;
+
+    c_cache_unlink(cache, entry);
+
+    cache->nb_entries--;
+    cache->cost -= entry->cost;
+
+    c_cache_entry_delete(cache, entry);
+
+    return 1;
+}
+
+int
+c_cache_get(struct c_cache *cache, const void *key, void **pvalue) {
+    struct c_cache_entry *entry;
+    void *ptr;
+
+    if (c_hash_table_get(cache->table, key, &ptr) == 0) {
+        cache->nb_misses++;
+        return 0;
+    }
+
+    entry = ptr;
+
+    c_cache_touch(cache, entry);
+    cache->nb_hits++;
+
+    if (pvalue)
+        *pvalue = entry->value;
+
+    return 1;
+}
+
+int
+c_cache_peek(const struct c_cache *cache, const void *key, void **pvalue) {
+    struct c_cache_entry *entry;
+    void *ptr;
+
+    if (c_hash_table_get(cache->table, key, &ptr) == 0)
+        return 0;
+
+    entry = ptr;
+
+    if (pvalue)
+        *pvalue = entry->value;
+
+    return 1;
+}
+
+bool
+c_cache_contains(const struct c_cache *cache, const void *key) {
+    return c_cache_peek(cache, key, NULL) == 1;
+}
+
+void
+c_cache_stats(const struct c_cache *cache, struct c_cache_stats *stats) {
+    memset(stats, 0, sizeof(struct c_cache_stats));
+
+    stats->nb_entries = cache->nb_entries;
+    stats->cost = cache->cost;
+
+    stats->nb_hits = cache->nb_hits;
+    stats->nb_misses = cache->nb_misses;
+    stats->nb_insertions = cache->nb_insertions;
+    stats->nb_evictions = cache->nb_evictions;
+}
+
+void
+c_cache_reset_stats(struct c_cache *cache) {
+    cache->nb_hits = 0;
+    cache->nb_misses = 0;
+    cache->nb_insertions = 0;
+    cache->nb_evictions = 0;
+}
+
+static struct c_cache_entry *
+c_cache_entry_new(struct c_cache *cache) {
+    struct c_cache_entry *entry;
+
+    if (cache->free_entries) {
+        entry = cache->free_entries;
+
+        cache->free_entries = entry->next;
+        cache->nb_free_entries--;
+
+        return entry;
+    }
+
+    entry = c_malloc(sizeof(struct c_cache_entry));
+    if (!entry) {
+        c_set_error("cannot allocate cache entry: %m");
+        return NULL;
+    }
+
+    return entry;
+}
+
+static void
+c_cache_entry_delete(struct c_cache *cache, struct c_cache_entry *entry) {
+    if (cache->nb_free_entries >= C_CACHE_MAX_FREE_ENTRIES) {
+        c_free(entry);
+        return;
+    }
+
+    entry->next = cache->free_entries;
+    cache->free_entries = entry;
+    cache->nb_free_entries++;
+}
+
+static void
+c_cache_link(struct c_cache *cache, struct c_cache_entry *entry) {
+    if (cache->policy == C_CACHE_CLOCK) {
+        c_cache_insert_before(entry, cache->hand);
+    } else {
+        c_cache_insert_before(entry, cache->list.next);
+    }
+}
+
+static void
+c_cache_unlink(struct c_cache *cache, struct c_cache_entry *entry) {
+    if (cache->hand == entry)
+        cache->hand = entry->next;
+
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+}
+
+static void
+c_cache_insert_before(struct c_cache_entry *entry,
+                      struct c_cache_entry *next) {
+    entry->prev = next->prev;
+    entry->next = next;
+
+    next->prev->next = entry;
+    next->prev = entry;
+}
+
+static void
+c_cache_touch(struct c_cache *cache, struct c_cache_entry *entry) {
+    if (cache->policy == C_CACHE_CLOCK) {
+        /* Avoid writing to the entry if the bit is already set */
+        if (!entry->referenced)
+            entry->referenced = true;
+    } else if (cache->list.next != entry) {
+        c_cache_unlink(cache, entry);
+        c_cache_insert_before(entry, cache->list.next);
+    }
+}
+
+static void
+c_cache_evict(struct c_cache *cache, const struct c_cache_entry *except) {
+    while (c_cache_is_full(cache)) {
+        struct c_cache_entry *entry;
+        void *key, *value;
+
+        entry = c_cache_victim(cache, except);
+        if (!entry)
+            break;
+
+        key = entry->key;
+        value = entry->value;
+
+        c_hash_table_remove(cache->table, key);
+        c_cache_unlink(cache, entry);
+
+        cache->nb_entries--;
+        cache->cost -= entry->cost;
+
+        c_cache_entry_delete(cache, entry);
+
+        cache->nb_evictions++;
+
+        if (cache->evict_func)
+            cache->evict_func(key, value, cache->evict_func_arg);
+    }
+}
+
+static struct c_cache_entry *
+c_cache_victim(struct c_cache *cache, const struct c_cache_entry *except) {
+    struct c_cache_entry *entry;
+
+    /* The entry which is being inserted or updated is never evicted */
+    if (cache->nb_entries == 0 || (cache->nb_entries == 1 && except))
+        return NULL;
+
+    if (cache->policy == C_CACHE_LRU) {
+        entry = cache->list.prev;
+        if (entry == except)
+            entry = entry->prev;
+
+        return entry;
+    }
+
+    for (;;) {
+        entry = cache->hand;
+        cache->hand = entry->next;
+
+        if (entry == &cache->list || entry == except)
+            continue;
+
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+
+        return entry;
+    }
+}
+
+static bool
+c_cache_is_full(const struct c_cache *cache) {
+    if (cache->max_entries > 0 && cache->nb_entries > cache->max_entries)
+        return true;
+
+    if (cache->max_cost > 0 && cache->cost > cache->max_cost)
+        return true;
+
+    return false;
+}
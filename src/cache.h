@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_CACHE_H
+#define LIBCORE_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+enum c_cache_policy {
+    C_CACHE_LRU,
+    C_CACHE_CLOCK,
+};
+
+typedef void (*c_cache_evict_func)(void *, void *, void *);
+
+struct c_cache_stats {
+    size_t nb_entries;
+    size_t cost;
+
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    uint64_t nb_insertions;
+    uint64_t nb_evictions;
+};
+
+struct c_cache *c_cache_new(c_hash_func, c_equal_func, enum c_cache_policy);
+void c_cache_delete(struct c_cache *);
+size_t c_cache_nb_entries(const struct c_cache *);
+size_t c_cache_cost(const struct c_cache *);
+bool c_cache_is_empty(const struct c_cache *);
+void c_cache_clear(struct c_cache *);
+
+void c_cache_set_evict_func(struct c_cache *, c_cache_evict_func, void *);
+void c_cache_set_max_entries(struct c_cache *, size_t);
+void c_cache_set_max_cost(struct c_cache *, size_t);
+
+int c_cache_insert(struct c_cache *, void *, void *, size_t);
+int c_cache_insert2(struct c_cache *, void *, void *, size_t,
+                    void **, void **);
+int c_cache_remove(struct c_cache *, const void *);
+int c_cache_remove2(struct c_cache *, const void *, void **, void **);
+int c_cache_get(struct c_cache *, const void *, void **);
+int c_cache_peek(const struct c_cache *, const void *, void **);
+bool c_cache_contains(const struct c_cache *, const void *);
+
+void c_cache_stats(const struct c_cache *, struct c_cache_stats *);
+void c_cache_reset_stats(struct c_cache *);
+
+#endif
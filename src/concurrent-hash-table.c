@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include <pthread.h>
+
+#include "internal.h"
+
+/*
+ * A concurrent hash table is a fixed array of shards, each shard being a
+ * regular hash table protected by its own reader-writer lock. The shard of a
+ * key is selected using the high bits of its hash, so that threads working on
+ * different keys rarely contend on the same lock; the hash table of each
+ * shard uses the low bits of the hash.
+ *
+ * Lookups only take the lock of the shard for reading. Shard hash tables never
+ * use incremental resizing, so that a lookup never modifies the table.
+ */
+
+#define C_CONCURRENT_HASH_TABLE_DEFAULT_NB_SHARDS 64
+#define C_CONCURRENT_HASH_TABLE_MAX_NB_SHARDS     65536
+
+/* Shards are padded so that the locks of two different shards are never
+ * stored in the same cache line, including with adjacent line prefetching. */
+#define C_CONCURRENT_HASH_TABLE_SHARD_SZ          128
+
+struct c_concurrent_hash_table_shard {
+    pthread_rwlock_t lock;
+    struct c_hash_table *table;
+};
+
+union c_concurrent_hash_table_padded_shard {
+    struct c_concurrent_hash_table_shard shard;
+    char padding[C_CONCURRENT_HASH_TABLE_SHARD_SZ];
+};
+
+struct c_concurrent_hash_table {
+    union c_concurrent_hash_table_padded_shard *shards;
+    size_t nb_shards; /* always a power of two */
+    unsigned int shard_shift;
+
+    c_hash_func hash_func;
+};
+
+struct c_concurrent_hash_table_iterator {
+    struct c_concurrent_hash_table_shard *shard;
+    struct c_hash_table_iterator *it;
+};
+
+static struct c_concurrent_hash_table_shard *
+c_concurrent_hash_table_shard(const struct c_concurrent_hash_table *, uint32_t);
+
+static void c_concurrent_hash_table_lock_read(
+    struct c_concurrent_hash_table_shard *);
+static void c_concurrent_hash_table_lock_write(
+    struct c_concurrent_hash_table_shard *);
+static void c_concurrent_hash_table_unlock(
+    struct c_concurrent_hash_table_shard *);
+
+struct c_concurrent_hash_table *
+c_concurrent_hash_table_new(c_hash_func hash_func, c_equal_func equal_func,
+                            size_t nb_shards) {
+    struct c_concurrent_hash_table *table;
+    unsigned int nb_bits;
+
+    if (nb_shards == 0)
+        nb_shards = C_CONCURRENT_HASH_TABLE_DEFAULT_NB_SHARDS;
+
+    if (nb_shards > C_CONCURRENT_HASH_TABLE_MAX_NB_SHARDS) {
+        c_set_error("too many shards");
+        return NULL;
+    }
+
+    nb_bits = 0;
+    while (((size_t)1 << nb_bits) < nb_shards)
+        nb_bits++;
+
+    table = c_malloc(sizeof(struct c_concurrent_hash_table));
+    if (!table)
+        return NULL;
+
+    memset(table, 0, sizeof(struct c_concurrent_hash_table));
+
+    table->hash_func = hash_func;
+    table->shard_shift = 32 - nb_bits;
+
+    table->shards = c_calloc((size_t)1 << nb_bits,
+                             sizeof(union c_concurrent_hash_table_padded_shard));
+    if (!table->shards) {
+        c_concurrent_hash_table_delete(table);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < ((size_t)1 << nb_bits); i++) {
+        struct c_concurrent_hash_table_shard *shard;
+        int ret;
+
+        shard = &table->shards[i].shard;
+
+        shard->table = c_hash_table_new(hash_func, equal_func);
+        if (!shard->table) {
+            c_concurrent_hash_table_delete(table);
+            return NULL;
+        }
+
+        ret = pthread_rwlock_init(&shard->lock, NULL);
+        if (ret != 0) {
+            c_set_error("cannot initialize lock: %s", strerror(ret));
+            c_hash_table_delete(shard->table);
+            shard->table = NULL;
+            c_concurrent_hash_table_delete(table);
+            return NULL;
+        }
+
+        table->nb_shards++;
+    }
+
+    return table;
+}
+
+void
+c_concurrent_hash_table_delete(struct c_concurrent_hash_table *table) {
+    if (!table)
+        return;
+
+    for (size_t i = 0; i < table->nb_shards; i++) {
+        struct c_concurrent_hash_table_shard *shard;
+
+        shard = &table->shards[i].shard;
+
+        pthread_rwlock_destroy(&shard->lock);
+        c_hash_table_delete(shard->table);
+    }
+
+    c_free(table->shards);
+
+    memset(table, 0, sizeof(struct c_concurrent_hash_table));
+    c_free(table);
+}
+
+size_t
+c_concurrent_hash_table_nb_shards(const struct c_concurrent_hash_table *table) {
+    return table->nb_shards;
+}
+
+size_t
+c_concurrent_hash_table_nb_entries(struct c_concurrent_hash_table *table) {
+    size_t nb_entries;
+
+    nb_entries = 0;
+
+    for (size_t i = 0; i < table->nb_shards; i++) {
+        struct c_concurrent_hash_table_shard *shard;
+
+        shard = &table->shards[i].shard;
+
+        c_concurrent_hash_table_lock_read(shard);
+        nb_entries += c_hash_table_nb_entries(shard->table);
+        c_concurrent_hash_table_unlock(shard);
+    }
+
+    return nb_entries;
+}
+
+bool
+c_concurrent_hash_table_is_empty(struct c_concurrent_hash_table *table) {
+    for (size_t i = 0; i < table->nb_shards; i++) {
+        struct c_concurrent_hash_table_shard *shard;
+        bool is_empty;
+
+        shard = &table->shards[i].shard;
+
+        c_concurrent_hash_table_lock_read(shard);
+        is_empty = c_hash_table_is_empty(shard->table);
+        c_concurrent_hash_table_unlock(shard);
+
+        if (!is_empty)
+            return false;
+    }
+
+    return true;
+}
+
+void
+c_concurrent_hash_table_clear(struct c_concurrent_hash_table *table) {
+    for (size_t i = 0; i < table->nb_shards; i++) {
+        struct c_concurrent_hash_table_shard *shard;
+
+        shard = &table->shards[i].shard;
+
+        c_concurrent_hash_table_lock_write(shard);
+        c_hash_table_clear(shard->table);
+        c_concurrent_hash_table_unlock(shard);
+    }
+}
+
+int
+c_concurrent_hash_table_insert(struct c_concurrent_hash_table *table,
+                               void *key, void *value) {
+    return c_concurrent_hash_table_insert2(table, key, value, NULL, NULL);
+}
+
+int
+c_concurrent_hash_table_insert2(struct c_concurrent_hash_table *table,
+                                void *key, void *value,
+                                void **old_key, void **old_value) {
+    struct c_concurrent_hash_table_shard *shard;
+    uint32_t hash;
+    int ret;
+
+    hash = table->hash_func(key);
+    shard = c_concurrent_hash_table_shard(table, hash);
+
+    c_concurrent_hash_table_lock_write(shard);
+    ret = c_hash_table_insert2_with_hash(shard->table, key, hash, value,
+                                         old_key, old_value);
+    c_concurrent_hash_table_unlock(shard);
+
+    return ret;
+}
+
+int
+c_concurrent_hash_table_remove(struct c_concurrent_hash_table *table,
+                               const void *key) {
+    return c_concurrent_hash_table_remove2(table, key, NULL, NULL);
+}
+
+int
+c_concurrent_hash_table_remove2(struct c_concurrent_hash_table *table,
+                                const void *key,
+                                void **old_key, void **old_value) {
+    struct c_concurrent_hash_table_shard *shard;
+    uint32_t hash;
+    int ret;
+
+    hash = table->hash_func(key);
+    shard = c_concurrent_hash_table_shard(table, hash);
+
+    c_concurrent_hash_table_lock_write(shard);
+    ret = c_hash_table_remove2_with_hash(shard->table, key, hash,
+                                         old_key, old_value);
+    c_concurrent_hash_table_unlock(shard);
+
+    return ret;
+}
+
+int
+c_concurrent_hash_table_get(struct c_concurrent_hash_table *table,
+                            const void *key, void **value) {
+    struct c_concurrent_hash_table_shard *shard;
+    uint32_t hash;
+    int ret;
+
+    hash = table->hash_func(key);
+    shard = c_concurrent_hash_table_shard(table, hash);
+
+    c_concurrent_hash_table_lock_read(shard);
+    ret = c_hash_table_get_with_hash(shard->table, key, hash, value);
+    c_concurrent_hash_table_unlock(shard);
+
+    return ret;
+}
+
+bool
+c_concurrent_hash_table_contains(struct c_concurrent_hash_table *table,
+                                 const void *key) {
+    void *value;
+
+    return c_concurrent_hash_table_get(table, key, &value) == 1;
+}
+
+struct c_concurrent_hash_table_iterator *
+c_concurrent_hash_table_iterate_shard(struct c_concurrent_hash_table *table,
+                                      size_t shard_index) {
+    struct c_concurrent_hash_table_iterator *it;
+    struct c_concurrent_hash_table_shard *shard;
+
+    assert(shard_index < table->nb_shards);
+
+    it = c_malloc(sizeof(struct c_concurrent_hash_table_iterator));
+    if (!it)
+        return NULL;
+
+    shard = &table->shards[shard_index].shard;
+
+    /* Hash table iterators are registered in their table, and the iterator
+     * can be used to modify values: the shard is locked for writing until the
+     * iterator is deleted. */
+    c_concurrent_hash_table_lock_write(shard);
+
+    it->shard = shard;
+
+    it->it = c_hash_table_iterate(shard->table);
+    if (!it->it) {
+        c_concurrent_hash_table_unlock(shard);
+        c_free(it);
+        return NULL;
+    }
+
+    return it;
+}
+
+void
+c_concurrent_hash_table_iterator_delete(
+    struct c_concurrent_hash_table_iterator *it) {
+    if (!it)
+        return;
+
+    c_hash_table_iterator_delete(it->it);
+    c_concurrent_hash_table_unlock(it->shard);
+
+    memset(it, 0, sizeof(struct c_concurrent_hash_table_iterator));
+    c_free(it);
+}
+
+int
+c_concurrent_hash_table_iterator_next(
+    struct c_concurrent_hash_table_iterator *it, void **key, void **value) {
+    return c_hash_table_iterator_next(it->it, key, value);
+}
+
+void
+c_concurrent_hash_table_iterator_set_value(
+    struct c_concurrent_hash_table_iterator *it, void *value) {
+    c_hash_table_iterator_set_value(it->it, value);
+}
+
+static struct c_concurrent_hash_table_shard *
+c_concurrent_hash_table_shard(const struct c_concurrent_hash_table *table,
+                              uint32_t hash) {
+    size_t idx;
+
+    if (table->nb_shards == 1)
+        return &table->shards[0].shard;
+
+    /* Fibonacci hashing: the multiplication spreads all bits of the hash
+     * into the high bits, so that weak hash functions still use all
+     * shards. */
+    idx = (uint32_t)(hash * UINT32_C(0x9e3779b9)) >> table->shard_shift;
+
+    return &table->shards[idx].shard;
+}
+
+/* Locking operations can only fail on programming errors, for example when
+ * a thread tries to lock a shard it already locked for writing. */
+static void
+c_concurrent_hash_table_lock_read(struct c_concurrent_hash_table_shard *shard) {
+    if (pthread_rwlock_rdlock(&shard->lock) != 0)
+        abort();
+}
+
+static void
+c_concurrent_hash_table_lock_write(struct c_concurrent_hash_table_shard *shard) {
+    if (pthread_rwlock_wrlock(&shard->lock) != 0)
+        abort();
+}
+
+static void
+c_concurrent_hash_table_unlock(struct c_concurrent_hash_table_shard *shard) {
+    if (pthread_rwlock_unlock(&shard->lock) != 0)
+        abort();
+}
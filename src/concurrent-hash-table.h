@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_CONCURRENT_HASH_TABLE_H
+#define LIBCORE_CONCURRENT_HASH_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct c_concurrent_hash_table *
+c_concurrent_hash_table_new(c_hash_func, c_equal_func, size_t);
+void c_concurrent_hash_table_delete(struct c_concurrent_hash_table *);
+size_t c_concurrent_hash_table_nb_shards(const struct c_concurrent_hash_table *);
+size_t c_concurrent_hash_table_nb_entries(struct c_concurrent_hash_table *);
+bool c_concurrent_hash_table_is_empty(struct c_concurrent_hash_table *);
+void c_concurrent_hash_table_clear(struct c_concurrent_hash_table *);
+
+int c_concurrent_hash_table_insert(struct c_concurrent_hash_table *,
+                                   void *, void *);
+int c_concurrent_hash_table_insert2(struct c_concurrent_hash_table *,
+                                    void *, void *, void **, void **);
+int c_concurrent_hash_table_remove(struct c_concurrent_hash_table *,
+                                   const void *);
+int c_concurrent_hash_table_remove2(struct c_concurrent_hash_table *,
+                                    const void *, void **, void **);
+int c_concurrent_hash_table_get(struct c_concurrent_hash_table *,
+                                const void *, void **);
+bool c_concurrent_hash_table_contains(struct c_concurrent_hash_table *,
+                                      const void *);
+
+struct c_concurrent_hash_table_iterator *
+c_concurrent_hash_table_iterate_shard(struct c_concurrent_hash_table *, size_t);
+void c_concurrent_hash_table_iterator_delete(
+    struct c_concurrent_hash_table_iterator *);
+int c_concurrent_hash_table_iterator_next(
+    struct c_concurrent_hash_table_iterator *, void **, void **);
+void c_concurrent_hash_table_iterator_set_value(
+    struct c_concurrent_hash_table_iterator *, void *);
+
+#endif
@@ -18,17 +18,30 @@
 #define LIBCORE_CORE_H
 
 #include <core/memory.h>
+#include <core/arena.h>
+#include <core/pool.h>
 #include <core/errors.h>
 #include <core/numbers.h>
 #include <core/strings.h>
 #include <core/buffer.h>
+#include <core/iobuf.h>
+#include <core/ring-buffer.h>
+#include <core/transfer.h>
+#include <core/mapped-file.h>
 #include <core/vector.h>
 #include <core/ptr-vector.h>
 #include <core/hash-table.h>
+#include <core/hash-set.h>
+#include <core/ordered-hash-table.h>
+#include <core/string-pool.h>
+#include <core/concurrent-hash-table.h>
+#include <core/rcu-hash-table.h>
+#include <core/int-map.h>
 #include <core/unicode.h>
 #include <core/command-line.h>
 #include <core/queue.h>
 #include <core/stack.h>
 #include <core/heap.h>
+#include <core/cache.h>
 
 #endif
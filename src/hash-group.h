@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_HASH_GROUP_H
+#define LIBCORE_HASH_GROUP_H
+
+/*
+ * Control bytes, probing and load policy shared by open addressing tables
+ * (hash tables, hash sets, ordered hash tables and integer maps).
+ *
+ * Each slot is associated with a control byte which is either
+ * C_HASH_CTRL_EMPTY, C_HASH_CTRL_DELETED, or the 7 high bits of the hash of
+ * the key stored in the slot (H2). Control bytes are examined by groups of
+ * C_HASH_GROUP_SZ bytes packed in a 64 bit integer, the first control byte
+ * being stored in the low byte of the group.
+ *
+ * The control array contains nb_slots + C_HASH_GROUP_SZ bytes: the first
+ * C_HASH_GROUP_SZ control bytes are cloned after the end of the array so
+ * that a group can always be loaded with a single read, including when it
+ * wraps around.
+ *
+ * Tables only differ by the content of their slots. Functions which have to
+ * look at keys take the address and the size of slots, and a function
+ * comparing the key stored in a slot with the key searched; since they are
+ * inlined, the comparison function is usually inlined too.
+ */
+
+#define C_HASH_GROUP_SZ 8
+
+#define C_HASH_GROUP_LSBS UINT64_C(0x0101010101010101)
+#define C_HASH_GROUP_MSBS UINT64_C(0x8080808080808080)
+
+#define C_HASH_CTRL_EMPTY   0x80
+#define C_HASH_CTRL_DELETED 0xfe
+
+#define C_HASH_CTRL_IS_FULL(ctrl_) (((ctrl_) & 0x80) == 0)
+
+#define C_HASH_H1(hash_) ((size_t)(hash_))
+#define C_HASH_H2(hash_) ((uint8_t)((hash_) >> 25))
+
+/* The maximum load factor is the maximum ratio of used (full or deleted)
+ * slots; whatever its value, there is always at least one empty slot. The
+ * minimum load factor is the ratio of full slots under which a table is
+ * shrunk. Shrinking halves the number of slots, so the minimum load factor
+ * must be lower than half the maximum load factor, otherwise the table would
+ * have to grow right after having been shrunk. */
+#define C_HASH_DEFAULT_MAX_LOAD_FACTOR 0.875
+#define C_HASH_DEFAULT_MIN_LOAD_FACTOR 0.2
+
+/* Returns true if the key stored in a slot is equal to the key searched */
+typedef bool (*c_hash_slot_equal_func)(const void *, const void *,
+                                       const void *);
+
+struct c_hash_probe {
+    size_t mask;
+    size_t offset;
+    size_t index;
+};
+
+static inline void
+c_hash_probe_init(struct c_hash_probe *probe, uint32_t hash, size_t nb_slots) {
+    probe->mask = nb_slots - 1;
+    probe->offset = C_HASH_H1(hash) & probe->mask;
+    probe->index = 0;
+}
+
+static inline void
+c_hash_probe_next(struct c_hash_probe *probe) {
+    /* Triangular probing visits every group when the number of slots is a
+     * power of two. */
+    probe->index += C_HASH_GROUP_SZ;
+    probe->offset = (probe->offset + probe->index) & probe->mask;
+}
+
+static inline uint64_t
+c_hash_group_load(const uint8_t *ctrl) {
+    uint64_t group;
+
+    /* The first control byte must end up in the low byte of the group */
+    memcpy(&group, ctrl, sizeof(uint64_t));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+#endif
+
+    return group;
+}
+
+static inline uint64_t
+c_hash_group_match(uint64_t group, uint8_t h2) {
+    uint64_t x;
+
+    /* Classic "has zero byte" trick. It can report false positives, which
+     * are filtered by checking the control byte of each candidate slot. */
+    x = group ^ (C_HASH_GROUP_LSBS * h2);
+    return (x - C_HASH_GROUP_LSBS) & ~x & C_HASH_GROUP_MSBS;
+}
+
+static inline uint64_t
+c_hash_group_match_empty(uint64_t group) {
+    /* Empty slots are the only ones with the high bit set and bit 1
+     * unset. */
+    return group & ~(group << 6) & C_HASH_GROUP_MSBS;
+}
+
+static inline uint64_t
+c_hash_group_match_empty_or_deleted(uint64_t group) {
+    return group & C_HASH_GROUP_MSBS;
+}
+
+static inline size_t
+c_hash_group_first(uint64_t match) {
+    return (size_t)__builtin_ctzll(match) / 8;
+}
+
+static inline size_t
+c_hash_group_leading_full(uint64_t match) {
+    /* Number of full or deleted slots at the end of a group given the result
+     * of c_hash_group_match_empty() */
+    return (size_t)__builtin_clzll(match) / 8;
+}
+
+static inline uint32_t
+c_hash_mix(uint32_t hash) {
+    /* The number of slots is a power of two, so we only use the low bits of
+     * the hash to select a slot; mix the hash value returned by the hash
+     * function (murmur3 finalizer) so that weak hash functions do not end up
+     * in long probe sequences. */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static inline size_t
+c_hash_max_load(size_t nb_slots, double max_load_factor) {
+    size_t max_load;
+
+    max_load = (size_t)((double)nb_slots * max_load_factor);
+
+    if (max_load == 0)
+        max_load = 1;
+    if (max_load >= nb_slots)
+        max_load = nb_slots - 1;
+
+    return max_load;
+}
+
+static inline size_t
+c_hash_min_load(size_t nb_slots, double min_load_factor) {
+    return (size_t)((double)nb_slots * min_load_factor);
+}
+
+static inline size_t
+c_hash_shrunk_nb_slots(size_t nb_slots, size_t min_nb_slots,
+                       size_t nb_entries, double min_load_factor) {
+    /* Halve the number of slots as long as the table is under its minimum
+     * load, but never go under min_nb_slots, which is usually the size
+     * matching a capacity reserved by the caller. */
+    while (nb_slots > min_nb_slots
+        && nb_entries < c_hash_min_load(nb_slots, min_load_factor)) {
+        nb_slots /= 2;
+    }
+
+    return nb_slots;
+}
+
+static inline size_t
+c_hash_ctrl_find(const uint8_t *ctrl, size_t nb_slots,
+                 const void *slots, size_t slot_sz, uint32_t hash,
+                 c_hash_slot_equal_func equal_func, const void *data,
+                 const void *key) {
+    struct c_hash_probe probe;
+    uint8_t h2;
+
+    h2 = C_HASH_H2(hash);
+
+    c_hash_probe_init(&probe, hash, nb_slots);
+
+    /* Most lookups end in the first slot of the probe sequence; fetching it
+     * right now overlaps the two cache misses. */
+    __builtin_prefetch((const uint8_t *)slots + probe.offset * slot_sz);
+
+    for (;;) {
+        uint64_t group, match;
+
+        group = c_hash_group_load(ctrl + probe.offset);
+
+        match = c_hash_group_match(group, h2);
+        while (match) {
+            size_t idx;
+
+            idx = (probe.offset + c_hash_group_first(match)) & probe.mask;
+
+            if (ctrl[idx] == h2
+             && equal_func(data, (const uint8_t *)slots + idx * slot_sz,
+                           key)) {
+                return idx;
+            }
+
+            match &= match - 1;
+        }
+
+        if (c_hash_group_match_empty(group))
+            return SIZE_MAX;
+
+        c_hash_probe_next(&probe);
+    }
+}
+
+static inline size_t
+c_hash_ctrl_find_free_slot(const uint8_t *ctrl, size_t nb_slots,
+                           uint32_t hash) {
+    struct c_hash_probe probe;
+
+    c_hash_probe_init(&probe, hash, nb_slots);
+
+    for (;;) {
+        uint64_t group, match;
+
+        group = c_hash_group_load(ctrl + probe.offset);
+
+        match = c_hash_group_match_empty_or_deleted(group);
+        if (match)
+            return (probe.offset + c_hash_group_first(match)) & probe.mask;
+
+        c_hash_probe_next(&probe);
+    }
+}
+
+static inline void
+c_hash_ctrl_set(uint8_t *ctrl, size_t nb_slots, size_t idx, uint8_t value) {
+    ctrl[idx] = value;
+
+    if (idx < C_HASH_GROUP_SZ)
+        ctrl[nb_slots + idx] = value;
+}
+
+static inline uint8_t
+c_hash_ctrl_erase(uint8_t *ctrl, size_t nb_slots, size_t idx) {
+    uint64_t empty_before, empty_after;
+    size_t idx_before;
+    uint8_t value;
+
+    /* If there is no group of full or deleted slots containing this slot,
+     * no probe sequence ever went past it, and we can mark it as empty
+     * instead of deleted. Returns the new control byte of the slot so that
+     * the caller can count deleted slots. */
+    idx_before = (idx - C_HASH_GROUP_SZ) & (nb_slots - 1);
+
+    empty_before = c_hash_group_match_empty(
+        c_hash_group_load(ctrl + idx_before));
+    empty_after = c_hash_group_match_empty(c_hash_group_load(ctrl + idx));
+
+    if (empty_before && empty_after
+     && c_hash_group_leading_full(empty_before)
+        + c_hash_group_first(empty_after) < C_HASH_GROUP_SZ) {
+        value = C_HASH_CTRL_EMPTY;
+    } else {
+        value = C_HASH_CTRL_DELETED;
+    }
+
+    c_hash_ctrl_set(ctrl, nb_slots, idx, value);
+    return value;
+}
+
+#endif
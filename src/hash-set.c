@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+#include "hash-group.h"
+
+/*
+ * Hash sets use the same open addressing scheme as hash tables (see
+ * hash-group.h), but slots only contain a pointer to the key, halving the
+ * size of the slot array compared to a hash table whose values are unused.
+ *
+ * Since both sets of a binary operation use the same hash function, the
+ * hash of each key is only computed once, and used both to look it up in
+ * one set and to insert it in the result.
+ */
+
+#define C_HASH_SET_MIN_NB_SLOTS C_HASH_GROUP_SZ
+
+struct c_hash_set {
+    void **slots;
+    uint8_t *ctrl;
+    size_t nb_slots;
+    size_t min_nb_slots; /* the set is never shrunk below this size */
+
+    size_t nb_entries;
+    size_t nb_deleted;
+
+    c_hash_func hash_func;
+    c_equal_func equal_func;
+};
+
+static uint32_t c_hash_set_hash(const struct c_hash_set *, const void *);
+static size_t c_hash_set_max_load(size_t);
+static int c_hash_set_nb_slots_for_capacity(size_t, size_t *);
+static int c_hash_set_resize(struct c_hash_set *, size_t);
+static void c_hash_set_shrink_if_needed(struct c_hash_set *);
+static bool c_hash_set_slot_equal(const void *, const void *, const void *);
+static bool c_hash_set_find(const struct c_hash_set *, const void *, uint32_t,
+                            size_t *);
+static int c_hash_set_add(struct c_hash_set *, void *, uint32_t);
+static void c_hash_set_erase(struct c_hash_set *, size_t);
+static bool c_hash_set_next(const struct c_hash_set *, size_t *, void **);
+
+struct c_hash_set *
+c_hash_set_new(c_hash_func hash_func, c_equal_func equal_func) {
+    return c_hash_set_new_with_capacity(hash_func, equal_func, 0);
+}
+
+struct c_hash_set *
+c_hash_set_new_with_capacity(c_hash_func hash_func, c_equal_func equal_func,
+                             size_t capacity) {
+    struct c_hash_set *set;
+    size_t nb_slots;
+
+    if (c_hash_set_nb_slots_for_capacity(capacity, &nb_slots) == -1)
+        return NULL;
+
+    set = c_malloc(sizeof(struct c_hash_set));
+    if (!set) {
+        c_set_error("cannot allocate set: %m");
+        return NULL;
+    }
+
+    memset(set, 0, sizeof(struct c_hash_set));
+
+    set->hash_func = hash_func;
+    set->equal_func = equal_func;
+
+    set->min_nb_slots = nb_slots;
+
+    if (c_hash_set_resize(set, nb_slots) == -1) {
+        c_hash_set_delete(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+struct c_hash_set *
+c_hash_set_copy(const struct c_hash_set *set) {
+    struct c_hash_set *nset;
+    size_t sz;
+
+    nset = c_malloc(sizeof(struct c_hash_set));
+    if (!nset) {
+        c_set_error("cannot allocate set: %m");
+        return NULL;
+    }
+
+    *nset = *set;
+
+    /* The copy has the same number of slots, so the slot array can be copied
+     * as it is without rehashing any key. */
+    sz = set->nb_slots * sizeof(void *) + set->nb_slots + C_HASH_GROUP_SZ;
+
+    nset->slots = c_malloc(sz);
+    if (!nset->slots) {
+        c_set_error("cannot allocate slots: %m");
+        c_free(nset);
+        return NULL;
+    }
+
+    memcpy(nset->slots, set->slots, sz);
+    nset->ctrl = (uint8_t *)(nset->slots + nset->nb_slots);
+
+    return nset;
+}
+
+void
+c_hash_set_delete(struct c_hash_set *set) {
+    if (!set)
+        return;
+
+    c_free(set->slots);
+    c_free0(set, sizeof(struct c_hash_set));
+}
+
+size_t
+c_hash_set_nb_entries(const struct c_hash_set *set) {
+    return set->nb_entries;
+}
+
+bool
+c_hash_set_is_empty(const struct c_hash_set *set) {
+    return set->nb_entries == 0;
+}
+
+void
+c_hash_set_clear(struct c_hash_set *set) {
+    memset(set->ctrl, C_HASH_CTRL_EMPTY, set->nb_slots + C_HASH_GROUP_SZ);
+
+    set->nb_entries = 0;
+    set->nb_deleted = 0;
+}
+
+size_t
+c_hash_set_capacity(const struct c_hash_set *set) {
+    return c_hash_set_max_load(set->nb_slots);
+}
+
+int
+c_hash_set_reserve(struct c_hash_set *set, size_t capacity) {
+    size_t nb_slots;
+
+    if (c_hash_set_nb_slots_for_capacity(capacity, &nb_slots) == -1)
+        return -1;
+
+    /* Removing keys must not undo the reservation */
+    set->min_nb_slots = nb_slots;
+
+    if (capacity <= c_hash_set_max_load(set->nb_slots) - set->nb_deleted)
+        return 0;
+
+    return c_hash_set_resize(set, nb_slots);
+}
+
+int
+c_hash_set_insert(struct c_hash_set *set, void *key) {
+    return c_hash_set_insert2(set, key, NULL);
+}
+
+int
+c_hash_set_insert2(struct c_hash_set *set, void *key, void **old_key) {
+    uint32_t hash;
+    size_t idx;
+
+    hash = c_hash_set_hash(set, key);
+
+    if (c_hash_set_find(set, key, hash, &idx)) {
+        if (old_key)
+            *old_key = set->slots[idx];
+
+        set->slots[idx] = key;
+        return 0;
+    }
+
+    if (old_key)
+        *old_key = NULL;
+
+    if (c_hash_set_add(set, key, hash) == -1)
+        return -1;
+
+    return 1;
+}
+
+int
+c_hash_set_remove(struct c_hash_set *set, const void *key) {
+    return c_hash_set_remove2(set, key, NULL);
+}
+
+int
+c_hash_set_remove2(struct c_hash_set *set, const void *key, void **old_key) {
+    size_t idx;
+
+    if (!c_hash_set_find(set, key, c_hash_set_hash(set, key), &idx))
+        return 0;
+
+    if (old_key)
+        *old_key = set->slots[idx];
+
+    c_hash_set_erase(set, idx);
+    c_hash_set_shrink_if_needed(set);
+
+    return 1;
+}
+
+int
+c_hash_set_get(const struct c_hash_set *set, const void *key, void **pkey) {
+    size_t idx;
+
+    if (!c_hash_set_find(set, key, c_hash_set_hash(set, key), &idx))
+        return 0;
+
+    if (pkey)
+        *pkey = set->slots[idx];
+
+    return 1;
+}
+
+bool
+c_hash_set_contains(const struct c_hash_set *set, const void *key) {
+    size_t idx;
+
+    return c_hash_set_find(set, key, c_hash_set_hash(set, key), &idx);
+}
+
+struct c_hash_set *
+c_hash_set_union(const struct c_hash_set *set1,
+                 const struct c_hash_set *set2) {
+    const struct c_hash_set *large, *small;
+    struct c_hash_set *set;
+    size_t idx;
+    void *key;
+
+    assert(set1->hash_func == set2->hash_func);
+    assert(set1->equal_func == set2->equal_func);
+
+    if (set1->nb_entries >= set2->nb_entries) {
+        large = set1;
+        small = set2;
+    } else {
+        large = set2;
+        small = set1;
+    }
+
+    set = c_hash_set_copy(large);
+    if (!set)
+        return NULL;
+
+    idx = 0;
+    while (c_hash_set_next(small, &idx, &key)) {
+        uint32_t hash;
+        size_t sidx;
+
+        hash = c_hash_set_hash(set, key);
+        if (c_hash_set_find(set, key, hash, &sidx))
+            continue;
+
+        if (c_hash_set_add(set, key, hash) == -1) {
+            c_hash_set_delete(set);
+            return NULL;
+        }
+    }
+
+    return set;
+}
+
+struct c_hash_set *
+c_hash_set_intersection(const struct c_hash_set *set1,
+                        const struct c_hash_set *set2) {
+    const struct c_hash_set *large, *small;
+    struct c_hash_set *set;
+    size_t idx;
+    void *key;
+
+    assert(set1->hash_func == set2->hash_func);
+    assert(set1->equal_func == set2->equal_func);
+
+    if (set1->nb_entries >= set2->nb_entries) {
+        large = set1;
+        small = set2;
+    } else {
+        large = set2;
+        small = set1;
+    }
+
+    set = c_hash_set_new_with_capacity(set1->hash_func, set1->equal_func,
+                                       small->nb_entries);
+    if (!set)
+        return NULL;
+
+    idx = 0;
+    while (c_hash_set_next(small, &idx, &key)) {
+        uint32_t hash;
+        size_t lidx;
+
+        hash = c_hash_set_hash(small, key);
+        if (!c_hash_set_find(large, key, hash, &lidx))
+            continue;
+
+        if (c_hash_set_add(set, key, hash) == -1) {
+            c_hash_set_delete(set);
+            return NULL;
+        }
+    }
+
+    return set;
+}
+
+struct c_hash_set *
+c_hash_set_difference(const struct c_hash_set *set1,
+                      const struct c_hash_set *set2) {
+    struct c_hash_set *set;
+    size_t idx;
+    void *key;
+
+    assert(set1->hash_func == set2->hash_func);
+    assert(set1->equal_func == set2->equal_func);
+
+    idx = 0;
+
+    if (set2->nb_entries < set1->nb_entries) {
+        /* Copy the first set and remove the keys of the second one */
+        set = c_hash_set_copy(set1);
+        if (!set)
+            return NULL;
+
+        while (c_hash_set_next(set2, &idx, &key)) {
+            size_t sidx;
+
+            if (c_hash_set_find(set, key, c_hash_set_hash(set, key), &sidx))
+                c_hash_set_erase(set, sidx);
+        }
+
+        c_hash_set_shrink_if_needed(set);
+    } else {
+        /* Copy the keys of the first set which are not in the second one */
+        set = c_hash_set_new_with_capacity(set1->hash_func, set1->equal_func,
+                                           set1->nb_entries);
+        if (!set)
+            return NULL;
+
+        while (c_hash_set_next(set1, &idx, &key)) {
+            uint32_t hash;
+            size_t sidx;
+
+            hash = c_hash_set_hash(set1, key);
+            if (c_hash_set_find(set2, key, hash, &sidx))
+                continue;
+
+            if (c_hash_set_add(set, key, hash) == -1) {
+                c_hash_set_delete(set);
+                return NULL;
+            }
+        }
+    }
+
+    return set;
+}
+
+void
+c_hash_set_iterator_init(struct c_hash_set_iterator *it,
+                         const struct c_hash_set *set) {
+    it->set = set;
+    it->slot = 0;
+}
+
+int
+c_hash_set_iterator_next(struct c_hash_set_iterator *it, void **pkey) {
+    void *key;
+
+    if (!c_hash_set_next(it->set, &it->slot, &key))
+        return 0;
+
+    if (pkey)
+        *pkey = key;
+
+    return 1;
+}
+
+static uint32_t
+c_hash_set_hash(const struct c_hash_set *set, const void *key) {
+    return c_hash_mix(set->hash_func(key));
+}
+
+static size_t
+c_hash_set_max_load(size_t nb_slots) {
+    return c_hash_max_load(nb_slots, C_HASH_DEFAULT_MAX_LOAD_FACTOR);
+}
+
+static int
+c_hash_set_nb_slots_for_capacity(size_t capacity, size_t *pnb_slots) {
+    size_t nb_slots;
+
+    nb_slots = C_HASH_SET_MIN_NB_SLOTS;
+
+    while (c_hash_set_max_load(nb_slots) < capacity) {
+        if (nb_slots > SIZE_MAX / 2 / (sizeof(void *) + 1)) {
+            c_set_error("capacity too large");
+            return -1;
+        }
+
+        nb_slots *= 2;
+    }
+
+    *pnb_slots = nb_slots;
+    return 0;
+}
+
+static int
+c_hash_set_resize(struct c_hash_set *set, size_t nb_slots) {
+    void **old_slots;
+    uint8_t *old_ctrl;
+    size_t old_nb_slots, nb_entries;
+    size_t sz;
+
+    assert(nb_slots >= C_HASH_SET_MIN_NB_SLOTS);
+    assert(set->nb_entries < c_hash_set_max_load(nb_slots));
+
+    old_slots = set->slots;
+    old_ctrl = set->ctrl;
+    old_nb_slots = set->nb_slots;
+
+    /* Slots and control bytes are stored in the same memory block */
+    sz = nb_slots * sizeof(void *) + nb_slots + C_HASH_GROUP_SZ;
+
+    set->slots = c_malloc(sz);
+    if (!set->slots) {
+        c_set_error("cannot allocate slots: %m");
+        set->slots = old_slots;
+        return -1;
+    }
+
+    set->ctrl = (uint8_t *)(set->slots + nb_slots);
+    set->nb_slots = nb_slots;
+
+    nb_entries = set->nb_entries;
+    c_hash_set_clear(set);
+
+    for (size_t i = 0; i < old_nb_slots; i++) {
+        uint32_t hash;
+        size_t idx;
+
+        if (!C_HASH_CTRL_IS_FULL(old_ctrl[i]))
+            continue;
+
+        hash = c_hash_set_hash(set, old_slots[i]);
+
+        idx = c_hash_ctrl_find_free_slot(set->ctrl, set->nb_slots, hash);
+        c_hash_ctrl_set(set->ctrl, set->nb_slots, idx, C_HASH_H2(hash));
+        set->slots[idx] = old_slots[i];
+    }
+
+    set->nb_entries = nb_entries;
+
+    c_free(old_slots);
+    return 0;
+}
+
+static void
+c_hash_set_shrink_if_needed(struct c_hash_set *set) {
+    size_t nb_slots;
+
+    nb_slots = c_hash_shrunk_nb_slots(set->nb_slots, set->min_nb_slots,
+                                      set->nb_entries,
+                                      C_HASH_DEFAULT_MIN_LOAD_FACTOR);
+
+    /* Failing to shrink the set is not an error */
+    if (nb_slots < set->nb_slots)
+        c_hash_set_resize(set, nb_slots);
+}
+
+static bool
+c_hash_set_slot_equal(const void *data, const void *slot, const void *key) {
+    const struct c_hash_set *set;
+
+    set = data;
+    return set->equal_func(*(void * const *)slot, key);
+}
+
+static bool
+c_hash_set_find(const struct c_hash_set *set, const void *key, uint32_t hash,
+                size_t *pidx) {
+    size_t idx;
+
+    idx = c_hash_ctrl_find(set->ctrl, set->nb_slots, set->slots,
+                           sizeof(void *), hash, c_hash_set_slot_equal, set,
+                           key);
+    if (idx == SIZE_MAX)
+        return false;
+
+    *pidx = idx;
+    return true;
+}
+
+static int
+c_hash_set_add(struct c_hash_set *set, void *key, uint32_t hash) {
+    size_t idx;
+
+    /* The key must not be in the set */
+
+    if (set->nb_entries + set->nb_deleted
+        >= c_hash_set_max_load(set->nb_slots)) {
+        size_t nb_slots;
+
+        /* If a significant part of the used slots only contain deleted
+         * entries, rehashing without growing is enough. */
+        nb_slots = set->nb_slots;
+        if (set->nb_deleted < set->nb_slots / 8) {
+            if (nb_slots > SIZE_MAX / 2 / (sizeof(void *) + 1)) {
+                c_set_error("set too large");
+                return -1;
+            }
+
+            nb_slots *= 2;
+        }
+
+        if (c_hash_set_resize(set, nb_slots) == -1)
+            return -1;
+    }
+
+    idx = c_hash_ctrl_find_free_slot(set->ctrl, set->nb_slots, hash);
+
+    if (set->ctrl[idx] == C_HASH_CTRL_DELETED)
+        set->nb_deleted--;
+
+    c_hash_ctrl_set(set->ctrl, set->nb_slots, idx, C_HASH_H2(hash));
+    set->slots[idx] = key;
+
+    set->nb_entries++;
+    return 0;
+}
+
+static void
+c_hash_set_erase(struct c_hash_set *set, size_t idx) {
+    if (c_hash_ctrl_erase(set->ctrl, set->nb_slots, idx)
+        == C_HASH_CTRL_DELETED) {
+        set->nb_deleted++;
+    }
+
+    set->slots[idx] = NULL;
+    set->nb_entries--;
+}
+
+static bool
+c_hash_set_next(const struct c_hash_set *set, size_t *pidx, void **pkey) {
+    for (size_t idx = *pidx; idx < set->nb_slots; idx++) {
+        if (!C_HASH_CTRL_IS_FULL(set->ctrl[idx]))
+            continue;
+
+        *pkey = set->slots[idx];
+        *pidx = idx + 1;
+        return true;
+    }
+
+    *pidx = set->nb_slots;
+    return false;
+}
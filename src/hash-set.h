@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_HASH_SET_H
+#define LIBCORE_HASH_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* The content of this structure is private. Its definition is public so that
+ * iterators can be allocated by the caller. */
+struct c_hash_set_iterator {
+    const struct c_hash_set *set;
+    size_t slot;
+};
+
+struct c_hash_set *c_hash_set_new(c_hash_func, c_equal_func);
+struct c_hash_set *c_hash_set_new_with_capacity(c_hash_func, c_equal_func,
+                                                size_t);
+struct c_hash_set *c_hash_set_copy(const struct c_hash_set *);
+void c_hash_set_delete(struct c_hash_set *);
+size_t c_hash_set_nb_entries(const struct c_hash_set *);
+bool c_hash_set_is_empty(const struct c_hash_set *);
+void c_hash_set_clear(struct c_hash_set *);
+
+size_t c_hash_set_capacity(const struct c_hash_set *);
+int c_hash_set_reserve(struct c_hash_set *, size_t);
+
+int c_hash_set_insert(struct c_hash_set *, void *);
+int c_hash_set_insert2(struct c_hash_set *, void *, void **);
+int c_hash_set_remove(struct c_hash_set *, const void *);
+int c_hash_set_remove2(struct c_hash_set *, const void *, void **);
+int c_hash_set_get(const struct c_hash_set *, const void *, void **);
+bool c_hash_set_contains(const struct c_hash_set *, const void *);
+
+struct c_hash_set *c_hash_set_union(const struct c_hash_set *,
+                                    const struct c_hash_set *);
+struct c_hash_set *c_hash_set_intersection(const struct c_hash_set *,
+                                           const struct c_hash_set *);
+struct c_hash_set *c_hash_set_difference(const struct c_hash_set *,
+                                         const struct c_hash_set *);
+
+void c_hash_set_iterator_init(struct c_hash_set_iterator *,
+                              const struct c_hash_set *);
+int c_hash_set_iterator_next(struct c_hash_set_iterator *, void **);
+
+#endif
@@ -16,77 +16,198 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "internal.h"
+#include "hash-group.h"
 
-#define C_UNUSED_HASH 0
+/*
+ * Entries are stored in a single array of slots using open addressing. Each
+ * slot is associated with a control byte stored in a separate array; control
+ * bytes are either C_HASH_CTRL_EMPTY, C_HASH_CTRL_DELETED, or the
+ * 7 high bits of the hash of the key stored in the slot (H2).
+ *
+ * Lookups start at the slot indexed by the hash of the key (H1) and probe
+ * groups of C_HASH_GROUP_SZ control bytes at once, using triangular
+ * steps. Keys are only compared for slots whose control byte matches H2, and
+ * the search stops at the first group containing an empty slot.
+ *
+ * The first C_HASH_GROUP_SZ control bytes are cloned after the end of
+ * the control array so that a group can always be loaded with a single read,
+ * including when it wraps around.
+ *
+ *        nb_slots                              group_sz
+ *   <---------------------------------------> <-------->
+ *
+ *  +----+----+----+----+-- ... --+----+----+----+-- ... -+
+ *  | c0 | c1 | c2 | c3 |         | cn | c0 | c1 |        |
+ *  +----+----+----+----+-- ... --+----+----+----+-- ... -+
+ *
+ * When incremental resizing is enabled, resizing the table only allocates
+ * new storage; the previous storage is kept and its entries are moved to the
+ * new one a few slots at a time, each time the table is accessed. Lookups
+ * search both storages while the rehash is in progress.
+ */
 
-struct c_hash_table_entry {
+#define C_HASH_TABLE_MIN_NB_SLOTS C_HASH_GROUP_SZ
+
+/* The number of slots of the previous storage processed each time an
+ * incrementally resized table is accessed. */
+#define C_HASH_TABLE_REHASH_STEP  32
+
+/* The number of keys hashed and prefetched before being looked up by
+ * c_hash_table_get_many(). */
+#define C_HASH_TABLE_BATCH_SZ     16
+
+/* See hash-group.h for the meaning of load factors */
+#define C_HASH_TABLE_MAX_MAX_LOAD_FACTOR 0.9375
+
+struct c_hash_table_slot {
     void *key;
     void *value;
-    uint32_t hash;
 };
 
-#define C_TABLE_ENTRY_IS_USED(entry_) ((entry_)->hash != C_UNUSED_HASH)
+struct c_hash_table_storage {
+    struct c_hash_table_slot *slots;
+    uint8_t *ctrl;
+    size_t nb_slots; /* always a power of two, 0 if not allocated */
 
-struct c_hash_table_bucket {
-    struct c_hash_table_entry *entries;
-    size_t sz;
+    size_t nb_entries;
+    size_t nb_deleted;
+
+    /* Number of entries for each probe length */
+    size_t probe_lengths[C_HASH_TABLE_PROBE_HISTOGRAM_SZ];
+
+    size_t alignment; /* alignment used to allocate slots */
 };
 
 struct c_hash_table {
     size_t nb_entries;
 
-    struct c_hash_table_bucket *buckets;
-    size_t buckets_sz;
+    struct c_hash_table_storage storage;
+
+    double max_load_factor;
+    double min_load_factor;
+    size_t max_load; /* maximum number of used slots in storage */
+    size_t min_load; /* number of entries under which storage is shrunk */
+    size_t min_nb_slots; /* the table is never shrunk below this size */
+
+    bool incremental_resize;
+    struct c_hash_table_storage old_storage;
+    size_t rehash_offset;
 
     c_hash_func hash_func;
     c_equal_func equal_func;
 
     int nb_iterators;
-};
+    bool shrink_pending; /* entries were removed during an iteration */
 
-struct c_hash_table_iterator {
-    struct c_hash_table *table;
-    size_t bucket;
-    size_t entry;
+    uint64_t nb_resizes;
+    uint64_t resize_time; /* nanoseconds */
+
+    const struct c_allocator *allocator;
+    size_t alignment; /* 0 if slots are not aligned */
 };
 
+static uint32_t c_hash_table_hash(const struct c_hash_table *, const void *);
+static size_t c_hash_table_max_load(const struct c_hash_table *, size_t);
+static int c_hash_table_nb_slots_for_capacity(const struct c_hash_table *,
+                                              size_t, size_t *);
+static void c_hash_table_update_load_limits(struct c_hash_table *);
 static int c_hash_table_resize(struct c_hash_table *, size_t);
-static int c_hash_table_insert_in(struct c_hash_table *,
-                                  struct c_hash_table_bucket *, size_t,
-                                  void *, void *, uint32_t, bool);
-static struct c_hash_table_entry *c_hash_table_entry(struct c_hash_table *,
-                                                     const void *);
+static void c_hash_table_shrink_if_needed(struct c_hash_table *);
+static uint64_t c_hash_table_now(void);
+static void c_hash_table_rehash(struct c_hash_table *, size_t);
+static void c_hash_table_rehash_on_access(struct c_hash_table *);
+static bool c_hash_table_lookup(const struct c_hash_table *, const void *,
+                                uint32_t, struct c_hash_table_storage **,
+                                size_t *);
+
+static int c_hash_table_storage_init(struct c_hash_table_storage *, size_t,
+                                     const struct c_allocator *, size_t);
+static void c_hash_table_storage_free(struct c_hash_table_storage *,
+                                      const struct c_allocator *);
+static void c_hash_table_storage_prefetch(const struct c_hash_table_storage *,
+                                          uint32_t);
+static bool c_hash_table_slot_equal(const void *, const void *,
+                                    const void *);
+static size_t c_hash_table_storage_find(const struct c_hash_table *,
+                                        const struct c_hash_table_storage *,
+                                        const void *, uint32_t);
+static size_t c_hash_table_storage_find_free_slot(
+    const struct c_hash_table_storage *, uint32_t);
+static void c_hash_table_storage_set(struct c_hash_table_storage *, size_t,
+                                     uint32_t, void *, void *);
+static void c_hash_table_storage_erase(struct c_hash_table_storage *, size_t,
+                                       uint32_t);
+static size_t c_hash_table_storage_probe_length(
+    const struct c_hash_table_storage *, size_t, uint32_t);
+static void c_hash_table_storage_add_probe_length(
+    struct c_hash_table_storage *, size_t, uint32_t, int);
+
+
+static uint64_t c_hash_wyhash(const void *, size_t, uint64_t);
+static void c_hash_mum(uint64_t *, uint64_t *);
+static uint64_t c_hash_wymix(uint64_t, uint64_t);
+static uint32_t c_hash_mix64(uint64_t);
+static uint64_t c_hash_read64(const uint8_t *);
+static uint64_t c_hash_read32(const uint8_t *);
+static size_t c_hash_string_length(const char *);
+
+static uint64_t c_hash_seed;
 
 
 struct c_hash_table *
 c_hash_table_new(c_hash_func hash_func, c_equal_func equal_func) {
+    return c_hash_table_new_with_allocator(hash_func, equal_func, NULL);
+}
+
+struct c_hash_table *
+c_hash_table_new_with_allocator(c_hash_func hash_func, c_equal_func equal_func,
+                                const struct c_allocator *allocator) {
     struct c_hash_table *table;
 
-    table = c_malloc(sizeof(struct c_hash_table));
-    if (!table) {
-        c_set_error("cannot allocate table: %m");
+    table = c_allocator_malloc0(allocator, sizeof(struct c_hash_table));
+    if (!table)
         return NULL;
-    }
 
-    memset(table, 0, sizeof(struct c_hash_table));
+    table->allocator = allocator;
+
+    table->max_load_factor = C_HASH_DEFAULT_MAX_LOAD_FACTOR;
+    table->min_load_factor = C_HASH_DEFAULT_MIN_LOAD_FACTOR;
+    table->min_nb_slots = C_HASH_TABLE_MIN_NB_SLOTS;
 
-    table->buckets_sz = 4;
-    table->buckets = c_calloc(table->buckets_sz,
-                              sizeof(struct c_hash_table_bucket));
-    if (!table->buckets) {
-        c_set_error("cannot allocate buckets: %m");
+    if (c_hash_table_storage_init(&table->storage, C_HASH_TABLE_MIN_NB_SLOTS,
+                                  allocator, 0) == -1) {
         c_hash_table_delete(table);
         return NULL;
     }
 
+    c_hash_table_update_load_limits(table);
+
     table->hash_func = hash_func;
     table->equal_func = equal_func;
 
     return table;
 }
 
+struct c_hash_table *
+c_hash_table_new_with_capacity(c_hash_func hash_func, c_equal_func equal_func,
+                               size_t capacity) {
+    struct c_hash_table *table;
+
+    table = c_hash_table_new(hash_func, equal_func);
+    if (!table)
+        return NULL;
+
+    if (c_hash_table_reserve(table, capacity) == -1) {
+        c_hash_table_delete(table);
+        return NULL;
+    }
+
+    return table;
+}
+
 void
 c_hash_table_delete(struct c_hash_table *table) {
     if (!table)
@@ -94,13 +215,10 @@ c_hash_table_delete(struct c_hash_table *table) {
 
     assert(table->nb_iterators == 0);
 
-    for (size_t i = 0; i < table->buckets_sz; i++)
-        c_free(table->buckets[i].entries);
-
-    c_free(table->buckets);
+    c_hash_table_storage_free(&table->storage, table->allocator);
+    c_hash_table_storage_free(&table->old_storage, table->allocator);
 
-    memset(table, 0, sizeof(struct c_hash_table));
-    c_free(table);
+    c_allocator_free0(table->allocator, table, sizeof(struct c_hash_table));
 }
 
 size_t
@@ -115,72 +233,211 @@ c_hash_table_is_empty(const struct c_hash_table *table) {
 
 void
 c_hash_table_clear(struct c_hash_table *table) {
+    struct c_hash_table_storage *storage;
+
     assert(table->nb_iterators == 0);
 
-    for (size_t b = 0; b < table->buckets_sz; b++) {
-        struct c_hash_table_bucket *bucket;
+    c_hash_table_storage_free(&table->old_storage, table->allocator);
 
-        bucket = table->buckets + b;
-        memset(bucket->entries, 0,
-               bucket->sz * sizeof(struct c_hash_table_entry));
-    }
+    storage = &table->storage;
+
+    memset(storage->ctrl, C_HASH_CTRL_EMPTY,
+           storage->nb_slots + C_HASH_GROUP_SZ);
+
+    storage->nb_entries = 0;
+    storage->nb_deleted = 0;
+
+    memset(storage->probe_lengths, 0, sizeof(storage->probe_lengths));
 
     table->nb_entries = 0;
 }
 
+size_t
+c_hash_table_capacity(const struct c_hash_table *table) {
+    return table->max_load;
+}
+
 int
-c_hash_table_insert(struct c_hash_table *table, void *key, void *value) {
-    uint32_t hash;
-    int ret;
+c_hash_table_reserve(struct c_hash_table *table, size_t capacity) {
+    size_t nb_slots;
 
     assert(table->nb_iterators == 0);
 
-    if (table->nb_entries >= table->buckets_sz) {
-        if (c_hash_table_resize(table, table->buckets_sz * 2) == -1)
-            return -1;
+    if (c_hash_table_nb_slots_for_capacity(table, capacity, &nb_slots) == -1)
+        return -1;
+
+    /* Removing entries must not undo the reservation */
+    table->min_nb_slots = nb_slots;
+
+    if (capacity <= table->max_load)
+        return 0;
+
+    return c_hash_table_resize(table, nb_slots);
+}
+
+int
+c_hash_table_shrink_to_fit(struct c_hash_table *table) {
+    size_t nb_slots;
+
+    assert(table->nb_iterators == 0);
+
+    if (c_hash_table_nb_slots_for_capacity(table, table->nb_entries,
+                                           &nb_slots) == -1) {
+        return -1;
     }
 
-    hash = table->hash_func(key);
-    if (hash == C_UNUSED_HASH)
-        hash++;
+    table->min_nb_slots = C_HASH_TABLE_MIN_NB_SLOTS;
+
+    if (nb_slots >= table->storage.nb_slots)
+        return 0;
+
+    return c_hash_table_resize(table, nb_slots);
+}
+
+int
+c_hash_table_set_alignment(struct c_hash_table *table, size_t alignment) {
+    size_t previous_alignment;
+
+    assert(table->nb_iterators == 0);
 
-    ret = c_hash_table_insert_in(table, table->buckets, table->buckets_sz,
-                                 key, value, hash, false);
-    if (ret == -1)
+    if ((alignment & (alignment - 1)) != 0) {
+        c_set_error("invalid alignment %zu", alignment);
         return -1;
+    }
+
+    if (alignment == table->alignment)
+        return 0;
 
-    if (ret == 1)
-        table->nb_entries++;
+    /* Entries are moved to a new storage allocated with the new alignment */
+    previous_alignment = table->alignment;
+    table->alignment = alignment;
 
-    return ret;
+    if (c_hash_table_resize(table, table->storage.nb_slots) == -1) {
+        table->alignment = previous_alignment;
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+c_hash_table_set_load_factors(struct c_hash_table *table,
+                              double max_load_factor, double min_load_factor) {
+    if (!(max_load_factor > 0.0
+          && max_load_factor <= C_HASH_TABLE_MAX_MAX_LOAD_FACTOR)) {
+        c_set_error("invalid maximum load factor");
+        return -1;
+    }
+
+    if (!(min_load_factor >= 0.0 && min_load_factor * 2 < max_load_factor)) {
+        c_set_error("invalid minimum load factor");
+        return -1;
+    }
+
+    table->max_load_factor = max_load_factor;
+    table->min_load_factor = min_load_factor;
+
+    /* If the table is now overloaded, the next insertion will grow it. */
+    c_hash_table_update_load_limits(table);
+
+    return 0;
+}
+
+void
+c_hash_table_set_incremental_resize(struct c_hash_table *table, bool enabled) {
+    table->incremental_resize = enabled;
+
+    if (!enabled && table->nb_iterators == 0)
+        c_hash_table_rehash(table, SIZE_MAX);
+}
+
+bool
+c_hash_table_is_rehashing(const struct c_hash_table *table) {
+    return table->old_storage.nb_slots > 0;
+}
+
+int
+c_hash_table_rehash_step(struct c_hash_table *table, size_t nb_slots) {
+    if (table->nb_iterators == 0 && c_hash_table_is_rehashing(table)) {
+        uint64_t start;
+
+        start = c_hash_table_now();
+        c_hash_table_rehash(table, nb_slots);
+        table->resize_time += c_hash_table_now() - start;
+    }
+
+    return c_hash_table_is_rehashing(table) ? 1 : 0;
+}
+
+int
+c_hash_table_insert(struct c_hash_table *table, void *key, void *value) {
+    return c_hash_table_insert2(table, key, value, NULL, NULL);
 }
 
 int
 c_hash_table_insert2(struct c_hash_table *table, void *key, void *value,
                      void **old_key, void **old_value) {
-    struct c_hash_table_entry *entry;
+    return c_hash_table_insert2_with_hash(table, key, table->hash_func(key),
+                                          value, old_key, old_value);
+}
+
+int
+c_hash_table_insert2_with_hash(struct c_hash_table *table, void *key,
+                               uint32_t hash, void *value,
+                               void **old_key, void **old_value) {
+    struct c_hash_table_storage *storage;
+    struct c_hash_table_slot *slot;
+    size_t idx;
 
     assert(table->nb_iterators == 0);
 
-    entry = c_hash_table_entry(table, key);
-    if (entry) {
+    c_hash_table_rehash_on_access(table);
+
+    hash = c_hash_mix(hash);
+
+    if (c_hash_table_lookup(table, key, hash, &storage, &idx)) {
+        slot = storage->slots + idx;
+
         if (old_key)
-            *old_key = entry->key;
+            *old_key = slot->key;
         if (old_value)
-            *old_value = entry->value;
+            *old_value = slot->value;
 
-        entry->key = key;
-        entry->value = value;
+        slot->key = key;
+        slot->value = value;
 
         return 0;
-    } else {
-        if (old_key)
-            *old_key = NULL;
-        if (old_value)
-            *old_value = NULL;
+    }
+
+    storage = &table->storage;
+
+    idx = c_hash_table_storage_find_free_slot(storage, hash);
+
+    if (storage->ctrl[idx] == C_HASH_CTRL_EMPTY
+     && storage->nb_entries + storage->nb_deleted >= table->max_load) {
+        size_t nb_slots;
+
+        /* If most used slots are deleted, rehashing the table at its
+         * current size is enough to make space. */
+        nb_slots = storage->nb_slots;
+        while (table->nb_entries * 2 >= c_hash_table_max_load(table, nb_slots))
+            nb_slots *= 2;
 
-        return c_hash_table_insert(table, key, value);
+        if (c_hash_table_resize(table, nb_slots) == -1)
+            return -1;
+
+        idx = c_hash_table_storage_find_free_slot(storage, hash);
     }
+
+    c_hash_table_storage_set(storage, idx, hash, key, value);
+    table->nb_entries++;
+
+    if (old_key)
+        *old_key = NULL;
+    if (old_value)
+        *old_value = NULL;
+
+    return 1;
 }
 
 int
@@ -191,48 +448,119 @@ c_hash_table_remove(struct c_hash_table *table, const void *key) {
 int
 c_hash_table_remove2(struct c_hash_table *table, const void *key,
                      void **old_key, void **old_value) {
-    struct c_hash_table_entry *entry;
-    bool should_resize;
+    return c_hash_table_remove2_with_hash(table, key, table->hash_func(key),
+                                          old_key, old_value);
+}
+
+int
+c_hash_table_remove2_with_hash(struct c_hash_table *table, const void *key,
+                               uint32_t hash, void **old_key, void **old_value) {
+    struct c_hash_table_storage *storage;
+    struct c_hash_table_slot *slot;
+    size_t idx;
+
+    c_hash_table_rehash_on_access(table);
+
+    hash = c_hash_mix(hash);
 
-    entry = c_hash_table_entry(table, key);
-    if (!entry)
+    if (!c_hash_table_lookup(table, key, hash, &storage, &idx))
         return 0;
 
+    slot = storage->slots + idx;
+
     if (old_key)
-        *old_key = entry->key;
+        *old_key = slot->key;
     if (old_value)
-        *old_value = entry->value;
+        *old_value = slot->value;
 
-    entry->key = NULL;
-    entry->value = NULL;
-    entry->hash = C_UNUSED_HASH;
+    c_hash_table_storage_erase(storage, idx, hash);
+    table->nb_entries--;
 
-    should_resize = table->buckets_sz > 4
-        && table->nb_entries * 4 <= table->buckets_sz;
-    if (table->nb_iterators == 0 && should_resize) {
-        if (c_hash_table_resize(table, table->buckets_sz / 2) == -1)
-            return -1;
-    }
+    c_hash_table_shrink_if_needed(table);
 
-    table->nb_entries--;
     return 1;
 }
 
 int
 c_hash_table_get(struct c_hash_table *table, const void *key, void **value) {
-    struct c_hash_table_entry *entry;
+    return c_hash_table_get_with_hash(table, key, table->hash_func(key), value);
+}
+
+int
+c_hash_table_get_with_hash(struct c_hash_table *table, const void *key,
+                           uint32_t hash, void **value) {
+    struct c_hash_table_storage *storage;
+    size_t idx;
 
-    entry = c_hash_table_entry(table, key);
-    if (!entry)
+    c_hash_table_rehash_on_access(table);
+
+    if (!c_hash_table_lookup(table, key, c_hash_mix(hash),
+                             &storage, &idx)) {
         return 0;
+    }
 
-    *value = entry->value;
+    *value = storage->slots[idx].value;
     return 1;
 }
 
+size_t
+c_hash_table_get_many(struct c_hash_table *table, const void * const *keys,
+                      size_t nb_keys, void **values, bool *found) {
+    uint32_t hashes[C_HASH_TABLE_BATCH_SZ];
+    size_t nb_found;
+
+    c_hash_table_rehash_on_access(table);
+
+    nb_found = 0;
+
+    for (size_t start = 0; start < nb_keys; start += C_HASH_TABLE_BATCH_SZ) {
+        size_t end;
+
+        end = start + C_HASH_TABLE_BATCH_SZ;
+        if (end > nb_keys)
+            end = nb_keys;
+
+        /* Hash all keys of the batch and start loading the memory their
+         * lookup will need, so that cache misses overlap instead of being
+         * serialized. */
+        for (size_t i = start; i < end; i++) {
+            uint32_t hash;
+
+            hash = c_hash_table_hash(table, keys[i]);
+            c_hash_table_storage_prefetch(&table->storage, hash);
+
+            hashes[i - start] = hash;
+        }
+
+        for (size_t i = start; i < end; i++) {
+            struct c_hash_table_storage *storage;
+            bool key_found;
+            size_t idx;
+
+            key_found = c_hash_table_lookup(table, keys[i], hashes[i - start],
+                                            &storage, &idx);
+            if (key_found) {
+                values[i] = storage->slots[idx].value;
+                nb_found++;
+            }
+
+            if (found)
+                found[i] = key_found;
+        }
+    }
+
+    return nb_found;
+}
+
 bool
 c_hash_table_contains(struct c_hash_table *table, const void *key) {
-    return c_hash_table_entry(table, key) != NULL;
+    struct c_hash_table_storage *storage;
+    size_t idx;
+
+    c_hash_table_rehash_on_access(table);
+
+    return c_hash_table_lookup(table, key, c_hash_table_hash(table, key),
+                               &storage, &idx);
 }
 
 struct c_hash_table_iterator *
@@ -245,11 +573,7 @@ c_hash_table_iterate(struct c_hash_table *table) {
         return NULL;
     }
 
-    it->table = table;
-    it->bucket = SIZE_MAX;
-    it->entry = 0;
-
-    table->nb_iterators++;
+    c_hash_table_iterator_init(it, table);
 
     return it;
 }
@@ -259,78 +583,187 @@ c_hash_table_iterator_delete(struct c_hash_table_iterator *it) {
     if (!it)
         return;
 
-    assert(it->table->nb_iterators > 0);
-    it->table->nb_iterators--;
+    c_hash_table_iterator_finish(it);
 
     memset(it, 0, sizeof(struct c_hash_table_iterator));
     c_free(it);
 }
 
+void
+c_hash_table_iterator_init(struct c_hash_table_iterator *it,
+                           struct c_hash_table *table) {
+    it->table = table;
+    it->storage = NULL;
+    it->slot = SIZE_MAX;
+    it->registered = true;
+
+    table->nb_iterators++;
+}
+
+void
+c_hash_table_iterator_finish(struct c_hash_table_iterator *it) {
+    struct c_hash_table *table;
+
+    if (!it->registered)
+        return;
+
+    table = it->table;
+
+    assert(table->nb_iterators > 0);
+    table->nb_iterators--;
+
+    it->registered = false;
+
+    /* Only check the load of the table if entries were removed during the
+     * iteration, so that read-only iterations never resize it. */
+    if (table->nb_iterators == 0 && table->shrink_pending) {
+        table->shrink_pending = false;
+        c_hash_table_shrink_if_needed(table);
+    }
+}
+
 int
 c_hash_table_iterator_next(struct c_hash_table_iterator *it,
                            void **key, void **value) {
-    if (it->bucket == SIZE_MAX) {
-        it->bucket = 0;
-        it->entry = 0;
+    struct c_hash_table *table;
+    struct c_hash_table_storage *storage;
+    size_t idx;
+
+    if (!it->registered)
+        return 0;
+
+    table = it->table;
+
+    if (it->slot == SIZE_MAX) {
+        storage = &table->storage;
+        idx = 0;
     } else {
-        it->entry++;
+        storage = it->storage;
+        idx = it->slot + 1;
     }
 
     for (;;) {
-        struct c_hash_table_bucket *bucket;
-        struct c_hash_table_entry *entry;
-
-        bucket = it->table->buckets + it->bucket;
-        if (it->entry >= bucket->sz) {
-            it->bucket++;
-            bucket++;
-
-            if (it->bucket >= it->table->buckets_sz) {
-                it->bucket = SIZE_MAX;
-                it->entry = 0;
-                return 0;
+        if (idx >= storage->nb_slots) {
+            /* Entries which have not been moved yet by an incremental
+             * rehash are still in the previous storage. */
+            if (storage == &table->old_storage
+             || !c_hash_table_is_rehashing(table)) {
+                break;
             }
 
-            it->entry = 0;
+            storage = &table->old_storage;
+            idx = 0;
+            continue;
         }
 
-        if (!bucket->entries)
-            continue;
-        entry = bucket->entries + it->entry;
+        if (C_HASH_CTRL_IS_FULL(storage->ctrl[idx])) {
+            struct c_hash_table_slot *slot;
+
+            slot = storage->slots + idx;
 
-        if (C_TABLE_ENTRY_IS_USED(entry)) {
             if (key)
-                *key = entry->key;
+                *key = slot->key;
             if (value)
-                *value = entry->value;
-            break;
+                *value = slot->value;
+
+            it->storage = storage;
+            it->slot = idx;
+            return 1;
         }
 
-        it->entry++;
+        idx++;
     }
 
-    return 1;
+    it->storage = NULL;
+    it->slot = SIZE_MAX;
+
+    c_hash_table_iterator_finish(it);
+    return 0;
 }
 
 void
 c_hash_table_iterator_set_value(struct c_hash_table_iterator *it, void *value) {
-    struct c_hash_table_bucket *bucket;
-    struct c_hash_table_entry *entry;
+    struct c_hash_table_storage *storage;
+
+    storage = it->storage;
 
-    if (it->bucket == SIZE_MAX)
+    if (it->slot == SIZE_MAX)
+        return;
+    if (!C_HASH_CTRL_IS_FULL(storage->ctrl[it->slot]))
         return;
 
-    bucket = it->table->buckets + it->bucket;
-    entry = bucket->entries + it->entry;
+    storage->slots[it->slot].value = value;
+}
+
+void
+c_hash_table_iterator_remove(struct c_hash_table_iterator *it) {
+    struct c_hash_table_storage *storage;
+    uint32_t hash;
 
-    entry->value = value;
+    storage = it->storage;
+
+    if (it->slot == SIZE_MAX)
+        return;
+    if (!C_HASH_CTRL_IS_FULL(storage->ctrl[it->slot]))
+        return;
+
+    hash = c_hash_table_hash(it->table, storage->slots[it->slot].key);
+
+    /* Erasing a slot never moves other entries, so the iteration can
+     * continue with the next slot. */
+    c_hash_table_storage_erase(storage, it->slot, hash);
+    it->table->nb_entries--;
+
+    it->table->shrink_pending = true;
+}
+
+int
+c_hash_table_foreach(struct c_hash_table *table,
+                     c_hash_table_foreach_func func, void *arg) {
+    struct c_hash_table_iterator it;
+    void *key, *value;
+
+    c_hash_table_iterator_init(&it, table);
+
+    while (c_hash_table_iterator_next(&it, &key, &value) == 1) {
+        int ret;
+
+        ret = func(key, value, arg);
+        if (ret != 0) {
+            c_hash_table_iterator_finish(&it);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+size_t
+c_hash_table_remove_if(struct c_hash_table *table,
+                       c_hash_table_predicate_func func, void *arg) {
+    struct c_hash_table_iterator it;
+    void *key, *value;
+    size_t nb_removed;
+
+    nb_removed = 0;
+
+    c_hash_table_iterator_init(&it, table);
+
+    while (c_hash_table_iterator_next(&it, &key, &value) == 1) {
+        if (func(key, value, arg)) {
+            c_hash_table_iterator_remove(&it);
+            nb_removed++;
+        }
+    }
+
+    return nb_removed;
 }
 
 int
 c_hash_table_keys(struct c_hash_table *table, void ***pkeys, size_t *p_nb_keys) {
-    struct c_hash_table_iterator *it;
+    struct c_hash_table_storage *storages[2];
     size_t nb_keys;
-    void **keys, *key;
+    void **keys;
     size_t idx;
 
     nb_keys = table->nb_entries;
@@ -344,37 +777,59 @@ c_hash_table_keys(struct c_hash_table *table, void ***pkeys, size_t *p_nb_keys)
     if (!keys)
         return -1;
 
-    it = c_hash_table_iterate(table);
-    if (!it) {
-        c_free(keys);
-        return -1;
-    }
+    storages[0] = &table->storage;
+    storages[1] = &table->old_storage;
 
     idx = 0;
-    while (c_hash_table_iterator_next(it, &key, NULL) == 1)
-        keys[idx++] = key;
+    for (size_t s = 0; s < 2; s++) {
+        struct c_hash_table_storage *storage;
+
+        storage = storages[s];
 
-    c_hash_table_iterator_delete(it);
+        for (size_t i = 0; i < storage->nb_slots; i++) {
+            if (C_HASH_CTRL_IS_FULL(storage->ctrl[i]))
+                keys[idx++] = storage->slots[i].key;
+        }
+    }
 
     *pkeys = keys;
     *p_nb_keys = nb_keys;
     return 0;
 }
 
+void
+c_set_hash_seed(uint64_t seed) {
+    c_hash_seed = seed;
+}
+
+uint32_t
+c_hash_memory(const void *ptr, size_t len) {
+    return c_hash_memory_seeded(ptr, len, 0);
+}
+
+uint32_t
+c_hash_memory_seeded(const void *ptr, size_t len, uint64_t seed) {
+    uint64_t hash;
+
+    hash = c_hash_wyhash(ptr, len, seed);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
 uint32_t
 c_hash_int32(const void *key) {
-    int32_t integer;
-    unsigned char *bytes;
-    uint32_t hash;
+    uint32_t x;
 
-    integer = C_POINTER_TO_INT32(key);
-    bytes = (unsigned char *)&integer;
+    /* Integer hash with a low bias (Chris Wellons, "lowbias32"). It is a
+     * bijection, so distinct integers never have the same hash. */
+    x = (uint32_t)C_POINTER_TO_INT32(key);
 
-    hash = 5381;
-    for (int i = 0; i < 4; i++)
-        hash = ((hash << 5) + hash) ^ bytes[i];
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
 
-    return hash;
+    return x;
 }
 
 bool
@@ -383,15 +838,33 @@ c_equal_int32(const void *k1, const void *k2) {
 }
 
 uint32_t
-c_hash_string(const void *key) {
-    const unsigned char *str;
-    uint32_t hash;
+c_hash_int64(const void *key) {
+    return c_hash_mix64((uint64_t)*(const int64_t *)key);
+}
 
-    hash = 5381;
-    for (str = key; *str; str++)
-        hash = ((hash << 5) + hash) ^ *str;
+bool
+c_equal_int64(const void *k1, const void *k2) {
+    return *(const int64_t *)k1 == *(const int64_t *)k2;
+}
 
-    return hash;
+uint32_t
+c_hash_pointer(const void *key) {
+    return c_hash_mix64((uint64_t)(uintptr_t)key);
+}
+
+bool
+c_equal_pointer(const void *k1, const void *k2) {
+    return k1 == k2;
+}
+
+uint32_t
+c_hash_string(const void *key) {
+    return c_hash_memory_seeded(key, c_hash_string_length(key), 0);
+}
+
+uint32_t
+c_hash_string_seeded(const void *key) {
+    return c_hash_memory_seeded(key, c_hash_string_length(key), c_hash_seed);
 }
 
 bool
@@ -399,57 +872,95 @@ c_equal_string(const void *k1, const void *k2) {
     return strcmp(k1, k2) == 0;
 }
 
-static struct c_hash_table_entry *
-c_hash_table_entry(struct c_hash_table *table, const void *key) {
-    struct c_hash_table_bucket *bucket;
-    uint32_t hash;
+void
+c_hash_table_stats(const struct c_hash_table *table,
+                   struct c_hash_table_stats *stats) {
+    const struct c_hash_table_storage *storages[2];
+    size_t total_probe_length;
 
-    hash = table->hash_func(key);
-    if (hash == C_UNUSED_HASH)
-        hash++;
+    memset(stats, 0, sizeof(struct c_hash_table_stats));
 
-    bucket = table->buckets + (hash % table->buckets_sz);
-    if (!bucket->entries)
-        return NULL;
+    stats->nb_entries = table->nb_entries;
+    stats->memory_size = sizeof(struct c_hash_table);
+
+    storages[0] = &table->storage;
+    storages[1] = &table->old_storage;
 
-    for (size_t i = 0; i < bucket->sz; i++) {
-        struct c_hash_table_entry *entry;
+    for (size_t s = 0; s < 2; s++) {
+        const struct c_hash_table_storage *storage;
 
-        entry = bucket->entries + i;
-        if (!C_TABLE_ENTRY_IS_USED(entry))
+        storage = storages[s];
+        if (storage->nb_slots == 0)
             continue;
 
-        if (entry->hash == hash && table->equal_func(key, entry->key))
-            return entry;
+        stats->nb_slots += storage->nb_slots;
+        stats->nb_deleted_slots += storage->nb_deleted;
+        stats->memory_size += storage->nb_slots
+            * (sizeof(struct c_hash_table_slot) + 1) + C_HASH_GROUP_SZ;
+
+        for (size_t i = 0; i < C_HASH_TABLE_PROBE_HISTOGRAM_SZ; i++)
+            stats->probe_lengths[i] += storage->probe_lengths[i];
     }
 
-    return NULL;
+    stats->load_factor = (double)(table->storage.nb_entries
+                                  + table->storage.nb_deleted)
+                       / (double)table->storage.nb_slots;
+
+    total_probe_length = 0;
+
+    for (size_t i = 0; i < C_HASH_TABLE_PROBE_HISTOGRAM_SZ; i++) {
+        if (stats->probe_lengths[i] == 0)
+            continue;
+
+        stats->max_probe_length = i + 1;
+        total_probe_length += (i + 1) * stats->probe_lengths[i];
+    }
+
+    if (stats->nb_entries > 0) {
+        stats->mean_probe_length = (double)total_probe_length
+                                 / (double)stats->nb_entries;
+    }
+
+    stats->nb_resizes = table->nb_resizes;
+    stats->resize_time = table->resize_time;
 }
 
 void
 c_hash_table_print(struct c_hash_table *table, FILE *file) {
+    struct c_hash_table_storage *storages[2];
+
     fprintf(file, "entries: %zu\n", table->nb_entries);
-    fprintf(file, "buckets: %zu\n", table->buckets_sz);
 
-    for (size_t b = 0; b < table->buckets_sz; b++) {
-        struct c_hash_table_bucket *bucket;
+    storages[0] = &table->storage;
+    storages[1] = &table->old_storage;
 
-        bucket = table->buckets + b;
+    for (size_t s = 0; s < 2; s++) {
+        struct c_hash_table_storage *storage;
+
+        storage = storages[s];
+        if (storage->nb_slots == 0)
+            continue;
 
-        fprintf(file, "bucket %04zu\n", b);
+        fprintf(file, "%s storage\n", (s == 0) ? "current" : "previous");
+        fprintf(file, "  entries: %zu\n", storage->nb_entries);
+        fprintf(file, "  deleted: %zu\n", storage->nb_deleted);
+        fprintf(file, "  slots: %zu\n", storage->nb_slots);
 
-        for (size_t e = 0; e < bucket->sz; e++) {
-            struct c_hash_table_entry *entry;
+        for (size_t i = 0; i < storage->nb_slots; i++) {
+            struct c_hash_table_slot *slot;
+            uint8_t ctrl;
 
-            entry = bucket->entries + e;
+            slot = storage->slots + i;
+            ctrl = storage->ctrl[i];
 
-            fprintf(file, "  entry %02zu  ", e);
+            fprintf(file, "  slot %04zu  ", i);
 
-            if (C_TABLE_ENTRY_IS_USED(entry)) {
+            if (C_HASH_CTRL_IS_FULL(ctrl)) {
                 fprintf(file, "key=%08"PRIxPTR" value=%08"PRIxPTR
-                        " hash=%"PRIu32,
-                        (intptr_t)entry->key, (intptr_t)entry->value,
-                        entry->hash);
+                        " h2=%02"PRIx8,
+                        (intptr_t)slot->key, (intptr_t)slot->value, ctrl);
+            } else if (ctrl == C_HASH_CTRL_DELETED) {
+                fputs("deleted", file);
             }
 
             fputc('\n', file);
@@ -457,122 +968,511 @@ c_hash_table_print(struct c_hash_table *table, FILE *file) {
     }
 }
 
+static uint32_t
+c_hash_table_hash(const struct c_hash_table *table, const void *key) {
+    return c_hash_mix(table->hash_func(key));
+}
+
+static size_t
+c_hash_table_max_load(const struct c_hash_table *table, size_t nb_slots) {
+    return c_hash_max_load(nb_slots, table->max_load_factor);
+}
+
+static int
+c_hash_table_nb_slots_for_capacity(const struct c_hash_table *table,
+                                   size_t capacity, size_t *pnb_slots) {
+    size_t nb_slots;
+
+    nb_slots = C_HASH_TABLE_MIN_NB_SLOTS;
+
+    while (c_hash_table_max_load(table, nb_slots) < capacity) {
+        if (nb_slots > SIZE_MAX / 2 / sizeof(struct c_hash_table_slot)) {
+            c_set_error("capacity too large");
+            return -1;
+        }
+
+        nb_slots *= 2;
+    }
+
+    *pnb_slots = nb_slots;
+    return 0;
+}
+
+static void
+c_hash_table_update_load_limits(struct c_hash_table *table) {
+    size_t nb_slots;
+
+    nb_slots = table->storage.nb_slots;
+
+    table->max_load = c_hash_table_max_load(table, nb_slots);
+    table->min_load = c_hash_min_load(nb_slots, table->min_load_factor);
+}
+
 static int
-c_hash_table_resize(struct c_hash_table *table, size_t sz) {
-    struct c_hash_table_bucket *buckets;
+c_hash_table_resize(struct c_hash_table *table, size_t nb_slots) {
+    struct c_hash_table_storage storage;
+    uint64_t start;
+
+    assert(nb_slots >= C_HASH_TABLE_MIN_NB_SLOTS);
+    assert(table->nb_entries <= c_hash_table_max_load(table, nb_slots));
 
-    buckets = c_calloc(sz, sizeof(struct c_hash_table_bucket));
-    if (!buckets) {
-        c_set_error("cannot allocate buckets: %m");
+    start = c_hash_table_now();
+
+    /* Since each insertion moves C_HASH_TABLE_REHASH_STEP slots, the new
+     * storage is always large enough to receive all entries of the previous
+     * one before having to grow again. We still make sure that there is at
+     * most one rehash in progress. */
+    c_hash_table_rehash(table, SIZE_MAX);
+
+    if (c_hash_table_storage_init(&storage, nb_slots, table->allocator,
+                                  table->alignment) == -1) {
         return -1;
     }
 
-    for (size_t b = 0; b < table->buckets_sz; b++) {
-        struct c_hash_table_bucket *bucket;
+    table->old_storage = table->storage;
+    table->storage = storage;
+    table->rehash_offset = 0;
+
+    c_hash_table_update_load_limits(table);
+
+    if (!table->incremental_resize)
+        c_hash_table_rehash(table, SIZE_MAX);
+
+    table->nb_resizes++;
+    table->resize_time += c_hash_table_now() - start;
+
+    return 0;
+}
+
+static uint64_t
+c_hash_table_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void
+c_hash_table_shrink_if_needed(struct c_hash_table *table) {
+    struct c_hash_table_storage *storage;
+
+    /* Entries never move while the table is being iterated, so we cannot
+     * shrink it; the table is checked again when the last iterator is
+     * finished. Failing to shrink the table is harmless: the entry has been
+     * removed anyway. */
+    if (table->nb_iterators > 0) {
+        table->shrink_pending = true;
+        return;
+    }
+
+    if (c_hash_table_is_rehashing(table))
+        return;
+
+    storage = &table->storage;
+
+    if (storage->nb_slots > table->min_nb_slots
+     && table->nb_entries < table->min_load) {
+        c_hash_table_resize(table, storage->nb_slots / 2);
+    }
+}
+
+static void
+c_hash_table_rehash(struct c_hash_table *table, size_t nb_slots) {
+    struct c_hash_table_storage *old_storage, *storage;
+    size_t end;
+
+    old_storage = &table->old_storage;
+    storage = &table->storage;
 
-        bucket = table->buckets + b;
-        if (!bucket->entries)
+    if (old_storage->nb_slots == 0)
+        return;
+
+    end = old_storage->nb_slots;
+    if (nb_slots < end - table->rehash_offset)
+        end = table->rehash_offset + nb_slots;
+
+    for (size_t i = table->rehash_offset; i < end; i++) {
+        struct c_hash_table_slot *slot;
+        uint32_t hash;
+        size_t idx;
+
+        if (!C_HASH_CTRL_IS_FULL(old_storage->ctrl[i]))
             continue;
 
-        for (size_t e = 0; e < bucket->sz; e++) {
-            struct c_hash_table_entry *entry;
+        slot = old_storage->slots + i;
+        hash = c_hash_table_hash(table, slot->key);
 
-            entry = bucket->entries + e;
-            if (!C_TABLE_ENTRY_IS_USED(entry))
-                continue;
+        idx = c_hash_table_storage_find_free_slot(storage, hash);
+        c_hash_table_storage_set(storage, idx, hash, slot->key, slot->value);
 
-            if (c_hash_table_insert_in(table, buckets, sz,
-                                       entry->key, entry->value,
-                                       entry->hash, true) == -1) {
-                for (size_t i = 0; i < sz; i++)
-                    c_free(buckets[i].entries);
-                c_free(buckets);
-                return -1;
-            }
-        }
+        /* Lookups may still go through the previous storage, so the entry
+         * must be removed from it without breaking probe sequences. */
+        c_hash_ctrl_set(old_storage->ctrl, old_storage->nb_slots, i,
+                        C_HASH_CTRL_DELETED);
+        c_hash_table_storage_add_probe_length(old_storage, i, hash, -1);
+        old_storage->nb_entries--;
+        old_storage->nb_deleted++;
     }
 
-    for (size_t b = 0; b < table->buckets_sz; b++)
-        c_free(table->buckets[b].entries);
-    c_free(table->buckets);
+    table->rehash_offset = end;
 
-    table->buckets_sz = sz;
-    table->buckets = buckets;
+    if (table->rehash_offset == old_storage->nb_slots) {
+        assert(old_storage->nb_entries == 0);
 
-    return 0;
+        c_hash_table_storage_free(old_storage, table->allocator);
+        table->rehash_offset = 0;
+    }
+}
+
+static void
+c_hash_table_rehash_on_access(struct c_hash_table *table) {
+    if (c_hash_table_is_rehashing(table) && table->nb_iterators == 0) {
+        uint64_t start;
+
+        start = c_hash_table_now();
+        c_hash_table_rehash(table, C_HASH_TABLE_REHASH_STEP);
+        table->resize_time += c_hash_table_now() - start;
+    }
+}
+
+static bool
+c_hash_table_lookup(const struct c_hash_table *table, const void *key,
+                    uint32_t hash, struct c_hash_table_storage **pstorage,
+                    size_t *pidx) {
+    const struct c_hash_table_storage *storage;
+    size_t idx;
+
+    storage = &table->storage;
+    idx = c_hash_table_storage_find(table, storage, key, hash);
+
+    if (idx == SIZE_MAX && table->old_storage.nb_entries > 0) {
+        storage = &table->old_storage;
+        idx = c_hash_table_storage_find(table, storage, key, hash);
+    }
+
+    if (idx == SIZE_MAX)
+        return false;
+
+    *pstorage = (struct c_hash_table_storage *)storage;
+    *pidx = idx;
+    return true;
 }
 
 static int
-c_hash_table_insert_in(struct c_hash_table *table,
-                       struct c_hash_table_bucket *buckets, size_t sz,
-                       void *key, void *value, uint32_t hash,
-                       bool is_resizing) {
-    struct c_hash_table_bucket *bucket;
-    struct c_hash_table_entry *entry;
-    bool new_entry_inserted;
+c_hash_table_storage_init(struct c_hash_table_storage *storage,
+                          size_t nb_slots,
+                          const struct c_allocator *allocator,
+                          size_t alignment) {
+    size_t sz;
 
-    bucket = buckets + (hash % sz);
+    memset(storage, 0, sizeof(struct c_hash_table_storage));
 
-    entry = NULL;
-    new_entry_inserted = true;
+    /* Slots and control bytes are stored in the same memory block */
+    sz = nb_slots * sizeof(struct c_hash_table_slot)
+       + nb_slots + C_HASH_GROUP_SZ;
 
-    if (bucket->entries) {
-        for (size_t i = 0; i < bucket->sz; i++) {
-            struct c_hash_table_entry *curr_entry;
+    storage->slots = c_allocator_aligned_alloc(allocator, alignment, sz);
+    if (!storage->slots)
+        return -1;
 
-            curr_entry = bucket->entries + i;
+    storage->alignment = alignment;
 
-            if (!C_TABLE_ENTRY_IS_USED(curr_entry)) {
-                if (!entry)
-                    entry = curr_entry;
+    storage->ctrl = (uint8_t *)(storage->slots + nb_slots);
+    memset(storage->ctrl, C_HASH_CTRL_EMPTY,
+           nb_slots + C_HASH_GROUP_SZ);
 
-                if (is_resizing)
-                    break;
-                continue;
-            }
+    storage->nb_slots = nb_slots;
 
-            if (hash == curr_entry->hash
-                && table->equal_func(key, curr_entry->key)) {
-                entry = curr_entry;
-                new_entry_inserted = false;
-                break;
-            }
-        }
+    return 0;
+}
+
+static void
+c_hash_table_storage_free(struct c_hash_table_storage *storage,
+                          const struct c_allocator *allocator) {
+    size_t nb_slots;
+
+    nb_slots = storage->nb_slots;
+
+    c_allocator_aligned_free(allocator, storage->alignment, storage->slots,
+                             nb_slots * sizeof(struct c_hash_table_slot)
+                             + nb_slots + C_HASH_GROUP_SZ);
+    memset(storage, 0, sizeof(struct c_hash_table_storage));
+}
+
+static void
+c_hash_table_storage_prefetch(const struct c_hash_table_storage *storage,
+                              uint32_t hash) {
+    size_t offset;
+
+    offset = C_HASH_H1(hash) & (storage->nb_slots - 1);
+
+    __builtin_prefetch(storage->ctrl + offset);
+    __builtin_prefetch(storage->slots + offset);
+}
+
+static bool
+c_hash_table_slot_equal(const void *data, const void *slot, const void *key) {
+    const struct c_hash_table *table;
+    const struct c_hash_table_slot *table_slot;
+
+    table = data;
+    table_slot = slot;
+
+    return table->equal_func(key, table_slot->key);
+}
+
+static size_t
+c_hash_table_storage_find(const struct c_hash_table *table,
+                          const struct c_hash_table_storage *storage,
+                          const void *key, uint32_t hash) {
+    return c_hash_ctrl_find(storage->ctrl, storage->nb_slots, storage->slots,
+                            sizeof(struct c_hash_table_slot), hash,
+                            c_hash_table_slot_equal, table, key);
+}
+
+static size_t
+c_hash_table_storage_find_free_slot(
+    const struct c_hash_table_storage *storage, uint32_t hash) {
+    return c_hash_ctrl_find_free_slot(storage->ctrl, storage->nb_slots, hash);
+}
+
+static void
+c_hash_table_storage_set(struct c_hash_table_storage *storage, size_t idx,
+                         uint32_t hash, void *key, void *value) {
+    struct c_hash_table_slot *slot;
+
+    if (storage->ctrl[idx] == C_HASH_CTRL_DELETED)
+        storage->nb_deleted--;
+
+    c_hash_ctrl_set(storage->ctrl, storage->nb_slots, idx, C_HASH_H2(hash));
+    c_hash_table_storage_add_probe_length(storage, idx, hash, 1);
+
+    slot = storage->slots + idx;
+    slot->key = key;
+    slot->value = value;
+
+    storage->nb_entries++;
+}
+
+static void
+c_hash_table_storage_erase(struct c_hash_table_storage *storage, size_t idx,
+                           uint32_t hash) {
+    if (c_hash_ctrl_erase(storage->ctrl, storage->nb_slots, idx)
+        == C_HASH_CTRL_DELETED) {
+        storage->nb_deleted++;
+    }
+
+    c_hash_table_storage_add_probe_length(storage, idx, hash, -1);
+
+    storage->slots[idx].key = NULL;
+    storage->slots[idx].value = NULL;
+
+    storage->nb_entries--;
+}
+
+static size_t
+c_hash_table_storage_probe_length(const struct c_hash_table_storage *storage,
+                                  size_t idx, uint32_t hash) {
+    struct c_hash_probe probe;
+    size_t length;
+
+    /* Replay the probe sequence until the group containing the slot */
+    c_hash_probe_init(&probe, hash, storage->nb_slots);
+
+    for (length = 1;; length++) {
+        if (((idx - probe.offset) & probe.mask) < C_HASH_GROUP_SZ)
+            return length;
+
+        c_hash_probe_next(&probe);
+    }
+}
+
+static void
+c_hash_table_storage_add_probe_length(struct c_hash_table_storage *storage,
+                                      size_t idx, uint32_t hash, int delta) {
+    size_t length;
+
+    length = c_hash_table_storage_probe_length(storage, idx, hash);
+    if (length > C_HASH_TABLE_PROBE_HISTOGRAM_SZ)
+        length = C_HASH_TABLE_PROBE_HISTOGRAM_SZ;
+
+    if (delta > 0) {
+        storage->probe_lengths[length - 1]++;
     } else {
-        bucket->sz = 1;
-        bucket->entries = c_calloc(bucket->sz, sizeof(struct c_hash_table_entry));
-        if (!bucket->entries) {
-            c_set_error("cannot allocate entries: %m");
-            return -1;
+        storage->probe_lengths[length - 1]--;
+    }
+}
+
+
+/*
+ * Memory hashing is based on wyhash by Wang Yi, released in the public
+ * domain (https://github.com/wangyi-fudan/wyhash). Input is read eight bytes
+ * at a time and mixed using 64x64->128 bit multiplications.
+ */
+
+static const uint64_t c_hash_secret[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47),
+};
+
+static uint64_t
+c_hash_wyhash(const void *ptr, size_t len, uint64_t seed) {
+    const uint8_t *p;
+    uint64_t a, b;
+
+    p = ptr;
+
+    seed ^= c_hash_wymix(seed ^ c_hash_secret[0], c_hash_secret[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t offset;
+
+            offset = (len >> 3) << 2;
+
+            a = (c_hash_read32(p) << 32) | c_hash_read32(p + offset);
+            b = (c_hash_read32(p + len - 4) << 32)
+              | c_hash_read32(p + len - 4 - offset);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8)
+              | p[len - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
         }
+    } else {
+        size_t i;
 
-        entry = bucket->entries;
-    }
+        i = len;
 
-    if (!entry) {
-        struct c_hash_table_entry *entries;
-        size_t sz;
+        if (i >= 48) {
+            uint64_t seed1, seed2;
 
-        sz = bucket->sz + 1;
-        entries = c_realloc(bucket->entries,
-                            sz * sizeof(struct c_hash_table_entry));
-        if (!entries) {
-            c_set_error("cannot reallocate entries: %m");
-            return -1;
+            seed1 = seed;
+            seed2 = seed;
+
+            do {
+                seed = c_hash_wymix(c_hash_read64(p) ^ c_hash_secret[1],
+                                    c_hash_read64(p + 8) ^ seed);
+                seed1 = c_hash_wymix(c_hash_read64(p + 16) ^ c_hash_secret[2],
+                                     c_hash_read64(p + 24) ^ seed1);
+                seed2 = c_hash_wymix(c_hash_read64(p + 32) ^ c_hash_secret[3],
+                                     c_hash_read64(p + 40) ^ seed2);
+
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+
+            seed ^= seed1 ^ seed2;
         }
 
-        memset(entries + bucket->sz, 0,
-               (sz - bucket->sz) * sizeof(struct c_hash_table_entry));
+        while (i > 16) {
+            seed = c_hash_wymix(c_hash_read64(p) ^ c_hash_secret[1],
+                                c_hash_read64(p + 8) ^ seed);
 
-        entry = entries + bucket->sz;
+            p += 16;
+            i -= 16;
+        }
 
-        bucket->entries = entries;
-        bucket->sz = sz;
+        a = c_hash_read64(p + i - 16);
+        b = c_hash_read64(p + i - 8);
     }
 
-    entry->key = key;
-    entry->value = value;
-    entry->hash = hash;
+    a ^= c_hash_secret[1];
+    b ^= seed;
+    c_hash_mum(&a, &b);
+
+    return c_hash_wymix(a ^ c_hash_secret[0] ^ len, b ^ c_hash_secret[1]);
+}
+
+static void
+c_hash_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r;
+
+    r = (__uint128_t)*a * *b;
+
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha, la, hb, lb, rh, rm0, rm1, rl, t, c, lo, hi;
+
+    ha = *a >> 32;
+    la = (uint32_t)*a;
+    hb = *b >> 32;
+    lb = (uint32_t)*b;
+
+    rh = ha * hb;
+    rm0 = ha * lb;
+    rm1 = hb * la;
+    rl = la * lb;
+
+    t = rl + (rm0 << 32);
+    c = (t < rl);
+    lo = t + (rm1 << 32);
+    c += (lo < t);
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static uint64_t
+c_hash_wymix(uint64_t a, uint64_t b) {
+    c_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static uint32_t
+c_hash_mix64(uint64_t x) {
+    /* Finalizer of splitmix64 */
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    x ^= x >> 31;
+
+    return (uint32_t)(x ^ (x >> 32));
+}
+
+static uint64_t
+c_hash_read64(const uint8_t *ptr) {
+    uint64_t value;
+
+    memcpy(&value, ptr, sizeof(uint64_t));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+
+    return value;
+}
+
+static uint64_t
+c_hash_read32(const uint8_t *ptr) {
+    uint32_t value;
+
+    memcpy(&value, ptr, sizeof(uint32_t));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+
+    return value;
+}
+
+static size_t
+c_hash_string_length(const char *str) {
+    size_t len;
+
+    /* Most keys are short, and the cost of calling strlen() is significant
+     * compared to the cost of hashing them. */
+    for (len = 0; len < 16; len++) {
+        if (str[len] == '\0')
+            return len;
+    }
 
-    return new_entry_inserted ? 1 : 0;
+    return len + strlen(str + len);
 }
@@ -28,19 +28,77 @@
 typedef uint32_t (*c_hash_func)(const void *);
 typedef bool (*c_equal_func)(const void *, const void *);
 
+/* The last entry of the probe length histogram counts all entries whose
+ * probe length is greater or equal to C_HASH_TABLE_PROBE_HISTOGRAM_SZ. */
+#define C_HASH_TABLE_PROBE_HISTOGRAM_SZ 16
+
+struct c_hash_table_stats {
+    size_t nb_entries;
+    size_t nb_slots;
+    size_t nb_deleted_slots;
+    double load_factor;
+
+    size_t max_probe_length;
+    double mean_probe_length;
+    size_t probe_lengths[C_HASH_TABLE_PROBE_HISTOGRAM_SZ];
+
+    size_t memory_size;
+
+    uint64_t nb_resizes;
+    uint64_t resize_time; /* nanoseconds */
+};
+
+typedef int (*c_hash_table_foreach_func)(void *, void *, void *);
+typedef bool (*c_hash_table_predicate_func)(void *, void *, void *);
+
+/* The content of this structure is private. Its definition is public so that
+ * iterators can be allocated by the caller. */
+struct c_hash_table_iterator {
+    struct c_hash_table *table;
+    struct c_hash_table_storage *storage;
+    size_t slot;
+    bool registered;
+};
+
 struct c_hash_table *c_hash_table_new(c_hash_func, c_equal_func);
+struct c_hash_table *c_hash_table_new_with_allocator(
+    c_hash_func, c_equal_func, const struct c_allocator *);
+struct c_hash_table *c_hash_table_new_with_capacity(c_hash_func, c_equal_func,
+                                                    size_t);
 void c_hash_table_delete(struct c_hash_table *);
 size_t c_hash_table_nb_entries(const struct c_hash_table *);
 bool c_hash_table_is_empty(const struct c_hash_table *);
 void c_hash_table_clear(struct c_hash_table *);
+
+size_t c_hash_table_capacity(const struct c_hash_table *);
+int c_hash_table_reserve(struct c_hash_table *, size_t);
+int c_hash_table_shrink_to_fit(struct c_hash_table *);
+int c_hash_table_set_alignment(struct c_hash_table *, size_t);
+int c_hash_table_set_load_factors(struct c_hash_table *, double, double);
+
+void c_hash_table_set_incremental_resize(struct c_hash_table *, bool);
+bool c_hash_table_is_rehashing(const struct c_hash_table *);
+int c_hash_table_rehash_step(struct c_hash_table *, size_t);
+
 int c_hash_table_insert(struct c_hash_table *, void *, void *);
 int c_hash_table_insert2(struct c_hash_table *, void *, void *,
                          void **, void **);
+int c_hash_table_insert2_with_hash(struct c_hash_table *, void *, uint32_t,
+                                   void *, void **, void **);
 int c_hash_table_remove(struct c_hash_table *, const void *);
 int c_hash_table_remove2(struct c_hash_table *, const void *,
                          void **, void **);
+int c_hash_table_remove2_with_hash(struct c_hash_table *, const void *,
+                                   uint32_t, void **, void **);
 int c_hash_table_get(struct c_hash_table *, const void *, void **);
+int c_hash_table_get_with_hash(struct c_hash_table *, const void *, uint32_t,
+                               void **);
+size_t c_hash_table_get_many(struct c_hash_table *, const void * const *,
+                             size_t, void **, bool *);
 bool c_hash_table_contains(struct c_hash_table *, const void *);
+
+void c_hash_table_stats(const struct c_hash_table *,
+                        struct c_hash_table_stats *);
 void c_hash_table_print(struct c_hash_table *, FILE *);
 
 struct c_hash_table_iterator *c_hash_table_iterate(struct c_hash_table *);
@@ -48,13 +106,35 @@ void c_hash_table_iterator_delete(struct c_hash_table_iterator *);
 int c_hash_table_iterator_next(struct c_hash_table_iterator *,
                                void **, void **);
 void c_hash_table_iterator_set_value(struct c_hash_table_iterator *, void *);
+void c_hash_table_iterator_remove(struct c_hash_table_iterator *);
+
+void c_hash_table_iterator_init(struct c_hash_table_iterator *,
+                                struct c_hash_table *);
+void c_hash_table_iterator_finish(struct c_hash_table_iterator *);
+
+int c_hash_table_foreach(struct c_hash_table *, c_hash_table_foreach_func,
+                         void *);
+size_t c_hash_table_remove_if(struct c_hash_table *,
+                              c_hash_table_predicate_func, void *);
 
 int c_hash_table_keys(struct c_hash_table *, void ***, size_t *);
 
+void c_set_hash_seed(uint64_t);
+
+uint32_t c_hash_memory(const void *, size_t);
+uint32_t c_hash_memory_seeded(const void *, size_t, uint64_t);
+
 uint32_t c_hash_int32(const void *);
 bool c_equal_int32(const void *, const void *);
 
+uint32_t c_hash_int64(const void *);
+bool c_equal_int64(const void *, const void *);
+
+uint32_t c_hash_pointer(const void *);
+bool c_equal_pointer(const void *, const void *);
+
 uint32_t c_hash_string(const void *);
+uint32_t c_hash_string_seeded(const void *);
 bool c_equal_string(const void *, const void *);
 
 #endif
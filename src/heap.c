@@ -24,6 +24,8 @@ struct c_heap {
     void **entries;
     size_t nb_entries;
     size_t entries_sz;
+
+    const struct c_allocator *allocator;
 };
 
 static void c_heap_swap(struct c_heap *, size_t, size_t);
@@ -32,13 +34,20 @@ static void c_heap_sink_down(struct c_heap *, size_t);
 
 struct c_heap *
 c_heap_new(c_heap_cmp_func cmp) {
+    return c_heap_new_with_allocator(cmp, NULL);
+}
+
+struct c_heap *
+c_heap_new_with_allocator(c_heap_cmp_func cmp,
+                          const struct c_allocator *allocator) {
     struct c_heap *heap;
 
-    heap = c_malloc0(sizeof(struct c_heap));
+    heap = c_allocator_malloc0(allocator, sizeof(struct c_heap));
     if (!heap)
         return NULL;
 
     heap->cmp = cmp;
+    heap->allocator = allocator;
 
     return heap;
 }
@@ -50,7 +59,7 @@ c_heap_delete(struct c_heap *heap) {
 
     c_heap_reset(heap);
 
-    c_free0(heap, sizeof(struct c_heap));
+    c_allocator_free0(heap->allocator, heap, sizeof(struct c_heap));
 }
 
 size_t
@@ -70,7 +79,9 @@ c_heap_clear(struct c_heap *heap) {
 
 void
 c_heap_reset(struct c_heap *heap) {
-    c_free(heap->entries);
+    c_allocator_free(heap->allocator, heap->entries,
+                     heap->entries_sz * sizeof(void *));
+    heap->entries = NULL;
     heap->nb_entries = 0;
     heap->entries_sz = 0;
 }
@@ -87,7 +98,9 @@ c_heap_add(struct c_heap *heap, void *entry) {
             entries_sz = heap->entries_sz * 2;
         }
 
-        entries = c_realloc(heap->entries, entries_sz * sizeof(void *));
+        entries = c_allocator_realloc(heap->allocator, heap->entries,
+                                      heap->entries_sz * sizeof(void *),
+                                      entries_sz * sizeof(void *));
         if (!entries)
             return -1;
 
@@ -22,6 +22,8 @@
 typedef int (*c_heap_cmp_func)(const void *, const void *);
 
 struct c_heap *c_heap_new(c_heap_cmp_func);
+struct c_heap *c_heap_new_with_allocator(c_heap_cmp_func,
+                                         const struct c_allocator *);
 void c_heap_delete(struct c_heap *);
 
 size_t c_heap_nb_entries(const struct c_heap *);
@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+#include "hash-group.h"
+
+/*
+ * Integer maps use the same open addressing scheme as hash tables (see
+ * hash-table.c), but are specialized for integer keys: keys are hashed and
+ * compared inline instead of through function pointers, and values have a
+ * fixed size and are copied in the slot right after the key. A map with 64
+ * bit keys and 64 bit values therefore uses 16 bytes per slot, plus one
+ * control byte.
+ *
+ *  +-----+-----+-------+-----+-----+-------+-- ... --+----+----+-- ... --+
+ *  | k0  | v0  |  pad  | k1  | v1  |  pad  |         | c0 | c1 |         |
+ *  +-----+-----+-------+-----+-----+-------+-- ... --+----+----+-- ... --+
+ *
+ * Values are aligned on the largest power of two dividing their size, up to
+ * 8 bytes, so that the pointers returned to the caller can be used to access
+ * them directly.
+ */
+
+#define C_INT_MAP_MIN_NB_SLOTS C_HASH_GROUP_SZ
+
+struct c_int_map {
+    size_t key_sz;
+    size_t value_sz;
+    size_t value_offset;
+    size_t slot_sz;
+
+    uint8_t *slots;
+    uint8_t *ctrl;
+    size_t nb_slots;
+    size_t min_nb_slots; /* the map is never shrunk below this size */
+
+    size_t nb_entries;
+    size_t nb_deleted;
+};
+
+struct c_int32_map {
+    struct c_int_map map;
+};
+
+struct c_int64_map {
+    struct c_int_map map;
+};
+
+static int c_int_map_init(struct c_int_map *, size_t, size_t);
+static void c_int_map_free(struct c_int_map *);
+static void c_int_map_clear(struct c_int_map *);
+static size_t c_int_map_capacity(const struct c_int_map *);
+static int c_int_map_reserve(struct c_int_map *, size_t);
+static int c_int_map_insert(struct c_int_map *, uint64_t, const void *);
+static void *c_int_map_get_or_insert(struct c_int_map *, uint64_t, bool *);
+static int c_int_map_remove(struct c_int_map *, uint64_t, void *);
+static void *c_int_map_get(const struct c_int_map *, uint64_t);
+static bool c_int_map_next(const struct c_int_map *, size_t *,
+                           uint64_t *, void **);
+
+static size_t c_int_map_align(size_t, size_t);
+static uint32_t c_int_map_hash(uint64_t);
+static size_t c_int_map_max_load(size_t);
+static int c_int_map_nb_slots_for_capacity(const struct c_int_map *, size_t,
+                                           size_t *);
+static int c_int_map_resize(struct c_int_map *, size_t);
+static bool c_int_map_slot_equal(const void *, const void *, const void *);
+static bool c_int_map_find(const struct c_int_map *, uint64_t, uint32_t,
+                           size_t *);
+static void c_int_map_erase(struct c_int_map *, size_t);
+static uint8_t *c_int_map_slot(const struct c_int_map *, size_t);
+static uint64_t c_int_map_slot_key(const struct c_int_map *, size_t);
+static void c_int_map_set_slot_key(struct c_int_map *, size_t, uint64_t);
+
+struct c_int32_map *
+c_int32_map_new(size_t value_sz) {
+    struct c_int32_map *map;
+
+    map = c_malloc(sizeof(struct c_int32_map));
+    if (!map) {
+        c_set_error("cannot allocate map: %m");
+        return NULL;
+    }
+
+    if (c_int_map_init(&map->map, sizeof(uint32_t), value_sz) == -1) {
+        c_free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+void
+c_int32_map_delete(struct c_int32_map *map) {
+    if (!map)
+        return;
+
+    c_int_map_free(&map->map);
+    c_free0(map, sizeof(struct c_int32_map));
+}
+
+size_t
+c_int32_map_nb_entries(const struct c_int32_map *map) {
+    return map->map.nb_entries;
+}
+
+bool
+c_int32_map_is_empty(const struct c_int32_map *map) {
+    return map->map.nb_entries == 0;
+}
+
+void
+c_int32_map_clear(struct c_int32_map *map) {
+    c_int_map_clear(&map->map);
+}
+
+size_t
+c_int32_map_capacity(const struct c_int32_map *map) {
+    return c_int_map_capacity(&map->map);
+}
+
+int
+c_int32_map_reserve(struct c_int32_map *map, size_t capacity) {
+    return c_int_map_reserve(&map->map, capacity);
+}
+
+int
+c_int32_map_insert(struct c_int32_map *map, int32_t key, const void *value) {
+    return c_int_map_insert(&map->map, (uint32_t)key, value);
+}
+
+void *
+c_int32_map_get_or_insert(struct c_int32_map *map, int32_t key,
+                          bool *inserted) {
+    return c_int_map_get_or_insert(&map->map, (uint32_t)key, inserted);
+}
+
+int
+c_int32_map_remove(struct c_int32_map *map, int32_t key, void *value) {
+    return c_int_map_remove(&map->map, (uint32_t)key, value);
+}
+
+void *
+c_int32_map_get(const struct c_int32_map *map, int32_t key) {
+    return c_int_map_get(&map->map, (uint32_t)key);
+}
+
+bool
+c_int32_map_contains(const struct c_int32_map *map, int32_t key) {
+    return c_int_map_get(&map->map, (uint32_t)key) != NULL;
+}
+
+void
+c_int32_map_iterator_init(struct c_int32_map_iterator *it,
+                          struct c_int32_map *map) {
+    it->map = map;
+    it->slot = 0;
+}
+
+int
+c_int32_map_iterator_next(struct c_int32_map_iterator *it,
+                          int32_t *pkey, void **pvalue) {
+    uint64_t key;
+
+    if (!c_int_map_next(&it->map->map, &it->slot, &key, pvalue))
+        return 0;
+
+    if (pkey)
+        *pkey = (int32_t)(uint32_t)key;
+
+    return 1;
+}
+
+struct c_int64_map *
+c_int64_map_new(size_t value_sz) {
+    struct c_int64_map *map;
+
+    map = c_malloc(sizeof(struct c_int64_map));
+    if (!map) {
+        c_set_error("cannot allocate map: %m");
+        return NULL;
+    }
+
+    if (c_int_map_init(&map->map, sizeof(uint64_t), value_sz) == -1) {
+        c_free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+void
+c_int64_map_delete(struct c_int64_map *map) {
+    if (!map)
+        return;
+
+    c_int_map_free(&map->map);
+    c_free0(map, sizeof(struct c_int64_map));
+}
+
+size_t
+c_int64_map_nb_entries(const struct c_int64_map *map) {
+    return map->map.nb_entries;
+}
+
+bool
+c_int64_map_is_empty(const struct c_int64_map *map) {
+    return map->map.nb_entries == 0;
+}
+
+void
+c_int64_map_clear(struct c_int64_map *map) {
+    c_int_map_clear(&map->map);
+}
+
+size_t
+c_int64_map_capacity(const struct c_int64_map *map) {
+    return c_int_map_capacity(&map->map);
+}
+
+int
+c_int64_map_reserve(struct c_int64_map *map, size_t capacity) {
+    return c_int_map_reserve(&map->map, capacity);
+}
+
+int
+c_int64_map_insert(struct c_int64_map *map, int64_t key, const void *value) {
+    return c_int_map_insert(&map->map, (uint64_t)key, value);
+}
+
+void *
+c_int64_map_get_or_insert(struct c_int64_map *map, int64_t key,
+                          bool *inserted) {
+    return c_int_map_get_or_insert(&map->map, (uint64_t)key, inserted);
+}
+
+int
+c_int64_map_remove(struct c_int64_map *map, int64_t key, void *value) {
+    return c_int_map_remove(&map->map, (uint64_t)key, value);
+}
+
+void *
+c_int64_map_get(const struct c_int64_map *map, int64_t key) {
+    return c_int_map_get(&map->map, (uint64_t)key);
+}
+
+bool
+c_int64_map_contains(const struct c_int64_map *map, int64_t key) {
+    return c_int_map_get(&map->map, (uint64_t)key) != NULL;
+}
+
+void
+c_int64_map_iterator_init(struct c_int64_map_iterator *it,
+                          struct c_int64_map *map) {
+    it->map = map;
+    it->slot = 0;
+}
+
+int
+c_int64_map_iterator_next(struct c_int64_map_iterator *it,
+                          int64_t *pkey, void **pvalue) {
+    uint64_t key;
+
+    if (!c_int_map_next(&it->map->map, &it->slot, &key, pvalue))
+        return 0;
+
+    if (pkey)
+        *pkey = (int64_t)key;
+
+    return 1;
+}
+
+static int
+c_int_map_init(struct c_int_map *map, size_t key_sz, size_t value_sz) {
+    size_t value_align, slot_align;
+
+    memset(map, 0, sizeof(struct c_int_map));
+
+    value_align = 1;
+    while (value_align < 8 && value_sz % (value_align * 2) == 0
+        && value_sz > 0) {
+        value_align *= 2;
+    }
+
+    slot_align = (key_sz > value_align) ? key_sz : value_align;
+
+    map->key_sz = key_sz;
+    map->value_sz = value_sz;
+    map->value_offset = c_int_map_align(key_sz, value_align);
+    map->slot_sz = c_int_map_align(map->value_offset + value_sz, slot_align);
+
+    map->min_nb_slots = C_INT_MAP_MIN_NB_SLOTS;
+
+    return c_int_map_resize(map, C_INT_MAP_MIN_NB_SLOTS);
+}
+
+static void
+c_int_map_free(struct c_int_map *map) {
+    c_free(map->slots);
+}
+
+static void
+c_int_map_clear(struct c_int_map *map) {
+    memset(map->ctrl, C_HASH_CTRL_EMPTY, map->nb_slots + C_HASH_GROUP_SZ);
+
+    map->nb_entries = 0;
+    map->nb_deleted = 0;
+}
+
+static size_t
+c_int_map_capacity(const struct c_int_map *map) {
+    return c_int_map_max_load(map->nb_slots);
+}
+
+static int
+c_int_map_reserve(struct c_int_map *map, size_t capacity) {
+    size_t nb_slots;
+
+    if (c_int_map_nb_slots_for_capacity(map, capacity, &nb_slots) == -1)
+        return -1;
+
+    map->min_nb_slots = nb_slots;
+
+    if (capacity <= c_int_map_max_load(map->nb_slots) - map->nb_deleted)
+        return 0;
+
+    return c_int_map_resize(map, nb_slots);
+}
+
+static int
+c_int_map_insert(struct c_int_map *map, uint64_t key, const void *value) {
+    void *slot_value;
+    bool inserted;
+
+    slot_value = c_int_map_get_or_insert(map, key, &inserted);
+    if (!slot_value)
+        return -1;
+
+    memcpy(slot_value, value, map->value_sz);
+
+    return inserted ? 1 : 0;
+}
+
+static void *
+c_int_map_get_or_insert(struct c_int_map *map, uint64_t key,
+                        bool *inserted) {
+    uint8_t *slot;
+    uint32_t hash;
+    size_t idx;
+
+    hash = c_int_map_hash(key);
+
+    if (c_int_map_find(map, key, hash, &idx)) {
+        if (inserted)
+            *inserted = false;
+
+        return c_int_map_slot(map, idx) + map->value_offset;
+    }
+
+    if (map->nb_entries + map->nb_deleted
+        >= c_int_map_max_load(map->nb_slots)) {
+        size_t nb_slots;
+
+        /* If a significant part of the used slots only contain deleted
+         * entries, rehashing without growing is enough. */
+        nb_slots = map->nb_slots;
+        if (map->nb_deleted < map->nb_slots / 8) {
+            if (nb_slots > SIZE_MAX / 2 / (map->slot_sz + 1)) {
+                c_set_error("map too large");
+                return NULL;
+            }
+
+            nb_slots *= 2;
+        }
+
+        if (c_int_map_resize(map, nb_slots) == -1)
+            return NULL;
+    }
+
+    idx = c_hash_ctrl_find_free_slot(map->ctrl, map->nb_slots, hash);
+
+    if (map->ctrl[idx] == C_HASH_CTRL_DELETED)
+        map->nb_deleted--;
+
+    c_hash_ctrl_set(map->ctrl, map->nb_slots, idx, C_HASH_H2(hash));
+    c_int_map_set_slot_key(map, idx, key);
+
+    slot = c_int_map_slot(map, idx);
+    memset(slot + map->value_offset, 0, map->value_sz);
+
+    map->nb_entries++;
+
+    if (inserted)
+        *inserted = true;
+
+    return slot + map->value_offset;
+}
+
+static int
+c_int_map_remove(struct c_int_map *map, uint64_t key, void *value) {
+    size_t idx, nb_slots;
+
+    if (!c_int_map_find(map, key, c_int_map_hash(key), &idx))
+        return 0;
+
+    if (value)
+        memcpy(value, c_int_map_slot(map, idx) + map->value_offset,
+               map->value_sz);
+
+    c_int_map_erase(map, idx);
+
+    nb_slots = c_hash_shrunk_nb_slots(map->nb_slots, map->min_nb_slots,
+                                      map->nb_entries,
+                                      C_HASH_DEFAULT_MIN_LOAD_FACTOR);
+
+    /* Failing to shrink the storage is not an error */
+    if (nb_slots < map->nb_slots)
+        c_int_map_resize(map, nb_slots);
+
+    return 1;
+}
+
+static void *
+c_int_map_get(const struct c_int_map *map, uint64_t key) {
+    size_t idx;
+
+    if (!c_int_map_find(map, key, c_int_map_hash(key), &idx))
+        return NULL;
+
+    return c_int_map_slot(map, idx) + map->value_offset;
+}
+
+static bool
+c_int_map_next(const struct c_int_map *map, size_t *pidx,
+               uint64_t *pkey, void **pvalue) {
+    for (size_t idx = *pidx; idx < map->nb_slots; idx++) {
+        if (!C_HASH_CTRL_IS_FULL(map->ctrl[idx]))
+            continue;
+
+        *pkey = c_int_map_slot_key(map, idx);
+        if (pvalue)
+            *pvalue = c_int_map_slot(map, idx) + map->value_offset;
+
+        *pidx = idx + 1;
+        return true;
+    }
+
+    *pidx = map->nb_slots;
+    return false;
+}
+
+static size_t
+c_int_map_align(size_t sz, size_t alignment) {
+    return (sz + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t
+c_int_map_hash(uint64_t key) {
+    /* Finalizer of MurmurHash3: integer keys are often sequential, and all
+     * their bits must affect both H1 and H2. */
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    key *= UINT64_C(0xc4ceb9fe1a85ec53);
+    key ^= key >> 33;
+
+    return (uint32_t)key;
+}
+
+static size_t
+c_int_map_max_load(size_t nb_slots) {
+    return c_hash_max_load(nb_slots, C_HASH_DEFAULT_MAX_LOAD_FACTOR);
+}
+
+static int
+c_int_map_nb_slots_for_capacity(const struct c_int_map *map,
+                                size_t capacity, size_t *pnb_slots) {
+    size_t nb_slots;
+
+    nb_slots = C_INT_MAP_MIN_NB_SLOTS;
+
+    while (c_int_map_max_load(nb_slots) < capacity) {
+        if (nb_slots > SIZE_MAX / 2 / (map->slot_sz + 1)) {
+            c_set_error("capacity too large");
+            return -1;
+        }
+
+        nb_slots *= 2;
+    }
+
+    *pnb_slots = nb_slots;
+    return 0;
+}
+
+static int
+c_int_map_resize(struct c_int_map *map, size_t nb_slots) {
+    struct c_int_map old_map;
+    size_t sz;
+
+    assert(nb_slots >= C_INT_MAP_MIN_NB_SLOTS);
+    assert(map->nb_entries < c_int_map_max_load(nb_slots));
+
+    old_map = *map;
+
+    /* Slots and control bytes are stored in the same memory block */
+    sz = nb_slots * map->slot_sz + nb_slots + C_HASH_GROUP_SZ;
+
+    map->slots = c_malloc(sz);
+    if (!map->slots) {
+        c_set_error("cannot allocate slots: %m");
+        *map = old_map;
+        return -1;
+    }
+
+    map->ctrl = map->slots + nb_slots * map->slot_sz;
+    map->nb_slots = nb_slots;
+
+    c_int_map_clear(map);
+
+    for (size_t i = 0; i < old_map.nb_slots; i++) {
+        uint32_t hash;
+        size_t idx;
+
+        if (!C_HASH_CTRL_IS_FULL(old_map.ctrl[i]))
+            continue;
+
+        hash = c_int_map_hash(c_int_map_slot_key(&old_map, i));
+
+        idx = c_hash_ctrl_find_free_slot(map->ctrl, nb_slots, hash);
+        c_hash_ctrl_set(map->ctrl, nb_slots, idx, C_HASH_H2(hash));
+
+        memcpy(c_int_map_slot(map, idx), c_int_map_slot(&old_map, i),
+               map->slot_sz);
+    }
+
+    map->nb_entries = old_map.nb_entries;
+
+    c_free(old_map.slots);
+    return 0;
+}
+
+static bool
+c_int_map_slot_equal(const void *data, const void *slot, const void *key) {
+    const struct c_int_map *map;
+
+    map = data;
+
+    /* The size of keys is the same for the whole map, so the branch is
+     * always predicted correctly. */
+    if (map->key_sz == sizeof(uint32_t)) {
+        return *(const uint32_t *)slot == *(const uint64_t *)key;
+    } else {
+        return *(const uint64_t *)slot == *(const uint64_t *)key;
+    }
+}
+
+static bool
+c_int_map_find(const struct c_int_map *map, uint64_t key, uint32_t hash,
+               size_t *pidx) {
+    size_t idx;
+
+    idx = c_hash_ctrl_find(map->ctrl, map->nb_slots, map->slots, map->slot_sz,
+                           hash, c_int_map_slot_equal, map, &key);
+    if (idx == SIZE_MAX)
+        return false;
+
+    *pidx = idx;
+    return true;
+}
+
+static void
+c_int_map_erase(struct c_int_map *map, size_t idx) {
+    if (c_hash_ctrl_erase(map->ctrl, map->nb_slots, idx)
+        == C_HASH_CTRL_DELETED) {
+        map->nb_deleted++;
+    }
+
+    map->nb_entries--;
+}
+
+static uint8_t *
+c_int_map_slot(const struct c_int_map *map, size_t idx) {
+    return map->slots + idx * map->slot_sz;
+}
+
+static uint64_t
+c_int_map_slot_key(const struct c_int_map *map, size_t idx) {
+    const uint8_t *slot;
+
+    slot = c_int_map_slot(map, idx);
+
+    if (map->key_sz == sizeof(uint32_t)) {
+        return *(const uint32_t *)slot;
+    } else {
+        return *(const uint64_t *)slot;
+    }
+}
+
+static void
+c_int_map_set_slot_key(struct c_int_map *map, size_t idx, uint64_t key) {
+    uint8_t *slot;
+
+    slot = c_int_map_slot(map, idx);
+
+    if (map->key_sz == sizeof(uint32_t)) {
+        *(uint32_t *)slot = (uint32_t)key;
+    } else {
+        *(uint64_t *)slot = key;
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_INT_MAP_H
+#define LIBCORE_INT_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* The content of these structures is private. Their definition is public so
+ * that iterators can be allocated by the caller. */
+struct c_int32_map_iterator {
+    struct c_int32_map *map;
+    size_t slot;
+};
+
+struct c_int64_map_iterator {
+    struct c_int64_map *map;
+    size_t slot;
+};
+
+/* 32 bit keys */
+struct c_int32_map *c_int32_map_new(size_t);
+void c_int32_map_delete(struct c_int32_map *);
+size_t c_int32_map_nb_entries(const struct c_int32_map *);
+bool c_int32_map_is_empty(const struct c_int32_map *);
+void c_int32_map_clear(struct c_int32_map *);
+size_t c_int32_map_capacity(const struct c_int32_map *);
+int c_int32_map_reserve(struct c_int32_map *, size_t);
+
+int c_int32_map_insert(struct c_int32_map *, int32_t, const void *);
+void *c_int32_map_get_or_insert(struct c_int32_map *, int32_t, bool *);
+int c_int32_map_remove(struct c_int32_map *, int32_t, void *);
+void *c_int32_map_get(const struct c_int32_map *, int32_t);
+bool c_int32_map_contains(const struct c_int32_map *, int32_t);
+
+void c_int32_map_iterator_init(struct c_int32_map_iterator *,
+                               struct c_int32_map *);
+int c_int32_map_iterator_next(struct c_int32_map_iterator *,
+                              int32_t *, void **);
+
+/* 64 bit keys */
+struct c_int64_map *c_int64_map_new(size_t);
+void c_int64_map_delete(struct c_int64_map *);
+size_t c_int64_map_nb_entries(const struct c_int64_map *);
+bool c_int64_map_is_empty(const struct c_int64_map *);
+void c_int64_map_clear(struct c_int64_map *);
+size_t c_int64_map_capacity(const struct c_int64_map *);
+int c_int64_map_reserve(struct c_int64_map *, size_t);
+
+int c_int64_map_insert(struct c_int64_map *, int64_t, const void *);
+void *c_int64_map_get_or_insert(struct c_int64_map *, int64_t, bool *);
+int c_int64_map_remove(struct c_int64_map *, int64_t, void *);
+void *c_int64_map_get(const struct c_int64_map *, int64_t);
+bool c_int64_map_contains(const struct c_int64_map *, int64_t);
+
+void c_int64_map_iterator_init(struct c_int64_map_iterator *,
+                               struct c_int64_map *);
+int c_int64_map_iterator_next(struct c_int64_map_iterator *,
+                              int64_t *, void **);
+
+#endif
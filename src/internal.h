@@ -26,17 +26,30 @@
 #include <string.h>
 
 #include "memory.h"
+#include "arena.h"
+#include "pool.h"
 #include "errors.h"
 #include "numbers.h"
 #include "strings.h"
 #include "buffer.h"
+#include "iobuf.h"
+#include "ring-buffer.h"
+#include "transfer.h"
+#include "mapped-file.h"
 #include "vector.h"
 #include "ptr-vector.h"
 #include "hash-table.h"
+#include "hash-set.h"
+#include "ordered-hash-table.h"
+#include "string-pool.h"
+#include "concurrent-hash-table.h"
+#include "rcu-hash-table.h"
+#include "int-map.h"
 #include "unicode.h"
 #include "command-line.h"
 #include "queue.h"
 #include "stack.h"
 #include "heap.h"
+#include "cache.h"
 
 #endif
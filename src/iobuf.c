@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <limits.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#ifdef IOV_MAX
+#  define C_IOBUF_MAX_IOVECS IOV_MAX
+#else
+#  define C_IOBUF_MAX_IOVECS 1024
+#endif
+
+#define C_IOBUF_MAX_SPARE_SEGMENTS 4
+
+/* Segments which do not receive data during a read are put back in the list
+ * of spare segments; never preparing more segments than this list can hold
+ * means that they are never freed. */
+#define C_IOBUF_MAX_READ_SEGMENTS C_IOBUF_MAX_SPARE_SEGMENTS
+
+/*
+ * An iobuf is a list of segments of the same size. Data are appended to the
+ * last segment and consumed from the first one, so that no data is ever
+ * moved. Empty segments are kept in a short list of spare segments to be
+ * reused.
+ *
+ *            start           end
+ *   +---------+---------------+-----------+
+ *   |         |     data      |           |
+ *   +---------+---------------+-----------+
+ */
+
+struct c_iobuf_segment {
+    struct c_iobuf_segment *next;
+
+    size_t start;
+    size_t end;
+
+    char data[];
+};
+
+struct c_iobuf {
+    struct c_iobuf_segment *first;
+    struct c_iobuf_segment *last;
+    size_t nb_segments;
+
+    size_t segment_sz;
+    size_t len;
+
+    struct c_iobuf_segment *spare_segments;
+    size_t nb_spare_segments;
+};
+
+static struct c_iobuf_segment *c_iobuf_segment_new(struct c_iobuf *);
+static void c_iobuf_segment_release(struct c_iobuf *,
+                                    struct c_iobuf_segment *);
+static void c_iobuf_append_segment(struct c_iobuf *,
+                                   struct c_iobuf_segment *);
+static void c_iobuf_remove_first_segment(struct c_iobuf *);
+
+struct c_iobuf *
+c_iobuf_new(size_t segment_sz) {
+    struct c_iobuf *iobuf;
+
+    if (segment_sz == 0)
+        segment_sz = C_IOBUF_DEFAULT_SEGMENT_SIZE;
+
+    if (segment_sz > SIZE_MAX - sizeof(struct c_iobuf_segment)) {
+        c_set_error("segment size too large");
+        return NULL;
+    }
+
+    iobuf = c_malloc0(sizeof(struct c_iobuf));
+    if (!iobuf)
+        return NULL;
+
+    iobuf->segment_sz = segment_sz;
+
+    return iobuf;
+}
+
+void
+c_iobuf_delete(struct c_iobuf *iobuf) {
+    struct c_iobuf_segment *segment;
+
+    if (!iobuf)
+        return;
+
+    c_iobuf_clear(iobuf);
+
+    segment = iobuf->spare_segments;
+    while (segment) {
+        struct c_iobuf_segment *next;
+
+        next = segment->next;
+        c_free(segment);
+        segment = next;
+    }
+
+    c_free0(iobuf, sizeof(struct c_iobuf));
+}
+
+size_t
+c_iobuf_length(const struct c_iobuf *iobuf) {
+    return iobuf->len;
+}
+
+bool
+c_iobuf_is_empty(const struct c_iobuf *iobuf) {
+    return iobuf->len == 0;
+}
+
+size_t
+c_iobuf_nb_segments(const struct c_iobuf *iobuf) {
+    return iobuf->nb_segments;
+}
+
+size_t
+c_iobuf_segment_size(const struct c_iobuf *iobuf) {
+    return iobuf->segment_sz;
+}
+
+void
+c_iobuf_clear(struct c_iobuf *iobuf) {
+    while (iobuf->first)
+        c_iobuf_remove_first_segment(iobuf);
+
+    iobuf->len = 0;
+}
+
+int
+c_iobuf_add(struct c_iobuf *iobuf, const void *data, size_t sz) {
+    const char *ptr;
+
+    ptr = data;
+
+    while (sz > 0) {
+        struct c_iobuf_segment *segment;
+        size_t count;
+
+        segment = iobuf->last;
+
+        if (!segment || segment->end == iobuf->segment_sz) {
+            segment = c_iobuf_segment_new(iobuf);
+            if (!segment)
+                return -1;
+
+            c_iobuf_append_segment(iobuf, segment);
+        }
+
+        count = iobuf->segment_sz - segment->end;
+        if (count > sz)
+            count = sz;
+
+        memcpy(segment->data + segment->end, ptr, count);
+        segment->end += count;
+        iobuf->len += count;
+
+        ptr += count;
+        sz -= count;
+    }
+
+    return 0;
+}
+
+int
+c_iobuf_add_buffer(struct c_iobuf *iobuf, const struct c_buffer *buf) {
+    return c_iobuf_add(iobuf, c_buffer_data(buf), c_buffer_length(buf));
+}
+
+size_t
+c_iobuf_skip(struct c_iobuf *iobuf, size_t n) {
+    size_t nb_skipped;
+
+    nb_skipped = 0;
+
+    while (n > 0 && iobuf->first) {
+        struct c_iobuf_segment *segment;
+        size_t count;
+
+        segment = iobuf->first;
+
+        count = segment->end - segment->start;
+        if (count > n)
+            count = n;
+
+        segment->start += count;
+        iobuf->len -= count;
+
+        if (segment->start == segment->end)
+            c_iobuf_remove_first_segment(iobuf);
+
+        nb_skipped += count;
+        n -= count;
+    }
+
+    return nb_skipped;
+}
+
+size_t
+c_iobuf_copy(const struct c_iobuf *iobuf, void *data, size_t n) {
+    const struct c_iobuf_segment *segment;
+    size_t nb_copied;
+    char *ptr;
+
+    ptr = data;
+    nb_copied = 0;
+
+    for (segment = iobuf->first; segment && n > 0; segment = segment->next) {
+        size_t count;
+
+        count = segment->end - segment->start;
+        if (count > n)
+            count = n;
+
+        memcpy(ptr, segment->data + segment->start, count);
+
+        ptr += count;
+        nb_copied += count;
+        n -= count;
+    }
+
+    return nb_copied;
+}
+
+size_t
+c_iobuf_remove(struct c_iobuf *iobuf, void *data, size_t n) {
+    size_t nb_copied;
+
+    nb_copied = c_iobuf_copy(iobuf, data, n);
+    c_iobuf_skip(iobuf, nb_copied);
+
+    return nb_copied;
+}
+
+int
+c_iobuf_iovecs(const struct c_iobuf *iobuf, struct iovec *iovecs,
+               int nb_iovecs) {
+    const struct c_iobuf_segment *segment;
+    int i;
+
+    i = 0;
+
+    for (segment = iobuf->first; segment && i < nb_iovecs;
+         segment = segment->next) {
+        if (segment->start == segment->end)
+            continue;
+
+        iovecs[i].iov_base = (char *)segment->data + segment->start;
+        iovecs[i].iov_len = segment->end - segment->start;
+        i++;
+    }
+
+    return i;
+}
+
+int
+c_iobuf_to_buffer(const struct c_iobuf *iobuf, struct c_buffer *buf) {
+    char *ptr;
+
+    if (iobuf->len == 0)
+        return 0;
+
+    ptr = c_buffer_reserve(buf, iobuf->len);
+    if (!ptr)
+        return -1;
+
+    c_iobuf_copy(iobuf, ptr, iobuf->len);
+    c_buffer_increase_length(buf, iobuf->len);
+
+    return 0;
+}
+
+ssize_t
+c_iobuf_read(struct c_iobuf *iobuf, int fd, size_t n) {
+    struct iovec iovecs[1 + C_IOBUF_MAX_READ_SEGMENTS];
+    struct c_iobuf_segment *segments, *segment, *last;
+    size_t free_space, remaining;
+    int nb_iovecs;
+    ssize_t ret;
+
+    /* The free space at the end of the last segment is used first, followed
+     * by new segments which are only appended if they received data. */
+    nb_iovecs = 0;
+    remaining = n;
+
+    last = iobuf->last;
+    if (last && last->end < iobuf->segment_sz && remaining > 0) {
+        free_space = iobuf->segment_sz - last->end;
+        if (free_space > remaining)
+            free_space = remaining;
+
+        iovecs[0].iov_base = last->data + last->end;
+        iovecs[0].iov_len = free_space;
+        nb_iovecs = 1;
+
+        remaining -= free_space;
+    }
+
+    segments = NULL;
+    segment = NULL;
+
+    for (int i = 0; remaining > 0 && i < C_IOBUF_MAX_READ_SEGMENTS; i++) {
+        struct c_iobuf_segment *nsegment;
+
+        nsegment = c_iobuf_segment_new(iobuf);
+        if (!nsegment) {
+            if (nb_iovecs > 0)
+                break;
+
+            return -1;
+        }
+
+        if (segment) {
+            segment->next = nsegment;
+        } else {
+            segments = nsegment;
+        }
+        segment = nsegment;
+
+        free_space = iobuf->segment_sz;
+        if (free_space > remaining)
+            free_space = remaining;
+
+        iovecs[nb_iovecs].iov_base = nsegment->data;
+        iovecs[nb_iovecs].iov_len = free_space;
+        nb_iovecs++;
+
+        remaining -= free_space;
+    }
+
+    if (nb_iovecs == 0)
+        return 0;
+
+    ret = readv(fd, iovecs, nb_iovecs);
+    if (ret == -1) {
+        c_set_error("%s", strerror(errno));
+    } else {
+        size_t nb_read;
+
+        nb_read = (size_t)ret;
+        iobuf->len += nb_read;
+
+        if (last && last->end < iobuf->segment_sz) {
+            size_t count;
+
+            count = iobuf->segment_sz - last->end;
+            if (count > nb_read)
+                count = nb_read;
+
+            last->end += count;
+            nb_read -= count;
+        }
+
+        while (nb_read > 0) {
+            size_t count;
+
+            segment = segments;
+            segments = segment->next;
+
+            count = iobuf->segment_sz;
+            if (count > nb_read)
+                count = nb_read;
+
+            segment->end = count;
+            nb_read -= count;
+
+            c_iobuf_append_segment(iobuf, segment);
+        }
+    }
+
+    while (segments) {
+        segment = segments;
+        segments = segment->next;
+
+        c_iobuf_segment_release(iobuf, segment);
+    }
+
+    return ret;
+}
+
+ssize_t
+c_iobuf_write(struct c_iobuf *iobuf, int fd) {
+    struct iovec iovecs[C_IOBUF_MAX_IOVECS];
+    int nb_iovecs;
+    ssize_t ret;
+
+    nb_iovecs = c_iobuf_iovecs(iobuf, iovecs, C_IOBUF_MAX_IOVECS);
+    if (nb_iovecs == 0)
+        return 0;
+
+    ret = writev(fd, iovecs, nb_iovecs);
+    if (ret == -1) {
+        c_set_error("%s", strerror(errno));
+        return -1;
+    }
+
+    c_iobuf_skip(iobuf, (size_t)ret);
+    return ret;
+}
+
+static struct c_iobuf_segment *
+c_iobuf_segment_new(struct c_iobuf *iobuf) {
+    struct c_iobuf_segment *segment;
+
+    if (iobuf->spare_segments) {
+        segment = iobuf->spare_segments;
+        iobuf->spare_segments = segment->next;
+        iobuf->nb_spare_segments--;
+    } else {
+        segment = c_malloc(sizeof(struct c_iobuf_segment) + iobuf->segment_sz);
+        if (!segment)
+            return NULL;
+    }
+
+    segment->next = NULL;
+    segment->start = 0;
+    segment->end = 0;
+
+    return segment;
+}
+
+static void
+c_iobuf_segment_release(struct c_iobuf *iobuf,
+                        struct c_iobuf_segment *segment) {
+    if (iobuf->nb_spare_segments >= C_IOBUF_MAX_SPARE_SEGMENTS) {
+        c_free(segment);
+        return;
+    }
+
+    segment->next = iobuf->spare_segments;
+    iobuf->spare_segments = segment;
+    iobuf->nb_spare_segments++;
+}
+
+static void
+c_iobuf_append_segment(struct c_iobuf *iobuf,
+                       struct c_iobuf_segment *segment) {
+    segment->next = NULL;
+
+    if (iobuf->last) {
+        iobuf->last->next = segment;
+    } else {
+        iobuf->first = segment;
+    }
+
+    iobuf->last = segment;
+    iobuf->nb_segments++;
+}
+
+static void
+c_iobuf_remove_first_segment(struct c_iobuf *iobuf) {
+    struct c_iobuf_segment *segment;
+
+    segment = iobuf->first;
+
+    iobuf->first = segment->next;
+    if (!iobuf->first)
+        iobuf->last = NULL;
+
+    iobuf->nb_segments--;
+
+    c_iobuf_segment_release(iobuf, segment);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_IOBUF_H
+#define LIBCORE_IOBUF_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define C_IOBUF_DEFAULT_SEGMENT_SIZE 16384
+
+struct c_iobuf *c_iobuf_new(size_t);
+void c_iobuf_delete(struct c_iobuf *);
+
+size_t c_iobuf_length(const struct c_iobuf *);
+bool c_iobuf_is_empty(const struct c_iobuf *);
+size_t c_iobuf_nb_segments(const struct c_iobuf *);
+size_t c_iobuf_segment_size(const struct c_iobuf *);
+
+void c_iobuf_clear(struct c_iobuf *);
+
+int c_iobuf_add(struct c_iobuf *, const void *, size_t);
+int c_iobuf_add_buffer(struct c_iobuf *, const struct c_buffer *);
+
+size_t c_iobuf_skip(struct c_iobuf *, size_t);
+size_t c_iobuf_copy(const struct c_iobuf *, void *, size_t);
+size_t c_iobuf_remove(struct c_iobuf *, void *, size_t);
+int c_iobuf_iovecs(const struct c_iobuf *, struct iovec *, int);
+
+int c_iobuf_to_buffer(const struct c_iobuf *, struct c_buffer *);
+
+ssize_t c_iobuf_read(struct c_iobuf *, int, size_t);
+ssize_t c_iobuf_write(struct c_iobuf *, int);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+/*
+ * A mapped file gives read-only access to the content of a file through a
+ * private memory mapping. If the window size is not null, only a part of the
+ * file, the window, is mapped at any time, and moving the window remaps the
+ * file. Mappings start on a page boundary, so the mapped area may start a
+ * bit before the window.
+ *
+ *   map_offset  offset            offset + len
+ *       |         |                    |
+ *   +---+---------+--------------------+-----------+
+ *   |   |         |       window       |           |
+ *   +---+---------+--------------------+-----------+
+ *       <------------ map_sz ---------->
+ */
+
+struct c_mapped_file {
+    int fd;
+    size_t file_sz;
+    size_t window_sz; /* 0 if the whole file is mapped */
+
+    char *map;
+    size_t map_sz;
+    size_t map_offset;
+
+    size_t offset;
+    size_t len;
+};
+
+static int c_mapped_file_map(struct c_mapped_file *, size_t);
+static void c_mapped_file_unmap(struct c_mapped_file *);
+
+struct c_mapped_file *
+c_mapped_file_open(const char *path, size_t window_sz) {
+    struct c_mapped_file *file;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        c_set_error("cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    file = c_mapped_file_new(fd, window_sz);
+    close(fd);
+
+    return file;
+}
+
+struct c_mapped_file *
+c_mapped_file_new(int fd, size_t window_sz) {
+    struct c_mapped_file *file;
+    struct stat st;
+
+    if (fstat(fd, &st) == -1) {
+        c_set_error("cannot stat file: %s", strerror(errno));
+        return NULL;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        c_set_error("not a regular file");
+        return NULL;
+    }
+
+    if ((uintmax_t)st.st_size > SIZE_MAX) {
+        c_set_error("file too large");
+        return NULL;
+    }
+
+    file = c_malloc0(sizeof(struct c_mapped_file));
+    if (!file)
+        return NULL;
+
+    file->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (file->fd == -1) {
+        c_set_error("cannot duplicate file descriptor: %s", strerror(errno));
+        c_free(file);
+        return NULL;
+    }
+
+    file->file_sz = (size_t)st.st_size;
+    file->window_sz = window_sz;
+
+    if (c_mapped_file_map(file, 0) == -1) {
+        c_mapped_file_delete(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+void
+c_mapped_file_delete(struct c_mapped_file *file) {
+    if (!file)
+        return;
+
+    c_mapped_file_unmap(file);
+    close(file->fd);
+
+    c_free0(file, sizeof(struct c_mapped_file));
+}
+
+size_t
+c_mapped_file_size(const struct c_mapped_file *file) {
+    return file->file_sz;
+}
+
+size_t
+c_mapped_file_window_size(const struct c_mapped_file *file) {
+    return file->window_sz;
+}
+
+const void *
+c_mapped_file_data(const struct c_mapped_file *file) {
+    if (!file->map)
+        return NULL;
+
+    return file->map + (file->offset - file->map_offset);
+}
+
+size_t
+c_mapped_file_length(const struct c_mapped_file *file) {
+    return file->len;
+}
+
+size_t
+c_mapped_file_offset(const struct c_mapped_file *file) {
+    return file->offset;
+}
+
+int
+c_mapped_file_seek(struct c_mapped_file *file, size_t offset) {
+    if (offset > file->file_sz) {
+        c_set_error("offset out of bounds");
+        return -1;
+    }
+
+    return c_mapped_file_map(file, offset);
+}
+
+int
+c_mapped_file_advance(struct c_mapped_file *file, size_t n) {
+    if (n > file->file_sz - file->offset) {
+        c_set_error("offset out of bounds");
+        return -1;
+    }
+
+    return c_mapped_file_map(file, file->offset + n);
+}
+
+static int
+c_mapped_file_map(struct c_mapped_file *file, size_t offset) {
+    size_t page_sz, map_offset, end;
+    char *map;
+
+    if (file->window_sz == 0 || file->window_sz > file->file_sz - offset) {
+        end = file->file_sz;
+    } else {
+        end = offset + file->window_sz;
+    }
+
+    /* If the window is already mapped, there is nothing to do */
+    if (file->map && offset >= file->map_offset
+     && end <= file->map_offset + file->map_sz) {
+        file->offset = offset;
+        file->len = end - offset;
+        return 0;
+    }
+
+    page_sz = (size_t)sysconf(_SC_PAGESIZE);
+    map_offset = offset - offset % page_sz;
+
+    map = NULL;
+    if (end > map_offset) {
+        map = mmap(NULL, end - map_offset, PROT_READ, MAP_PRIVATE,
+                   file->fd, (off_t)map_offset);
+        if (map == MAP_FAILED) {
+            c_set_error("cannot map file: %s", strerror(errno));
+            return -1;
+        }
+
+        /* Mapped files are mostly read sequentially; the kernel can read
+         * ahead aggressively and drop pages once they have been read. */
+        posix_madvise(map, end - map_offset, POSIX_MADV_SEQUENTIAL);
+        posix_madvise(map, end - map_offset, POSIX_MADV_WILLNEED);
+    }
+
+    c_mapped_file_unmap(file);
+
+    if (map) {
+        file->map = map;
+        file->map_sz = end - map_offset;
+        file->map_offset = map_offset;
+    }
+
+    file->offset = offset;
+    file->len = end - offset;
+
+    return 0;
+}
+
+static void
+c_mapped_file_unmap(struct c_mapped_file *file) {
+    if (!file->map)
+        return;
+
+    munmap(file->map, file->map_sz);
+
+    file->map = NULL;
+    file->map_sz = 0;
+    file->map_offset = 0;
+}
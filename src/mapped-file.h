@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_MAPPED_FILE_H
+#define LIBCORE_MAPPED_FILE_H
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+
+struct c_mapped_file *c_mapped_file_open(const char *, size_t);
+struct c_mapped_file *c_mapped_file_new(int, size_t);
+void c_mapped_file_delete(struct c_mapped_file *);
+
+size_t c_mapped_file_size(const struct c_mapped_file *);
+size_t c_mapped_file_window_size(const struct c_mapped_file *);
+
+const void *c_mapped_file_data(const struct c_mapped_file *);
+size_t c_mapped_file_length(const struct c_mapped_file *);
+size_t c_mapped_file_offset(const struct c_mapped_file *);
+
+int c_mapped_file_seek(struct c_mapped_file *, size_t);
+int c_mapped_file_advance(struct c_mapped_file *, size_t);
+
+#endif
@@ -14,14 +14,32 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef C_PLATFORM_LINUX
+/* MAP_ANONYMOUS and MADV_HUGEPAGE */
+#  define _DEFAULT_SOURCE
+#endif
+
+#include <inttypes.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+
+#ifdef C_PLATFORM_LINUX
+#  include <execinfo.h>
+#endif
+
 #include "internal.h"
 
-#define C_DEFAULT_ALLOCATOR  \
-    {                        \
-        .malloc = malloc,    \
-        .free = free,        \
-        .calloc = calloc,    \
-        .realloc = realloc   \
+static void *c_memory_default_aligned_alloc(size_t, size_t);
+
+#define C_DEFAULT_ALLOCATOR                                 \
+    {                                                       \
+        .malloc = malloc,                                   \
+        .free = free,                                       \
+        .calloc = calloc,                                   \
+        .realloc = realloc,                                 \
+        .aligned_alloc = c_memory_default_aligned_alloc,    \
+        .aligned_free = free                                \
     }
 
 static const struct c_memory_allocator c_default_memory_allocator_data =
@@ -32,15 +50,395 @@ static struct c_memory_allocator c_memory_allocator = C_DEFAULT_ALLOCATOR;
 const struct c_memory_allocator *c_default_memory_allocator =
     &c_default_memory_allocator_data;
 
+/*
+ * The thread cache is an optional layer between the library and the memory
+ * allocator. Small allocations are rounded up to a size class, and released
+ * blocks are kept in per-thread magazines, i.e. fixed-size arrays of free
+ * blocks of the same size class. Each thread has two magazines per size
+ * class; when both are empty or full, a magazine is exchanged with the
+ * depot, a global list of magazines protected by a mutex. The depot only
+ * keeps a limited number of full magazines; additional blocks are returned
+ * to the memory allocator.
+ *
+ * Each block is preceded by a header containing its size class, so that
+ * c_free() can find the right magazine. Headers are also used by memory
+ * statistics, which need the size of blocks when they are released. Since
+ * blocks allocated without a header cannot be released once headers are
+ * used, the thread cache and statistics must be enabled before any
+ * allocation. When they are not, the only cost is a test in each function.
+ */
+
+#define C_MEMORY_HEADER_SZ          16
+#define C_MEMORY_NB_SIZE_CLASSES    28
+#define C_MEMORY_NO_SIZE_CLASS      SIZE_MAX
+#define C_MEMORY_MAGAZINE_SZ        32
+#define C_MEMORY_DEPOT_MAX_MAGAZINES 16
+
+#define C_MEMORY_HUGE_PAGE_SZ       (2 * 1024 * 1024)
+#define C_MEMORY_DEFAULT_HUGE_PAGE_THRESHOLD (8 * 1024 * 1024)
+
+#define C_MEMORY_MAX_SITES          1024
+#define C_MEMORY_MAX_SITE_FRAMES    16
+#define C_MEMORY_NB_PRINTED_SITES   10
+
+struct c_memory_header {
+    size_t size_class; /* C_MEMORY_NO_SIZE_CLASS if the block is not cached */
+    size_t size;       /* requested size */
+};
+
+struct c_memory_magazine {
+    struct c_memory_magazine *next;
+
+    size_t nb_blocks;
+    struct c_memory_header *blocks[C_MEMORY_MAGAZINE_SZ];
+};
+
+struct c_memory_depot {
+    pthread_mutex_t mutex;
+
+    struct c_memory_magazine *full_magazines;
+    size_t nb_full_magazines;
+
+    struct c_memory_magazine *empty_magazines;
+    size_t nb_empty_magazines;
+};
+
+struct c_memory_thread_cache {
+    struct c_memory_magazine *loaded[C_MEMORY_NB_SIZE_CLASSES];
+    struct c_memory_magazine *previous[C_MEMORY_NB_SIZE_CLASSES];
+
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+
+    bool registered;
+};
+
+static const size_t c_memory_size_classes[C_MEMORY_NB_SIZE_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    144, 160, 176, 192, 208, 224, 240, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+};
+
+struct c_memory_site {
+    uint32_t hash;
+    size_t nb_frames; /* 0 if the site is not used */
+    void *frames[C_MEMORY_MAX_SITE_FRAMES];
+
+    uint64_t nb_samples;
+    uint64_t size;
+};
+
+struct c_memory_sites {
+    pthread_mutex_t mutex;
+
+    struct c_memory_site *sites;
+    size_t nb_sites;
+    uint64_t nb_dropped_samples;
+};
+
+/* Either the thread cache or statistics are enabled */
+static bool c_memory_headers;
+
+static bool c_memory_thread_cache_enabled;
+static pthread_key_t c_memory_thread_cache_key;
+static struct c_memory_depot c_memory_depots[C_MEMORY_NB_SIZE_CLASSES];
+static struct c_memory_cache_stats c_memory_cache_stats_data;
+
+static __thread struct c_memory_thread_cache c_memory_thread_cache;
+
+static bool c_memory_stats_enabled;
+static size_t c_memory_sampling_interval;
+static struct c_memory_stats c_memory_stats_data;
+static struct c_memory_sites c_memory_sites;
+
+static __thread size_t c_memory_sampling_counter;
+
+static size_t c_memory_huge_page_threshold =
+    C_MEMORY_DEFAULT_HUGE_PAGE_THRESHOLD;
+
+/* c_aligned_free() uses the huge page threshold to know how a block was
+ * allocated, so the threshold cannot change once a block has been allocated
+ * with c_aligned_alloc(). */
+static bool c_memory_huge_page_threshold_frozen;
+
+static void *c_memory_header_malloc(size_t, void *);
+static void c_memory_header_free(void *);
+static void *c_memory_header_realloc(void *, size_t, void *);
+static struct c_memory_header *c_memory_block_alloc(size_t);
+static void c_memory_block_release(struct c_memory_header *);
+static size_t c_memory_size_class(size_t);
+static struct c_memory_header *c_memory_cache_get(size_t);
+static void c_memory_cache_put(size_t, struct c_memory_header *);
+static void c_memory_depot_put(size_t, struct c_memory_magazine *);
+static void c_memory_magazine_release(struct c_memory_magazine *);
+static void c_memory_thread_cache_flush_counters(
+    struct c_memory_thread_cache *);
+static void c_memory_thread_cache_delete(void *);
+
+static void c_memory_stats_add(size_t, void *);
+static void c_memory_stats_remove(size_t);
+static void c_memory_stats_resize(size_t, size_t, size_t);
+static void c_memory_sample(size_t, void *);
+static int c_memory_cmp_sites(const void *, const void *);
+
+static bool c_memory_is_valid_alignment(size_t);
+static void *c_memory_map_huge_pages(size_t, size_t);
+static void c_memory_unmap_huge_pages(void *, size_t);
+static void *c_memory_align_block(void *, size_t, size_t);
+static void *c_memory_aligned_block_origin(void *, size_t *);
+
 void
 c_set_memory_allocator(const struct c_memory_allocator *allocator) {
     c_memory_allocator = *allocator;
 }
 
+int
+c_memory_enable_thread_cache(void) {
+    int ret;
+
+    if (c_memory_thread_cache_enabled)
+        return 0;
+
+    ret = pthread_key_create(&c_memory_thread_cache_key,
+                             c_memory_thread_cache_delete);
+    if (ret != 0) {
+        c_set_error("cannot create thread key: %s", strerror(ret));
+        return -1;
+    }
+
+    for (size_t i = 0; i < C_MEMORY_NB_SIZE_CLASSES; i++) {
+        ret = pthread_mutex_init(&c_memory_depots[i].mutex, NULL);
+        if (ret != 0) {
+            c_set_error("cannot initialize mutex: %s", strerror(ret));
+
+            for (size_t j = 0; j < i; j++)
+                pthread_mutex_destroy(&c_memory_depots[j].mutex);
+            pthread_key_delete(c_memory_thread_cache_key);
+
+            return -1;
+        }
+    }
+
+    c_memory_thread_cache_enabled = true;
+    c_memory_headers = true;
+
+    return 0;
+}
+
+void
+c_memory_flush_thread_cache(void) {
+    struct c_memory_thread_cache *cache;
+
+    if (!c_memory_thread_cache_enabled)
+        return;
+
+    cache = &c_memory_thread_cache;
+
+    for (size_t i = 0; i < C_MEMORY_NB_SIZE_CLASSES; i++) {
+        c_memory_depot_put(i, cache->loaded[i]);
+        c_memory_depot_put(i, cache->previous[i]);
+
+        cache->loaded[i] = NULL;
+        cache->previous[i] = NULL;
+    }
+
+    c_memory_thread_cache_flush_counters(cache);
+}
+
+void
+c_memory_cache_stats(struct c_memory_cache_stats *stats) {
+    struct c_memory_cache_stats *data;
+
+    c_memory_thread_cache_flush_counters(&c_memory_thread_cache);
+
+    data = &c_memory_cache_stats_data;
+
+    stats->nb_hits = __atomic_load_n(&data->nb_hits, __ATOMIC_RELAXED);
+    stats->nb_misses = __atomic_load_n(&data->nb_misses, __ATOMIC_RELAXED);
+    stats->nb_depot_gets = __atomic_load_n(&data->nb_depot_gets,
+                                           __ATOMIC_RELAXED);
+    stats->nb_depot_puts = __atomic_load_n(&data->nb_depot_puts,
+                                           __ATOMIC_RELAXED);
+}
+
+int
+c_memory_enable_stats(size_t sampling_interval) {
+    struct c_memory_stats *data;
+    int ret;
+
+    if (c_memory_stats_enabled)
+        return 0;
+
+    data = &c_memory_stats_data;
+
+    for (size_t i = 0; i < C_MEMORY_NB_SIZE_CLASSES; i++)
+        data->size_classes[i].size = c_memory_size_classes[i];
+    data->size_classes[C_MEMORY_NB_SIZE_CLASSES].size = SIZE_MAX;
+
+    if (sampling_interval > 0) {
+        struct c_memory_sites *sites;
+        size_t sz;
+
+        sites = &c_memory_sites;
+
+        ret = pthread_mutex_init(&sites->mutex, NULL);
+        if (ret != 0) {
+            c_set_error("cannot initialize mutex: %s", strerror(ret));
+            return -1;
+        }
+
+        sz = C_MEMORY_MAX_SITES * sizeof(struct c_memory_site);
+
+        sites->sites = c_memory_allocator.malloc(sz);
+        if (!sites->sites) {
+            c_set_error("cannot allocate sites: %s", strerror(errno));
+            pthread_mutex_destroy(&sites->mutex);
+            return -1;
+        }
+
+        memset(sites->sites, 0, sz);
+    }
+
+    c_memory_sampling_interval = sampling_interval;
+    c_memory_stats_enabled = true;
+    c_memory_headers = true;
+
+    return 0;
+}
+
+void
+c_memory_stats(struct c_memory_stats *stats) {
+    const struct c_memory_stats *data;
+
+    memset(stats, 0, sizeof(struct c_memory_stats));
+
+    if (!c_memory_stats_enabled)
+        return;
+
+    data = &c_memory_stats_data;
+
+    stats->live_size = __atomic_load_n(&data->live_size, __ATOMIC_RELAXED);
+    stats->peak_live_size = __atomic_load_n(&data->peak_live_size,
+                                            __ATOMIC_RELAXED);
+
+    stats->nb_allocations = __atomic_load_n(&data->nb_allocations,
+                                            __ATOMIC_RELAXED);
+    stats->nb_frees = __atomic_load_n(&data->nb_frees, __ATOMIC_RELAXED);
+    stats->nb_reallocs = __atomic_load_n(&data->nb_reallocs,
+                                         __ATOMIC_RELAXED);
+    stats->realloc_copy_size = __atomic_load_n(&data->realloc_copy_size,
+                                               __ATOMIC_RELAXED);
+    stats->nb_samples = __atomic_load_n(&data->nb_samples, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < C_MEMORY_STATS_NB_SIZE_CLASSES; i++) {
+        stats->size_classes[i].size = data->size_classes[i].size;
+        stats->size_classes[i].nb_allocations =
+            __atomic_load_n(&data->size_classes[i].nb_allocations,
+                            __ATOMIC_RELAXED);
+    }
+}
+
+void
+c_memory_print_stats(FILE *file) {
+    struct c_memory_sites *sites;
+    struct c_memory_site *sorted_sites;
+    struct c_memory_stats stats;
+    size_t nb_sites;
+
+    if (!c_memory_stats_enabled) {
+        fprintf(file, "memory statistics disabled\n");
+        return;
+    }
+
+    c_memory_stats(&stats);
+
+    fprintf(file, "live size: %zu\n", stats.live_size);
+    fprintf(file, "peak live size: %zu\n", stats.peak_live_size);
+    fprintf(file, "allocations: %"PRIu64"\n", stats.nb_allocations);
+    fprintf(file, "frees: %"PRIu64"\n", stats.nb_frees);
+    fprintf(file, "reallocs: %"PRIu64"\n", stats.nb_reallocs);
+    fprintf(file, "realloc copy size: %"PRIu64"\n", stats.realloc_copy_size);
+
+    fprintf(file, "size classes:\n");
+    for (size_t i = 0; i < C_MEMORY_STATS_NB_SIZE_CLASSES; i++) {
+        const struct c_memory_size_class_stats *size_class;
+
+        size_class = &stats.size_classes[i];
+        if (size_class->nb_allocations == 0)
+            continue;
+
+        if (size_class->size == SIZE_MAX) {
+            fprintf(file, "  larger  %"PRIu64"\n",
+                    size_class->nb_allocations);
+        } else {
+            fprintf(file, "  %-7zu %"PRIu64"\n",
+                    size_class->size, size_class->nb_allocations);
+        }
+    }
+
+    if (c_memory_sampling_interval == 0)
+        return;
+
+    fprintf(file, "samples: %"PRIu64" (1 every %zu allocations)\n",
+            stats.nb_samples, c_memory_sampling_interval);
+
+    /* Sites are copied so that the lock is not held while printing */
+    sites = &c_memory_sites;
+
+    sorted_sites = c_memory_allocator.malloc(C_MEMORY_MAX_SITES
+                                             * sizeof(struct c_memory_site));
+    if (!sorted_sites)
+        return;
+
+    if (pthread_mutex_lock(&sites->mutex) != 0)
+        abort();
+
+    nb_sites = 0;
+    for (size_t i = 0; i < C_MEMORY_MAX_SITES; i++) {
+        if (sites->sites[i].nb_frames > 0)
+            sorted_sites[nb_sites++] = sites->sites[i];
+    }
+
+    if (sites->nb_dropped_samples > 0) {
+        fprintf(file, "dropped samples: %"PRIu64"\n",
+                sites->nb_dropped_samples);
+    }
+
+    if (pthread_mutex_unlock(&sites->mutex) != 0)
+        abort();
+
+    qsort(sorted_sites, nb_sites, sizeof(struct c_memory_site),
+          c_memory_cmp_sites);
+
+    for (size_t i = 0; i < nb_sites && i < C_MEMORY_NB_PRINTED_SITES; i++) {
+        const struct c_memory_site *site;
+
+        site = &sorted_sites[i];
+
+        fprintf(file, "site %zu: %"PRIu64" samples, %"PRIu64" bytes\n",
+                i + 1, site->nb_samples, site->size);
+
+#ifdef C_PLATFORM_LINUX
+        fflush(file);
+        backtrace_symbols_fd(site->frames, (int)site->nb_frames, fileno(file));
+#else
+        for (size_t j = 0; j < site->nb_frames; j++)
+            fprintf(file, "  %p\n", site->frames[j]);
+#endif
+    }
+
+    c_memory_allocator.free(sorted_sites);
+}
+
 void *
 c_malloc(size_t sz) {
     void *ptr;
 
+    if (c_memory_headers)
+        return c_memory_header_malloc(sz, __builtin_return_address(0));
+
     ptr = c_memory_allocator.malloc(sz);
     if (!ptr) {
         c_set_error("cannot allocate %zu bytes: %s", sz, strerror(errno));
@@ -64,6 +462,11 @@ c_malloc0(size_t sz) {
 
 void
 c_free(void *ptr) {
+    if (c_memory_headers) {
+        c_memory_header_free(ptr);
+        return;
+    }
+
     c_memory_allocator.free(ptr);
 }
 
@@ -80,6 +483,16 @@ void *
 c_calloc(size_t nb, size_t sz) {
     void *ptr;
 
+    if (c_memory_headers) {
+        if (sz > 0 && nb > SIZE_MAX / sz) {
+            c_set_error("cannot allocate %zux%zu bytes: size too large",
+                        nb, sz);
+            return NULL;
+        }
+
+        return c_malloc0(nb * sz);
+    }
+
     ptr = c_memory_allocator.calloc(nb, sz);
     if (!ptr) {
         c_set_error("cannot allocate %zux%zu bytes: %s",
@@ -94,6 +507,10 @@ void *
 c_realloc(void *ptr, size_t sz) {
     void *nptr;
 
+    if (c_memory_headers)
+        return c_memory_header_realloc(ptr, sz,
+                                       __builtin_return_address(0));
+
     nptr = c_memory_allocator.realloc(ptr, sz);
     if (!nptr) {
         c_set_error("cannot reallocate %zu bytes: %s", sz, strerror(errno));
@@ -102,3 +519,947 @@ c_realloc(void *ptr, size_t sz) {
 
     return nptr;
 }
+
+int
+c_memory_set_huge_page_threshold(size_t threshold) {
+    if (threshold == c_memory_huge_page_threshold)
+        return 0;
+
+    if (__atomic_load_n(&c_memory_huge_page_threshold_frozen,
+                        __ATOMIC_ACQUIRE)) {
+        c_set_error("cannot change the huge page threshold once aligned "
+                    "memory has been allocated");
+        return -1;
+    }
+
+    c_memory_huge_page_threshold = threshold;
+    return 0;
+}
+
+void *
+c_aligned_alloc(size_t alignment, size_t sz) {
+    void *ptr;
+
+    if (!c_memory_is_valid_alignment(alignment)) {
+        c_set_error("invalid alignment %zu", alignment);
+        return NULL;
+    }
+
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+
+    /* Only write the flag once so that concurrent allocations do not
+     * contend on its cache line. */
+    if (!__atomic_load_n(&c_memory_huge_page_threshold_frozen,
+                         __ATOMIC_RELAXED)) {
+        __atomic_store_n(&c_memory_huge_page_threshold_frozen, true,
+                         __ATOMIC_RELEASE);
+    }
+
+    if (c_memory_huge_page_threshold > 0
+     && sz >= c_memory_huge_page_threshold) {
+        ptr = c_memory_map_huge_pages(alignment, sz);
+    } else if (c_memory_allocator.aligned_alloc
+            && c_memory_allocator.aligned_free) {
+        ptr = c_memory_allocator.aligned_alloc(alignment, sz);
+        if (!ptr) {
+            c_set_error("cannot allocate %zu bytes: %s",
+                        sz, strerror(errno));
+        }
+    } else {
+        size_t block_sz;
+        void *block;
+
+        /* The memory allocator cannot align blocks, so we allocate a larger
+         * block and keep its address before the aligned pointer. */
+        if (sz > SIZE_MAX - alignment - 2 * sizeof(size_t)) {
+            c_set_error("cannot allocate %zu bytes: size too large", sz);
+            return NULL;
+        }
+
+        block_sz = sz + alignment + 2 * sizeof(size_t);
+
+        block = c_memory_allocator.malloc(block_sz);
+        if (!block) {
+            c_set_error("cannot allocate %zu bytes: %s",
+                        sz, strerror(errno));
+            return NULL;
+        }
+
+        ptr = c_memory_align_block(block, block_sz, alignment);
+    }
+
+    if (ptr && c_memory_stats_enabled)
+        c_memory_stats_add(sz, __builtin_return_address(0));
+
+    return ptr;
+}
+
+void
+c_aligned_free(void *ptr, size_t sz) {
+    if (!ptr)
+        return;
+
+    if (c_memory_stats_enabled)
+        c_memory_stats_remove(sz);
+
+    if (c_memory_huge_page_threshold > 0
+     && sz >= c_memory_huge_page_threshold) {
+        c_memory_unmap_huge_pages(ptr, sz);
+    } else if (c_memory_allocator.aligned_alloc
+            && c_memory_allocator.aligned_free) {
+        c_memory_allocator.aligned_free(ptr);
+    } else {
+        c_memory_allocator.free(c_memory_aligned_block_origin(ptr, NULL));
+    }
+}
+
+void *
+c_allocator_malloc(const struct c_allocator *allocator, size_t sz) {
+    void *ptr;
+
+    if (!allocator)
+        return c_malloc(sz);
+
+    ptr = allocator->malloc(allocator->data, sz);
+    if (!ptr) {
+        c_set_error("cannot allocate %zu bytes: %s", sz, strerror(errno));
+        return NULL;
+    }
+
+    return ptr;
+}
+
+void *
+c_allocator_malloc0(const struct c_allocator *allocator, size_t sz) {
+    void *ptr;
+
+    ptr = c_allocator_malloc(allocator, sz);
+    if (!ptr)
+        return NULL;
+
+    memset(ptr, 0, sz);
+    return ptr;
+}
+
+void
+c_allocator_free(const struct c_allocator *allocator, void *ptr, size_t sz) {
+    if (!allocator) {
+        c_free(ptr);
+        return;
+    }
+
+    if (!ptr)
+        return;
+
+    allocator->free(allocator->data, ptr, sz);
+}
+
+void
+c_allocator_free0(const struct c_allocator *allocator, void *ptr, size_t sz) {
+    if (!ptr)
+        return;
+
+    memset(ptr, 0, sz);
+    c_allocator_free(allocator, ptr, sz);
+}
+
+void *
+c_allocator_realloc(const struct c_allocator *allocator, void *ptr,
+                    size_t old_sz, size_t sz) {
+    void *nptr;
+
+    if (!allocator)
+        return c_realloc(ptr, sz);
+
+    nptr = allocator->realloc(allocator->data, ptr, old_sz, sz);
+    if (!nptr) {
+        c_set_error("cannot reallocate %zu bytes: %s", sz, strerror(errno));
+        return NULL;
+    }
+
+    return nptr;
+}
+
+void *
+c_allocator_aligned_alloc(const struct c_allocator *allocator,
+                          size_t alignment, size_t sz) {
+    size_t block_sz;
+    void *block, *ptr;
+
+    if (alignment == 0)
+        return c_allocator_malloc(allocator, sz);
+
+    if (!allocator)
+        return c_aligned_alloc(alignment, sz);
+
+    if (!c_memory_is_valid_alignment(alignment)) {
+        c_set_error("invalid alignment %zu", alignment);
+        return NULL;
+    }
+
+    /* Both functions must be available, otherwise the block could not be
+     * released the same way it was allocated. */
+    if (allocator->aligned_alloc && allocator->aligned_free) {
+        ptr = allocator->aligned_alloc(allocator->data, alignment, sz);
+        if (!ptr) {
+            c_set_error("cannot allocate %zu bytes: %s",
+                        sz, strerror(errno));
+            return NULL;
+        }
+
+        return ptr;
+    }
+
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+
+    if (sz > SIZE_MAX - alignment - 2 * sizeof(size_t)) {
+        c_set_error("cannot allocate %zu bytes: size too large", sz);
+        return NULL;
+    }
+
+    block_sz = sz + alignment + 2 * sizeof(size_t);
+
+    block = c_allocator_malloc(allocator, block_sz);
+    if (!block)
+        return NULL;
+
+    return c_memory_align_block(block, block_sz, alignment);
+}
+
+void
+c_allocator_aligned_free(const struct c_allocator *allocator,
+                         size_t alignment, void *ptr, size_t sz) {
+    void *block;
+    size_t block_sz;
+
+    if (alignment == 0) {
+        c_allocator_free(allocator, ptr, sz);
+        return;
+    }
+
+    if (!allocator) {
+        c_aligned_free(ptr, sz);
+        return;
+    }
+
+    if (!ptr)
+        return;
+
+    if (allocator->aligned_alloc && allocator->aligned_free) {
+        allocator->aligned_free(allocator->data, ptr, sz);
+        return;
+    }
+
+    block = c_memory_aligned_block_origin(ptr, &block_sz);
+    c_allocator_free(allocator, block, block_sz);
+}
+
+void *
+c_allocator_aligned_realloc(const struct c_allocator *allocator,
+                            size_t alignment, void *ptr,
+                            size_t old_sz, size_t sz) {
+    void *nptr;
+
+    if (alignment == 0)
+        return c_allocator_realloc(allocator, ptr, old_sz, sz);
+
+    /* There is no way to resize an aligned block in place */
+    nptr = c_allocator_aligned_alloc(allocator, alignment, sz);
+    if (!nptr)
+        return NULL;
+
+    if (ptr) {
+        memcpy(nptr, ptr, (old_sz < sz) ? old_sz : sz);
+        c_allocator_aligned_free(allocator, alignment, ptr, old_sz);
+    }
+
+    return nptr;
+}
+
+static void *
+c_memory_header_malloc(size_t sz, void *caller) {
+    struct c_memory_header *header;
+
+    header = c_memory_block_alloc(sz);
+    if (!header)
+        return NULL;
+
+    if (c_memory_stats_enabled)
+        c_memory_stats_add(sz, caller);
+
+    return (uint8_t *)header + C_MEMORY_HEADER_SZ;
+}
+
+static void
+c_memory_header_free(void *ptr) {
+    struct c_memory_header *header;
+
+    if (!ptr)
+        return;
+
+    header = (struct c_memory_header *)((uint8_t *)ptr - C_MEMORY_HEADER_SZ);
+
+    if (c_memory_stats_enabled)
+        c_memory_stats_remove(header->size);
+
+    c_memory_block_release(header);
+}
+
+static void *
+c_memory_header_realloc(void *ptr, size_t sz, void *caller) {
+    struct c_memory_header *header, *nheader;
+    size_t old_sz, copy_sz;
+
+    if (!ptr)
+        return c_memory_header_malloc(sz, caller);
+
+    header = (struct c_memory_header *)((uint8_t *)ptr - C_MEMORY_HEADER_SZ);
+    old_sz = header->size;
+
+    if (header->size_class == C_MEMORY_NO_SIZE_CLASS
+     && (!c_memory_thread_cache_enabled
+         || c_memory_size_class(sz) == C_MEMORY_NO_SIZE_CLASS)) {
+        /* Blocks which are not cached are resized by the memory allocator */
+        if (sz > SIZE_MAX - C_MEMORY_HEADER_SZ) {
+            c_set_error("cannot reallocate %zu bytes: size too large", sz);
+            return NULL;
+        }
+
+        nheader = c_memory_allocator.realloc(header, C_MEMORY_HEADER_SZ + sz);
+        if (!nheader) {
+            c_set_error("cannot reallocate %zu bytes: %s",
+                        sz, strerror(errno));
+            return NULL;
+        }
+
+        nheader->size = sz;
+
+        if (c_memory_stats_enabled) {
+            copy_sz = (nheader != header) ? ((old_sz < sz) ? old_sz : sz) : 0;
+            c_memory_stats_resize(old_sz, sz, copy_sz);
+        }
+
+        return (uint8_t *)nheader + C_MEMORY_HEADER_SZ;
+    }
+
+    if (header->size_class != C_MEMORY_NO_SIZE_CLASS
+     && sz <= c_memory_size_classes[header->size_class]) {
+        header->size = sz;
+
+        if (c_memory_stats_enabled)
+            c_memory_stats_resize(old_sz, sz, 0);
+
+        return ptr;
+    }
+
+    nheader = c_memory_block_alloc(sz);
+    if (!nheader)
+        return NULL;
+
+    copy_sz = (old_sz < sz) ? old_sz : sz;
+    memcpy((uint8_t *)nheader + C_MEMORY_HEADER_SZ, ptr, copy_sz);
+
+    c_memory_block_release(header);
+
+    if (c_memory_stats_enabled)
+        c_memory_stats_resize(old_sz, sz, copy_sz);
+
+    return (uint8_t *)nheader + C_MEMORY_HEADER_SZ;
+}
+
+static struct c_memory_header *
+c_memory_block_alloc(size_t sz) {
+    struct c_memory_header *header;
+    size_t size_class, block_sz;
+
+    size_class = C_MEMORY_NO_SIZE_CLASS;
+    block_sz = sz;
+    header = NULL;
+
+    if (c_memory_thread_cache_enabled) {
+        size_class = c_memory_size_class(sz);
+
+        if (size_class != C_MEMORY_NO_SIZE_CLASS) {
+            block_sz = c_memory_size_classes[size_class];
+            header = c_memory_cache_get(size_class);
+        }
+    }
+
+    if (!header) {
+        if (block_sz > SIZE_MAX - C_MEMORY_HEADER_SZ) {
+            c_set_error("cannot allocate %zu bytes: size too large", sz);
+            return NULL;
+        }
+
+        header = c_memory_allocator.malloc(C_MEMORY_HEADER_SZ + block_sz);
+        if (!header) {
+            c_set_error("cannot allocate %zu bytes: %s", sz, strerror(errno));
+            return NULL;
+        }
+    }
+
+    header->size_class = size_class;
+    header->size = sz;
+
+    return header;
+}
+
+static void
+c_memory_block_release(struct c_memory_header *header) {
+    if (header->size_class == C_MEMORY_NO_SIZE_CLASS) {
+        c_memory_allocator.free(header);
+        return;
+    }
+
+    c_memory_cache_put(header->size_class, header);
+}
+
+static size_t
+c_memory_size_class(size_t sz) {
+    if (sz <= 256)
+        return (sz == 0) ? 0 : (sz - 1) / 16;
+
+    for (size_t i = 16; i < C_MEMORY_NB_SIZE_CLASSES; i++) {
+        if (sz <= c_memory_size_classes[i])
+            return i;
+    }
+
+    return C_MEMORY_NO_SIZE_CLASS;
+}
+
+static struct c_memory_header *
+c_memory_cache_get(size_t size_class) {
+    struct c_memory_thread_cache *cache;
+    struct c_memory_magazine *loaded, *previous, *full, *empty;
+    struct c_memory_depot *depot;
+
+    cache = &c_memory_thread_cache;
+
+    loaded = cache->loaded[size_class];
+    if (loaded && loaded->nb_blocks > 0) {
+        cache->nb_hits++;
+        return loaded->blocks[--loaded->nb_blocks];
+    }
+
+    previous = cache->previous[size_class];
+    if (previous && previous->nb_blocks > 0) {
+        cache->loaded[size_class] = previous;
+        cache->previous[size_class] = loaded;
+
+        cache->nb_hits++;
+        return previous->blocks[--previous->nb_blocks];
+    }
+
+    /* Both magazines are empty: exchange one of them for a full magazine of
+     * the depot if there is one. The number of full magazines is read
+     * without locking first so that threads which only allocate do not
+     * contend on the depot. */
+    depot = &c_memory_depots[size_class];
+
+    if (__atomic_load_n(&depot->nb_full_magazines, __ATOMIC_RELAXED) == 0) {
+        cache->nb_misses++;
+        return NULL;
+    }
+
+    empty = NULL;
+
+    if (pthread_mutex_lock(&depot->mutex) != 0)
+        abort();
+
+    full = depot->full_magazines;
+    if (full) {
+        depot->full_magazines = full->next;
+        __atomic_store_n(&depot->nb_full_magazines,
+                         depot->nb_full_magazines - 1, __ATOMIC_RELAXED);
+
+        if (previous) {
+            if (depot->nb_empty_magazines < C_MEMORY_DEPOT_MAX_MAGAZINES) {
+                previous->next = depot->empty_magazines;
+                depot->empty_magazines = previous;
+                depot->nb_empty_magazines++;
+            } else {
+                empty = previous;
+            }
+        }
+    }
+
+    if (pthread_mutex_unlock(&depot->mutex) != 0)
+        abort();
+
+    if (empty)
+        c_memory_allocator.free(empty);
+
+    if (!full) {
+        cache->nb_misses++;
+        return NULL;
+    }
+
+    __atomic_fetch_add(&c_memory_cache_stats_data.nb_depot_gets, 1,
+                       __ATOMIC_RELAXED);
+
+    cache->previous[size_class] = loaded;
+    cache->loaded[size_class] = full;
+
+    if (!cache->registered) {
+        /* Make sure magazines are returned when the thread exits */
+        if (pthread_setspecific(c_memory_thread_cache_key, cache) == 0)
+            cache->registered = true;
+    }
+
+    cache->nb_hits++;
+    c_memory_thread_cache_flush_counters(cache);
+
+    return full->blocks[--full->nb_blocks];
+}
+
+static void
+c_memory_cache_put(size_t size_class, struct c_memory_header *header) {
+    struct c_memory_thread_cache *cache;
+    struct c_memory_magazine *loaded, *previous, *empty, *overflow;
+    struct c_memory_depot *depot;
+
+    cache = &c_memory_thread_cache;
+
+    loaded = cache->loaded[size_class];
+    if (loaded && loaded->nb_blocks < C_MEMORY_MAGAZINE_SZ) {
+        loaded->blocks[loaded->nb_blocks++] = header;
+        return;
+    }
+
+    previous = cache->previous[size_class];
+    if (previous && previous->nb_blocks < C_MEMORY_MAGAZINE_SZ) {
+        cache->loaded[size_class] = previous;
+        cache->previous[size_class] = loaded;
+
+        previous->blocks[previous->nb_blocks++] = header;
+        return;
+    }
+
+    /* Both magazines are full (or missing): give the previous one to the
+     * depot and take an empty one. */
+    depot = &c_memory_depots[size_class];
+    overflow = NULL;
+
+    if (pthread_mutex_lock(&depot->mutex) != 0)
+        abort();
+
+    if (previous) {
+        if (depot->nb_full_magazines < C_MEMORY_DEPOT_MAX_MAGAZINES) {
+            previous->next = depot->full_magazines;
+            depot->full_magazines = previous;
+            __atomic_store_n(&depot->nb_full_magazines,
+                             depot->nb_full_magazines + 1, __ATOMIC_RELAXED);
+
+            __atomic_fetch_add(&c_memory_cache_stats_data.nb_depot_puts, 1,
+                               __ATOMIC_RELAXED);
+        } else {
+            overflow = previous;
+        }
+    }
+
+    empty = depot->empty_magazines;
+    if (empty) {
+        depot->empty_magazines = empty->next;
+        depot->nb_empty_magazines--;
+    }
+
+    if (pthread_mutex_unlock(&depot->mutex) != 0)
+        abort();
+
+    if (overflow) {
+        /* The depot is full: blocks go back to the memory allocator */
+        c_memory_magazine_release(overflow);
+
+        if (empty) {
+            c_memory_allocator.free(overflow);
+        } else {
+            empty = overflow;
+        }
+    }
+
+    if (!empty) {
+        empty = c_memory_allocator.malloc(sizeof(struct c_memory_magazine));
+        if (!empty) {
+            c_memory_allocator.free(header);
+            return;
+        }
+
+        empty->nb_blocks = 0;
+    }
+
+    cache->previous[size_class] = loaded;
+    cache->loaded[size_class] = empty;
+
+    if (!cache->registered) {
+        if (pthread_setspecific(c_memory_thread_cache_key, cache) == 0)
+            cache->registered = true;
+    }
+
+    empty->blocks[empty->nb_blocks++] = header;
+
+    c_memory_thread_cache_flush_counters(cache);
+}
+
+static void
+c_memory_depot_put(size_t size_class, struct c_memory_magazine *magazine) {
+    struct c_memory_depot *depot;
+    bool full;
+
+    if (!magazine)
+        return;
+
+    depot = &c_memory_depots[size_class];
+    full = magazine->nb_blocks > 0;
+
+    if (pthread_mutex_lock(&depot->mutex) != 0)
+        abort();
+
+    if (full && depot->nb_full_magazines < C_MEMORY_DEPOT_MAX_MAGAZINES) {
+        magazine->next = depot->full_magazines;
+        depot->full_magazines = magazine;
+        __atomic_store_n(&depot->nb_full_magazines,
+                         depot->nb_full_magazines + 1, __ATOMIC_RELAXED);
+
+        __atomic_fetch_add(&c_memory_cache_stats_data.nb_depot_puts, 1,
+                           __ATOMIC_RELAXED);
+
+        magazine = NULL;
+    } else if (!full
+            && depot->nb_empty_magazines < C_MEMORY_DEPOT_MAX_MAGAZINES) {
+        magazine->next = depot->empty_magazines;
+        depot->empty_magazines = magazine;
+        depot->nb_empty_magazines++;
+
+        magazine = NULL;
+    }
+
+    if (pthread_mutex_unlock(&depot->mutex) != 0)
+        abort();
+
+    if (magazine) {
+        c_memory_magazine_release(magazine);
+        c_memory_allocator.free(magazine);
+    }
+}
+
+static void
+c_memory_magazine_release(struct c_memory_magazine *magazine) {
+    for (size_t i = 0; i < magazine->nb_blocks; i++)
+        c_memory_allocator.free(magazine->blocks[i]);
+
+    magazine->nb_blocks = 0;
+}
+
+static void
+c_memory_thread_cache_flush_counters(struct c_memory_thread_cache *cache) {
+    struct c_memory_cache_stats *data;
+
+    data = &c_memory_cache_stats_data;
+
+    if (cache->nb_hits > 0) {
+        __atomic_fetch_add(&data->nb_hits, cache->nb_hits, __ATOMIC_RELAXED);
+        cache->nb_hits = 0;
+    }
+
+    if (cache->nb_misses > 0) {
+        __atomic_fetch_add(&data->nb_misses, cache->nb_misses,
+                           __ATOMIC_RELAXED);
+        cache->nb_misses = 0;
+    }
+}
+
+static void
+c_memory_thread_cache_delete(void *arg) {
+    struct c_memory_thread_cache *cache;
+
+    cache = arg;
+
+    c_memory_flush_thread_cache();
+
+    /* Destructors of other keys may still release memory; registering the
+     * cache again makes sure it is flushed once more. */
+    cache->registered = false;
+}
+
+static void
+c_memory_stats_add(size_t sz, void *caller) {
+    struct c_memory_stats *data;
+    size_t live_size, peak_live_size, size_class;
+
+    data = &c_memory_stats_data;
+
+    __atomic_fetch_add(&data->nb_allocations, 1, __ATOMIC_RELAXED);
+
+    size_class = c_memory_size_class(sz);
+    if (size_class == C_MEMORY_NO_SIZE_CLASS)
+        size_class = C_MEMORY_NB_SIZE_CLASSES;
+    __atomic_fetch_add(&data->size_classes[size_class].nb_allocations, 1,
+                       __ATOMIC_RELAXED);
+
+    live_size = __atomic_add_fetch(&data->live_size, sz, __ATOMIC_RELAXED);
+
+    peak_live_size = __atomic_load_n(&data->peak_live_size, __ATOMIC_RELAXED);
+    while (live_size > peak_live_size) {
+        if (__atomic_compare_exchange_n(&data->peak_live_size,
+                                        &peak_live_size, live_size, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (c_memory_sampling_interval > 0) {
+        if (++c_memory_sampling_counter >= c_memory_sampling_interval) {
+            c_memory_sampling_counter = 0;
+            c_memory_sample(sz, caller);
+        }
+    }
+}
+
+static void
+c_memory_stats_remove(size_t sz) {
+    struct c_memory_stats *data;
+
+    data = &c_memory_stats_data;
+
+    __atomic_fetch_add(&data->nb_frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&data->live_size, sz, __ATOMIC_RELAXED);
+}
+
+static void
+c_memory_stats_resize(size_t old_sz, size_t sz, size_t copy_sz) {
+    struct c_memory_stats *data;
+
+    data = &c_memory_stats_data;
+
+    __atomic_fetch_add(&data->nb_reallocs, 1, __ATOMIC_RELAXED);
+
+    if (copy_sz > 0) {
+        __atomic_fetch_add(&data->realloc_copy_size, copy_sz,
+                           __ATOMIC_RELAXED);
+    }
+
+    if (sz >= old_sz) {
+        size_t live_size, peak_live_size;
+
+        live_size = __atomic_add_fetch(&data->live_size, sz - old_sz,
+                                       __ATOMIC_RELAXED);
+
+        peak_live_size = __atomic_load_n(&data->peak_live_size,
+                                         __ATOMIC_RELAXED);
+        while (live_size > peak_live_size) {
+            if (__atomic_compare_exchange_n(&data->peak_live_size,
+                                            &peak_live_size, live_size, true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+    } else {
+        __atomic_fetch_sub(&data->live_size, old_sz - sz, __ATOMIC_RELAXED);
+    }
+}
+
+static void
+c_memory_sample(size_t sz, void *caller) {
+    struct c_memory_sites *sites;
+    struct c_memory_site *site;
+    void *frames[C_MEMORY_MAX_SITE_FRAMES * 2];
+    size_t nb_frames, idx;
+    uint32_t hash;
+
+    /* The caller is the return address of c_malloc(); the frames of the
+     * memory layer are the ones before it in the backtrace. Frame counts
+     * cannot be used since the compiler may inline functions or use tail
+     * calls. */
+    frames[0] = caller;
+    nb_frames = 1;
+
+#ifdef C_PLATFORM_LINUX
+    {
+        size_t nb;
+        int ret;
+
+        ret = backtrace(frames, C_MEMORY_MAX_SITE_FRAMES * 2);
+        nb = (ret > 0) ? (size_t)ret : 0;
+
+        for (size_t i = 0; i < nb; i++) {
+            if (frames[i] == caller) {
+                nb_frames = nb - i;
+                if (nb_frames > C_MEMORY_MAX_SITE_FRAMES)
+                    nb_frames = C_MEMORY_MAX_SITE_FRAMES;
+
+                memmove(frames, frames + i, nb_frames * sizeof(void *));
+                break;
+            }
+        }
+
+        if (frames[0] != caller) {
+            frames[0] = caller;
+            nb_frames = 1;
+        }
+    }
+#endif
+
+    hash = c_hash_memory(frames, nb_frames * sizeof(void *));
+
+    sites = &c_memory_sites;
+
+    if (pthread_mutex_lock(&sites->mutex) != 0)
+        abort();
+
+    __atomic_fetch_add(&c_memory_stats_data.nb_samples, 1, __ATOMIC_RELAXED);
+
+    /* Open addressing with linear probing; sites are never removed */
+    idx = hash % C_MEMORY_MAX_SITES;
+    site = NULL;
+
+    for (size_t i = 0; i < C_MEMORY_MAX_SITES; i++) {
+        struct c_memory_site *candidate;
+
+        candidate = &sites->sites[(idx + i) % C_MEMORY_MAX_SITES];
+
+        if (candidate->nb_frames == 0) {
+            candidate->hash = hash;
+            candidate->nb_frames = nb_frames;
+            memcpy(candidate->frames, frames, nb_frames * sizeof(void *));
+
+            sites->nb_sites++;
+
+            site = candidate;
+            break;
+        }
+
+        if (candidate->hash == hash && candidate->nb_frames == nb_frames
+         && memcmp(candidate->frames, frames,
+                   nb_frames * sizeof(void *)) == 0) {
+            site = candidate;
+            break;
+        }
+    }
+
+    if (site) {
+        site->nb_samples++;
+        site->size += sz;
+    } else {
+        sites->nb_dropped_samples++;
+    }
+
+    if (pthread_mutex_unlock(&sites->mutex) != 0)
+        abort();
+}
+
+static int
+c_memory_cmp_sites(const void *p1, const void *p2) {
+    const struct c_memory_site *site1, *site2;
+
+    site1 = p1;
+    site2 = p2;
+
+    if (site1->size < site2->size)
+        return 1;
+    if (site1->size > site2->size)
+        return -1;
+
+    return 0;
+}
+
+static void *
+c_memory_default_aligned_alloc(size_t alignment, size_t sz) {
+    void *ptr;
+    int ret;
+
+    ret = posix_memalign(&ptr, alignment, sz);
+    if (ret != 0) {
+        errno = ret;
+        return NULL;
+    }
+
+    return ptr;
+}
+
+static bool
+c_memory_is_valid_alignment(size_t alignment) {
+    return alignment > 0 && (alignment & (alignment - 1)) == 0;
+}
+
+static void *
+c_memory_map_huge_pages(size_t alignment, size_t sz) {
+    size_t map_sz, region_sz, head_sz, tail_sz;
+    uintptr_t region, ptr;
+    void *addr;
+
+    /* Mappings are rounded to the size of huge pages and aligned on their
+     * boundaries, so that the kernel can back the whole range with huge
+     * pages. */
+    if (alignment < C_MEMORY_HUGE_PAGE_SZ)
+        alignment = C_MEMORY_HUGE_PAGE_SZ;
+
+    if (sz > SIZE_MAX - C_MEMORY_HUGE_PAGE_SZ - alignment) {
+        c_set_error("cannot allocate %zu bytes: size too large", sz);
+        return NULL;
+    }
+
+    map_sz = (sz + C_MEMORY_HUGE_PAGE_SZ - 1)
+           & ~(size_t)(C_MEMORY_HUGE_PAGE_SZ - 1);
+    region_sz = map_sz + alignment;
+
+    addr = mmap(NULL, region_sz, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        c_set_error("cannot map %zu bytes: %s", region_sz, strerror(errno));
+        return NULL;
+    }
+
+    region = (uintptr_t)addr;
+    ptr = (region + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    head_sz = ptr - region;
+    tail_sz = region_sz - head_sz - map_sz;
+
+    if (head_sz > 0)
+        munmap((void *)region, head_sz);
+    if (tail_sz > 0)
+        munmap((void *)(ptr + map_sz), tail_sz);
+
+#ifdef MADV_HUGEPAGE
+    /* Transparent huge pages may be disabled; the mapping is still usable
+     * with regular pages. */
+    madvise((void *)ptr, map_sz, MADV_HUGEPAGE);
+#endif
+
+    return (void *)ptr;
+}
+
+static void
+c_memory_unmap_huge_pages(void *ptr, size_t sz) {
+    size_t map_sz;
+
+    map_sz = (sz + C_MEMORY_HUGE_PAGE_SZ - 1)
+           & ~(size_t)(C_MEMORY_HUGE_PAGE_SZ - 1);
+
+    if (munmap(ptr, map_sz) == -1)
+        abort();
+}
+
+static void *
+c_memory_align_block(void *block, size_t block_sz, size_t alignment) {
+    uintptr_t ptr;
+
+    ptr = ((uintptr_t)block + 2 * sizeof(size_t) + alignment - 1)
+        & ~(uintptr_t)(alignment - 1);
+
+    ((size_t *)ptr)[-1] = (uintptr_t)block;
+    ((size_t *)ptr)[-2] = block_sz;
+
+    return (void *)ptr;
+}
+
+static void *
+c_memory_aligned_block_origin(void *ptr, size_t *pblock_sz) {
+    if (pblock_sz)
+        *pblock_sz = ((size_t *)ptr)[-2];
+
+    return (void *)((size_t *)ptr)[-1];
+}
@@ -17,6 +17,8 @@
 #ifndef LIBCORE_MEMORY_H
 #define LIBCORE_MEMORY_H
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 struct c_memory_allocator {
@@ -24,12 +26,51 @@ struct c_memory_allocator {
     void (*free)(void *ptr);
     void *(*calloc)(size_t nb, size_t sz);
     void *(*realloc)(void *ptr, size_t sz);
+
+    void *(*aligned_alloc)(size_t alignment, size_t sz);
+    void (*aligned_free)(void *ptr);
 };
 
 extern const struct c_memory_allocator *c_default_memory_allocator;
 
 void c_set_memory_allocator(const struct c_memory_allocator *allocator);
 
+struct c_memory_cache_stats {
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    uint64_t nb_depot_gets;
+    uint64_t nb_depot_puts;
+};
+
+int c_memory_enable_thread_cache(void);
+void c_memory_flush_thread_cache(void);
+void c_memory_cache_stats(struct c_memory_cache_stats *);
+
+#define C_MEMORY_STATS_NB_SIZE_CLASSES 29
+
+struct c_memory_size_class_stats {
+    size_t size;
+    uint64_t nb_allocations;
+};
+
+struct c_memory_stats {
+    size_t live_size;
+    size_t peak_live_size;
+
+    uint64_t nb_allocations;
+    uint64_t nb_frees;
+    uint64_t nb_reallocs;
+    uint64_t realloc_copy_size;
+    uint64_t nb_samples;
+
+    struct c_memory_size_class_stats
+        size_classes[C_MEMORY_STATS_NB_SIZE_CLASSES];
+};
+
+int c_memory_enable_stats(size_t);
+void c_memory_stats(struct c_memory_stats *);
+void c_memory_print_stats(FILE *);
+
 void *c_malloc(size_t);
 void *c_malloc0(size_t);
 void c_free(void *);
@@ -37,4 +78,32 @@ void c_free0(void *, size_t);
 void *c_calloc(size_t, size_t);
 void *c_realloc(void *, size_t);
 
+int c_memory_set_huge_page_threshold(size_t);
+
+void *c_aligned_alloc(size_t, size_t);
+void c_aligned_free(void *, size_t);
+
+struct c_allocator {
+    void *(*malloc)(void *data, size_t sz);
+    void (*free)(void *data, void *ptr, size_t sz);
+    void *(*realloc)(void *data, void *ptr, size_t old_sz, size_t sz);
+
+    void *(*aligned_alloc)(void *data, size_t alignment, size_t sz);
+    void (*aligned_free)(void *data, void *ptr, size_t sz);
+
+    void *data;
+};
+
+void *c_allocator_malloc(const struct c_allocator *, size_t);
+void *c_allocator_malloc0(const struct c_allocator *, size_t);
+void c_allocator_free(const struct c_allocator *, void *, size_t);
+void c_allocator_free0(const struct c_allocator *, void *, size_t);
+void *c_allocator_realloc(const struct c_allocator *, void *, size_t, size_t);
+
+void *c_allocator_aligned_alloc(const struct c_allocator *, size_t, size_t);
+void c_allocator_aligned_free(const struct c_allocator *, size_t,
+                              void *, size_t);
+void *c_allocator_aligned_realloc(const struct c_allocator *, size_t,
+                                  void *, size_t, size_t);
+
 #endif
@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+#include "hash-group.h"
+
+/*
+ * Entries are stored in a dense array in insertion order. The index used to
+ * find them is an open addressing table (see hash-table.c) whose slots only
+ * contain the position of an entry in the array.
+ *
+ *   index                      entries
+ *  +----+----+----+----+      +-----------+-----------+-----------+--
+ *  |  2 |    |  0 |  1 |      | k0 v0 h0  | k1 v1 h1  | k2 v2 h2  |
+ *  +----+----+----+----+      +-----------+-----------+-----------+--
+ *
+ * Removing an entry marks it as deleted in the array; deleted entries are
+ * dropped when the array is rebuilt, which happens when it is full or when
+ * the table shrinks. Each entry of the array, deleted or not, accounts for
+ * at most one used (full or deleted) slot of the index; the array never
+ * contains more entries than the maximum load of the index, so the index
+ * always has empty slots and never has to be resized independently.
+ *
+ * The hash of each key is stored in its entry, so that the index can be
+ * rebuilt without calling the hash function.
+ */
+
+#define C_ORDERED_HASH_TABLE_MIN_NB_SLOTS C_HASH_GROUP_SZ
+
+struct c_ordered_hash_table_entry {
+    void *key;
+    void *value;
+    uint32_t hash;
+    bool deleted;
+};
+
+struct c_ordered_hash_table {
+    struct c_ordered_hash_table_entry *entries;
+    size_t nb_used_entries; /* including deleted entries */
+    size_t nb_entries;
+
+    uint32_t *slots;
+    uint8_t *ctrl;
+    size_t nb_slots;
+    size_t min_nb_slots; /* the index is never shrunk below this size */
+
+    c_hash_func hash_func;
+    c_equal_func equal_func;
+};
+
+/* Key searched by c_ordered_hash_table_find() */
+struct c_ordered_hash_table_lookup {
+    const void *key;
+    uint32_t hash;
+};
+
+static uint32_t c_ordered_hash_table_hash(const struct c_ordered_hash_table *,
+                                          const void *);
+static size_t c_ordered_hash_table_max_load(size_t);
+static int c_ordered_hash_table_nb_slots_for_capacity(size_t, size_t *);
+static int c_ordered_hash_table_rebuild(struct c_ordered_hash_table *, size_t);
+static void c_ordered_hash_table_shrink_if_needed(
+    struct c_ordered_hash_table *);
+static bool c_ordered_hash_table_slot_equal(const void *, const void *,
+                                            const void *);
+static bool c_ordered_hash_table_find(const struct c_ordered_hash_table *,
+                                      const void *, uint32_t, size_t *);
+static void c_ordered_hash_table_erase(struct c_ordered_hash_table *, size_t);
+
+struct c_ordered_hash_table *
+c_ordered_hash_table_new(c_hash_func hash_func, c_equal_func equal_func) {
+    return c_ordered_hash_table_new_with_capacity(hash_func, equal_func, 0);
+}
+
+struct c_ordered_hash_table *
+c_ordered_hash_table_new_with_capacity(c_hash_func hash_func,
+                                       c_equal_func equal_func,
+                                       size_t capacity) {
+    struct c_ordered_hash_table *table;
+    size_t nb_slots;
+
+    if (c_ordered_hash_table_nb_slots_for_capacity(capacity, &nb_slots) == -1)
+        return NULL;
+
+    table = c_malloc(sizeof(struct c_ordered_hash_table));
+    if (!table) {
+        c_set_error("cannot allocate table: %m");
+        return NULL;
+    }
+
+    memset(table, 0, sizeof(struct c_ordered_hash_table));
+
+    table->hash_func = hash_func;
+    table->equal_func = equal_func;
+    table->min_nb_slots = nb_slots;
+
+    if (c_ordered_hash_table_rebuild(table, nb_slots) == -1) {
+        c_ordered_hash_table_delete(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+void
+c_ordered_hash_table_delete(struct c_ordered_hash_table *table) {
+    if (!table)
+        return;
+
+    c_free(table->entries);
+    c_free(table->slots);
+
+    c_free0(table, sizeof(struct c_ordered_hash_table));
+}
+
+size_t
+c_ordered_hash_table_nb_entries(const struct c_ordered_hash_table *table) {
+    return table->nb_entries;
+}
+
+bool
+c_ordered_hash_table_is_empty(const struct c_ordered_hash_table *table) {
+    return table->nb_entries == 0;
+}
+
+void
+c_ordered_hash_table_clear(struct c_ordered_hash_table *table) {
+    memset(table->ctrl, C_HASH_CTRL_EMPTY,
+           table->nb_slots + C_HASH_GROUP_SZ);
+
+    table->nb_used_entries = 0;
+    table->nb_entries = 0;
+}
+
+size_t
+c_ordered_hash_table_capacity(const struct c_ordered_hash_table *table) {
+    return c_ordered_hash_table_max_load(table->nb_slots);
+}
+
+int
+c_ordered_hash_table_reserve(struct c_ordered_hash_table *table,
+                             size_t capacity) {
+    size_t nb_slots, nb_deleted;
+
+    if (c_ordered_hash_table_nb_slots_for_capacity(capacity, &nb_slots) == -1)
+        return -1;
+
+    table->min_nb_slots = nb_slots;
+
+    nb_deleted = table->nb_used_entries - table->nb_entries;
+
+    if (capacity <= c_ordered_hash_table_max_load(table->nb_slots) - nb_deleted)
+        return 0;
+
+    return c_ordered_hash_table_rebuild(table, nb_slots);
+}
+
+int
+c_ordered_hash_table_insert(struct c_ordered_hash_table *table,
+                            void *key, void *value) {
+    return c_ordered_hash_table_insert2(table, key, value, NULL, NULL);
+}
+
+int
+c_ordered_hash_table_insert2(struct c_ordered_hash_table *table,
+                             void *key, void *value,
+                             void **old_key, void **old_value) {
+    struct c_ordered_hash_table_entry *entry;
+    uint32_t hash;
+    size_t idx;
+
+    hash = c_ordered_hash_table_hash(table, key);
+
+    if (c_ordered_hash_table_find(table, key, hash, &idx)) {
+        /* Updating an entry does not change its position */
+        entry = table->entries + table->slots[idx];
+
+        if (old_key)
+            *old_key = entry->key;
+        if (old_value)
+            *old_value = entry->value;
+
+        entry->key = key;
+        entry->value = value;
+
+        return 0;
+    }
+
+    if (old_key)
+        *old_key = NULL;
+    if (old_value)
+        *old_value = NULL;
+
+    if (table->nb_used_entries
+        == c_ordered_hash_table_max_load(table->nb_slots)) {
+        size_t nb_slots;
+
+        /* If a significant part of the array only contains deleted entries,
+         * compacting it is enough. */
+        nb_slots = table->nb_slots;
+        if (table->nb_used_entries - table->nb_entries < nb_slots / 8) {
+            if (nb_slots > UINT32_MAX / 2) {
+                c_set_error("table too large");
+                return -1;
+            }
+
+            nb_slots *= 2;
+        }
+
+        if (c_ordered_hash_table_rebuild(table, nb_slots) == -1)
+            return -1;
+    }
+
+    idx = c_hash_ctrl_find_free_slot(table->ctrl, table->nb_slots, hash);
+    c_hash_ctrl_set(table->ctrl, table->nb_slots, idx, C_HASH_H2(hash));
+    table->slots[idx] = (uint32_t)table->nb_used_entries;
+
+    entry = table->entries + table->nb_used_entries;
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash;
+    entry->deleted = false;
+
+    table->nb_used_entries++;
+    table->nb_entries++;
+
+    return 1;
+}
+
+int
+c_ordered_hash_table_remove(struct c_ordered_hash_table *table,
+                            const void *key) {
+    return c_ordered_hash_table_remove2(table, key, NULL, NULL);
+}
+
+int
+c_ordered_hash_table_remove2(struct c_ordered_hash_table *table,
+                             const void *key,
+                             void **old_key, void **old_value) {
+    struct c_ordered_hash_table_entry *entry;
+    uint32_t hash;
+    size_t idx;
+
+    hash = c_ordered_hash_table_hash(table, key);
+
+    if (!c_ordered_hash_table_find(table, key, hash, &idx))
+        return 0;
+
+    entry = table->entries + table->slots[idx];
+
+    if (old_key)
+        *old_key = entry->key;
+    if (old_value)
+        *old_value = entry->value;
+
+    entry->deleted = true;
+    c_ordered_hash_table_erase(table, idx);
+
+    c_ordered_hash_table_shrink_if_needed(table);
+
+    return 1;
+}
+
+int
+c_ordered_hash_table_get(const struct c_ordered_hash_table *table,
+                         const void *key, void **pvalue) {
+    uint32_t hash;
+    size_t idx;
+
+    hash = c_ordered_hash_table_hash(table, key);
+
+    if (!c_ordered_hash_table_find(table, key, hash, &idx))
+        return 0;
+
+    if (pvalue)
+        *pvalue = table->entries[table->slots[idx]].value;
+
+    return 1;
+}
+
+bool
+c_ordered_hash_table_contains(const struct c_ordered_hash_table *table,
+                              const void *key) {
+    return c_ordered_hash_table_get(table, key, NULL) == 1;
+}
+
+void
+c_ordered_hash_table_iterator_init(struct c_ordered_hash_table_iterator *it,
+                                   struct c_ordered_hash_table *table) {
+    it->table = table;
+    it->entry = 0;
+}
+
+int
+c_ordered_hash_table_iterator_next(struct c_ordered_hash_table_iterator *it,
+                                   void **pkey, void **pvalue) {
+    struct c_ordered_hash_table *table;
+
+    table = it->table;
+
+    while (it->entry < table->nb_used_entries) {
+        struct c_ordered_hash_table_entry *entry;
+
+        entry = table->entries + it->entry++;
+        if (entry->deleted)
+            continue;
+
+        if (pkey)
+            *pkey = entry->key;
+        if (pvalue)
+            *pvalue = entry->value;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void
+c_ordered_hash_table_iterator_set_value(
+    struct c_ordered_hash_table_iterator *it, void *value) {
+    struct c_ordered_hash_table_entry *entry;
+
+    if (it->entry == 0 || it->entry > it->table->nb_used_entries)
+        return;
+
+    entry = it->table->entries + it->entry - 1;
+    if (entry->deleted)
+        return;
+
+    entry->value = value;
+}
+
+static uint32_t
+c_ordered_hash_table_hash(const struct c_ordered_hash_table *table,
+                          const void *key) {
+    return c_hash_mix(table->hash_func(key));
+}
+
+static size_t
+c_ordered_hash_table_max_load(size_t nb_slots) {
+    return c_hash_max_load(nb_slots, C_HASH_DEFAULT_MAX_LOAD_FACTOR);
+}
+
+static int
+c_ordered_hash_table_nb_slots_for_capacity(size_t capacity,
+                                           size_t *pnb_slots) {
+    size_t nb_slots;
+
+    nb_slots = C_ORDERED_HASH_TABLE_MIN_NB_SLOTS;
+
+    while (c_ordered_hash_table_max_load(nb_slots) < capacity) {
+        /* Entries are referenced by 32 bit positions in the index */
+        if (nb_slots > UINT32_MAX / 2) {
+            c_set_error("capacity too large");
+            return -1;
+        }
+
+        nb_slots *= 2;
+    }
+
+    *pnb_slots = nb_slots;
+    return 0;
+}
+
+static int
+c_ordered_hash_table_rebuild(struct c_ordered_hash_table *table,
+                             size_t nb_slots) {
+    struct c_ordered_hash_table_entry *entries;
+    uint32_t *slots;
+    size_t nb_entries, sz;
+
+    assert(nb_slots >= C_ORDERED_HASH_TABLE_MIN_NB_SLOTS);
+    assert(table->nb_entries < c_ordered_hash_table_max_load(nb_slots));
+
+    entries = c_calloc(c_ordered_hash_table_max_load(nb_slots),
+                       sizeof(struct c_ordered_hash_table_entry));
+    if (!entries) {
+        c_set_error("cannot allocate entries: %m");
+        return -1;
+    }
+
+    /* Slots and control bytes are stored in the same memory block */
+    sz = nb_slots * sizeof(uint32_t) + nb_slots + C_HASH_GROUP_SZ;
+
+    slots = c_malloc(sz);
+    if (!slots) {
+        c_set_error("cannot allocate slots: %m");
+        c_free(entries);
+        return -1;
+    }
+
+    /* Copy entries which have not been deleted, keeping their order */
+    nb_entries = 0;
+    for (size_t i = 0; i < table->nb_used_entries; i++) {
+        if (table->entries[i].deleted)
+            continue;
+
+        entries[nb_entries++] = table->entries[i];
+    }
+
+    assert(nb_entries == table->nb_entries);
+
+    c_free(table->entries);
+    c_free(table->slots);
+
+    table->entries = entries;
+    table->slots = slots;
+    table->ctrl = (uint8_t *)(slots + nb_slots);
+    table->nb_slots = nb_slots;
+
+    c_ordered_hash_table_clear(table);
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        size_t idx;
+
+        idx = c_hash_ctrl_find_free_slot(table->ctrl, nb_slots,
+                                         entries[i].hash);
+        c_hash_ctrl_set(table->ctrl, nb_slots, idx,
+                        C_HASH_H2(entries[i].hash));
+        table->slots[idx] = (uint32_t)i;
+    }
+
+    table->nb_used_entries = nb_entries;
+    table->nb_entries = nb_entries;
+
+    return 0;
+}
+
+static void
+c_ordered_hash_table_shrink_if_needed(struct c_ordered_hash_table *table) {
+    size_t nb_slots;
+
+    nb_slots = c_hash_shrunk_nb_slots(table->nb_slots, table->min_nb_slots,
+                                      table->nb_entries,
+                                      C_HASH_DEFAULT_MIN_LOAD_FACTOR);
+
+    /* Failing to shrink the table is not an error */
+    if (nb_slots < table->nb_slots)
+        c_ordered_hash_table_rebuild(table, nb_slots);
+}
+
+static bool
+c_ordered_hash_table_slot_equal(const void *data, const void *slot,
+                                const void *key) {
+    const struct c_ordered_hash_table *table;
+    const struct c_ordered_hash_table_entry *entry;
+    const struct c_ordered_hash_table_lookup *lookup;
+
+    table = data;
+    entry = table->entries + *(const uint32_t *)slot;
+    lookup = key;
+
+    /* Comparing full hashes first avoids most calls to the equality
+     * function when H2 values collide. */
+    return entry->hash == lookup->hash
+        && table->equal_func(entry->key, lookup->key);
+}
+
+static bool
+c_ordered_hash_table_find(const struct c_ordered_hash_table *table,
+                          const void *key, uint32_t hash, size_t *pidx) {
+    struct c_ordered_hash_table_lookup lookup;
+    size_t idx;
+
+    lookup.key = key;
+    lookup.hash = hash;
+
+    idx = c_hash_ctrl_find(table->ctrl, table->nb_slots,
+                           table->slots, sizeof(uint32_t), hash,
+                           c_ordered_hash_table_slot_equal, table, &lookup);
+    if (idx == SIZE_MAX)
+        return false;
+
+    *pidx = idx;
+    return true;
+}
+
+static void
+c_ordered_hash_table_erase(struct c_ordered_hash_table *table, size_t idx) {
+    /* Deleted slots do not have to be counted: each of them matches a
+     * deleted entry of the array, and the array is rebuilt before the index
+     * runs out of empty slots. */
+    c_hash_ctrl_erase(table->ctrl, table->nb_slots, idx);
+
+    table->nb_entries--;
+}
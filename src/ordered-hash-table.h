@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_ORDERED_HASH_TABLE_H
+#define LIBCORE_ORDERED_HASH_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* The content of this structure is private. Its definition is public so that
+ * iterators can be allocated by the caller. */
+struct c_ordered_hash_table_iterator {
+    struct c_ordered_hash_table *table;
+    size_t entry;
+};
+
+struct c_ordered_hash_table *
+c_ordered_hash_table_new(c_hash_func, c_equal_func);
+struct c_ordered_hash_table *
+c_ordered_hash_table_new_with_capacity(c_hash_func, c_equal_func, size_t);
+void c_ordered_hash_table_delete(struct c_ordered_hash_table *);
+size_t c_ordered_hash_table_nb_entries(const struct c_ordered_hash_table *);
+bool c_ordered_hash_table_is_empty(const struct c_ordered_hash_table *);
+void c_ordered_hash_table_clear(struct c_ordered_hash_table *);
+
+size_t c_ordered_hash_table_capacity(const struct c_ordered_hash_table *);
+int c_ordered_hash_table_reserve(struct c_ordered_hash_table *, size_t);
+
+int c_ordered_hash_table_insert(struct c_ordered_hash_table *, void *, void *);
+int c_ordered_hash_table_insert2(struct c_ordered_hash_table *, void *, void *,
+                                 void **, void **);
+int c_ordered_hash_table_remove(struct c_ordered_hash_table *, const void *);
+int c_ordered_hash_table_remove2(struct c_ordered_hash_table *, const void *,
+                                 void **, void **);
+int c_ordered_hash_table_get(const struct c_ordered_hash_table *,
+                             const void *, void **);
+bool c_ordered_hash_table_contains(const struct c_ordered_hash_table *,
+                                   const void *);
+
+void c_ordered_hash_table_iterator_init(struct c_ordered_hash_table_iterator *,
+                                        struct c_ordered_hash_table *);
+int c_ordered_hash_table_iterator_next(struct c_ordered_hash_table_iterator *,
+                                       void **, void **);
+void c_ordered_hash_table_iterator_set_value(
+    struct c_ordered_hash_table_iterator *, void *);
+
+#endif
@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+/*
+ * A pool allocates objects of a fixed size in slabs. A slab is a block of
+ * at least one memory page, which is carved into objects on demand; released
+ * objects are linked in a free list and reused by the next allocations. Slabs
+ * are only released when the pool is deleted.
+ *
+ * Concurrent pools give each thread a cache of free objects, so that most
+ * allocations and releases do not have to take the pool lock. Objects move
+ * between caches and the pool free list in batches. When a thread exits, its
+ * cache is returned to the pool.
+ */
+
+#define C_POOL_SLAB_HEADER_SZ       16
+#define C_POOL_MIN_OBJECTS_PER_SLAB 8
+
+#define C_POOL_CACHE_BATCH_SZ 32
+#define C_POOL_CACHE_MAX_SZ   (2 * C_POOL_CACHE_BATCH_SZ)
+
+struct c_pool_object {
+    struct c_pool_object *next;
+};
+
+struct c_pool_slab {
+    struct c_pool_slab *next;
+};
+
+struct c_pool_cache {
+    struct c_pool *pool;
+
+    struct c_pool_object *objects;
+    size_t nb_objects;
+
+    /* Only modified by the thread owning the cache */
+    uint64_t nb_allocations;
+    uint64_t nb_releases;
+
+    struct c_pool_cache *prev;
+    struct c_pool_cache *next;
+};
+
+struct c_pool {
+    size_t object_sz;
+    size_t slab_sz;
+
+    struct c_pool_slab *slabs;
+    size_t nb_slabs;
+    uint8_t *slab_ptr; /* first object not carved yet in the last slab */
+    uint8_t *slab_end;
+
+    struct c_pool_object *objects;
+
+    uint64_t nb_allocations;
+    uint64_t nb_releases;
+
+    bool concurrent;
+    uint64_t id;
+    pthread_mutex_t mutex;
+    pthread_key_t cache_key;
+    struct c_pool_cache *caches;
+};
+
+/* The last cache used by the current thread. Thread-specific data are slow
+ * to access, and most threads only ever use a single pool. Pools are
+ * identified by a unique id since a new pool can be allocated at the address
+ * of a deleted one. */
+static __thread struct c_pool_cache *c_pool_last_cache;
+static __thread uint64_t c_pool_last_cache_pool_id;
+
+static uint64_t c_pool_last_id;
+
+static struct c_pool *c_pool_new2(size_t, bool);
+static void *c_pool_alloc_object(struct c_pool *);
+static void c_pool_free_object(struct c_pool *, void *);
+static void c_pool_lock(struct c_pool *);
+static void c_pool_unlock(struct c_pool *);
+
+static struct c_pool_cache *c_pool_cache(struct c_pool *);
+static void c_pool_cache_delete(void *);
+static void c_pool_cache_fill(struct c_pool_cache *);
+static void c_pool_cache_flush(struct c_pool_cache *, size_t);
+
+static void *c_pool_allocator_malloc(void *, size_t);
+static void c_pool_allocator_free(void *, void *, size_t);
+static void *c_pool_allocator_realloc(void *, void *, size_t, size_t);
+
+struct c_pool *
+c_pool_new(size_t object_sz) {
+    return c_pool_new2(object_sz, false);
+}
+
+struct c_pool *
+c_pool_new_concurrent(size_t object_sz) {
+    return c_pool_new2(object_sz, true);
+}
+
+void
+c_pool_delete(struct c_pool *pool) {
+    struct c_pool_slab *slab;
+
+    if (!pool)
+        return;
+
+    if (pool->concurrent) {
+        struct c_pool_cache *cache;
+
+        /* Once the key is deleted, destructors are not called anymore for
+         * threads which are still running */
+        pthread_key_delete(pool->cache_key);
+
+        cache = pool->caches;
+        while (cache) {
+            struct c_pool_cache *next;
+
+            next = cache->next;
+            c_free0(cache, sizeof(struct c_pool_cache));
+            cache = next;
+        }
+
+        pthread_mutex_destroy(&pool->mutex);
+    }
+
+    slab = pool->slabs;
+    while (slab) {
+        struct c_pool_slab *next;
+
+        next = slab->next;
+        c_free(slab);
+        slab = next;
+    }
+
+    c_free0(pool, sizeof(struct c_pool));
+}
+
+size_t
+c_pool_object_size(const struct c_pool *pool) {
+    return pool->object_sz;
+}
+
+void *
+c_pool_alloc(struct c_pool *pool) {
+    struct c_pool_cache *cache;
+    struct c_pool_object *object;
+
+    if (!pool->concurrent) {
+        object = c_pool_alloc_object(pool);
+        if (!object)
+            return NULL;
+
+        pool->nb_allocations++;
+        return object;
+    }
+
+    cache = c_pool_cache(pool);
+    if (!cache)
+        return NULL;
+
+    if (!cache->objects) {
+        c_pool_lock(pool);
+        c_pool_cache_fill(cache);
+        c_pool_unlock(pool);
+
+        if (!cache->objects)
+            return NULL;
+    }
+
+    object = cache->objects;
+    cache->objects = object->next;
+    cache->nb_objects--;
+
+    __atomic_store_n(&cache->nb_allocations, cache->nb_allocations + 1,
+                     __ATOMIC_RELAXED);
+
+    return object;
+}
+
+void
+c_pool_free(struct c_pool *pool, void *ptr) {
+    struct c_pool_cache *cache;
+    struct c_pool_object *object;
+
+    if (!ptr)
+        return;
+
+    if (!pool->concurrent) {
+        c_pool_free_object(pool, ptr);
+        pool->nb_releases++;
+        return;
+    }
+
+    cache = c_pool_cache(pool);
+    if (!cache) {
+        c_pool_lock(pool);
+        c_pool_free_object(pool, ptr);
+        pool->nb_releases++;
+        c_pool_unlock(pool);
+        return;
+    }
+
+    object = ptr;
+    object->next = cache->objects;
+    cache->objects = object;
+    cache->nb_objects++;
+
+    __atomic_store_n(&cache->nb_releases, cache->nb_releases + 1,
+                     __ATOMIC_RELAXED);
+
+    if (cache->nb_objects > C_POOL_CACHE_MAX_SZ) {
+        c_pool_lock(pool);
+        c_pool_cache_flush(cache, C_POOL_CACHE_BATCH_SZ);
+        c_pool_unlock(pool);
+    }
+}
+
+void
+c_pool_stats(struct c_pool *pool, struct c_pool_stats *stats) {
+    const struct c_pool_cache *cache;
+    size_t nb_objects_per_slab;
+
+    memset(stats, 0, sizeof(struct c_pool_stats));
+
+    c_pool_lock(pool);
+
+    stats->nb_allocations = pool->nb_allocations;
+    stats->nb_releases = pool->nb_releases;
+
+    stats->memory_size = sizeof(struct c_pool) + pool->nb_slabs * pool->slab_sz;
+
+    for (cache = pool->caches; cache; cache = cache->next) {
+        stats->nb_allocations += __atomic_load_n(&cache->nb_allocations,
+                                                 __ATOMIC_RELAXED);
+        stats->nb_releases += __atomic_load_n(&cache->nb_releases,
+                                              __ATOMIC_RELAXED);
+
+        stats->memory_size += sizeof(struct c_pool_cache);
+    }
+
+    stats->object_size = pool->object_sz;
+    stats->nb_slabs = pool->nb_slabs;
+
+    c_pool_unlock(pool);
+
+    nb_objects_per_slab =
+        (pool->slab_sz - C_POOL_SLAB_HEADER_SZ) / pool->object_sz;
+
+    /* Counters of thread caches are read while other threads may be using
+     * them, so they are not necessarily consistent with each other */
+    if (stats->nb_allocations > stats->nb_releases) {
+        stats->nb_objects =
+            (size_t)(stats->nb_allocations - stats->nb_releases);
+    }
+
+    if (stats->nb_slabs * nb_objects_per_slab > stats->nb_objects) {
+        stats->nb_free_objects =
+            stats->nb_slabs * nb_objects_per_slab - stats->nb_objects;
+    }
+}
+
+void
+c_pool_init_allocator(struct c_pool *pool, struct c_allocator *allocator) {
+    allocator->malloc = c_pool_allocator_malloc;
+    allocator->free = c_pool_allocator_free;
+    allocator->realloc = c_pool_allocator_realloc;
+    allocator->aligned_alloc = NULL;
+    allocator->aligned_free = NULL;
+
+    allocator->data = pool;
+}
+
+static struct c_pool *
+c_pool_new2(size_t object_sz, bool concurrent) {
+    struct c_pool *pool;
+    size_t slab_sz;
+    long page_sz;
+    int ret;
+
+    if (object_sz > SIZE_MAX / (4 * C_POOL_MIN_OBJECTS_PER_SLAB)) {
+        c_set_error("object size too large");
+        return NULL;
+    }
+
+    /* Free objects store a pointer to the next free object. Since the size
+     * of a type is always a multiple of its alignment, objects are correctly
+     * aligned as long as the first object of each slab is. */
+    if (object_sz < sizeof(struct c_pool_object))
+        object_sz = sizeof(struct c_pool_object);
+    object_sz = (object_sz + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    page_sz = sysconf(_SC_PAGESIZE);
+    if (page_sz <= 0)
+        page_sz = 4096;
+
+    slab_sz = (size_t)page_sz;
+    while ((slab_sz - C_POOL_SLAB_HEADER_SZ) / object_sz
+           < C_POOL_MIN_OBJECTS_PER_SLAB) {
+        slab_sz *= 2;
+    }
+
+    pool = c_malloc0(sizeof(struct c_pool));
+    if (!pool) {
+        c_set_error("cannot allocate pool: %m");
+        return NULL;
+    }
+
+    pool->object_sz = object_sz;
+    pool->slab_sz = slab_sz;
+
+    if (concurrent) {
+        ret = pthread_mutex_init(&pool->mutex, NULL);
+        if (ret != 0) {
+            c_set_error("cannot initialize mutex: %s", strerror(ret));
+            c_free0(pool, sizeof(struct c_pool));
+            return NULL;
+        }
+
+        ret = pthread_key_create(&pool->cache_key, c_pool_cache_delete);
+        if (ret != 0) {
+            c_set_error("cannot create thread key: %s", strerror(ret));
+            pthread_mutex_destroy(&pool->mutex);
+            c_free0(pool, sizeof(struct c_pool));
+            return NULL;
+        }
+
+        pool->concurrent = true;
+        pool->id = __atomic_add_fetch(&c_pool_last_id, 1, __ATOMIC_RELAXED);
+    }
+
+    return pool;
+}
+
+static void *
+c_pool_alloc_object(struct c_pool *pool) {
+    struct c_pool_object *object;
+
+    if (pool->objects) {
+        object = pool->objects;
+        pool->objects = object->next;
+        return object;
+    }
+
+    if (pool->slab_ptr == pool->slab_end) {
+        struct c_pool_slab *slab;
+
+        slab = c_malloc(pool->slab_sz);
+        if (!slab) {
+            c_set_error("cannot allocate slab: %m");
+            return NULL;
+        }
+
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->nb_slabs++;
+
+        pool->slab_ptr = (uint8_t *)slab + C_POOL_SLAB_HEADER_SZ;
+        pool->slab_end = pool->slab_ptr
+            + (pool->slab_sz - C_POOL_SLAB_HEADER_SZ)
+              / pool->object_sz * pool->object_sz;
+    }
+
+    object = (struct c_pool_object *)pool->slab_ptr;
+    pool->slab_ptr += pool->object_sz;
+
+    return object;
+}
+
+static void
+c_pool_free_object(struct c_pool *pool, void *ptr) {
+    struct c_pool_object *object;
+
+    object = ptr;
+    object->next = pool->objects;
+    pool->objects = object;
+}
+
+static void
+c_pool_lock(struct c_pool *pool) {
+    if (!pool->concurrent)
+        return;
+
+    if (pthread_mutex_lock(&pool->mutex) != 0)
+        abort();
+}
+
+static void
+c_pool_unlock(struct c_pool *pool) {
+    if (!pool->concurrent)
+        return;
+
+    if (pthread_mutex_unlock(&pool->mutex) != 0)
+        abort();
+}
+
+static struct c_pool_cache *
+c_pool_cache(struct c_pool *pool) {
+    struct c_pool_cache *cache;
+    int ret;
+
+    if (c_pool_last_cache_pool_id == pool->id)
+        return c_pool_last_cache;
+
+    cache = pthread_getspecific(pool->cache_key);
+    if (cache)
+        goto end;
+
+    cache = c_malloc0(sizeof(struct c_pool_cache));
+    if (!cache) {
+        c_set_error("cannot allocate cache: %m");
+        return NULL;
+    }
+
+    cache->pool = pool;
+
+    ret = pthread_setspecific(pool->cache_key, cache);
+    if (ret != 0) {
+        c_set_error("cannot set thread cache: %s", strerror(ret));
+        c_free0(cache, sizeof(struct c_pool_cache));
+        return NULL;
+    }
+
+    c_pool_lock(pool);
+
+    cache->next = pool->caches;
+    if (pool->caches)
+        pool->caches->prev = cache;
+    pool->caches = cache;
+
+    c_pool_unlock(pool);
+
+end:
+    c_pool_last_cache = cache;
+    c_pool_last_cache_pool_id = pool->id;
+
+    return cache;
+}
+
+static void
+c_pool_cache_delete(void *arg) {
+    struct c_pool_cache *cache;
+    struct c_pool *pool;
+
+    cache = arg;
+    pool = cache->pool;
+
+    if (c_pool_last_cache == cache) {
+        c_pool_last_cache = NULL;
+        c_pool_last_cache_pool_id = 0;
+    }
+
+    c_pool_lock(pool);
+
+    c_pool_cache_flush(cache, cache->nb_objects);
+
+    pool->nb_allocations += cache->nb_allocations;
+    pool->nb_releases += cache->nb_releases;
+
+    if (cache->prev)
+        cache->prev->next = cache->next;
+    if (cache->next)
+        cache->next->prev = cache->prev;
+    if (cache == pool->caches)
+        pool->caches = cache->next;
+
+    c_pool_unlock(pool);
+
+    c_free0(cache, sizeof(struct c_pool_cache));
+}
+
+static void
+c_pool_cache_fill(struct c_pool_cache *cache) {
+    struct c_pool *pool;
+
+    pool = cache->pool;
+
+    while (cache->nb_objects < C_POOL_CACHE_BATCH_SZ) {
+        struct c_pool_object *object;
+
+        object = c_pool_alloc_object(pool);
+        if (!object)
+            break;
+
+        object->next = cache->objects;
+        cache->objects = object;
+        cache->nb_objects++;
+    }
+}
+
+static void
+c_pool_cache_flush(struct c_pool_cache *cache, size_t nb_objects) {
+    struct c_pool *pool;
+
+    pool = cache->pool;
+
+    for (size_t i = 0; i < nb_objects && cache->objects; i++) {
+        struct c_pool_object *object;
+
+        object = cache->objects;
+        cache->objects = object->next;
+        cache->nb_objects--;
+
+        c_pool_free_object(pool, object);
+    }
+}
+
+static void *
+c_pool_allocator_malloc(void *pool, size_t sz) {
+    if (sz > c_pool_object_size(pool))
+        return c_malloc(sz);
+
+    return c_pool_alloc(pool);
+}
+
+static void
+c_pool_allocator_free(void *pool, void *ptr, size_t sz) {
+    if (sz > c_pool_object_size(pool)) {
+        c_free(ptr);
+        return;
+    }
+
+    c_pool_free(pool, ptr);
+}
+
+static void *
+c_pool_allocator_realloc(void *pool, void *ptr, size_t old_sz, size_t sz) {
+    size_t object_sz;
+    void *nptr;
+
+    object_sz = c_pool_object_size(pool);
+
+    if (!ptr)
+        return c_pool_allocator_malloc(pool, sz);
+
+    if (old_sz > object_sz && sz > object_sz)
+        return c_realloc(ptr, sz);
+
+    if (old_sz <= object_sz && sz <= object_sz)
+        return ptr;
+
+    nptr = c_pool_allocator_malloc(pool, sz);
+    if (!nptr)
+        return NULL;
+
+    memcpy(nptr, ptr, (old_sz < sz) ? old_sz : sz);
+    c_pool_allocator_free(pool, ptr, old_sz);
+
+    return nptr;
+}
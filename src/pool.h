@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_POOL_H
+#define LIBCORE_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct c_pool_stats {
+    size_t object_size;
+
+    size_t nb_slabs;
+    size_t nb_objects;
+    size_t nb_free_objects;
+    size_t memory_size;
+
+    uint64_t nb_allocations;
+    uint64_t nb_releases;
+};
+
+struct c_pool *c_pool_new(size_t);
+struct c_pool *c_pool_new_concurrent(size_t);
+void c_pool_delete(struct c_pool *);
+
+size_t c_pool_object_size(const struct c_pool *);
+
+void *c_pool_alloc(struct c_pool *);
+void c_pool_free(struct c_pool *, void *);
+
+void c_pool_stats(struct c_pool *, struct c_pool_stats *);
+
+void c_pool_init_allocator(struct c_pool *, struct c_allocator *);
+
+#endif
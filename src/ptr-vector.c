@@ -22,16 +22,25 @@ struct c_ptr_vector {
     void **entries;
     size_t nb_entries;
     size_t entries_sz;
+
+    const struct c_allocator *allocator;
 };
 
 struct c_ptr_vector *
 c_ptr_vector_new(void) {
+    return c_ptr_vector_new_with_allocator(NULL);
+}
+
+struct c_ptr_vector *
+c_ptr_vector_new_with_allocator(const struct c_allocator *allocator) {
     struct c_ptr_vector *vector;
 
-    vector = c_malloc0(sizeof(struct c_ptr_vector));
+    vector = c_allocator_malloc0(allocator, sizeof(struct c_ptr_vector));
     if (!vector)
         return NULL;
 
+    vector->allocator = allocator;
+
     return vector;
 }
 
@@ -40,9 +49,10 @@ c_ptr_vector_delete(struct c_ptr_vector *vector) {
     if (!vector)
         return;
 
-    c_free(vector->entries);
+    c_allocator_free(vector->allocator, vector->entries,
+                     vector->entries_sz * sizeof(void *));
 
-    c_free0(vector, sizeof(struct c_ptr_vector));
+    c_allocator_free0(vector->allocator, vector, sizeof(struct c_ptr_vector));
 }
 
 void
@@ -73,7 +83,9 @@ c_ptr_vector_append(struct c_ptr_vector *vector, const void *value) {
     if (vector->entries_sz == 0
      || vector->nb_entries > vector->entries_sz - 1) {
         entries_sz = (vector->entries_sz == 0) ? 4 : (vector->entries_sz * 2);
-        entries = c_realloc(vector->entries, entries_sz * sizeof(void *));
+        entries = c_allocator_realloc(vector->allocator, vector->entries,
+                                      vector->entries_sz * sizeof(void *),
+                                      entries_sz * sizeof(void *));
         if (!entries)
             return -1;
     } else {
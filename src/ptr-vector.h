@@ -21,6 +21,8 @@
 #include <stdlib.h>
 
 struct c_ptr_vector *c_ptr_vector_new(void);
+struct c_ptr_vector *c_ptr_vector_new_with_allocator(
+    const struct c_allocator *);
 void c_ptr_vector_delete(struct c_ptr_vector *);
 
 void **c_ptr_vector_entries(const struct c_ptr_vector *);
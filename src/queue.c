@@ -21,28 +21,40 @@
 struct c_queue_entry {
     void *value;
 
+    const struct c_allocator *allocator;
+
     struct c_queue_entry *prev;
     struct c_queue_entry *next;
 };
 
-static struct c_queue_entry *c_queue_entry_new(void *);
+static struct c_queue_entry *c_queue_entry_new(const struct c_allocator *,
+                                               void *);
 
 struct c_queue {
     struct c_queue_entry *first;
     struct c_queue_entry *last;
     size_t length;
+
+    const struct c_allocator *allocator;
 };
 
 static void c_queue_add_entry(struct c_queue *, struct c_queue_entry *);
 
 struct c_queue *
 c_queue_new(void) {
+    return c_queue_new_with_allocator(NULL);
+}
+
+struct c_queue *
+c_queue_new_with_allocator(const struct c_allocator *allocator) {
     struct c_queue *queue;
 
-    queue = c_malloc0(sizeof(struct c_queue));
+    queue = c_allocator_malloc0(allocator, sizeof(struct c_queue));
     if (!queue)
         return NULL;
 
+    queue->allocator = allocator;
+
     return queue;
 }
 
@@ -53,7 +65,7 @@ c_queue_delete(struct c_queue *queue) {
 
     c_queue_clear(queue);
 
-    c_free0(queue, sizeof(struct c_queue));
+    c_allocator_free0(queue->allocator, queue, sizeof(struct c_queue));
 }
 
 size_t
@@ -88,7 +100,7 @@ int
 c_queue_push(struct c_queue *queue, void *value) {
     struct c_queue_entry *entry;
 
-    entry = c_queue_entry_new(value);
+    entry = c_queue_entry_new(queue->allocator, value);
     if (!entry)
         return -1;
 
@@ -136,7 +148,12 @@ c_queue_entry_delete(struct c_queue_entry *entry) {
     if (!entry)
         return;
 
-    c_free0(entry, sizeof(struct c_queue_entry));
+    c_allocator_free(entry->allocator, entry, sizeof(struct c_queue_entry));
+}
+
+size_t
+c_queue_entry_size(void) {
+    return sizeof(struct c_queue_entry);
 }
 
 struct c_queue_entry *
@@ -173,14 +190,15 @@ c_queue_remove_entry(struct c_queue *queue, struct c_queue_entry *entry) {
 }
 
 static struct c_queue_entry *
-c_queue_entry_new(void *value) {
+c_queue_entry_new(const struct c_allocator *allocator, void *value) {
     struct c_queue_entry *entry;
 
-    entry = c_malloc0(sizeof(struct c_queue_entry));
+    entry = c_allocator_malloc0(allocator, sizeof(struct c_queue_entry));
     if (!entry)
         return NULL;
 
     entry->value = value;
+    entry->allocator = allocator;
 
     return entry;
 }
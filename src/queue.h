@@ -18,6 +18,7 @@
 #define LIBCORE_QUEUE_H
 
 struct c_queue *c_queue_new(void);
+struct c_queue *c_queue_new_with_allocator(const struct c_allocator *);
 void c_queue_delete(struct c_queue *);
 
 size_t c_queue_length(const struct c_queue *);
@@ -32,6 +33,7 @@ struct c_queue_entry *c_queue_first_entry(struct c_queue *);
 struct c_queue_entry *c_queue_last_entry(struct c_queue *);
 
 void c_queue_entry_delete(struct c_queue_entry *);
+size_t c_queue_entry_size(void);
 struct c_queue_entry *c_queue_entry_prev(struct c_queue_entry *);
 struct c_queue_entry *c_queue_entry_next(struct c_queue_entry *);
 void *c_queue_entry_value(const struct c_queue_entry *);
@@ -0,0 +1,717 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "internal.h"
+
+/*
+ * A RCU hash table is a chained hash table whose buckets and entries are
+ * never modified once they can be reached by readers.
+ *
+ * Writers are serialized by a mutex. They insert, replace or remove entries
+ * by building new entries and publishing them with a single atomic pointer
+ * store, so that a concurrent reader always sees either the old or the new
+ * version of a chain. Growing the table builds a new bucket array containing
+ * copies of all entries, and publishes it the same way.
+ *
+ * Readers never lock anything and never write memory shared with other
+ * readers: before accessing the table, a reader stores the current epoch of
+ * the table in its own reader structure, and clears it when it is done.
+ *
+ * Objects which are not reachable anymore (entries, bucket arrays, and
+ * pointers passed to c_rcu_hash_table_defer_free()) are tagged with the
+ * current epoch and added to a garbage list; the epoch is then incremented.
+ * An object tagged with epoch E is freed once no reader is in a read-side
+ * critical section started at an epoch lower or equal to E: all readers which
+ * could have obtained a reference to the object have finished.
+ */
+
+#define C_RCU_HASH_TABLE_MIN_NB_BUCKETS 16
+
+/* Reader structures are allocated with padding so that the epochs of two
+ * readers are never stored in the same cache line. */
+#define C_RCU_HASH_TABLE_READER_SZ      128
+
+struct c_rcu_hash_table_garbage {
+    struct c_rcu_hash_table_garbage *next;
+    uint64_t epoch;
+    void *ptr;
+};
+
+struct c_rcu_hash_table_entry {
+    struct c_rcu_hash_table_garbage garbage; /* must be the first member */
+
+    struct c_rcu_hash_table_entry *next;
+    uint32_t hash;
+
+    void *key;
+    void *value;
+};
+
+struct c_rcu_hash_table_buckets {
+    struct c_rcu_hash_table_garbage garbage; /* must be the first member */
+
+    size_t nb_buckets; /* always a power of two */
+    unsigned int shift;
+
+    struct c_rcu_hash_table_entry *buckets[];
+};
+
+struct c_rcu_hash_table_reader {
+    uint64_t epoch; /* 0 if not in a critical section */
+    unsigned int nesting;
+    struct c_rcu_hash_table *table;
+};
+
+struct c_rcu_hash_table {
+    struct c_rcu_hash_table_buckets *buckets;
+    uint64_t epoch;
+
+    c_hash_func hash_func;
+    c_equal_func equal_func;
+
+    pthread_mutex_t mutex;
+
+    /* Only accessed with the mutex locked */
+    size_t nb_entries;
+    struct c_ptr_vector *readers;
+    struct c_rcu_hash_table_garbage *garbage;
+};
+
+static struct c_rcu_hash_table_buckets *c_rcu_hash_table_buckets_new(size_t);
+static size_t c_rcu_hash_table_bucket_index(
+    const struct c_rcu_hash_table_buckets *, uint32_t);
+
+static struct c_rcu_hash_table_entry *
+c_rcu_hash_table_entry_new(uint32_t, void *, void *);
+
+static struct c_rcu_hash_table_entry **
+c_rcu_hash_table_find(struct c_rcu_hash_table *, const void *, uint32_t);
+static void c_rcu_hash_table_grow(struct c_rcu_hash_table *);
+
+static void c_rcu_hash_table_retire(struct c_rcu_hash_table *,
+                                    struct c_rcu_hash_table_garbage *);
+static void c_rcu_hash_table_collect(struct c_rcu_hash_table *);
+static void c_rcu_hash_table_free_garbage(struct c_rcu_hash_table *,
+                                          uint64_t);
+
+static void c_rcu_hash_table_lock(struct c_rcu_hash_table *);
+static void c_rcu_hash_table_unlock(struct c_rcu_hash_table *);
+
+struct c_rcu_hash_table *
+c_rcu_hash_table_new(c_hash_func hash_func, c_equal_func equal_func) {
+    struct c_rcu_hash_table *table;
+    int ret;
+
+    table = c_malloc(sizeof(struct c_rcu_hash_table));
+    if (!table)
+        return NULL;
+
+    memset(table, 0, sizeof(struct c_rcu_hash_table));
+
+    table->hash_func = hash_func;
+    table->equal_func = equal_func;
+
+    table->epoch = 1;
+
+    table->buckets = c_rcu_hash_table_buckets_new(C_RCU_HASH_TABLE_MIN_NB_BUCKETS);
+    if (!table->buckets)
+        goto error;
+
+    table->readers = c_ptr_vector_new();
+    if (!table->readers)
+        goto error;
+
+    ret = pthread_mutex_init(&table->mutex, NULL);
+    if (ret != 0) {
+        c_set_error("cannot initialize mutex: %s", strerror(ret));
+        goto error;
+    }
+
+    return table;
+
+error:
+    c_ptr_vector_delete(table->readers);
+    c_free(table->buckets);
+    c_free(table);
+    return NULL;
+}
+
+void
+c_rcu_hash_table_delete(struct c_rcu_hash_table *table) {
+    struct c_rcu_hash_table_buckets *buckets;
+
+    if (!table)
+        return;
+
+    for (size_t i = 0; i < c_ptr_vector_length(table->readers); i++) {
+        struct c_rcu_hash_table_reader *reader;
+
+        reader = c_ptr_vector_entry(table->readers, i);
+        assert(reader->epoch == 0);
+
+        c_free(reader);
+    }
+
+    c_ptr_vector_delete(table->readers);
+
+    c_rcu_hash_table_free_garbage(table, UINT64_MAX);
+
+    buckets = table->buckets;
+
+    for (size_t i = 0; i < buckets->nb_buckets; i++) {
+        struct c_rcu_hash_table_entry *entry;
+
+        entry = buckets->buckets[i];
+        while (entry) {
+            struct c_rcu_hash_table_entry *next;
+
+            next = entry->next;
+            c_free(entry);
+            entry = next;
+        }
+    }
+
+    c_free(buckets);
+
+    pthread_mutex_destroy(&table->mutex);
+
+    memset(table, 0, sizeof(struct c_rcu_hash_table));
+    c_free(table);
+}
+
+size_t
+c_rcu_hash_table_nb_entries(const struct c_rcu_hash_table *table) {
+    return __atomic_load_n(&table->nb_entries, __ATOMIC_RELAXED);
+}
+
+bool
+c_rcu_hash_table_is_empty(const struct c_rcu_hash_table *table) {
+    return c_rcu_hash_table_nb_entries(table) == 0;
+}
+
+struct c_rcu_hash_table_reader *
+c_rcu_hash_table_register_reader(struct c_rcu_hash_table *table) {
+    struct c_rcu_hash_table_reader *reader;
+    int ret;
+
+    reader = c_malloc(C_RCU_HASH_TABLE_READER_SZ);
+    if (!reader)
+        return NULL;
+
+    memset(reader, 0, C_RCU_HASH_TABLE_READER_SZ);
+    reader->table = table;
+
+    c_rcu_hash_table_lock(table);
+    ret = c_ptr_vector_append(table->readers, reader);
+    c_rcu_hash_table_unlock(table);
+
+    if (ret == -1) {
+        c_free(reader);
+        return NULL;
+    }
+
+    return reader;
+}
+
+void
+c_rcu_hash_table_unregister_reader(struct c_rcu_hash_table_reader *reader) {
+    struct c_rcu_hash_table *table;
+
+    if (!reader)
+        return;
+
+    assert(reader->nesting == 0);
+
+    table = reader->table;
+
+    c_rcu_hash_table_lock(table);
+
+    for (size_t i = 0; i < c_ptr_vector_length(table->readers); i++) {
+        if (c_ptr_vector_entry(table->readers, i) == reader) {
+            c_ptr_vector_remove(table->readers, i);
+            break;
+        }
+    }
+
+    c_rcu_hash_table_unlock(table);
+
+    c_free(reader);
+}
+
+void
+c_rcu_hash_table_read_lock(struct c_rcu_hash_table_reader *reader) {
+    uint64_t epoch;
+
+    if (reader->nesting++ > 0)
+        return;
+
+    epoch = __atomic_load_n(&reader->table->epoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&reader->epoch, epoch, __ATOMIC_RELAXED);
+
+    /* The epoch must be visible to writers before we read any pointer in
+     * the table: a writer which does not see it must be sure that we will
+     * see its modifications. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void
+c_rcu_hash_table_read_unlock(struct c_rcu_hash_table_reader *reader) {
+    assert(reader->nesting > 0);
+
+    if (--reader->nesting > 0)
+        return;
+
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+int
+c_rcu_hash_table_get(struct c_rcu_hash_table_reader *reader, const void *key,
+                     void **value) {
+    struct c_rcu_hash_table *table;
+    struct c_rcu_hash_table_buckets *buckets;
+    struct c_rcu_hash_table_entry *entry;
+    uint32_t hash;
+    size_t idx;
+    int ret;
+
+    table = reader->table;
+
+    hash = table->hash_func(key);
+
+    c_rcu_hash_table_read_lock(reader);
+
+    buckets = __atomic_load_n(&table->buckets, __ATOMIC_ACQUIRE);
+    idx = c_rcu_hash_table_bucket_index(buckets, hash);
+
+    ret = 0;
+
+    entry = __atomic_load_n(&buckets->buckets[idx], __ATOMIC_ACQUIRE);
+    while (entry) {
+        if (entry->hash == hash && table->equal_func(entry->key, key)) {
+            *value = entry->value;
+            ret = 1;
+            break;
+        }
+
+        entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE);
+    }
+
+    c_rcu_hash_table_read_unlock(reader);
+
+    return ret;
+}
+
+bool
+c_rcu_hash_table_contains(struct c_rcu_hash_table_reader *reader,
+                          const void *key) {
+    void *value;
+
+    return c_rcu_hash_table_get(reader, key, &value) == 1;
+}
+
+int
+c_rcu_hash_table_insert(struct c_rcu_hash_table *table,
+                        void *key, void *value) {
+    return c_rcu_hash_table_insert2(table, key, value, NULL, NULL);
+}
+
+int
+c_rcu_hash_table_insert2(struct c_rcu_hash_table *table, void *key,
+                         void *value, void **old_key, void **old_value) {
+    struct c_rcu_hash_table_entry **pentry, *entry, *new_entry;
+    uint32_t hash;
+
+    hash = table->hash_func(key);
+
+    new_entry = c_rcu_hash_table_entry_new(hash, key, value);
+    if (!new_entry)
+        return -1;
+
+    c_rcu_hash_table_lock(table);
+
+    pentry = c_rcu_hash_table_find(table, key, hash);
+    entry = *pentry;
+
+    if (entry) {
+        /* Readers may be using the current entry: replace it by a new one
+         * with the same successor. */
+        if (old_key)
+            *old_key = entry->key;
+        if (old_value)
+            *old_value = entry->value;
+
+        new_entry->next = entry->next;
+        __atomic_store_n(pentry, new_entry, __ATOMIC_RELEASE);
+
+        c_rcu_hash_table_retire(table, &entry->garbage);
+        c_rcu_hash_table_collect(table);
+
+        c_rcu_hash_table_unlock(table);
+        return 0;
+    }
+
+    /* pentry points to the pointer ending the chain */
+    __atomic_store_n(pentry, new_entry, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->nb_entries, table->nb_entries + 1,
+                     __ATOMIC_RELAXED);
+
+    if (table->nb_entries > table->buckets->nb_buckets)
+        c_rcu_hash_table_grow(table);
+
+    c_rcu_hash_table_collect(table);
+
+    c_rcu_hash_table_unlock(table);
+
+    if (old_key)
+        *old_key = NULL;
+    if (old_value)
+        *old_value = NULL;
+
+    return 1;
+}
+
+int
+c_rcu_hash_table_remove(struct c_rcu_hash_table *table, const void *key) {
+    return c_rcu_hash_table_remove2(table, key, NULL, NULL);
+}
+
+int
+c_rcu_hash_table_remove2(struct c_rcu_hash_table *table, const void *key,
+                         void **old_key, void **old_value) {
+    struct c_rcu_hash_table_entry **pentry, *entry;
+
+    c_rcu_hash_table_lock(table);
+
+    pentry = c_rcu_hash_table_find(table, key, table->hash_func(key));
+    entry = *pentry;
+
+    if (!entry) {
+        c_rcu_hash_table_unlock(table);
+        return 0;
+    }
+
+    if (old_key)
+        *old_key = entry->key;
+    if (old_value)
+        *old_value = entry->value;
+
+    /* The next pointer of the entry is left untouched so that readers
+     * currently on the entry can continue to walk the chain. */
+    __atomic_store_n(pentry, entry->next, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->nb_entries, table->nb_entries - 1,
+                     __ATOMIC_RELAXED);
+
+    c_rcu_hash_table_retire(table, &entry->garbage);
+    c_rcu_hash_table_collect(table);
+
+    c_rcu_hash_table_unlock(table);
+    return 1;
+}
+
+void
+c_rcu_hash_table_clear(struct c_rcu_hash_table *table) {
+    struct c_rcu_hash_table_buckets *buckets;
+
+    c_rcu_hash_table_lock(table);
+
+    buckets = table->buckets;
+
+    for (size_t i = 0; i < buckets->nb_buckets; i++) {
+        struct c_rcu_hash_table_entry *entry;
+
+        entry = buckets->buckets[i];
+        __atomic_store_n(&buckets->buckets[i], NULL, __ATOMIC_RELEASE);
+
+        for (; entry; entry = entry->next)
+            c_rcu_hash_table_retire(table, &entry->garbage);
+    }
+
+    __atomic_store_n(&table->nb_entries, 0, __ATOMIC_RELAXED);
+
+    c_rcu_hash_table_collect(table);
+
+    c_rcu_hash_table_unlock(table);
+}
+
+int
+c_rcu_hash_table_defer_free(struct c_rcu_hash_table *table, void *ptr) {
+    struct c_rcu_hash_table_garbage *garbage;
+
+    if (!ptr)
+        return 0;
+
+    garbage = c_malloc(sizeof(struct c_rcu_hash_table_garbage));
+    if (!garbage)
+        return -1;
+
+    garbage->ptr = ptr;
+
+    c_rcu_hash_table_lock(table);
+    c_rcu_hash_table_retire(table, garbage);
+    c_rcu_hash_table_collect(table);
+    c_rcu_hash_table_unlock(table);
+
+    return 0;
+}
+
+void
+c_rcu_hash_table_synchronize(struct c_rcu_hash_table *table) {
+    uint64_t epoch;
+
+    c_rcu_hash_table_lock(table);
+
+    epoch = __atomic_fetch_add(&table->epoch, 1, __ATOMIC_SEQ_CST);
+
+    /* Wait for all readers which may have entered their critical section
+     * before the epoch was incremented. */
+    for (size_t i = 0; i < c_ptr_vector_length(table->readers); i++) {
+        struct c_rcu_hash_table_reader *reader;
+
+        reader = c_ptr_vector_entry(table->readers, i);
+
+        for (;;) {
+            uint64_t reader_epoch;
+
+            reader_epoch = __atomic_load_n(&reader->epoch,
+                                           __ATOMIC_SEQ_CST);
+            if (reader_epoch == 0 || reader_epoch > epoch)
+                break;
+
+            sched_yield();
+        }
+    }
+
+    c_rcu_hash_table_free_garbage(table, epoch + 1);
+
+    c_rcu_hash_table_unlock(table);
+}
+
+static struct c_rcu_hash_table_buckets *
+c_rcu_hash_table_buckets_new(size_t nb_buckets) {
+    struct c_rcu_hash_table_buckets *buckets;
+    unsigned int nb_bits;
+    size_t sz;
+
+    nb_bits = 0;
+    while (((size_t)1 << nb_bits) < nb_buckets)
+        nb_bits++;
+
+    sz = sizeof(struct c_rcu_hash_table_buckets)
+       + nb_buckets * sizeof(struct c_rcu_hash_table_entry *);
+
+    buckets = c_malloc(sz);
+    if (!buckets)
+        return NULL;
+
+    memset(buckets, 0, sz);
+
+    buckets->garbage.ptr = buckets;
+    buckets->nb_buckets = nb_buckets;
+    buckets->shift = 32 - nb_bits;
+
+    return buckets;
+}
+
+static size_t
+c_rcu_hash_table_bucket_index(const struct c_rcu_hash_table_buckets *buckets,
+                              uint32_t hash) {
+    /* Fibonacci hashing: use the high bits of the product so that weak hash
+     * functions do not end up in a few buckets. */
+    return (uint32_t)(hash * UINT32_C(0x9e3779b9)) >> buckets->shift;
+}
+
+static struct c_rcu_hash_table_entry *
+c_rcu_hash_table_entry_new(uint32_t hash, void *key, void *value) {
+    struct c_rcu_hash_table_entry *entry;
+
+    entry = c_malloc(sizeof(struct c_rcu_hash_table_entry));
+    if (!entry)
+        return NULL;
+
+    memset(entry, 0, sizeof(struct c_rcu_hash_table_entry));
+
+    entry->garbage.ptr = entry;
+    entry->hash = hash;
+    entry->key = key;
+    entry->value = value;
+
+    return entry;
+}
+
+static struct c_rcu_hash_table_entry **
+c_rcu_hash_table_find(struct c_rcu_hash_table *table, const void *key,
+                      uint32_t hash) {
+    struct c_rcu_hash_table_buckets *buckets;
+    struct c_rcu_hash_table_entry **pentry;
+
+    /* Return a pointer to the pointer referencing the entry, or to the
+     * pointer ending the chain if there is no entry for this key. */
+    buckets = table->buckets;
+    pentry = &buckets->buckets[c_rcu_hash_table_bucket_index(buckets, hash)];
+
+    while (*pentry) {
+        struct c_rcu_hash_table_entry *entry;
+
+        entry = *pentry;
+        if (entry->hash == hash && table->equal_func(entry->key, key))
+            break;
+
+        pentry = &entry->next;
+    }
+
+    return pentry;
+}
+
+static void
+c_rcu_hash_table_grow(struct c_rcu_hash_table *table) {
+    struct c_rcu_hash_table_buckets *buckets, *old_buckets;
+
+    old_buckets = table->buckets;
+
+    /* Entries of the current bucket array may be in use by readers, so we
+     * cannot relink them: the new bucket array contains copies. Failing to
+     * grow is harmless, chains are just longer. */
+    buckets = c_rcu_hash_table_buckets_new(old_buckets->nb_buckets * 2);
+    if (!buckets)
+        return;
+
+    for (size_t i = 0; i < old_buckets->nb_buckets; i++) {
+        struct c_rcu_hash_table_entry *entry;
+
+        for (entry = old_buckets->buckets[i]; entry; entry = entry->next) {
+            struct c_rcu_hash_table_entry *copy;
+            size_t idx;
+
+            copy = c_rcu_hash_table_entry_new(entry->hash,
+                                              entry->key, entry->value);
+            if (!copy)
+                goto error;
+
+            idx = c_rcu_hash_table_bucket_index(buckets, entry->hash);
+
+            copy->next = buckets->buckets[idx];
+            buckets->buckets[idx] = copy;
+        }
+    }
+
+    __atomic_store_n(&table->buckets, buckets, __ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < old_buckets->nb_buckets; i++) {
+        struct c_rcu_hash_table_entry *entry;
+
+        for (entry = old_buckets->buckets[i]; entry; entry = entry->next)
+            c_rcu_hash_table_retire(table, &entry->garbage);
+    }
+
+    c_rcu_hash_table_retire(table, &old_buckets->garbage);
+    return;
+
+error:
+    for (size_t i = 0; i < buckets->nb_buckets; i++) {
+        struct c_rcu_hash_table_entry *entry;
+
+        entry = buckets->buckets[i];
+        while (entry) {
+            struct c_rcu_hash_table_entry *next;
+
+            next = entry->next;
+            c_free(entry);
+            entry = next;
+        }
+    }
+
+    c_free(buckets);
+}
+
+static void
+c_rcu_hash_table_retire(struct c_rcu_hash_table *table,
+                        struct c_rcu_hash_table_garbage *garbage) {
+    garbage->epoch = table->epoch;
+
+    garbage->next = table->garbage;
+    table->garbage = garbage;
+}
+
+static void
+c_rcu_hash_table_collect(struct c_rcu_hash_table *table) {
+    uint64_t min_epoch;
+
+    if (!table->garbage)
+        return;
+
+    /* Objects retired before this point are not reachable by readers
+     * entering their critical section after the increment. */
+    min_epoch = __atomic_add_fetch(&table->epoch, 1, __ATOMIC_SEQ_CST);
+
+    for (size_t i = 0; i < c_ptr_vector_length(table->readers); i++) {
+        struct c_rcu_hash_table_reader *reader;
+        uint64_t epoch;
+
+        reader = c_ptr_vector_entry(table->readers, i);
+
+        epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < min_epoch)
+            min_epoch = epoch;
+    }
+
+    c_rcu_hash_table_free_garbage(table, min_epoch);
+}
+
+static void
+c_rcu_hash_table_free_garbage(struct c_rcu_hash_table *table,
+                              uint64_t min_epoch) {
+    struct c_rcu_hash_table_garbage **pgarbage;
+
+    /* Free all objects retired before min_epoch */
+    pgarbage = &table->garbage;
+
+    while (*pgarbage) {
+        struct c_rcu_hash_table_garbage *garbage;
+
+        garbage = *pgarbage;
+
+        if (garbage->epoch >= min_epoch) {
+            pgarbage = &garbage->next;
+            continue;
+        }
+
+        *pgarbage = garbage->next;
+
+        if (garbage->ptr != garbage)
+            c_free(garbage->ptr);
+        c_free(garbage);
+    }
+}
+
+/* Locking operations can only fail on programming errors, for example when
+ * a thread tries to lock a mutex it already owns. */
+static void
+c_rcu_hash_table_lock(struct c_rcu_hash_table *table) {
+    if (pthread_mutex_lock(&table->mutex) != 0)
+        abort();
+}
+
+static void
+c_rcu_hash_table_unlock(struct c_rcu_hash_table *table) {
+    if (pthread_mutex_unlock(&table->mutex) != 0)
+        abort();
+}
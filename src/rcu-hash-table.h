@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_RCU_HASH_TABLE_H
+#define LIBCORE_RCU_HASH_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct c_rcu_hash_table *c_rcu_hash_table_new(c_hash_func, c_equal_func);
+void c_rcu_hash_table_delete(struct c_rcu_hash_table *);
+size_t c_rcu_hash_table_nb_entries(const struct c_rcu_hash_table *);
+bool c_rcu_hash_table_is_empty(const struct c_rcu_hash_table *);
+
+struct c_rcu_hash_table_reader *
+c_rcu_hash_table_register_reader(struct c_rcu_hash_table *);
+void c_rcu_hash_table_unregister_reader(struct c_rcu_hash_table_reader *);
+
+void c_rcu_hash_table_read_lock(struct c_rcu_hash_table_reader *);
+void c_rcu_hash_table_read_unlock(struct c_rcu_hash_table_reader *);
+
+int c_rcu_hash_table_get(struct c_rcu_hash_table_reader *, const void *,
+                         void **);
+bool c_rcu_hash_table_contains(struct c_rcu_hash_table_reader *,
+                               const void *);
+
+int c_rcu_hash_table_insert(struct c_rcu_hash_table *, void *, void *);
+int c_rcu_hash_table_insert2(struct c_rcu_hash_table *, void *, void *,
+                             void **, void **);
+int c_rcu_hash_table_remove(struct c_rcu_hash_table *, const void *);
+int c_rcu_hash_table_remove2(struct c_rcu_hash_table *, const void *,
+                             void **, void **);
+void c_rcu_hash_table_clear(struct c_rcu_hash_table *);
+
+int c_rcu_hash_table_defer_free(struct c_rcu_hash_table *, void *);
+void c_rcu_hash_table_synchronize(struct c_rcu_hash_table *);
+
+#endif
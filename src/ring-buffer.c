@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifdef C_PLATFORM_LINUX
+/* memfd_create() and MAP_ANONYMOUS */
+#  define _GNU_SOURCE
+#endif
+
+#include <sys/mman.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*
+ * The memory of a ring buffer is mapped twice in a row, so that the content
+ * of the buffer and its free space are always contiguous in memory, even
+ * when they wrap around the end of the buffer. For example, with content
+ * "abcdef" starting near the end of the buffer:
+ *
+ *                       start          start + len
+ *                         |                 |
+ *   +-----+-------------+-----+-----+-------------+-----+
+ *   | def |             | abc | def |             | abc |
+ *   +-----+-------------+-----+-----+-------------+-----+
+ *   <----------- sz ----------><----------- sz ----------->
+ *
+ * start is always lower than sz.
+ */
+
+struct c_ring_buffer {
+    char *data;
+    size_t sz;
+
+    size_t start;
+    size_t len;
+};
+
+static int c_ring_buffer_create_fd(size_t);
+
+struct c_ring_buffer *
+c_ring_buffer_new(size_t sz) {
+    struct c_ring_buffer *buf;
+    size_t page_sz;
+    char *data, *ptr;
+    int fd;
+
+    if (sz == 0)
+        sz = C_RING_BUFFER_DEFAULT_SIZE;
+
+    page_sz = (size_t)sysconf(_SC_PAGESIZE);
+    if (sz > SIZE_MAX / 2 - page_sz) {
+        c_set_error("ring buffer size too large");
+        return NULL;
+    }
+
+    sz = (sz + page_sz - 1) / page_sz * page_sz;
+
+    fd = c_ring_buffer_create_fd(sz);
+    if (fd == -1)
+        return NULL;
+
+    /* Reserve a contiguous address range, then map the file twice on top
+     * of it. */
+    data = mmap(NULL, sz * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        c_set_error("cannot reserve memory: %s", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        ptr = mmap(data + (size_t)i * sz, sz, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED, fd, 0);
+        if (ptr == MAP_FAILED) {
+            c_set_error("cannot map memory: %s", strerror(errno));
+            munmap(data, sz * 2);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    close(fd);
+
+    buf = c_malloc0(sizeof(struct c_ring_buffer));
+    if (!buf) {
+        munmap(data, sz * 2);
+        return NULL;
+    }
+
+    buf->data = data;
+    buf->sz = sz;
+
+    return buf;
+}
+
+void
+c_ring_buffer_delete(struct c_ring_buffer *buf) {
+    if (!buf)
+        return;
+
+    munmap(buf->data, buf->sz * 2);
+
+    c_free0(buf, sizeof(struct c_ring_buffer));
+}
+
+void *
+c_ring_buffer_data(const struct c_ring_buffer *buf) {
+    return buf->data + buf->start;
+}
+
+size_t
+c_ring_buffer_length(const struct c_ring_buffer *buf) {
+    return buf->len;
+}
+
+size_t
+c_ring_buffer_size(const struct c_ring_buffer *buf) {
+    return buf->sz;
+}
+
+size_t
+c_ring_buffer_free_space(const struct c_ring_buffer *buf) {
+    return buf->sz - buf->len;
+}
+
+void
+c_ring_buffer_clear(struct c_ring_buffer *buf) {
+    buf->start = 0;
+    buf->len = 0;
+}
+
+void *
+c_ring_buffer_reserve(struct c_ring_buffer *buf, size_t sz) {
+    if (sz > buf->sz - buf->len) {
+        c_set_error("not enough space in ring buffer");
+        return NULL;
+    }
+
+    return buf->data + buf->start + buf->len;
+}
+
+int
+c_ring_buffer_increase_length(struct c_ring_buffer *buf, size_t n) {
+    if (n > buf->sz - buf->len) {
+        c_set_error("length increment too large");
+        return -1;
+    }
+
+    buf->len += n;
+    return 0;
+}
+
+int
+c_ring_buffer_add(struct c_ring_buffer *buf, const void *data, size_t sz) {
+    char *ptr;
+
+    ptr = c_ring_buffer_reserve(buf, sz);
+    if (!ptr)
+        return -1;
+
+    memcpy(ptr, data, sz);
+    buf->len += sz;
+
+    return 0;
+}
+
+int
+c_ring_buffer_add_string(struct c_ring_buffer *buf, const char *str) {
+    return c_ring_buffer_add(buf, str, strlen(str));
+}
+
+void
+c_ring_buffer_skip(struct c_ring_buffer *buf, size_t n) {
+    if (n > buf->len)
+        n = buf->len;
+
+    buf->len -= n;
+    buf->start += n;
+
+    if (buf->start >= buf->sz)
+        buf->start -= buf->sz;
+
+    if (buf->len == 0)
+        buf->start = 0;
+}
+
+ssize_t
+c_ring_buffer_read(struct c_ring_buffer *buf, int fd, size_t n) {
+    ssize_t ret;
+    char *ptr;
+
+    if (n > buf->sz - buf->len)
+        n = buf->sz - buf->len;
+
+    if (n == 0) {
+        c_set_error("ring buffer full");
+        return -1;
+    }
+
+    ptr = buf->data + buf->start + buf->len;
+
+    ret = read(fd, ptr, n);
+    if (ret == -1) {
+        c_set_error("%s", strerror(errno));
+        return -1;
+    }
+
+    buf->len += (size_t)ret;
+    return ret;
+}
+
+ssize_t
+c_ring_buffer_write(struct c_ring_buffer *buf, int fd) {
+    ssize_t ret;
+
+    ret = write(fd, buf->data + buf->start, buf->len);
+    if (ret == -1) {
+        c_set_error("%s", strerror(errno));
+        return -1;
+    }
+
+    c_ring_buffer_skip(buf, (size_t)ret);
+    return ret;
+}
+
+static int
+c_ring_buffer_create_fd(size_t sz) {
+    int fd;
+
+#ifdef C_PLATFORM_LINUX
+    fd = memfd_create("libcore-ring-buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+        c_set_error("cannot create memory file: %s", strerror(errno));
+        return -1;
+    }
+#else
+    static unsigned int counter;
+    char name[64];
+
+    snprintf(name, sizeof(name), "/libcore-ring-buffer-%ld-%u",
+             (long)getpid(), __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        c_set_error("cannot create shared memory object: %s",
+                    strerror(errno));
+        return -1;
+    }
+
+    shm_unlink(name);
+#endif
+
+    if (ftruncate(fd, (off_t)sz) == -1) {
+        c_set_error("cannot resize memory file: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
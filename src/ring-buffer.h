@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_RING_BUFFER_H
+#define LIBCORE_RING_BUFFER_H
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+
+#define C_RING_BUFFER_DEFAULT_SIZE 65536
+
+struct c_ring_buffer *c_ring_buffer_new(size_t);
+void c_ring_buffer_delete(struct c_ring_buffer *);
+
+void *c_ring_buffer_data(const struct c_ring_buffer *);
+size_t c_ring_buffer_length(const struct c_ring_buffer *);
+size_t c_ring_buffer_size(const struct c_ring_buffer *);
+size_t c_ring_buffer_free_space(const struct c_ring_buffer *);
+
+void c_ring_buffer_clear(struct c_ring_buffer *);
+
+void *c_ring_buffer_reserve(struct c_ring_buffer *, size_t);
+int c_ring_buffer_increase_length(struct c_ring_buffer *, size_t);
+int c_ring_buffer_add(struct c_ring_buffer *, const void *, size_t);
+int c_ring_buffer_add_string(struct c_ring_buffer *, const char *);
+
+void c_ring_buffer_skip(struct c_ring_buffer *, size_t);
+
+ssize_t c_ring_buffer_read(struct c_ring_buffer *, int, size_t);
+ssize_t c_ring_buffer_write(struct c_ring_buffer *, int);
+
+#endif
@@ -21,28 +21,40 @@
 struct c_stack_entry {
     void *value;
 
+    const struct c_allocator *allocator;
+
     struct c_stack_entry *prev; /* upward */
     struct c_stack_entry *next; /* downward */
 };
 
-static struct c_stack_entry *c_stack_entry_new(void *);
+static struct c_stack_entry *c_stack_entry_new(const struct c_allocator *,
+                                               void *);
 
 struct c_stack {
     struct c_stack_entry *top;
     struct c_stack_entry *bottom;
     size_t length;
+
+    const struct c_allocator *allocator;
 };
 
 static void c_stack_add_entry(struct c_stack *, struct c_stack_entry *);
 
 struct c_stack *
 c_stack_new(void) {
+    return c_stack_new_with_allocator(NULL);
+}
+
+struct c_stack *
+c_stack_new_with_allocator(const struct c_allocator *allocator) {
     struct c_stack *stack;
 
-    stack = c_malloc0(sizeof(struct c_stack));
+    stack = c_allocator_malloc0(allocator, sizeof(struct c_stack));
     if (!stack)
         return NULL;
 
+    stack->allocator = allocator;
+
     return stack;
 }
 
@@ -53,7 +65,7 @@ c_stack_delete(struct c_stack *stack) {
 
     c_stack_clear(stack);
 
-    c_free0(stack, sizeof(struct c_stack));
+    c_allocator_free0(stack->allocator, stack, sizeof(struct c_stack));
 }
 
 size_t
@@ -88,7 +100,7 @@ int
 c_stack_push(struct c_stack *stack, void *value) {
     struct c_stack_entry *entry;
 
-    entry = c_stack_entry_new(value);
+    entry = c_stack_entry_new(stack->allocator, value);
     if (!entry)
         return -1;
 
@@ -136,7 +148,12 @@ c_stack_entry_delete(struct c_stack_entry *entry) {
     if (!entry)
         return;
 
-    c_free0(entry, sizeof(struct c_stack_entry));
+    c_allocator_free(entry->allocator, entry, sizeof(struct c_stack_entry));
+}
+
+size_t
+c_stack_entry_size(void) {
+    return sizeof(struct c_stack_entry);
 }
 
 struct c_stack_entry *
@@ -173,14 +190,15 @@ c_stack_remove_entry(struct c_stack *stack, struct c_stack_entry *entry) {
 }
 
 static struct c_stack_entry *
-c_stack_entry_new(void *value) {
+c_stack_entry_new(const struct c_allocator *allocator, void *value) {
     struct c_stack_entry *entry;
 
-    entry = c_malloc0(sizeof(struct c_stack_entry));
+    entry = c_allocator_malloc0(allocator, sizeof(struct c_stack_entry));
     if (!entry)
         return NULL;
 
     entry->value = value;
+    entry->allocator = allocator;
 
     return entry;
 }
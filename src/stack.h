@@ -18,6 +18,7 @@
 #define LIBCORE_STACK_H
 
 struct c_stack *c_stack_new(void);
+struct c_stack *c_stack_new_with_allocator(const struct c_allocator *);
 void c_stack_delete(struct c_stack *);
 
 size_t c_stack_length(const struct c_stack *);
@@ -32,6 +33,7 @@ struct c_stack_entry *c_stack_top_entry(struct c_stack *);
 struct c_stack_entry *c_stack_bottom_entry(struct c_stack *);
 
 void c_stack_entry_delete(struct c_stack_entry *);
+size_t c_stack_entry_size(void);
 struct c_stack_entry *c_stack_entry_prev(struct c_stack_entry *);
 struct c_stack_entry *c_stack_entry_next(struct c_stack_entry *);
 void *c_stack_entry_value(const struct c_stack_entry *);
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+
+#include "internal.h"
+
+/*
+ * Interned strings are stored in an arena, each string being preceded by a
+ * header. The header contains the hash of the string, so that
+ * neither lookups nor resizes of the hash table have to hash stored strings
+ * again.
+ *
+ *   +--------+------+-----+--------+--------+--------+-----+-- ... --+
+ *   | header | "abc\0"    | header | "foobar\0"      | ... |         |
+ *   +--------+------+-----+--------+--------+--------+-----+-- ... --+
+ *
+ * The hash table uses pointers to headers both as keys and values. Lookups use
+ * a header allocated on the stack whose string pointer references the string
+ * of the caller.
+ */
+
+struct c_string_pool_string {
+    const char *str;
+    size_t length;
+    uint32_t hash;
+    uint32_t id;
+};
+
+struct c_string_pool {
+    struct c_hash_table *table;
+    struct c_ptr_vector *strings; /* indexed by id */
+
+    struct c_arena *arena;
+
+    size_t strings_size;
+};
+
+static const char *c_string_pool_intern_string(
+    struct c_string_pool *, const struct c_string_pool_string *);
+static struct c_string_pool_string *c_string_pool_find(
+    struct c_string_pool *, const void *, size_t,
+    struct c_string_pool_string *);
+static uint32_t c_string_pool_hash_string(const void *);
+static bool c_string_pool_equal_string(const void *, const void *);
+
+struct c_string_pool *
+c_string_pool_new(void) {
+    struct c_string_pool *pool;
+
+    pool = c_malloc0(sizeof(struct c_string_pool));
+    if (!pool) {
+        c_set_error("cannot allocate string pool: %m");
+        return NULL;
+    }
+
+    pool->arena = c_arena_new(0);
+    if (!pool->arena)
+        goto error;
+
+    pool->table = c_hash_table_new(c_string_pool_hash_string,
+                                   c_string_pool_equal_string);
+    if (!pool->table)
+        goto error;
+
+    pool->strings = c_ptr_vector_new();
+    if (!pool->strings)
+        goto error;
+
+    return pool;
+
+error:
+    c_string_pool_delete(pool);
+    return NULL;
+}
+
+void
+c_string_pool_delete(struct c_string_pool *pool) {
+    if (!pool)
+        return;
+
+    c_ptr_vector_delete(pool->strings);
+    c_hash_table_delete(pool->table);
+    c_arena_delete(pool->arena);
+
+    c_free0(pool, sizeof(struct c_string_pool));
+}
+
+size_t
+c_string_pool_nb_strings(const struct c_string_pool *pool) {
+    return c_ptr_vector_length(pool->strings);
+}
+
+void
+c_string_pool_clear(struct c_string_pool *pool) {
+    c_hash_table_clear(pool->table);
+    c_ptr_vector_clear(pool->strings);
+
+    c_arena_reset(pool->arena);
+
+    pool->strings_size = 0;
+}
+
+const char *
+c_string_pool_intern(struct c_string_pool *pool, const char *str) {
+    return c_string_pool_intern_memory(pool, str, strlen(str));
+}
+
+const char *
+c_string_pool_intern_memory(struct c_string_pool *pool,
+                            const void *data, size_t length) {
+    struct c_string_pool_string *string, key;
+
+    string = c_string_pool_find(pool, data, length, &key);
+    if (string)
+        return string->str;
+
+    return c_string_pool_intern_string(pool, &key);
+}
+
+const char *
+c_string_pool_lookup(struct c_string_pool *pool, const char *str) {
+    return c_string_pool_lookup_memory(pool, str, strlen(str));
+}
+
+const char *
+c_string_pool_lookup_memory(struct c_string_pool *pool,
+                            const void *data, size_t length) {
+    struct c_string_pool_string *string, key;
+
+    string = c_string_pool_find(pool, data, length, &key);
+    if (!string)
+        return NULL;
+
+    return string->str;
+}
+
+uint32_t
+c_string_pool_id(const char *str) {
+    const struct c_string_pool_string *string;
+
+    string = (const struct c_string_pool_string *)str - 1;
+    return string->id;
+}
+
+size_t
+c_string_pool_length(const char *str) {
+    const struct c_string_pool_string *string;
+
+    string = (const struct c_string_pool_string *)str - 1;
+    return string->length;
+}
+
+const char *
+c_string_pool_string(const struct c_string_pool *pool, uint32_t id) {
+    if (id >= c_ptr_vector_length(pool->strings))
+        return NULL;
+
+    return c_ptr_vector_entry(pool->strings, id);
+}
+
+void
+c_string_pool_stats(const struct c_string_pool *pool,
+                    struct c_string_pool_stats *stats) {
+    struct c_arena_stats arena_stats;
+    struct c_hash_table_stats table_stats;
+    size_t nb_strings;
+
+    memset(stats, 0, sizeof(struct c_string_pool_stats));
+
+    nb_strings = c_ptr_vector_length(pool->strings);
+
+    stats->nb_strings = nb_strings;
+    stats->strings_size = pool->strings_size;
+
+    c_arena_stats(pool->arena, &arena_stats);
+    stats->nb_blocks = arena_stats.nb_chunks;
+
+    c_hash_table_stats(pool->table, &table_stats);
+
+    stats->memory_size = sizeof(struct c_string_pool)
+                       + arena_stats.memory_size
+                       + table_stats.memory_size
+                       + nb_strings * sizeof(void *);
+}
+
+static const char *
+c_string_pool_intern_string(struct c_string_pool *pool,
+                            const struct c_string_pool_string *key) {
+    struct c_string_pool_string *string;
+    size_t nb_strings;
+    char *str;
+
+    nb_strings = c_ptr_vector_length(pool->strings);
+    if (nb_strings > UINT32_MAX) {
+        c_set_error("too many strings");
+        return NULL;
+    }
+
+    /* The string immediately follows its header */
+    string = c_arena_alloc(pool->arena, sizeof(struct c_string_pool_string)
+                                        + key->length + 1);
+    if (!string)
+        return NULL;
+
+    str = (char *)(string + 1);
+    memcpy(str, key->str, key->length);
+    str[key->length] = '\0';
+
+    string->str = str;
+    string->length = key->length;
+    string->hash = key->hash;
+    string->id = (uint32_t)nb_strings;
+
+    if (c_ptr_vector_append(pool->strings, str) == -1)
+        return NULL;
+
+    if (c_hash_table_insert(pool->table, string, string) == -1) {
+        c_ptr_vector_remove(pool->strings, nb_strings);
+        return NULL;
+    }
+
+    pool->strings_size += key->length + 1;
+
+    return str;
+}
+
+static struct c_string_pool_string *
+c_string_pool_find(struct c_string_pool *pool, const void *data,
+                   size_t length, struct c_string_pool_string *key) {
+    void *string;
+
+    key->str = data;
+    key->length = length;
+    key->hash = c_hash_memory(data, length);
+    key->id = 0;
+
+    if (c_hash_table_get(pool->table, key, &string) == 0)
+        return NULL;
+
+    return string;
+}
+
+static uint32_t
+c_string_pool_hash_string(const void *ptr) {
+    const struct c_string_pool_string *string;
+
+    string = ptr;
+    return string->hash;
+}
+
+static bool
+c_string_pool_equal_string(const void *ptr1, const void *ptr2) {
+    const struct c_string_pool_string *string1, *string2;
+
+    string1 = ptr1;
+    string2 = ptr2;
+
+    return string1->hash == string2->hash
+        && string1->length == string2->length
+        && memcmp(string1->str, string2->str, string1->length) == 0;
+}
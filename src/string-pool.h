@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef LIBCORE_STRING_POOL_H
+#define LIBCORE_STRING_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct c_string_pool_stats {
+    size_t nb_strings;
+    size_t strings_size; /* including the final null characters */
+
+    size_t nb_blocks;
+    size_t memory_size;
+};
+
+struct c_string_pool *c_string_pool_new(void);
+void c_string_pool_delete(struct c_string_pool *);
+size_t c_string_pool_nb_strings(const struct c_string_pool *);
+void c_string_pool_clear(struct c_string_pool *);
+
+const char *c_string_pool_intern(struct c_string_pool *, const char *);
+const char *c_string_pool_intern_memory(struct c_string_pool *,
+                                        const void *, size_t);
+const char *c_string_pool_lookup(struct c_string_pool *, const char *);
+const char *c_string_pool_lookup_memory(struct c_string_pool *,
+                                        const void *, size_t);
+
+uint32_t c_string_pool_id(const char *);
+size_t c_string_pool_length(const char *);
+const char *c_string_pool_string(const struct c_string_pool *, uint32_t);
+
+void c_string_pool_stats(const struct c_string_pool *,
+                         struct c_string_pool_stats *);
+
+#endif
@@ -165,7 +165,7 @@ c_memory_search(const void *haystack, size_t haystack_sz,
         return (void *)hptr;
 
     /* Fill the skip table */
-    for (size_t i = 0; i <= 256; i++)
+    for (size_t i = 0; i < 256; i++)
         skip_table[i] = nlen;
 
     for (size_t i = 0; i < nlen - 1; i++)
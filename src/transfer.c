@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifdef C_PLATFORM_LINUX
+/* splice() and copy_file_range() */
+#  define _GNU_SOURCE
+#endif
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#ifdef C_PLATFORM_LINUX
+#  include <sys/sendfile.h>
+#  include <sys/syscall.h>
+#endif
+
+#ifdef C_PLATFORM_FREEBSD
+#  include <sys/uio.h>
+#endif
+
+#include "internal.h"
+
+#define C_TRANSFER_BUFFER_SIZE 16384
+
+/* Zero-copy transfers are tried first; if the kernel does not support them
+ * for the file descriptors involved, the transfer is done by copying data in
+ * user space. Functions return -2 when the operation is not supported. */
+
+static bool c_transfer_copy_file_range_unavailable;
+
+static ssize_t c_transfer_copy_file_range(int, int, off_t *, size_t);
+static ssize_t c_transfer_splice(int, int, off_t *, size_t);
+static ssize_t c_transfer_sendfile(int, int, const struct stat *, off_t *,
+                                   size_t);
+static ssize_t c_transfer_buffered(int, int, const struct stat *, off_t *,
+                                   size_t);
+static bool c_transfer_is_unsupported(int);
+
+ssize_t
+c_transfer(int out_fd, int in_fd, off_t *offset, size_t n) {
+    struct stat in_st, out_st;
+    ssize_t ret;
+
+    if (n == 0)
+        return 0;
+
+    if (fstat(in_fd, &in_st) == -1 || fstat(out_fd, &out_st) == -1) {
+        c_set_error("cannot stat file descriptor: %s", strerror(errno));
+        return -1;
+    }
+
+    if (offset && !S_ISREG(in_st.st_mode)) {
+        errno = ESPIPE;
+        c_set_error("cannot use an offset with a non-regular file");
+        return -1;
+    }
+
+    if (n > SSIZE_MAX)
+        n = SSIZE_MAX;
+
+    ret = -2;
+
+    if (S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode))
+        ret = c_transfer_copy_file_range(out_fd, in_fd, offset, n);
+
+    if (ret == -2 && (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode)))
+        ret = c_transfer_splice(out_fd, in_fd, offset, n);
+
+    if (ret == -2 && S_ISREG(in_st.st_mode))
+        ret = c_transfer_sendfile(out_fd, in_fd, &out_st, offset, n);
+
+    if (ret == -2)
+        ret = c_transfer_buffered(out_fd, in_fd, &in_st, offset, n);
+
+    return ret;
+}
+
+static ssize_t
+c_transfer_copy_file_range(int out_fd, int in_fd, off_t *offset, size_t n) {
+#if defined(C_PLATFORM_LINUX) && defined(SYS_copy_file_range)
+    loff_t loffset;
+    long ret;
+
+    if (__atomic_load_n(&c_transfer_copy_file_range_unavailable,
+                        __ATOMIC_RELAXED)) {
+        return -2;
+    }
+
+    if (offset)
+        loffset = *offset;
+
+    ret = syscall(SYS_copy_file_range, in_fd, offset ? &loffset : NULL,
+                  out_fd, NULL, n, 0U);
+    if (ret == -1) {
+        if (errno == ENOSYS) {
+            __atomic_store_n(&c_transfer_copy_file_range_unavailable, true,
+                             __ATOMIC_RELAXED);
+        }
+
+        /* Both file descriptors are valid since we could stat them;
+         * EBADF is returned when the output file was opened with
+         * O_APPEND, which copy_file_range() does not support. */
+        if (c_transfer_is_unsupported(errno) || errno == EBADF)
+            return -2;
+
+        c_set_error("cannot copy file range: %s", strerror(errno));
+        return -1;
+    }
+
+    if (offset)
+        *offset = (off_t)loffset;
+
+    return (ssize_t)ret;
+#else
+    return -2;
+#endif
+}
+
+static ssize_t
+c_transfer_splice(int out_fd, int in_fd, off_t *offset, size_t n) {
+#ifdef C_PLATFORM_LINUX
+    loff_t loffset;
+    ssize_t ret;
+
+    /* Offsets only apply to the input file, which is never a pipe when an
+     * offset is used. */
+    if (offset)
+        loffset = *offset;
+
+    ret = splice(in_fd, offset ? &loffset : NULL, out_fd, NULL, n,
+                 SPLICE_F_MOVE);
+    if (ret == -1) {
+        if (c_transfer_is_unsupported(errno))
+            return -2;
+
+        c_set_error("cannot splice data: %s", strerror(errno));
+        return -1;
+    }
+
+    if (offset)
+        *offset = (off_t)loffset;
+
+    return ret;
+#else
+    return -2;
+#endif
+}
+
+static ssize_t
+c_transfer_sendfile(int out_fd, int in_fd, const struct stat *out_st,
+                    off_t *offset, size_t n) {
+#if defined(C_PLATFORM_LINUX)
+    ssize_t ret;
+
+    ret = sendfile(out_fd, in_fd, offset, n);
+    if (ret == -1) {
+        if (c_transfer_is_unsupported(errno))
+            return -2;
+
+        c_set_error("cannot send file: %s", strerror(errno));
+        return -1;
+    }
+
+    return ret;
+#elif defined(C_PLATFORM_FREEBSD)
+    off_t start, nb_sent;
+
+    /* FreeBSD only supports sockets as destination, and always uses an
+     * explicit offset. */
+    if (!S_ISSOCK(out_st->st_mode))
+        return -2;
+
+    if (offset) {
+        start = *offset;
+    } else {
+        start = lseek(in_fd, 0, SEEK_CUR);
+        if (start == -1) {
+            c_set_error("cannot get file position: %s", strerror(errno));
+            return -1;
+        }
+    }
+
+    nb_sent = 0;
+
+    if (sendfile(in_fd, out_fd, start, n, NULL, &nb_sent, 0) == -1) {
+        if (c_transfer_is_unsupported(errno))
+            return -2;
+
+        if (errno != EAGAIN || nb_sent == 0) {
+            c_set_error("cannot send file: %s", strerror(errno));
+            return -1;
+        }
+    }
+
+    if (offset) {
+        *offset = start + nb_sent;
+    } else if (lseek(in_fd, start + nb_sent, SEEK_SET) == -1) {
+        c_set_error("cannot set file position: %s", strerror(errno));
+        return -1;
+    }
+
+    return (ssize_t)nb_sent;
+#else
+    return -2;
+#endif
+}
+
+static ssize_t
+c_transfer_buffered(int out_fd, int in_fd, const struct stat *in_st,
+                    off_t *offset, size_t n) {
+    char buf[C_TRANSFER_BUFFER_SIZE];
+    ssize_t nb_read, nb_written;
+    off_t position;
+
+    if (n > sizeof(buf))
+        n = sizeof(buf);
+
+    position = 0;
+
+    /* Data which cannot be written must stay in the input file so that the
+     * transfer can be resumed: regular files are read at an explicit
+     * position and sockets are peeked. Other files are read and written
+     * entirely. */
+    if (S_ISREG(in_st->st_mode)) {
+        if (offset) {
+            position = *offset;
+        } else {
+            position = lseek(in_fd, 0, SEEK_CUR);
+            if (position == -1) {
+                c_set_error("cannot get file position: %s", strerror(errno));
+                return -1;
+            }
+        }
+
+        nb_read = pread(in_fd, buf, n, position);
+    } else if (S_ISSOCK(in_st->st_mode)) {
+        nb_read = recv(in_fd, buf, n, MSG_PEEK);
+    } else {
+        nb_read = read(in_fd, buf, n);
+    }
+
+    if (nb_read == -1) {
+        c_set_error("cannot read file: %s", strerror(errno));
+        return -1;
+    } else if (nb_read == 0) {
+        return 0;
+    }
+
+    if (S_ISREG(in_st->st_mode) || S_ISSOCK(in_st->st_mode)) {
+        nb_written = write(out_fd, buf, (size_t)nb_read);
+        if (nb_written == -1) {
+            c_set_error("cannot write file: %s", strerror(errno));
+            return -1;
+        }
+    } else {
+        nb_written = 0;
+
+        while (nb_written < nb_read) {
+            ssize_t ret;
+
+            ret = write(out_fd, buf + nb_written,
+                        (size_t)(nb_read - nb_written));
+            if (ret == -1) {
+                if (errno == EINTR)
+                    continue;
+
+                c_set_error("cannot write file: %s", strerror(errno));
+                return -1;
+            }
+
+            nb_written += ret;
+        }
+    }
+
+    if (S_ISREG(in_st->st_mode)) {
+        if (offset) {
+            *offset = position + nb_written;
+        } else if (lseek(in_fd, position + nb_written, SEEK_SET) == -1) {
+            c_set_error("cannot set file position: %s", strerror(errno));
+            return -1;
+        }
+    } else if (S_ISSOCK(in_st->st_mode)) {
+        /* Consume the data written; they are still in the receive queue
+         * since they have only been peeked. */
+        if (recv(in_fd, buf, (size_t)nb_written, 0) == -1) {
+            c_set_error("cannot read socket: %s", strerror(errno));
+            return -1;
+        }
+    }
+
+    return nb_written;
+}
+
+static bool
+c_transfer_is_unsupported(int error) {
+    return error == ENOSYS || error == EINVAL || error == EXDEV
+        || error == EOPNOTSUPP || error == ENOTSOCK;
+}
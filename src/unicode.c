@@ -16,6 +16,27 @@
 
 #include "internal.h"
 
+/* Byte ranges of the first byte of UTF-8 sequences, see
+ * c_utf8_read_codepoint(). */
+static const uint8_t c_utf8_ranges[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 00 - 0f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 10 - 1f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 20 - 2f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 30 - 3f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 40 - 4f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 50 - 5f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 60 - 6f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 70 - 7f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 80 - 8f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 90 - 9f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* a0 - af */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* b0 - bf */
+    0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, /* c0 - cf */
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, /* d0 - df */
+    3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 6, 6, /* e0 - ef */
+    7, 8, 8, 8, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* f0 - ff */
+};
+
 size_t
 c_ustring_length(const uint32_t *ustring) {
     const uint32_t *ptr;
@@ -54,25 +75,6 @@ c_codepoint_is_valid(uint32_t codepoint) {
 int
 c_utf8_read_codepoint(const char *string, uint32_t *pcodepoint,
                       size_t *plength) {
-    static const uint8_t ranges[256] = {
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 00 - 0f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 10 - 1f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 20 - 2f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 30 - 3f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 40 - 4f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 50 - 5f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 60 - 6f */
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 70 - 7f */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 80 - 8f */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 90 - 9f */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* a0 - af */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* b0 - bf */
-        0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, /* c0 - cf */
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, /* d0 - df */
-        3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 6, 6, /* e0 - ef */
-        7, 8, 8, 8, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* f0 - ff */
-    };
-
     uint32_t codepoint;
     const unsigned char *ptr;
     size_t length;
@@ -82,7 +84,7 @@ c_utf8_read_codepoint(const char *string, uint32_t *pcodepoint,
 
     /* Reference: Unicode 7.0 - Table 3.7 */
 
-    range = ranges[*ptr];
+    range = c_utf8_ranges[*ptr];
     switch (range) {
     case 1:
         /* 0xxxxxxx */
@@ -217,6 +219,84 @@ c_utf8_nb_codepoints(const char *string, size_t *pcount) {
     return 0;
 }
 
+int
+c_utf8_read_codepoint_n(const char *data, size_t sz, uint32_t *pcodepoint,
+                        size_t *plength) {
+    size_t length;
+
+    if (sz == 0) {
+        c_set_error("truncated byte sequence");
+        return -1;
+    }
+
+    switch (c_utf8_ranges[(unsigned char)data[0]]) {
+    case 1:
+        length = 1;
+        break;
+
+    case 2:
+        length = 2;
+        break;
+
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+        length = 3;
+        break;
+
+    case 7:
+    case 8:
+    case 9:
+        length = 4;
+        break;
+
+    default:
+        c_set_error("invalid byte sequence");
+        return -1;
+    }
+
+    if (length > sz) {
+        c_set_error("truncated byte sequence");
+        return -1;
+    }
+
+    return c_utf8_read_codepoint(data, pcodepoint, plength);
+}
+
+int
+c_utf8_validate_n(const char *data, size_t sz) {
+    size_t count;
+
+    return c_utf8_nb_codepoints_n(data, sz, &count);
+}
+
+int
+c_utf8_nb_codepoints_n(const char *data, size_t sz, size_t *pcount) {
+    const char *ptr, *end;
+    size_t count;
+
+    ptr = data;
+    end = data + sz;
+    count = 0;
+
+    while (ptr < end) {
+        uint32_t codepoint;
+        size_t length;
+
+        if (c_utf8_read_codepoint_n(ptr, (size_t)(end - ptr),
+                                    &codepoint, &length) == -1) {
+            return -1;
+        }
+
+        count++;
+        ptr += length;
+    }
+
+    *pcount = count;
+    return 0;
+}
+
 uint32_t *
 c_utf8_decode(const char *string) {
     uint32_t *codepoints;
@@ -24,19 +24,29 @@ struct c_vector {
     size_t entries_sz;
 
     size_t entry_sz;
+
+    const struct c_allocator *allocator;
+    size_t alignment; /* 0 if entries are not aligned */
 };
 
 struct c_vector *
 c_vector_new(size_t entry_sz) {
+    return c_vector_new_with_allocator(entry_sz, NULL);
+}
+
+struct c_vector *
+c_vector_new_with_allocator(size_t entry_sz,
+                            const struct c_allocator *allocator) {
     struct c_vector *vector;
 
     assert(entry_sz > 0);
 
-    vector = c_malloc0(sizeof(struct c_vector));
+    vector = c_allocator_malloc0(allocator, sizeof(struct c_vector));
     if (!vector)
         return NULL;
 
     vector->entry_sz = entry_sz;
+    vector->allocator = allocator;
 
     return vector;
 }
@@ -46,9 +56,43 @@ c_vector_delete(struct c_vector *vector) {
     if (!vector)
         return;
 
-    c_free(vector->entries);
+    c_allocator_aligned_free(vector->allocator, vector->alignment,
+                             vector->entries,
+                             vector->entries_sz * vector->entry_sz);
+
+    c_allocator_free0(vector->allocator, vector, sizeof(struct c_vector));
+}
+
+int
+c_vector_set_alignment(struct c_vector *vector, size_t alignment) {
+    size_t sz;
+    void *entries;
+
+    if ((alignment & (alignment - 1)) != 0) {
+        c_set_error("invalid alignment %zu", alignment);
+        return -1;
+    }
+
+    if (alignment == vector->alignment)
+        return 0;
+
+    sz = vector->entries_sz * vector->entry_sz;
+
+    if (vector->entries) {
+        entries = c_allocator_aligned_alloc(vector->allocator, alignment, sz);
+        if (!entries)
+            return -1;
+
+        memcpy(entries, vector->entries,
+               vector->nb_entries * vector->entry_sz);
 
-    c_free0(vector, sizeof(struct c_vector));
+        c_allocator_aligned_free(vector->allocator, vector->alignment,
+                                 vector->entries, sz);
+        vector->entries = entries;
+    }
+
+    vector->alignment = alignment;
+    return 0;
 }
 
 void
@@ -79,7 +123,12 @@ c_vector_append(struct c_vector *vector, const void *value) {
     if (vector->entries_sz == 0
      || vector->nb_entries > vector->entries_sz - 1) {
         entries_sz = (vector->entries_sz == 0) ? 4 : (vector->entries_sz * 2);
-        entries = c_realloc(vector->entries, entries_sz * vector->entry_sz);
+        entries = c_allocator_aligned_realloc(vector->allocator,
+                                              vector->alignment,
+                                              vector->entries,
+                                              vector->entries_sz
+                                              * vector->entry_sz,
+                                              entries_sz * vector->entry_sz);
         if (!entries)
             return -1;
     } else {
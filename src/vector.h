@@ -21,8 +21,12 @@
 #include <stdlib.h>
 
 struct c_vector *c_vector_new(size_t);
+struct c_vector *c_vector_new_with_allocator(size_t,
+                                             const struct c_allocator *);
 void c_vector_delete(struct c_vector *);
 
+int c_vector_set_alignment(struct c_vector *, size_t);
+
 void *c_vector_entries(const struct c_vector *);
 size_t c_vector_length(const struct c_vector *);
 bool c_vector_is_empty(const struct c_vector *);
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+TEST(alloc) {
+    struct c_arena *arena;
+    struct c_arena_stats stats;
+    uint8_t *ptrs[1000];
+
+    arena = c_arena_new(1024);
+
+    c_arena_stats(arena, &stats);
+    TEST_UINT_EQ(stats.nb_chunks, 0);
+    TEST_UINT_EQ(stats.used_size, 0);
+
+    for (size_t i = 0; i < 1000; i++) {
+        ptrs[i] = c_arena_alloc(arena, i % 50 + 1);
+        TEST_PTR_NOT_NULL(ptrs[i]);
+        TEST_UINT_EQ((uintptr_t)ptrs[i] % C_ARENA_DEFAULT_ALIGNMENT, 0);
+        memset(ptrs[i], (int)(i % 256), i % 50 + 1);
+    }
+
+    for (size_t i = 0; i < 1000; i++) {
+        for (size_t j = 0; j < i % 50 + 1; j++)
+            TEST_UINT_EQ(ptrs[i][j], i % 256);
+    }
+
+    c_arena_stats(arena, &stats);
+    TEST_TRUE(stats.nb_chunks > 1);
+    TEST_TRUE(stats.used_size >= 1000 * 25);
+
+    c_arena_delete(arena);
+}
+
+TEST(alloc_aligned) {
+    struct c_arena *arena;
+    void *ptr;
+
+    arena = c_arena_new(1024);
+
+    for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+        c_arena_alloc_aligned(arena, 1, 1);
+
+        ptr = c_arena_alloc_aligned(arena, 10, alignment);
+        TEST_PTR_NOT_NULL(ptr);
+        TEST_UINT_EQ((uintptr_t)ptr % alignment, 0);
+    }
+
+    c_arena_delete(arena);
+}
+
+TEST(large_alloc) {
+    struct c_arena *arena;
+    struct c_arena_stats stats;
+    uint8_t *small, *large;
+
+    arena = c_arena_new(1024);
+
+    small = c_arena_alloc(arena, 16);
+    memset(small, 0xaa, 16);
+
+    large = c_arena_alloc(arena, 10000);
+    TEST_PTR_NOT_NULL(large);
+    memset(large, 0xbb, 10000);
+
+    c_arena_stats(arena, &stats);
+    TEST_UINT_EQ(stats.nb_chunks, 2);
+    TEST_TRUE(stats.memory_size > 10000);
+
+    /* Large chunks are released when the arena is cleared */
+    c_arena_clear(arena);
+
+    c_arena_stats(arena, &stats);
+    TEST_UINT_EQ(stats.nb_chunks, 1);
+    TEST_UINT_EQ(stats.used_size, 0);
+    TEST_TRUE(stats.memory_size < 10000);
+
+    c_arena_reset(arena);
+
+    c_arena_stats(arena, &stats);
+    TEST_UINT_EQ(stats.nb_chunks, 0);
+
+    TEST_PTR_NOT_NULL(c_arena_alloc(arena, 16));
+
+    c_arena_delete(arena);
+}
+
+TEST(realloc) {
+    struct c_arena *arena;
+    char *str, *str2;
+
+    arena = c_arena_new(1024);
+
+    /* The last allocation is resized in place */
+    str = c_arena_realloc(arena, NULL, 0, 4);
+    memcpy(str, "foo", 4);
+    str2 = c_arena_realloc(arena, str, 4, 7);
+    TEST_TRUE(str2 == str);
+    memcpy(str2 + 3, "bar", 4);
+    TEST_STRING_EQ(str2, "foobar");
+
+    /* Other allocations are copied */
+    c_arena_alloc(arena, 8);
+    str = c_arena_realloc(arena, str2, 7, 10);
+    TEST_TRUE(str != str2);
+    TEST_STRING_EQ(str, "foobar");
+
+    /* Allocations which do not fit in the current chunk are copied */
+    str2 = c_arena_realloc(arena, str, 10, 2000);
+    TEST_TRUE(str2 != str);
+    TEST_STRING_EQ(str2, "foobar");
+
+    c_arena_delete(arena);
+}
+
+TEST(strings) {
+    struct c_arena *arena;
+    uint8_t *ptr;
+
+    arena = c_arena_new(0);
+
+    TEST_STRING_EQ(c_arena_strdup(arena, "foo"), "foo");
+    TEST_STRING_EQ(c_arena_strdup(arena, ""), "");
+    TEST_STRING_EQ(c_arena_strndup(arena, "foobar", 3), "foo");
+
+    ptr = c_arena_memdup(arena, "\x01\x02\x03", 3);
+    TEST_UINT_EQ(ptr[0], 1);
+    TEST_UINT_EQ(ptr[2], 3);
+
+    ptr = c_arena_calloc(arena, 10, 4);
+    for (size_t i = 0; i < 40; i++)
+        TEST_UINT_EQ(ptr[i], 0);
+
+    c_arena_delete(arena);
+}
+
+TEST(mark_rewind) {
+    struct c_arena *arena;
+    struct c_arena_mark start, mark;
+    struct c_arena_stats stats;
+    void *ptr, *ptr2;
+
+    arena = c_arena_new(1024);
+
+    c_arena_mark(arena, &start);
+
+    c_arena_alloc(arena, 100);
+
+    c_arena_mark(arena, &mark);
+    ptr = c_arena_alloc(arena, 100);
+
+    for (int i = 0; i < 100; i++)
+        c_arena_alloc(arena, 100);
+
+    c_arena_stats(arena, &stats);
+    TEST_TRUE(stats.nb_chunks > 1);
+    TEST_TRUE(stats.used_size >= 101 * 100);
+
+    /* Memory allocated after the mark is reused */
+    c_arena_rewind(arena, &mark);
+
+    ptr2 = c_arena_alloc(arena, 100);
+    TEST_TRUE(ptr2 == ptr);
+
+    /* Chunks are kept after a rewind */
+    for (int i = 0; i < 100; i++)
+        c_arena_alloc(arena, 100);
+
+    c_arena_rewind(arena, &start);
+
+    c_arena_stats(arena, &stats);
+    TEST_UINT_EQ(stats.used_size, 0);
+    TEST_TRUE(stats.nb_chunks > 1);
+
+    c_arena_delete(arena);
+}
+
+TEST(allocator) {
+    struct c_arena *arena;
+    struct c_arena_stats stats;
+    struct c_allocator allocator;
+    struct c_vector *vector;
+    struct c_queue *queue;
+    struct c_hash_table *table;
+
+    arena = c_arena_new(0);
+    c_arena_init_allocator(arena, &allocator);
+
+    vector = c_vector_new_with_allocator(sizeof(int), &allocator);
+    queue = c_queue_new_with_allocator(&allocator);
+    table = c_hash_table_new_with_allocator(c_hash_int32, c_equal_int32,
+                                            &allocator);
+
+    for (int i = 0; i < 1000; i++) {
+        c_vector_append(vector, &i);
+        c_queue_push(queue, C_INT32_TO_POINTER(i));
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), NULL);
+    }
+
+    TEST_UINT_EQ(c_vector_length(vector), 1000);
+    TEST_UINT_EQ(*(int *)c_vector_entry(vector, 999), 999);
+    TEST_UINT_EQ(c_queue_length(queue), 1000);
+    TEST_INT_EQ(C_POINTER_TO_INT32(c_queue_pop(queue)), 0);
+    TEST_TRUE(c_hash_table_contains(table, C_INT32_TO_POINTER(999)));
+
+    c_arena_stats(arena, &stats);
+    TEST_TRUE(stats.used_size > 1000 * sizeof(int));
+
+    c_hash_table_delete(table);
+    c_queue_delete(queue);
+    c_vector_delete(vector);
+
+    c_arena_delete(arena);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("arena");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, alloc);
+    TEST_RUN(suite, alloc_aligned);
+    TEST_RUN(suite, large_alloc);
+    TEST_RUN(suite, realloc);
+    TEST_RUN(suite, strings);
+    TEST_RUN(suite, mark_rewind);
+    TEST_RUN(suite, allocator);
+
+    test_suite_print_results_and_exit(suite);
+}
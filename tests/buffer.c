@@ -198,6 +198,174 @@ TEST(free_space_after_skip) {
     TEST_UINT_EQ(c_buffer_free_space(buf), C_BUFFER_MIN_SIZE);
 }
 
+struct c_test_allocator_data {
+    size_t nb_allocations;
+    size_t size; /* bytes currently allocated */
+};
+
+static void *
+c_test_allocator_malloc(void *arg, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->nb_allocations++;
+    data->size += sz;
+
+    return malloc(sz);
+}
+
+static void
+c_test_allocator_free(void *arg, void *ptr, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->size -= sz;
+
+    free(ptr);
+}
+
+static void *
+c_test_allocator_realloc(void *arg, void *ptr, size_t old_sz, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->nb_allocations++;
+    data->size += sz - old_sz;
+
+    return realloc(ptr, sz);
+}
+
+static void
+c_test_allocator_init(struct c_allocator *allocator,
+                      struct c_test_allocator_data *data) {
+    memset(data, 0, sizeof(struct c_test_allocator_data));
+
+    allocator->malloc = c_test_allocator_malloc;
+    allocator->free = c_test_allocator_free;
+    allocator->realloc = c_test_allocator_realloc;
+    allocator->aligned_alloc = NULL;
+    allocator->aligned_free = NULL;
+    allocator->data = data;
+}
+
+TEST(allocator) {
+    struct c_allocator allocator;
+    struct c_test_allocator_data data;
+    struct c_buffer *buf;
+    char *str;
+    size_t len;
+
+    c_test_allocator_init(&allocator, &data);
+
+    buf = c_buffer_new_with_allocator(&allocator);
+    TEST_PTR_NOT_NULL(buf);
+
+    for (int i = 0; i < 1000; i++)
+        c_buffer_add_string(buf, "abcdefgh");
+    TEST_TRUE(data.nb_allocations > 2);
+
+    /* Extracted data is allocated with the library allocator */
+    str = c_buffer_extract_string(buf, &len);
+    TEST_UINT_EQ(len, 8000);
+    TEST_UINT_EQ(strlen(str), 8000);
+    c_free(str);
+
+    c_buffer_add_string(buf, "abc");
+    C_TEST_BUFFER_EQ(buf, "abc", 3);
+
+    c_buffer_delete(buf);
+
+    TEST_UINT_EQ(data.size, 0);
+}
+
+TEST(alignment) {
+    struct c_allocator allocator;
+    struct c_test_allocator_data data;
+    struct c_buffer *buf;
+    char *str;
+
+    buf = c_buffer_new();
+    c_buffer_add_string(buf, "abc");
+    TEST_INT_EQ(c_buffer_set_alignment(buf, 4096), 0);
+    TEST_UINT_EQ((uintptr_t)c_buffer_data(buf) % 4096, 0);
+    C_TEST_BUFFER_EQ(buf, "abc", 3);
+
+    for (int i = 0; i < 1000; i++)
+        c_buffer_add_string(buf, "abcdefgh");
+    TEST_UINT_EQ((uintptr_t)c_buffer_data(buf) % 4096, 0);
+    TEST_UINT_EQ(c_buffer_length(buf), 8003);
+
+    str = c_buffer_extract_string(buf, NULL);
+    TEST_UINT_EQ(strlen(str), 8003);
+    c_free(str);
+
+    TEST_INT_EQ(c_buffer_set_alignment(buf, 3), -1);
+    c_buffer_delete(buf);
+
+    c_test_allocator_init(&allocator, &data);
+
+    buf = c_buffer_new_with_allocator(&allocator);
+    TEST_INT_EQ(c_buffer_set_alignment(buf, 64), 0);
+
+    for (int i = 0; i < 1000; i++) {
+        c_buffer_add_string(buf, "abcdefgh");
+        TEST_UINT_EQ((uintptr_t)c_buffer_data(buf) % 64, 0);
+    }
+
+    c_buffer_delete(buf);
+
+    TEST_UINT_EQ(data.size, 0);
+}
+
+TEST(growth) {
+    struct c_allocator allocator;
+    struct c_test_allocator_data data;
+    struct c_buffer *buf;
+    size_t sz;
+
+    c_test_allocator_init(&allocator, &data);
+
+    buf = c_buffer_new_with_allocator(&allocator);
+
+    /* Small appends grow the buffer geometrically */
+    for (int i = 0; i < 100000; i++) {
+        TEST_PTR_NOT_NULL(c_buffer_reserve(buf, 10));
+        c_buffer_increase_length(buf, 10);
+    }
+
+    TEST_UINT_EQ(c_buffer_length(buf), 1000000);
+    TEST_TRUE(data.nb_allocations < 30);
+
+    TEST_INT_EQ(c_buffer_shrink_to_fit(buf), 0);
+    TEST_UINT_EQ(c_buffer_size(buf), 1000000);
+
+    TEST_INT_EQ(c_buffer_reserve_capacity(buf, 2000000), 0);
+    TEST_UINT_EQ(c_buffer_size(buf), 2000000);
+    TEST_INT_EQ(c_buffer_reserve_capacity(buf, 100), 0);
+    TEST_UINT_EQ(c_buffer_size(buf), 2000000);
+
+    /* The growth increment can be capped */
+    TEST_INT_EQ(c_buffer_set_growth_policy(buf, 1.0, 0), -1);
+    TEST_INT_EQ(c_buffer_set_growth_policy(buf, 1.5, 4096), 0);
+
+    c_buffer_shrink_to_fit(buf);
+    for (int i = 0; i < 1000; i++) {
+        sz = c_buffer_size(buf);
+        c_buffer_add(buf, "abcdefgh", 8);
+        TEST_TRUE(c_buffer_size(buf) - sz <= 4096);
+    }
+
+    TEST_UINT_EQ(c_buffer_length(buf), 1008000);
+
+    c_buffer_skip(buf, c_buffer_length(buf));
+    TEST_INT_EQ(c_buffer_shrink_to_fit(buf), 0);
+    TEST_UINT_EQ(c_buffer_size(buf), 0);
+
+    c_buffer_delete(buf);
+
+    TEST_UINT_EQ(data.size, 0);
+}
+
 int
 main(int argc, char **argv) {
     struct test_suite *suite;
@@ -213,6 +381,9 @@ main(int argc, char **argv) {
     TEST_RUN(suite, remove);
     TEST_RUN(suite, dup);
     TEST_RUN(suite, free_space_after_skip);
+    TEST_RUN(suite, allocator);
+    TEST_RUN(suite, alignment);
+    TEST_RUN(suite, growth);
 
     test_suite_print_results_and_exit(suite);
 }
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+struct test_evictions {
+    int32_t keys[16];
+    size_t nb_keys;
+};
+
+static void
+test_evict(void *key, void *value, void *arg) {
+    struct test_evictions *evictions;
+
+    evictions = arg;
+
+    if (evictions->nb_keys < 16)
+        evictions->keys[evictions->nb_keys] = C_POINTER_TO_INT32(key);
+    evictions->nb_keys++;
+}
+
+static int
+test_insert(struct c_cache *cache, int32_t key, size_t cost) {
+    return c_cache_insert(cache, C_INT32_TO_POINTER(key),
+                          C_INT32_TO_POINTER(key * 10), cost);
+}
+
+static bool
+test_get(struct c_cache *cache, int32_t key) {
+    return c_cache_get(cache, C_INT32_TO_POINTER(key), NULL) == 1;
+}
+
+static bool
+test_contains(struct c_cache *cache, int32_t key) {
+    return c_cache_contains(cache, C_INT32_TO_POINTER(key));
+}
+
+TEST(insert) {
+    struct c_cache *cache;
+    const char *key, *value;
+
+    cache = c_cache_new(c_hash_string, c_equal_string, C_CACHE_LRU);
+
+    TEST_TRUE(c_cache_is_empty(cache));
+
+    TEST_INT_EQ(c_cache_insert(cache, "a", "abc", 3), 1);
+    TEST_INT_EQ(c_cache_insert(cache, "d", "def", 3), 1);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 2);
+    TEST_UINT_EQ(c_cache_cost(cache), 6);
+
+    TEST_INT_EQ(c_cache_get(cache, "a", (void **)&value), 1);
+    TEST_STRING_EQ(value, "abc");
+    TEST_INT_EQ(c_cache_get(cache, "g", (void **)&value), 0);
+
+    TEST_INT_EQ(c_cache_insert2(cache, "a", "foobar", 6,
+                                (void **)&key, (void **)&value), 0);
+    TEST_STRING_EQ(key, "a");
+    TEST_STRING_EQ(value, "abc");
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 2);
+    TEST_UINT_EQ(c_cache_cost(cache), 9);
+
+    TEST_INT_EQ(c_cache_peek(cache, "a", (void **)&value), 1);
+    TEST_STRING_EQ(value, "foobar");
+
+    TEST_INT_EQ(c_cache_remove2(cache, "d", (void **)&key,
+                                (void **)&value), 1);
+    TEST_STRING_EQ(key, "d");
+    TEST_STRING_EQ(value, "def");
+    TEST_INT_EQ(c_cache_remove(cache, "d"), 0);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 1);
+    TEST_UINT_EQ(c_cache_cost(cache), 6);
+
+    c_cache_clear(cache);
+    TEST_TRUE(c_cache_is_empty(cache));
+    TEST_UINT_EQ(c_cache_cost(cache), 0);
+
+    c_cache_delete(cache);
+}
+
+TEST(lru) {
+    struct c_cache *cache;
+    struct test_evictions evictions;
+
+    memset(&evictions, 0, sizeof(struct test_evictions));
+
+    cache = c_cache_new(c_hash_int32, c_equal_int32, C_CACHE_LRU);
+    c_cache_set_evict_func(cache, test_evict, &evictions);
+    c_cache_set_max_entries(cache, 3);
+
+    test_insert(cache, 1, 0);
+    test_insert(cache, 2, 0);
+    test_insert(cache, 3, 0);
+
+    /* 1 is now the most recently used entry */
+    TEST_TRUE(test_get(cache, 1));
+
+    test_insert(cache, 4, 0);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 3);
+    TEST_UINT_EQ(evictions.nb_keys, 1);
+    TEST_INT_EQ(evictions.keys[0], 2);
+
+    test_insert(cache, 5, 0);
+    TEST_UINT_EQ(evictions.nb_keys, 2);
+    TEST_INT_EQ(evictions.keys[1], 3);
+
+    TEST_TRUE(test_contains(cache, 1));
+    TEST_TRUE(test_contains(cache, 4));
+    TEST_TRUE(test_contains(cache, 5));
+
+    /* Peeking does not affect the order of entries */
+    TEST_TRUE(test_contains(cache, 1));
+    test_insert(cache, 6, 0);
+    TEST_INT_EQ(evictions.keys[2], 1);
+
+    c_cache_delete(cache);
+}
+
+TEST(clock) {
+    struct c_cache *cache;
+    struct test_evictions evictions;
+
+    memset(&evictions, 0, sizeof(struct test_evictions));
+
+    cache = c_cache_new(c_hash_int32, c_equal_int32, C_CACHE_CLOCK);
+    c_cache_set_evict_func(cache, test_evict, &evictions);
+    c_cache_set_max_entries(cache, 3);
+
+    test_insert(cache, 1, 0);
+    test_insert(cache, 2, 0);
+    test_insert(cache, 3, 0);
+
+    /* 1 gets a second chance */
+    TEST_TRUE(test_get(cache, 1));
+
+    test_insert(cache, 4, 0);
+    TEST_UINT_EQ(evictions.nb_keys, 1);
+    TEST_INT_EQ(evictions.keys[0], 2);
+
+    test_insert(cache, 5, 0);
+    TEST_UINT_EQ(evictions.nb_keys, 2);
+    TEST_INT_EQ(evictions.keys[1], 3);
+
+    /* The reference bit of 1 has been cleared */
+    test_insert(cache, 6, 0);
+    TEST_UINT_EQ(evictions.nb_keys, 3);
+    TEST_INT_EQ(evictions.keys[2], 1);
+
+    TEST_TRUE(test_contains(cache, 4));
+    TEST_TRUE(test_contains(cache, 5));
+    TEST_TRUE(test_contains(cache, 6));
+
+    c_cache_delete(cache);
+}
+
+TEST(cost) {
+    struct c_cache *cache;
+    struct test_evictions evictions;
+
+    memset(&evictions, 0, sizeof(struct test_evictions));
+
+    cache = c_cache_new(c_hash_int32, c_equal_int32, C_CACHE_LRU);
+    c_cache_set_evict_func(cache, test_evict, &evictions);
+    c_cache_set_max_cost(cache, 100);
+
+    test_insert(cache, 1, 40);
+    test_insert(cache, 2, 40);
+    TEST_UINT_EQ(evictions.nb_keys, 0);
+
+    test_insert(cache, 3, 40);
+    TEST_UINT_EQ(evictions.nb_keys, 1);
+    TEST_INT_EQ(evictions.keys[0], 1);
+    TEST_UINT_EQ(c_cache_cost(cache), 80);
+
+    /* An entry more expensive than the maximum cost is kept alone */
+    test_insert(cache, 4, 200);
+    TEST_UINT_EQ(evictions.nb_keys, 3);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 1);
+    TEST_TRUE(test_contains(cache, 4));
+
+    /* Lowering the limit evicts entries immediately */
+    test_insert(cache, 5, 10);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 1);
+    TEST_TRUE(test_contains(cache, 5));
+
+    c_cache_set_max_cost(cache, 0);
+    test_insert(cache, 6, 10);
+    test_insert(cache, 7, 10);
+    c_cache_set_max_entries(cache, 1);
+    TEST_UINT_EQ(c_cache_nb_entries(cache), 1);
+    TEST_TRUE(test_contains(cache, 7));
+
+    c_cache_delete(cache);
+}
+
+TEST(stats) {
+    struct c_cache *cache;
+    struct c_cache_stats stats;
+
+    cache = c_cache_new(c_hash_int32, c_equal_int32, C_CACHE_CLOCK);
+    c_cache_set_max_entries(cache, 10);
+
+    for (int32_t i = 0; i < 20; i++)
+        test_insert(cache, i, 1);
+
+    for (int32_t i = 0; i < 20; i++)
+        test_get(cache, i);
+
+    c_cache_stats(cache, &stats);
+    TEST_UINT_EQ(stats.nb_entries, 10);
+    TEST_UINT_EQ(stats.cost, 10);
+    TEST_UINT_EQ(stats.nb_hits, 10);
+    TEST_UINT_EQ(stats.nb_misses, 10);
+    TEST_UINT_EQ(stats.nb_insertions, 20);
+    TEST_UINT_EQ(stats.nb_evictions, 10);
+
+    c_cache_reset_stats(cache);
+    c_cache_stats(cache, &stats);
+    TEST_UINT_EQ(stats.nb_hits, 0);
+    TEST_UINT_EQ(stats.nb_entries, 10);
+
+    c_cache_delete(cache);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("cache");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, insert);
+    TEST_RUN(suite, lru);
+    TEST_RUN(suite, clock);
+    TEST_RUN(suite, cost);
+    TEST_RUN(suite, stats);
+
+    test_suite_print_results_and_exit(suite);
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_NB_THREADS          8
+#define TEST_NB_KEYS_PER_THREAD  10000
+
+struct test_thread {
+    struct c_concurrent_hash_table *table;
+    int32_t first_key;
+    int nb_errors;
+};
+
+static void *test_thread_main(void *);
+
+TEST(insert) {
+    struct c_concurrent_hash_table *table;
+    const char *str;
+
+    table = c_concurrent_hash_table_new(c_hash_string, c_equal_string, 4);
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_shards(table), 4);
+
+    TEST_TRUE(c_concurrent_hash_table_is_empty(table));
+
+    TEST_INT_EQ(c_concurrent_hash_table_insert(table, "a", "abc"), 1);
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_entries(table), 1);
+
+    c_concurrent_hash_table_insert(table, "d", "def");
+    c_concurrent_hash_table_insert(table, "g", "ghi");
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_entries(table), 3);
+    TEST_FALSE(c_concurrent_hash_table_is_empty(table));
+
+    TEST_INT_EQ(c_concurrent_hash_table_get(table, "a", (void **)&str), 1);
+    TEST_STRING_EQ(str, "abc");
+    TEST_INT_EQ(c_concurrent_hash_table_get(table, "g", (void **)&str), 1);
+    TEST_STRING_EQ(str, "ghi");
+    TEST_INT_EQ(c_concurrent_hash_table_get(table, "x", (void **)&str), 0);
+
+    TEST_INT_EQ(c_concurrent_hash_table_insert(table, "g", "foo"), 0);
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_entries(table), 3);
+    TEST_INT_EQ(c_concurrent_hash_table_get(table, "g", (void **)&str), 1);
+    TEST_STRING_EQ(str, "foo");
+
+    c_concurrent_hash_table_delete(table);
+}
+
+TEST(insert2) {
+    struct c_concurrent_hash_table *table;
+    char *old_key, *old_value;
+
+    table = c_concurrent_hash_table_new(c_hash_string, c_equal_string, 0);
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_shards(table), 64);
+
+    TEST_INT_EQ(c_concurrent_hash_table_insert2(table, "a", "abc",
+                                                (void **)&old_key,
+                                                (void **)&old_value), 1);
+    TEST_PTR_NULL(old_key);
+    TEST_PTR_NULL(old_value);
+
+    TEST_INT_EQ(c_concurrent_hash_table_insert2(table, "a", "def",
+                                                (void **)&old_key,
+                                                (void **)&old_value), 0);
+    TEST_STRING_EQ(old_key, "a");
+    TEST_STRING_EQ(old_value, "abc");
+
+    c_concurrent_hash_table_delete(table);
+}
+
+TEST(remove) {
+    struct c_concurrent_hash_table *table;
+    char *old_key, *old_value;
+
+    table = c_concurrent_hash_table_new(c_hash_string, c_equal_string, 3);
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_shards(table), 4);
+
+    c_concurrent_hash_table_insert(table, "a", "abc");
+    c_concurrent_hash_table_insert(table, "d", "def");
+
+    TEST_INT_EQ(c_concurrent_hash_table_remove(table, "a"), 1);
+    TEST_FALSE(c_concurrent_hash_table_contains(table, "a"));
+    TEST_TRUE(c_concurrent_hash_table_contains(table, "d"));
+    TEST_INT_EQ(c_concurrent_hash_table_remove(table, "a"), 0);
+
+    TEST_INT_EQ(c_concurrent_hash_table_remove2(table, "d",
+                                                (void **)&old_key,
+                                                (void **)&old_value), 1);
+    TEST_STRING_EQ(old_key, "d");
+    TEST_STRING_EQ(old_value, "def");
+    TEST_TRUE(c_concurrent_hash_table_is_empty(table));
+
+    c_concurrent_hash_table_insert(table, "g", "ghi");
+    c_concurrent_hash_table_clear(table);
+    TEST_TRUE(c_concurrent_hash_table_is_empty(table));
+    TEST_FALSE(c_concurrent_hash_table_contains(table, "g"));
+
+    c_concurrent_hash_table_delete(table);
+}
+
+TEST(iterate_shard) {
+    struct c_concurrent_hash_table *table;
+    struct c_concurrent_hash_table_iterator *it;
+    size_t nb_values, nb_found;
+    void *key, *value;
+    bool found[1000];
+
+    nb_values = sizeof(found) / sizeof(found[0]);
+    memset(found, 0, sizeof(found));
+
+    table = c_concurrent_hash_table_new(c_hash_int32, c_equal_int32, 16);
+
+    for (size_t i = 0; i < nb_values; i++) {
+        c_concurrent_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                       C_INT32_TO_POINTER(i));
+    }
+
+    nb_found = 0;
+
+    for (size_t s = 0; s < c_concurrent_hash_table_nb_shards(table); s++) {
+        size_t nb_shard_entries;
+
+        nb_shard_entries = 0;
+
+        it = c_concurrent_hash_table_iterate_shard(table, s);
+
+        while (c_concurrent_hash_table_iterator_next(it, &key, &value) == 1) {
+            int32_t i;
+
+            i = C_POINTER_TO_INT32(key);
+            TEST_INT_EQ(C_POINTER_TO_INT32(value), i);
+            TEST_FALSE(found[i]);
+            found[i] = true;
+
+            c_concurrent_hash_table_iterator_set_value(it,
+                                                       C_INT32_TO_POINTER(-i));
+
+            nb_shard_entries++;
+        }
+
+        c_concurrent_hash_table_iterator_delete(it);
+
+        /* Keys are spread across all shards */
+        TEST_TRUE(nb_shard_entries > 0);
+        nb_found += nb_shard_entries;
+    }
+
+    TEST_UINT_EQ(nb_found, nb_values);
+
+    for (size_t i = 0; i < nb_values; i++) {
+        void *value;
+
+        TEST_INT_EQ(c_concurrent_hash_table_get(table, C_INT32_TO_POINTER(i),
+                                                &value), 1);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), -(int32_t)i);
+    }
+
+    c_concurrent_hash_table_delete(table);
+}
+
+TEST(threads) {
+    struct c_concurrent_hash_table *table;
+    struct test_thread threads[TEST_NB_THREADS];
+    pthread_t thread_ids[TEST_NB_THREADS];
+
+    table = c_concurrent_hash_table_new(c_hash_int32, c_equal_int32, 0);
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        threads[i].table = table;
+        threads[i].first_key = (int32_t)(i * TEST_NB_KEYS_PER_THREAD);
+        threads[i].nb_errors = 0;
+
+        if (pthread_create(&thread_ids[i], NULL, test_thread_main,
+                           &threads[i]) != 0) {
+            TEST_ABORT("cannot create thread");
+        }
+    }
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        pthread_join(thread_ids[i], NULL);
+        TEST_INT_EQ(threads[i].nb_errors, 0);
+    }
+
+    /* Each thread removed the odd keys it inserted */
+    TEST_UINT_EQ(c_concurrent_hash_table_nb_entries(table),
+                 TEST_NB_THREADS * TEST_NB_KEYS_PER_THREAD / 2);
+
+    for (int32_t i = 0; i < TEST_NB_THREADS * TEST_NB_KEYS_PER_THREAD; i++) {
+        TEST_BOOL_EQ(c_concurrent_hash_table_contains(table,
+                                                      C_INT32_TO_POINTER(i)),
+                     i % 2 == 0);
+    }
+
+    c_concurrent_hash_table_delete(table);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("concurrent-hash-table");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, insert);
+    TEST_RUN(suite, insert2);
+    TEST_RUN(suite, remove);
+    TEST_RUN(suite, iterate_shard);
+    TEST_RUN(suite, threads);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static void *
+test_thread_main(void *arg) {
+    struct test_thread *thread;
+    int32_t first, last;
+
+    thread = arg;
+
+    first = thread->first_key;
+    last = first + TEST_NB_KEYS_PER_THREAD;
+
+    for (int32_t i = first; i < last; i++) {
+        if (c_concurrent_hash_table_insert(thread->table, C_INT32_TO_POINTER(i),
+                                           C_INT32_TO_POINTER(i)) != 1) {
+            thread->nb_errors++;
+        }
+    }
+
+    for (int32_t i = first; i < last; i++) {
+        void *value;
+
+        if (c_concurrent_hash_table_get(thread->table, C_INT32_TO_POINTER(i),
+                                        &value) != 1
+         || C_POINTER_TO_INT32(value) != i) {
+            thread->nb_errors++;
+        }
+
+        if (i % 2 == 1
+         && c_concurrent_hash_table_remove(thread->table,
+                                           C_INT32_TO_POINTER(i)) != 1) {
+            thread->nb_errors++;
+        }
+    }
+
+    return NULL;
+}
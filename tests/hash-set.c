@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+static struct c_hash_set *
+test_int_set(int32_t start, int32_t end, int32_t step) {
+    struct c_hash_set *set;
+
+    set = c_hash_set_new(c_hash_int32, c_equal_int32);
+
+    for (int32_t i = start; i < end; i += step)
+        c_hash_set_insert(set, C_INT32_TO_POINTER(i));
+
+    return set;
+}
+
+TEST(insert) {
+    struct c_hash_set *set;
+    const char *key;
+    char str[] = "abc";
+
+    set = c_hash_set_new(c_hash_string, c_equal_string);
+
+    TEST_TRUE(c_hash_set_is_empty(set));
+
+    TEST_INT_EQ(c_hash_set_insert(set, "abc"), 1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 1);
+    TEST_INT_EQ(c_hash_set_insert(set, "def"), 1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 2);
+
+    TEST_TRUE(c_hash_set_contains(set, "abc"));
+    TEST_TRUE(c_hash_set_contains(set, "def"));
+    TEST_FALSE(c_hash_set_contains(set, "ghi"));
+
+    TEST_INT_EQ(c_hash_set_insert2(set, str, (void **)&key), 0);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 2);
+    TEST_STRING_EQ(key, "abc");
+    TEST_TRUE(key != str);
+
+    TEST_INT_EQ(c_hash_set_get(set, "abc", (void **)&key), 1);
+    TEST_TRUE(key == str);
+    TEST_INT_EQ(c_hash_set_get(set, "ghi", (void **)&key), 0);
+
+    c_hash_set_delete(set);
+}
+
+TEST(remove) {
+    struct c_hash_set *set;
+    void *key;
+
+    set = test_int_set(0, 1000, 1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 1000);
+
+    for (int32_t i = 0; i < 1000; i += 2)
+        TEST_INT_EQ(c_hash_set_remove(set, C_INT32_TO_POINTER(i)), 1);
+
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 500);
+    TEST_INT_EQ(c_hash_set_remove(set, C_INT32_TO_POINTER(0)), 0);
+
+    for (int32_t i = 0; i < 1000; i++) {
+        TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(i))
+                  == (i % 2 == 1));
+    }
+
+    TEST_INT_EQ(c_hash_set_remove2(set, C_INT32_TO_POINTER(1), &key), 1);
+    TEST_INT_EQ(C_POINTER_TO_INT32(key), 1);
+
+    for (int32_t i = 3; i < 1000; i += 2)
+        TEST_INT_EQ(c_hash_set_remove(set, C_INT32_TO_POINTER(i)), 1);
+
+    TEST_TRUE(c_hash_set_is_empty(set));
+
+    c_hash_set_delete(set);
+}
+
+TEST(clear) {
+    struct c_hash_set *set;
+
+    set = test_int_set(0, 100, 1);
+
+    c_hash_set_clear(set);
+    TEST_TRUE(c_hash_set_is_empty(set));
+    TEST_FALSE(c_hash_set_contains(set, C_INT32_TO_POINTER(1)));
+
+    c_hash_set_insert(set, C_INT32_TO_POINTER(1));
+    TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(1)));
+
+    c_hash_set_delete(set);
+}
+
+TEST(capacity) {
+    struct c_hash_set *set;
+    size_t capacity;
+
+    set = c_hash_set_new_with_capacity(c_hash_int32, c_equal_int32, 1000);
+    capacity = c_hash_set_capacity(set);
+    TEST_TRUE(capacity >= 1000);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_hash_set_insert(set, C_INT32_TO_POINTER(i));
+
+    TEST_UINT_EQ(c_hash_set_capacity(set), capacity);
+
+    TEST_INT_EQ(c_hash_set_reserve(set, 10000), 0);
+    TEST_TRUE(c_hash_set_capacity(set) >= 10000);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 1000);
+    TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(999)));
+
+    /* Removing keys does not shrink the set below the reserved capacity */
+    capacity = c_hash_set_capacity(set);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_hash_set_remove(set, C_INT32_TO_POINTER(i));
+
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 0);
+    TEST_UINT_EQ(c_hash_set_capacity(set), capacity);
+
+    c_hash_set_delete(set);
+}
+
+TEST(copy) {
+    struct c_hash_set *set, *copy;
+
+    set = test_int_set(0, 100, 1);
+
+    copy = c_hash_set_copy(set);
+    c_hash_set_remove(set, C_INT32_TO_POINTER(1));
+
+    TEST_UINT_EQ(c_hash_set_nb_entries(copy), 100);
+    for (int32_t i = 0; i < 100; i++)
+        TEST_TRUE(c_hash_set_contains(copy, C_INT32_TO_POINTER(i)));
+
+    c_hash_set_delete(copy);
+    c_hash_set_delete(set);
+}
+
+TEST(union) {
+    struct c_hash_set *set1, *set2, *set;
+
+    set1 = test_int_set(0, 100, 2);
+    set2 = test_int_set(0, 30, 3);
+
+    set = c_hash_set_union(set1, set2);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 55);
+    for (int32_t i = 0; i < 100; i++) {
+        TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(i))
+                  == (i % 2 == 0 || (i < 30 && i % 3 == 0)));
+    }
+    c_hash_set_delete(set);
+
+    set = c_hash_set_union(set2, set1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 55);
+    c_hash_set_delete(set);
+
+    c_hash_set_delete(set1);
+    c_hash_set_delete(set2);
+}
+
+TEST(intersection) {
+    struct c_hash_set *set1, *set2, *set;
+
+    set1 = test_int_set(0, 100, 2);
+    set2 = test_int_set(0, 30, 3);
+
+    set = c_hash_set_intersection(set1, set2);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 5);
+    for (int32_t i = 0; i < 100; i++) {
+        TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(i))
+                  == (i < 30 && i % 6 == 0));
+    }
+    c_hash_set_delete(set);
+
+    set = c_hash_set_intersection(set2, set1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 5);
+    c_hash_set_delete(set);
+
+    c_hash_set_delete(set1);
+    c_hash_set_delete(set2);
+}
+
+TEST(difference) {
+    struct c_hash_set *set1, *set2, *set;
+
+    set1 = test_int_set(0, 100, 2);
+    set2 = test_int_set(0, 30, 3);
+
+    set = c_hash_set_difference(set1, set2);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 45);
+    for (int32_t i = 0; i < 100; i++) {
+        TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(i))
+                  == (i % 2 == 0 && !(i < 30 && i % 6 == 0)));
+    }
+    c_hash_set_delete(set);
+
+    set = c_hash_set_difference(set2, set1);
+    TEST_UINT_EQ(c_hash_set_nb_entries(set), 5);
+    for (int32_t i = 0; i < 100; i++) {
+        TEST_TRUE(c_hash_set_contains(set, C_INT32_TO_POINTER(i))
+                  == (i < 30 && i % 3 == 0 && i % 2 == 1));
+    }
+    c_hash_set_delete(set);
+
+    c_hash_set_delete(set1);
+    c_hash_set_delete(set2);
+}
+
+TEST(iterate) {
+    struct c_hash_set *set;
+    struct c_hash_set_iterator it;
+    int32_t sum;
+    size_t nb_keys;
+    void *key;
+
+    set = test_int_set(1, 101, 1);
+
+    nb_keys = 0;
+    sum = 0;
+
+    c_hash_set_iterator_init(&it, set);
+    while (c_hash_set_iterator_next(&it, &key) == 1) {
+        sum += C_POINTER_TO_INT32(key);
+        nb_keys++;
+    }
+
+    TEST_UINT_EQ(nb_keys, 100);
+    TEST_INT_EQ(sum, 5050);
+    TEST_INT_EQ(c_hash_set_iterator_next(&it, &key), 0);
+
+    c_hash_set_delete(set);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("hash-set");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, insert);
+    TEST_RUN(suite, remove);
+    TEST_RUN(suite, clear);
+    TEST_RUN(suite, capacity);
+    TEST_RUN(suite, copy);
+    TEST_RUN(suite, union);
+    TEST_RUN(suite, intersection);
+    TEST_RUN(suite, difference);
+    TEST_RUN(suite, iterate);
+
+    test_suite_print_results_and_exit(suite);
+}
@@ -18,6 +18,8 @@
 
 #include "../src/internal.h"
 
+static int c_test_sum_values(void *, void *, void *);
+
 TEST(insert) {
     struct c_hash_table *table;
     const char *str;
@@ -68,6 +70,53 @@ TEST(insert2) {
     c_hash_table_delete(table);
 }
 
+TEST(get_with_hash) {
+    struct c_hash_table *table;
+    const char *str;
+
+    table = c_hash_table_new(c_hash_string, c_equal_string);
+
+    c_hash_table_insert(table, "a", "abc");
+    c_hash_table_insert(table, "d", "def");
+
+    TEST_INT_EQ(c_hash_table_get_with_hash(table, "a", c_hash_string("a"),
+                                           (void **)&str), 1);
+    TEST_STRING_EQ(str, "abc");
+    TEST_INT_EQ(c_hash_table_get_with_hash(table, "g", c_hash_string("g"),
+                                           (void **)&str), 0);
+
+    c_hash_table_delete(table);
+}
+
+TEST(get_many) {
+    struct c_hash_table *table;
+    const char *keys[] = {"a", "b", "d", "e", "g"};
+    void *values[5];
+    bool found[5];
+
+    table = c_hash_table_new(c_hash_string, c_equal_string);
+
+    c_hash_table_insert(table, "a", "abc");
+    c_hash_table_insert(table, "d", "def");
+    c_hash_table_insert(table, "g", "ghi");
+
+    TEST_UINT_EQ(c_hash_table_get_many(table, (const void * const *)keys, 5,
+                                       values, found), 3);
+    TEST_TRUE(found[0]);
+    TEST_STRING_EQ(values[0], "abc");
+    TEST_FALSE(found[1]);
+    TEST_TRUE(found[2]);
+    TEST_STRING_EQ(values[2], "def");
+    TEST_FALSE(found[3]);
+    TEST_TRUE(found[4]);
+    TEST_STRING_EQ(values[4], "ghi");
+
+    TEST_UINT_EQ(c_hash_table_get_many(table, (const void * const *)keys, 0,
+                                       values, found), 0);
+
+    c_hash_table_delete(table);
+}
+
 TEST(remove) {
     struct c_hash_table *table;
 
@@ -149,6 +198,278 @@ TEST(resize) {
     c_hash_table_delete(table);
 }
 
+TEST(remove_insert) {
+    struct c_hash_table *table;
+    void *value;
+
+    size_t nb_entries = 1000;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    for (size_t i = 0; i < nb_entries; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    for (size_t round = 0; round < 10; round++) {
+        for (size_t i = round % 2; i < nb_entries; i += 2) {
+            TEST_INT_EQ(c_hash_table_remove(table, C_INT32_TO_POINTER(i)), 1);
+        }
+
+        TEST_UINT_EQ(c_hash_table_nb_entries(table), nb_entries / 2);
+
+        for (size_t i = round % 2; i < nb_entries; i += 2) {
+            TEST_INT_EQ(c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                            C_INT32_TO_POINTER(i + round)),
+                        1);
+        }
+    }
+
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), nb_entries);
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        TEST_INT_EQ(c_hash_table_get(table, C_INT32_TO_POINTER(i), &value), 1);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), i + 8 + (i % 2));
+    }
+
+    c_hash_table_delete(table);
+}
+
+TEST(capacity) {
+    struct c_hash_table *table;
+    size_t capacity;
+
+    table = c_hash_table_new_with_capacity(c_hash_int32, c_equal_int32, 1000);
+    TEST_TRUE(c_hash_table_capacity(table) >= 1000);
+    capacity = c_hash_table_capacity(table);
+
+    for (size_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    TEST_INT_EQ(c_hash_table_reserve(table, 100), 0);
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    TEST_INT_EQ(c_hash_table_reserve(table, 100000), 0);
+    TEST_TRUE(c_hash_table_capacity(table) >= 100000);
+    capacity = c_hash_table_capacity(table);
+
+    for (size_t i = 1000; i < 100000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    for (size_t i = 10; i < 100000; i++)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    TEST_INT_EQ(c_hash_table_shrink_to_fit(table), 0);
+    TEST_TRUE(c_hash_table_capacity(table) >= 10);
+    TEST_TRUE(c_hash_table_capacity(table) < 20);
+
+    for (size_t i = 0; i < 10; i++) {
+        void *value;
+
+        TEST_INT_EQ(c_hash_table_get(table, C_INT32_TO_POINTER(i), &value), 1);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), (int32_t)i);
+    }
+
+    c_hash_table_delete(table);
+}
+
+TEST(reserved_capacity) {
+    struct c_hash_table *table;
+    size_t capacity;
+    intptr_t sum;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    TEST_INT_EQ(c_hash_table_reserve(table, 100000), 0);
+    capacity = c_hash_table_capacity(table);
+
+    /* Neither iterating nor removing entries shrinks a reserved table */
+    sum = 0;
+    TEST_INT_EQ(c_hash_table_foreach(table, c_test_sum_values, &sum), 0);
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    TEST_INT_EQ(c_hash_table_insert(table, C_INT32_TO_POINTER(1),
+                                    C_INT32_TO_POINTER(1)), 1);
+    TEST_INT_EQ(c_hash_table_remove(table, C_INT32_TO_POINTER(1)), 1);
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    for (int n = 0; n < 10; n++) {
+        for (int32_t i = 0; i < 1000; i++) {
+            c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                C_INT32_TO_POINTER(i));
+        }
+
+        for (int32_t i = 0; i < 1000; i++)
+            c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+    }
+
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    /* A smaller reservation lets the table shrink down to it */
+    TEST_INT_EQ(c_hash_table_reserve(table, 1000), 0);
+    TEST_INT_EQ(c_hash_table_insert(table, C_INT32_TO_POINTER(1),
+                                    C_INT32_TO_POINTER(1)), 1);
+    for (int n = 0; n < 10; n++)
+        TEST_INT_EQ(c_hash_table_remove(table, C_INT32_TO_POINTER(1)), n == 0);
+    TEST_TRUE(c_hash_table_capacity(table) < capacity);
+    TEST_TRUE(c_hash_table_capacity(table) >= 1000);
+
+    c_hash_table_delete(table);
+}
+
+TEST(load_factors) {
+    struct c_hash_table *table;
+    size_t capacity;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.0, 0.0), -1);
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 1.0, 0.0), -1);
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.5, 0.25), -1);
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.5, -0.1), -1);
+
+    /* Never shrink */
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.5, 0.0), 0);
+
+    for (size_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    capacity = c_hash_table_capacity(table);
+    TEST_TRUE(capacity >= 1000);
+    TEST_TRUE(capacity < 2000);
+
+    for (size_t i = 0; i < 1000; i++)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+    TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+
+    /* Hysteresis */
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.8, 0.2), 0);
+    TEST_INT_EQ(c_hash_table_shrink_to_fit(table), 0);
+
+    for (size_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+    capacity = c_hash_table_capacity(table);
+
+    for (int n = 0; n < 100; n++) {
+        for (size_t i = 1000; i < 1100; i++) {
+            c_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                C_INT32_TO_POINTER(i));
+        }
+
+        for (size_t i = 1000; i < 1100; i++)
+            c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+    }
+
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), 1000);
+    TEST_TRUE(c_hash_table_capacity(table) >= capacity);
+
+    c_hash_table_delete(table);
+}
+
+TEST(incremental_resize) {
+    struct c_hash_table *table;
+    struct c_hash_table_iterator *it;
+    bool rehashed;
+    void *key;
+
+    size_t nb_entries = 1000;
+    size_t nb_iterated;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+    c_hash_table_set_incremental_resize(table, true);
+
+    rehashed = false;
+    for (size_t i = 0; i < nb_entries; i++) {
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+        if (c_hash_table_is_rehashing(table))
+            rehashed = true;
+    }
+
+    TEST_TRUE(rehashed);
+
+    for (size_t i = 0; i < nb_entries; i++)
+        TEST_TRUE(c_hash_table_contains(table, C_INT32_TO_POINTER(i)));
+
+    for (size_t i = 0; i < nb_entries; i += 2)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    nb_iterated = 0;
+    it = c_hash_table_iterate(table);
+    while (c_hash_table_iterator_next(it, &key, NULL) == 1) {
+        TEST_INT_EQ(C_POINTER_TO_INT32(key) % 2, 1);
+        nb_iterated++;
+    }
+    c_hash_table_iterator_delete(it);
+
+    TEST_UINT_EQ(nb_iterated, nb_entries / 2);
+
+    TEST_INT_EQ(c_hash_table_rehash_step(table, SIZE_MAX), 0);
+    TEST_FALSE(c_hash_table_is_rehashing(table));
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), nb_entries / 2);
+
+    c_hash_table_delete(table);
+}
+
+TEST(stats) {
+    struct c_hash_table *table;
+    struct c_hash_table_stats stats;
+    size_t nb_entries;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    c_hash_table_stats(table, &stats);
+    TEST_UINT_EQ(stats.nb_entries, 0);
+    TEST_TRUE(stats.nb_slots > 0);
+    TEST_UINT_EQ(stats.max_probe_length, 0);
+    TEST_UINT_EQ(stats.nb_resizes, 0);
+    TEST_TRUE(stats.memory_size > 0);
+
+    for (int32_t i = 0; i < 10000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    for (int32_t i = 0; i < 10000; i += 3)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    c_hash_table_stats(table, &stats);
+    TEST_UINT_EQ(stats.nb_entries, c_hash_table_nb_entries(table));
+    TEST_TRUE(stats.nb_slots >= stats.nb_entries);
+    TEST_TRUE(stats.load_factor > 0.0 && stats.load_factor < 1.0);
+    TEST_TRUE(stats.max_probe_length >= 1);
+    TEST_TRUE(stats.mean_probe_length >= 1.0);
+    TEST_TRUE(stats.mean_probe_length <= (double)stats.max_probe_length);
+    TEST_TRUE(stats.nb_resizes > 0);
+    TEST_TRUE(stats.memory_size > stats.nb_slots * 2 * sizeof(void *));
+
+    nb_entries = 0;
+    for (size_t i = 0; i < C_HASH_TABLE_PROBE_HISTOGRAM_SZ; i++)
+        nb_entries += stats.probe_lengths[i];
+    TEST_UINT_EQ(nb_entries, stats.nb_entries);
+
+    /* The histogram is kept up to date during incremental resizes */
+    c_hash_table_set_incremental_resize(table, true);
+
+    for (int32_t i = 10000; i < 30000; i++) {
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+        if (i % 2 == 0)
+            c_hash_table_remove(table, C_INT32_TO_POINTER(i - 5000));
+    }
+
+    c_hash_table_stats(table, &stats);
+    TEST_UINT_EQ(stats.nb_entries, c_hash_table_nb_entries(table));
+
+    nb_entries = 0;
+    for (size_t i = 0; i < C_HASH_TABLE_PROBE_HISTOGRAM_SZ; i++)
+        nb_entries += stats.probe_lengths[i];
+    TEST_UINT_EQ(nb_entries, stats.nb_entries);
+
+    c_hash_table_clear(table);
+    c_hash_table_stats(table, &stats);
+    TEST_UINT_EQ(stats.nb_entries, 0);
+    TEST_UINT_EQ(stats.max_probe_length, 0);
+
+    c_hash_table_delete(table);
+}
+
 TEST(iterate) {
     struct c_hash_table *table;
     struct c_hash_table_iterator *it;
@@ -288,6 +609,151 @@ TEST(iterate_remove) {
     c_hash_table_delete(table);
 }
 
+static int
+c_test_sum_values(void *key, void *value, void *arg) {
+    intptr_t *sum;
+
+    sum = arg;
+    *sum += C_POINTER_TO_INT32(value);
+
+    return (C_POINTER_TO_INT32(key) == -1) ? 1 : 0;
+}
+
+static bool
+c_test_is_odd_key(void *key, void *value, void *arg) {
+    return C_POINTER_TO_INT32(key) % 2 == 1;
+}
+
+TEST(iterate_stack) {
+    struct c_hash_table *table;
+    struct c_hash_table_iterator it;
+    void *key, *value;
+    size_t nb_entries;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    for (int32_t i = 0; i < 100; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    nb_entries = 0;
+    c_hash_table_iterator_init(&it, table);
+    while (c_hash_table_iterator_next(&it, &key, &value) == 1) {
+        TEST_INT_EQ(C_POINTER_TO_INT32(key), C_POINTER_TO_INT32(value));
+        nb_entries++;
+    }
+    TEST_UINT_EQ(nb_entries, 100);
+
+    /* The iterator was finished when it reached the end of the table */
+    TEST_INT_EQ(c_hash_table_insert(table, C_INT32_TO_POINTER(100),
+                                    C_INT32_TO_POINTER(100)), 1);
+
+    /* Early exit */
+    c_hash_table_iterator_init(&it, table);
+    TEST_INT_EQ(c_hash_table_iterator_next(&it, &key, &value), 1);
+    c_hash_table_iterator_finish(&it);
+    c_hash_table_iterator_finish(&it);
+    TEST_INT_EQ(c_hash_table_iterator_next(&it, &key, &value), 0);
+
+    /* Removal */
+    c_hash_table_iterator_init(&it, table);
+    while (c_hash_table_iterator_next(&it, &key, &value) == 1) {
+        if (C_POINTER_TO_INT32(key) % 2 == 0)
+            c_hash_table_iterator_remove(&it);
+    }
+
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), 50);
+    for (int32_t i = 0; i <= 100; i++) {
+        TEST_BOOL_EQ(c_hash_table_contains(table, C_INT32_TO_POINTER(i)),
+                     i % 2 == 1);
+    }
+
+    c_hash_table_delete(table);
+}
+
+TEST(foreach) {
+    struct c_hash_table *table;
+    intptr_t sum;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    sum = 0;
+    TEST_INT_EQ(c_hash_table_foreach(table, c_test_sum_values, &sum), 0);
+    TEST_INT_EQ(sum, 0);
+
+    for (int32_t i = 0; i < 100; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    sum = 0;
+    TEST_INT_EQ(c_hash_table_foreach(table, c_test_sum_values, &sum), 0);
+    TEST_INT_EQ(sum, 4950);
+
+    /* The callback stops the iteration when it finds the key -1 */
+    c_hash_table_insert(table, C_INT32_TO_POINTER(-1), C_INT32_TO_POINTER(0));
+    TEST_INT_EQ(c_hash_table_foreach(table, c_test_sum_values, &sum), 1);
+
+    c_hash_table_delete(table);
+}
+
+TEST(foreach_no_resize) {
+    struct c_hash_table *table;
+    size_t capacity;
+    intptr_t sum;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+    for (int32_t i = 0; i < 200; i++)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    /* The table is now under its minimum load, but only removals can
+     * shrink it. */
+    TEST_INT_EQ(c_hash_table_set_load_factors(table, 0.875, 0.4), 0);
+    capacity = c_hash_table_capacity(table);
+
+    for (int n = 0; n < 2; n++) {
+        sum = 0;
+        TEST_INT_EQ(c_hash_table_foreach(table, c_test_sum_values, &sum), 0);
+        TEST_INT_EQ(sum, 479600);
+        TEST_UINT_EQ(c_hash_table_capacity(table), capacity);
+    }
+
+    TEST_UINT_EQ(c_hash_table_remove_if(table, c_test_is_odd_key, NULL), 400);
+    TEST_TRUE(c_hash_table_capacity(table) < capacity);
+
+    c_hash_table_delete(table);
+}
+
+TEST(remove_if) {
+    struct c_hash_table *table;
+
+    table = c_hash_table_new(c_hash_int32, c_equal_int32);
+
+    TEST_UINT_EQ(c_hash_table_remove_if(table, c_test_is_odd_key, NULL), 0);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), C_INT32_TO_POINTER(i));
+
+    TEST_UINT_EQ(c_hash_table_remove_if(table, c_test_is_odd_key, NULL), 500);
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), 500);
+
+    for (int32_t i = 0; i < 1000; i++) {
+        TEST_BOOL_EQ(c_hash_table_contains(table, C_INT32_TO_POINTER(i)),
+                     i % 2 == 0);
+    }
+
+    /* The table can be modified after the iteration */
+    TEST_INT_EQ(c_hash_table_insert(table, C_INT32_TO_POINTER(1),
+                                    C_INT32_TO_POINTER(1)), 1);
+
+    c_hash_table_delete(table);
+}
+
+static int
+c_test_cmp_string_ptrs(const void *p1, const void *p2) {
+    return strcmp(*(const char **)p1, *(const char **)p2);
+}
+
 TEST(keys) {
     struct c_hash_table *table;
 
@@ -305,7 +771,7 @@ TEST(keys) {
         TEST_UINT_EQ(nb_keys, nb_keys_);                                 \
                                                                          \
         qsort(keys, nb_keys, sizeof(const char *),                       \
-              (int (*)(const void *, const void *))strcmp);              \
+              c_test_cmp_string_ptrs);                                   \
         for (size_t i = 0; i < nb_keys; i++)                             \
             TEST_STRING_EQ(keys[i], expected_keys[i]);                   \
                                                                          \
@@ -331,6 +797,170 @@ TEST(keys) {
     c_hash_table_delete(table);
 }
 
+TEST(hash_functions) {
+    struct c_hash_table *table;
+    int64_t i64_keys[] = {0, 1, -1, INT64_MAX, INT64_MIN};
+    int values[3];
+    void *value;
+
+    /* Strings */
+    TEST_UINT_EQ(c_hash_string("foo"), c_hash_memory("foo", 3));
+    TEST_UINT_EQ(c_hash_string("a long string with more than 16 bytes"),
+                 c_hash_memory("a long string with more than 16 bytes", 37));
+    TEST_UINT_EQ(c_hash_string(""), c_hash_memory("", 0));
+    TEST_TRUE(c_hash_memory("foo", 3) != c_hash_memory("foo", 2));
+    TEST_TRUE(c_hash_memory_seeded("foo", 3, 1)
+              != c_hash_memory_seeded("foo", 3, 2));
+
+    c_set_hash_seed(42);
+    TEST_UINT_EQ(c_hash_string_seeded("foo"),
+                 c_hash_memory_seeded("foo", 3, 42));
+    c_set_hash_seed(0);
+
+    /* 32 bit integers */
+    for (int32_t i = 1; i < 1000; i++) {
+        TEST_TRUE(c_hash_int32(C_INT32_TO_POINTER(i))
+                  != c_hash_int32(C_INT32_TO_POINTER(i - 1)));
+    }
+
+    /* 64 bit integers */
+    table = c_hash_table_new(c_hash_int64, c_equal_int64);
+
+    for (size_t i = 0; i < sizeof(i64_keys) / sizeof(i64_keys[0]); i++)
+        c_hash_table_insert(table, i64_keys + i, C_INT32_TO_POINTER(i));
+
+    for (size_t i = 0; i < sizeof(i64_keys) / sizeof(i64_keys[0]); i++) {
+        int64_t key;
+
+        key = i64_keys[i];
+        TEST_INT_EQ(c_hash_table_get(table, &key, &value), 1);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), i);
+    }
+
+    c_hash_table_delete(table);
+
+    /* Pointers */
+    table = c_hash_table_new(c_hash_pointer, c_equal_pointer);
+
+    for (size_t i = 0; i < 3; i++)
+        c_hash_table_insert(table, values + i, C_INT32_TO_POINTER(i));
+
+    TEST_INT_EQ(c_hash_table_get(table, values + 1, &value), 1);
+    TEST_INT_EQ(C_POINTER_TO_INT32(value), 1);
+    TEST_FALSE(c_hash_table_contains(table, values + 3));
+
+    c_hash_table_delete(table);
+}
+
+struct c_test_allocator_data {
+    size_t nb_allocations;
+    size_t size; /* bytes currently allocated */
+};
+
+static void *
+c_test_allocator_malloc(void *arg, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->nb_allocations++;
+    data->size += sz;
+
+    return malloc(sz);
+}
+
+static void
+c_test_allocator_free(void *arg, void *ptr, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->size -= sz;
+
+    free(ptr);
+}
+
+static void *
+c_test_allocator_realloc(void *arg, void *ptr, size_t old_sz, size_t sz) {
+    struct c_test_allocator_data *data;
+
+    data = arg;
+    data->nb_allocations++;
+    data->size += sz - old_sz;
+
+    return realloc(ptr, sz);
+}
+
+static void
+c_test_allocator_init(struct c_allocator *allocator,
+                      struct c_test_allocator_data *data) {
+    memset(data, 0, sizeof(struct c_test_allocator_data));
+
+    allocator->malloc = c_test_allocator_malloc;
+    allocator->free = c_test_allocator_free;
+    allocator->realloc = c_test_allocator_realloc;
+    allocator->aligned_alloc = NULL;
+    allocator->aligned_free = NULL;
+    allocator->data = data;
+}
+
+TEST(allocator) {
+    struct c_allocator allocator;
+    struct c_test_allocator_data data;
+    struct c_hash_table *table;
+
+    c_test_allocator_init(&allocator, &data);
+
+    table = c_hash_table_new_with_allocator(c_hash_int32, c_equal_int32,
+                                            &allocator);
+    TEST_PTR_NOT_NULL(table);
+    TEST_UINT_EQ(data.nb_allocations, 2);
+
+    for (int32_t i = 0; i < 10000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), NULL);
+    TEST_TRUE(data.nb_allocations > 2);
+
+    for (int32_t i = 0; i < 10000; i++)
+        c_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    c_hash_table_clear(table);
+    c_hash_table_delete(table);
+
+    /* All sizes passed to free() match allocated sizes */
+    TEST_UINT_EQ(data.size, 0);
+}
+
+TEST(alignment) {
+    struct c_allocator allocator;
+    struct c_test_allocator_data data;
+    struct c_hash_table *table;
+    void *value;
+
+    c_test_allocator_init(&allocator, &data);
+
+    table = c_hash_table_new_with_allocator(c_hash_int32, c_equal_int32,
+                                            &allocator);
+    TEST_PTR_NOT_NULL(table);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), NULL);
+
+    TEST_INT_EQ(c_hash_table_set_alignment(table, 64), 0);
+    TEST_INT_EQ(c_hash_table_set_alignment(table, 48), -1);
+
+    for (int32_t i = 1000; i < 10000; i++)
+        c_hash_table_insert(table, C_INT32_TO_POINTER(i), NULL);
+
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), 10000);
+    for (int32_t i = 0; i < 10000; i++)
+        TEST_TRUE(c_hash_table_get(table, C_INT32_TO_POINTER(i), &value));
+
+    TEST_INT_EQ(c_hash_table_set_alignment(table, 0), 0);
+    TEST_UINT_EQ(c_hash_table_nb_entries(table), 10000);
+
+    c_hash_table_delete(table);
+
+    TEST_UINT_EQ(data.size, 0);
+}
+
 int
 main(int argc, char **argv) {
     struct test_suite *suite;
@@ -342,14 +972,29 @@ main(int argc, char **argv) {
 
     TEST_RUN(suite, insert);
     TEST_RUN(suite, insert2);
+    TEST_RUN(suite, get_with_hash);
+    TEST_RUN(suite, get_many);
     TEST_RUN(suite, remove);
     TEST_RUN(suite, remove2);
     TEST_RUN(suite, clear);
     TEST_RUN(suite, resize);
+    TEST_RUN(suite, remove_insert);
+    TEST_RUN(suite, capacity);
+    TEST_RUN(suite, reserved_capacity);
+    TEST_RUN(suite, load_factors);
+    TEST_RUN(suite, incremental_resize);
+    TEST_RUN(suite, stats);
     TEST_RUN(suite, iterate);
     TEST_RUN(suite, iterate_set_value);
     TEST_RUN(suite, iterate_remove);
+    TEST_RUN(suite, iterate_stack);
+    TEST_RUN(suite, foreach);
+    TEST_RUN(suite, foreach_no_resize);
+    TEST_RUN(suite, remove_if);
     TEST_RUN(suite, keys);
+    TEST_RUN(suite, hash_functions);
+    TEST_RUN(suite, allocator);
+    TEST_RUN(suite, alignment);
 
     test_suite_print_results_and_exit(suite);
 }
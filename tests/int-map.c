@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+TEST(int32_insert) {
+    struct c_int32_map *map;
+    uint64_t value, *pvalue;
+
+    map = c_int32_map_new(sizeof(uint64_t));
+
+    TEST_TRUE(c_int32_map_is_empty(map));
+
+    value = 1;
+    TEST_INT_EQ(c_int32_map_insert(map, 1, &value), 1);
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 1);
+
+    value = 2;
+    TEST_INT_EQ(c_int32_map_insert(map, -2, &value), 1);
+    value = 3;
+    TEST_INT_EQ(c_int32_map_insert(map, 0, &value), 1);
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 3);
+
+    pvalue = c_int32_map_get(map, -2);
+    TEST_PTR_NOT_NULL(pvalue);
+    TEST_UINT_EQ(*pvalue, 2);
+
+    value = 42;
+    TEST_INT_EQ(c_int32_map_insert(map, 0, &value), 0);
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 3);
+    pvalue = c_int32_map_get(map, 0);
+    TEST_PTR_NOT_NULL(pvalue);
+    TEST_UINT_EQ(*pvalue, 42);
+
+    TEST_PTR_NULL(c_int32_map_get(map, 2));
+    TEST_FALSE(c_int32_map_contains(map, 2));
+    TEST_TRUE(c_int32_map_contains(map, 1));
+
+    c_int32_map_delete(map);
+}
+
+TEST(int32_get_or_insert) {
+    struct c_int32_map *map;
+    uint32_t *counter;
+    bool inserted;
+
+    map = c_int32_map_new(sizeof(uint32_t));
+
+    for (int32_t i = 0; i < 1000; i++) {
+        counter = c_int32_map_get_or_insert(map, i % 10, &inserted);
+        TEST_PTR_NOT_NULL(counter);
+        TEST_TRUE(inserted == (i < 10));
+
+        (*counter)++;
+    }
+
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 10);
+
+    for (int32_t i = 0; i < 10; i++) {
+        counter = c_int32_map_get(map, i);
+        TEST_PTR_NOT_NULL(counter);
+        TEST_UINT_EQ(*counter, 100);
+    }
+
+    c_int32_map_delete(map);
+}
+
+TEST(int32_remove) {
+    struct c_int32_map *map;
+    uint16_t value;
+
+    map = c_int32_map_new(sizeof(uint16_t));
+
+    for (int32_t i = 0; i < 1000; i++) {
+        value = (uint16_t)i;
+        TEST_INT_EQ(c_int32_map_insert(map, i, &value), 1);
+    }
+
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 1000);
+
+    for (int32_t i = 0; i < 1000; i += 2) {
+        TEST_INT_EQ(c_int32_map_remove(map, i, &value), 1);
+        TEST_UINT_EQ(value, i);
+    }
+
+    TEST_UINT_EQ(c_int32_map_nb_entries(map), 500);
+    TEST_INT_EQ(c_int32_map_remove(map, 0, NULL), 0);
+
+    for (int32_t i = 0; i < 1000; i++) {
+        uint16_t *pvalue;
+
+        pvalue = c_int32_map_get(map, i);
+
+        if (i % 2 == 0) {
+            TEST_PTR_NULL(pvalue);
+        } else {
+            TEST_PTR_NOT_NULL(pvalue);
+            TEST_UINT_EQ(*pvalue, i);
+        }
+    }
+
+    for (int32_t i = 1; i < 1000; i += 2)
+        TEST_INT_EQ(c_int32_map_remove(map, i, NULL), 1);
+
+    TEST_TRUE(c_int32_map_is_empty(map));
+
+    c_int32_map_delete(map);
+}
+
+TEST(int64_insert) {
+    struct c_int64_map *map;
+    uint64_t value, *pvalue;
+
+    map = c_int64_map_new(sizeof(uint64_t));
+
+    for (int64_t i = 0; i < 10000; i++) {
+        value = (uint64_t)i * 3;
+        TEST_INT_EQ(c_int64_map_insert(map, i << 32, &value), 1);
+    }
+
+    TEST_UINT_EQ(c_int64_map_nb_entries(map), 10000);
+
+    for (int64_t i = 0; i < 10000; i++) {
+        pvalue = c_int64_map_get(map, i << 32);
+        TEST_PTR_NOT_NULL(pvalue);
+        TEST_UINT_EQ(*pvalue, i * 3);
+
+        TEST_FALSE(c_int64_map_contains(map, (i << 32) + 1));
+    }
+
+    value = 1;
+    TEST_INT_EQ(c_int64_map_insert(map, INT64_MIN, &value), 1);
+    TEST_TRUE(c_int64_map_contains(map, INT64_MIN));
+
+    c_int64_map_delete(map);
+}
+
+TEST(int64_clear) {
+    struct c_int64_map *map;
+    uint8_t value;
+
+    map = c_int64_map_new(sizeof(uint8_t));
+
+    value = 1;
+    for (int64_t i = 0; i < 100; i++)
+        c_int64_map_insert(map, i, &value);
+
+    c_int64_map_clear(map);
+    TEST_TRUE(c_int64_map_is_empty(map));
+    TEST_FALSE(c_int64_map_contains(map, 1));
+
+    c_int64_map_insert(map, 1, &value);
+    TEST_UINT_EQ(c_int64_map_nb_entries(map), 1);
+    TEST_TRUE(c_int64_map_contains(map, 1));
+
+    c_int64_map_delete(map);
+}
+
+TEST(int64_reserve) {
+    struct c_int64_map *map;
+    size_t capacity;
+    uint64_t value;
+
+    map = c_int64_map_new(sizeof(uint64_t));
+
+    TEST_INT_EQ(c_int64_map_reserve(map, 1000), 0);
+    capacity = c_int64_map_capacity(map);
+    TEST_TRUE(capacity >= 1000);
+
+    for (int64_t i = 0; i < 1000; i++) {
+        value = (uint64_t)i;
+        c_int64_map_insert(map, i, &value);
+    }
+
+    TEST_UINT_EQ(c_int64_map_capacity(map), capacity);
+
+    /* Removing entries does not shrink the map below the reserved
+     * capacity */
+    for (int64_t i = 0; i < 1000; i++)
+        c_int64_map_remove(map, i, NULL);
+
+    TEST_UINT_EQ(c_int64_map_nb_entries(map), 0);
+    TEST_UINT_EQ(c_int64_map_capacity(map), capacity);
+
+    c_int64_map_delete(map);
+}
+
+TEST(int64_iterate) {
+    struct c_int64_map *map;
+    struct c_int64_map_iterator it;
+    int64_t key, sum;
+    uint64_t value;
+    void *pvalue;
+    size_t nb_entries;
+
+    map = c_int64_map_new(sizeof(uint64_t));
+
+    c_int64_map_iterator_init(&it, map);
+    TEST_INT_EQ(c_int64_map_iterator_next(&it, &key, &pvalue), 0);
+
+    for (int64_t i = 1; i <= 100; i++) {
+        value = (uint64_t)i * 2;
+        c_int64_map_insert(map, i, &value);
+    }
+
+    nb_entries = 0;
+    sum = 0;
+
+    c_int64_map_iterator_init(&it, map);
+    while (c_int64_map_iterator_next(&it, &key, &pvalue) == 1) {
+        TEST_UINT_EQ(*(uint64_t *)pvalue, key * 2);
+
+        *(uint64_t *)pvalue = 0;
+
+        sum += key;
+        nb_entries++;
+    }
+
+    TEST_UINT_EQ(nb_entries, 100);
+    TEST_INT_EQ(sum, 5050);
+
+    TEST_INT_EQ(c_int64_map_iterator_next(&it, &key, &pvalue), 0);
+
+    TEST_UINT_EQ(*(uint64_t *)c_int64_map_get(map, 42), 0);
+
+    c_int64_map_delete(map);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("int-map");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, int32_insert);
+    TEST_RUN(suite, int32_get_or_insert);
+    TEST_RUN(suite, int32_remove);
+    TEST_RUN(suite, int64_insert);
+    TEST_RUN(suite, int64_clear);
+    TEST_RUN(suite, int64_reserve);
+    TEST_RUN(suite, int64_iterate);
+
+    test_suite_print_results_and_exit(suite);
+}
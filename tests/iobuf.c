@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <unistd.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define C_TEST_IOBUF_EQ(iobuf_, data_, sz_)                                \
+    do {                                                                   \
+        char tmp__[1024];                                                  \
+        size_t sz__;                                                       \
+                                                                           \
+        sz__ = c_iobuf_copy(iobuf_, tmp__, sizeof(tmp__));                 \
+        TEST_UINT_EQ(c_iobuf_length(iobuf_), sz_);                         \
+        TEST_UINT_EQ(sz__, sz_);                                           \
+        TEST_MEM_EQ(tmp__, sz__, data_, sz_);                              \
+    } while (0)
+
+TEST(add) {
+    struct c_iobuf *iobuf;
+
+    iobuf = c_iobuf_new(8);
+    TEST_PTR_NOT_NULL(iobuf);
+    TEST_TRUE(c_iobuf_is_empty(iobuf));
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 0);
+
+    c_iobuf_add(iobuf, "abc", 3);
+    C_TEST_IOBUF_EQ(iobuf, "abc", 3);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 1);
+
+    c_iobuf_add(iobuf, "defghijklmnopqrstu", 18);
+    C_TEST_IOBUF_EQ(iobuf, "abcdefghijklmnopqrstu", 21);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 3);
+
+    c_iobuf_clear(iobuf);
+    TEST_TRUE(c_iobuf_is_empty(iobuf));
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 0);
+
+    c_iobuf_delete(iobuf);
+}
+
+TEST(skip) {
+    struct c_iobuf *iobuf;
+    char tmp[32];
+
+    iobuf = c_iobuf_new(8);
+
+    c_iobuf_add(iobuf, "abcdefghijklmnopqrstu", 21);
+
+    TEST_UINT_EQ(c_iobuf_skip(iobuf, 2), 2);
+    C_TEST_IOBUF_EQ(iobuf, "cdefghijklmnopqrstu", 19);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 3);
+
+    TEST_UINT_EQ(c_iobuf_skip(iobuf, 6), 6);
+    C_TEST_IOBUF_EQ(iobuf, "ijklmnopqrstu", 13);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 2);
+
+    TEST_UINT_EQ(c_iobuf_remove(iobuf, tmp, 10), 10);
+    TEST_MEM_EQ(tmp, 10, "ijklmnopqr", 10);
+    C_TEST_IOBUF_EQ(iobuf, "stu", 3);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 1);
+
+    TEST_UINT_EQ(c_iobuf_skip(iobuf, 10), 3);
+    TEST_TRUE(c_iobuf_is_empty(iobuf));
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf), 0);
+
+    c_iobuf_add(iobuf, "abc", 3);
+    C_TEST_IOBUF_EQ(iobuf, "abc", 3);
+
+    c_iobuf_delete(iobuf);
+}
+
+TEST(buffers) {
+    struct c_iobuf *iobuf;
+    struct c_buffer *buf;
+
+    iobuf = c_iobuf_new(4);
+    buf = c_buffer_new();
+
+    c_buffer_add_string(buf, "hello world");
+    c_iobuf_add_buffer(iobuf, buf);
+    C_TEST_IOBUF_EQ(iobuf, "hello world", 11);
+
+    c_buffer_clear(buf);
+    c_buffer_add_string(buf, "> ");
+    TEST_INT_EQ(c_iobuf_to_buffer(iobuf, buf), 0);
+    TEST_UINT_EQ(c_buffer_length(buf), 13);
+    TEST_MEM_EQ(c_buffer_data(buf), 13, "> hello world", 13);
+
+    c_buffer_delete(buf);
+    c_iobuf_delete(iobuf);
+}
+
+TEST(iovecs) {
+    struct c_iobuf *iobuf;
+    struct iovec iovecs[2];
+
+    iobuf = c_iobuf_new(4);
+    c_iobuf_add(iobuf, "abcdefghij", 10);
+    c_iobuf_skip(iobuf, 1);
+
+    TEST_INT_EQ(c_iobuf_iovecs(iobuf, iovecs, 2), 2);
+    TEST_MEM_EQ(iovecs[0].iov_base, iovecs[0].iov_len, "bcd", 3);
+    TEST_MEM_EQ(iovecs[1].iov_base, iovecs[1].iov_len, "efgh", 4);
+
+    c_iobuf_delete(iobuf);
+}
+
+TEST(read_write) {
+    struct c_iobuf *iobuf, *iobuf2;
+    char data[4000], tmp[4000];
+    int fds[2];
+    size_t len;
+    ssize_t ret;
+
+    if (pipe(fds) == -1)
+        TEST_ABORT("cannot create pipe: %s", strerror(errno));
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (char)('a' + i % 26);
+
+    iobuf = c_iobuf_new(64);
+    iobuf2 = c_iobuf_new(100);
+
+    c_iobuf_add(iobuf, data, sizeof(data));
+
+    ret = c_iobuf_write(iobuf, fds[1]);
+    TEST_INT_EQ(ret, sizeof(data));
+    TEST_TRUE(c_iobuf_is_empty(iobuf));
+
+    /* The first read only partially fills the last segment */
+    ret = c_iobuf_read(iobuf2, fds[0], 150);
+    TEST_INT_EQ(ret, 150);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf2), 2);
+
+    /* Each read fills the end of the last segment and at most 4 new
+     * segments */
+    ret = c_iobuf_read(iobuf2, fds[0], 10000);
+    TEST_INT_EQ(ret, 50 + 4 * 100);
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf2), 6);
+
+    len = 150 + 450;
+    while (len < sizeof(data)) {
+        ret = c_iobuf_read(iobuf2, fds[0], 10000);
+        TEST_TRUE(ret > 0 && ret <= 400);
+        len += (size_t)ret;
+    }
+
+    TEST_UINT_EQ(c_iobuf_length(iobuf2), sizeof(data));
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf2), 40);
+
+    TEST_UINT_EQ(c_iobuf_copy(iobuf2, tmp, sizeof(tmp)), sizeof(tmp));
+    TEST_MEM_EQ(tmp, sizeof(tmp), data, sizeof(data));
+
+    close(fds[1]);
+
+    ret = c_iobuf_read(iobuf2, fds[0], 100);
+    TEST_INT_EQ(ret, 0);
+    TEST_UINT_EQ(c_iobuf_length(iobuf2), sizeof(data));
+    TEST_UINT_EQ(c_iobuf_nb_segments(iobuf2), 40);
+
+    close(fds[0]);
+
+    c_iobuf_delete(iobuf);
+    c_iobuf_delete(iobuf2);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("iobuf");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, add);
+    TEST_RUN(suite, skip);
+    TEST_RUN(suite, buffers);
+    TEST_RUN(suite, iovecs);
+    TEST_RUN(suite, read_write);
+
+    test_suite_print_results_and_exit(suite);
+}
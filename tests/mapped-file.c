@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <unistd.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_DATA_SIZE 100000
+
+static char test_data[TEST_DATA_SIZE];
+
+static int test_create_file(char *, const void *, size_t);
+
+TEST(whole_file) {
+    char path[] = "/tmp/libcore-test-XXXXXX";
+    struct c_mapped_file *file;
+
+    if (test_create_file(path, test_data, TEST_DATA_SIZE) == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    file = c_mapped_file_open(path, 0);
+    if (!file)
+        TEST_ABORT("cannot map file: %s", c_get_error());
+
+    TEST_UINT_EQ(c_mapped_file_size(file), TEST_DATA_SIZE);
+    TEST_UINT_EQ(c_mapped_file_offset(file), 0);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data, TEST_DATA_SIZE);
+
+    TEST_INT_EQ(c_mapped_file_seek(file, 50000), 0);
+    TEST_UINT_EQ(c_mapped_file_offset(file), 50000);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data + 50000, TEST_DATA_SIZE - 50000);
+
+    TEST_INT_EQ(c_mapped_file_seek(file, TEST_DATA_SIZE), 0);
+    TEST_UINT_EQ(c_mapped_file_length(file), 0);
+
+    TEST_INT_EQ(c_mapped_file_seek(file, TEST_DATA_SIZE + 1), -1);
+    TEST_UINT_EQ(c_mapped_file_offset(file), TEST_DATA_SIZE);
+
+    c_mapped_file_delete(file);
+    unlink(path);
+}
+
+TEST(window) {
+    char path[] = "/tmp/libcore-test-XXXXXX";
+    struct c_mapped_file *file;
+
+    if (test_create_file(path, test_data, TEST_DATA_SIZE) == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    file = c_mapped_file_open(path, 10000);
+    if (!file)
+        TEST_ABORT("cannot map file: %s", c_get_error());
+
+    TEST_UINT_EQ(c_mapped_file_size(file), TEST_DATA_SIZE);
+    TEST_UINT_EQ(c_mapped_file_window_size(file), 10000);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data, 10000);
+
+    /* Windows do not have to start on a page boundary */
+    TEST_INT_EQ(c_mapped_file_advance(file, 12345), 0);
+    TEST_UINT_EQ(c_mapped_file_offset(file), 12345);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data + 12345, 10000);
+
+    /* Moving backward inside the current mapping */
+    TEST_INT_EQ(c_mapped_file_seek(file, 12400), 0);
+    TEST_INT_EQ(c_mapped_file_seek(file, 12300), 0);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data + 12300, 10000);
+
+    /* The last window is shorter */
+    TEST_INT_EQ(c_mapped_file_seek(file, 95000), 0);
+    TEST_MEM_EQ(c_mapped_file_data(file), c_mapped_file_length(file),
+                test_data + 95000, 5000);
+
+    TEST_INT_EQ(c_mapped_file_advance(file, 5001), -1);
+    TEST_INT_EQ(c_mapped_file_advance(file, 5000), 0);
+    TEST_UINT_EQ(c_mapped_file_length(file), 0);
+
+    c_mapped_file_delete(file);
+    unlink(path);
+}
+
+TEST(empty_file) {
+    char path[] = "/tmp/libcore-test-XXXXXX";
+    struct c_mapped_file *file;
+
+    if (test_create_file(path, NULL, 0) == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    file = c_mapped_file_open(path, 0);
+    if (!file)
+        TEST_ABORT("cannot map file: %s", c_get_error());
+
+    TEST_UINT_EQ(c_mapped_file_size(file), 0);
+    TEST_UINT_EQ(c_mapped_file_length(file), 0);
+    TEST_PTR_NULL(c_mapped_file_data(file));
+
+    c_mapped_file_delete(file);
+    unlink(path);
+}
+
+TEST(invalid_file) {
+    int fds[2];
+
+    TEST_PTR_NULL(c_mapped_file_open("/nonexistent", 0));
+
+    if (pipe(fds) == -1)
+        TEST_ABORT("cannot create pipe: %s", strerror(errno));
+
+    TEST_PTR_NULL(c_mapped_file_new(fds[0], 0));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(text) {
+    const char *text = "foo \xc3\xa9t\xc3\xa9 \xe2\x82\xac bar";
+    char path[] = "/tmp/libcore-test-XXXXXX";
+    struct c_mapped_file *file;
+    const char *data, *ptr;
+    size_t len, count;
+
+    if (test_create_file(path, text, strlen(text)) == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    file = c_mapped_file_open(path, 0);
+    if (!file)
+        TEST_ABORT("cannot map file: %s", c_get_error());
+
+    data = c_mapped_file_data(file);
+    len = c_mapped_file_length(file);
+
+    ptr = c_memory_search_string(data, len, "bar");
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_UINT_EQ((size_t)(ptr - data), 14);
+
+    TEST_INT_EQ(c_utf8_nb_codepoints_n(data, len, &count), 0);
+    TEST_UINT_EQ(count, 13);
+
+    c_mapped_file_delete(file);
+    unlink(path);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    for (size_t i = 0; i < TEST_DATA_SIZE; i++)
+        test_data[i] = (char)(i % 251);
+
+    suite = test_suite_new("mapped-file");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, whole_file);
+    TEST_RUN(suite, window);
+    TEST_RUN(suite, empty_file);
+    TEST_RUN(suite, invalid_file);
+    TEST_RUN(suite, text);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static int
+test_create_file(char *path, const void *data, size_t sz) {
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd == -1)
+        return -1;
+
+    if (sz > 0 && write(fd, data, sz) != (ssize_t)sz) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
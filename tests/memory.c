@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_NB_THREADS  8
+#define TEST_NB_BLOCKS   1000
+#define TEST_NB_ROUNDS   100
+#define TEST_SAMPLING_INTERVAL 16
+
+struct test_thread {
+    int nb_errors;
+};
+
+struct test_allocator_data {
+    size_t nb_aligned_allocations;
+    size_t size; /* bytes currently allocated */
+};
+
+static void *test_thread_main(void *);
+
+static void test_allocator_init(struct c_allocator *,
+                                struct test_allocator_data *);
+static void *test_allocator_malloc(void *, size_t);
+static void test_allocator_free(void *, void *, size_t);
+static void *test_allocator_realloc(void *, void *, size_t, size_t);
+static void *test_allocator_aligned_alloc(void *, size_t, size_t);
+
+TEST(malloc) {
+    struct c_memory_cache_stats stats, stats2;
+    void *ptr, *ptr2;
+
+    c_memory_cache_stats(&stats);
+
+    ptr = c_malloc(24);
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_UINT_EQ((uintptr_t)ptr % 16, 0);
+    memset(ptr, 0xff, 24);
+    c_free(ptr);
+
+    /* The block is reused for an allocation of the same size class */
+    ptr2 = c_malloc(32);
+    TEST_TRUE(ptr2 == ptr);
+    c_free(ptr2);
+
+    c_memory_cache_stats(&stats2);
+    TEST_TRUE(stats2.nb_hits > stats.nb_hits);
+
+    ptr = c_malloc0(100);
+    for (size_t i = 0; i < 100; i++)
+        TEST_UINT_EQ(((uint8_t *)ptr)[i], 0);
+    c_free(ptr);
+
+    ptr = c_calloc(10, 40);
+    for (size_t i = 0; i < 400; i++)
+        TEST_UINT_EQ(((uint8_t *)ptr)[i], 0);
+    c_free(ptr);
+
+    c_free(NULL);
+}
+
+TEST(size_classes) {
+    uint8_t *ptrs[5000];
+
+    for (size_t i = 0; i < 5000; i++) {
+        ptrs[i] = c_malloc(i);
+        TEST_PTR_NOT_NULL(ptrs[i]);
+        memset(ptrs[i], (int)(i % 256), i);
+    }
+
+    for (size_t i = 0; i < 5000; i++) {
+        for (size_t j = 0; j < i; j++)
+            TEST_UINT_EQ(ptrs[i][j], i % 256);
+
+        c_free(ptrs[i]);
+    }
+}
+
+TEST(realloc) {
+    uint8_t *ptr;
+
+    ptr = c_realloc(NULL, 10);
+    for (size_t i = 0; i < 10; i++)
+        ptr[i] = (uint8_t)i;
+
+    /* Growing across size classes and beyond */
+    for (size_t sz = 20; sz < 100000; sz *= 2) {
+        ptr = c_realloc(ptr, sz);
+        TEST_PTR_NOT_NULL(ptr);
+
+        for (size_t i = 0; i < 10; i++)
+            TEST_UINT_EQ(ptr[i], i);
+    }
+
+    ptr = c_realloc(ptr, 5);
+    for (size_t i = 0; i < 5; i++)
+        TEST_UINT_EQ(ptr[i], i);
+
+    c_free(ptr);
+}
+
+TEST(depot) {
+    struct c_memory_cache_stats stats, stats2;
+    void *ptrs[TEST_NB_BLOCKS];
+
+    c_memory_cache_stats(&stats);
+
+    /* Releasing many blocks fills magazines which are moved to the depot */
+    for (size_t i = 0; i < TEST_NB_BLOCKS; i++)
+        ptrs[i] = c_malloc(64);
+    for (size_t i = 0; i < TEST_NB_BLOCKS; i++)
+        c_free(ptrs[i]);
+
+    c_memory_cache_stats(&stats2);
+    TEST_TRUE(stats2.nb_depot_puts > stats.nb_depot_puts);
+
+    for (size_t i = 0; i < TEST_NB_BLOCKS; i++)
+        ptrs[i] = c_malloc(64);
+    for (size_t i = 0; i < TEST_NB_BLOCKS; i++)
+        c_free(ptrs[i]);
+
+    c_memory_cache_stats(&stats);
+    TEST_TRUE(stats.nb_depot_gets > stats2.nb_depot_gets);
+
+    c_memory_flush_thread_cache();
+}
+
+TEST(stats) {
+    struct c_memory_stats stats, stats2;
+    uint8_t *ptr;
+    size_t idx;
+    FILE *file;
+
+    c_memory_stats(&stats);
+
+    ptr = c_malloc(40);
+    TEST_PTR_NOT_NULL(ptr);
+    memset(ptr, 0xff, 40);
+
+    c_memory_stats(&stats2);
+    TEST_UINT_EQ(stats2.live_size, stats.live_size + 40);
+    TEST_UINT_EQ(stats2.nb_allocations, stats.nb_allocations + 1);
+    TEST_TRUE(stats2.peak_live_size >= stats2.live_size);
+
+    idx = C_MEMORY_STATS_NB_SIZE_CLASSES;
+    for (size_t i = 0; i < C_MEMORY_STATS_NB_SIZE_CLASSES; i++) {
+        if (stats2.size_classes[i].size >= 40) {
+            idx = i;
+            break;
+        }
+    }
+
+    TEST_UINT_EQ(stats2.size_classes[idx].size, 48);
+    TEST_UINT_EQ(stats2.size_classes[idx].nb_allocations,
+                 stats.size_classes[idx].nb_allocations + 1);
+
+    /* Growing out of the size class copies the data */
+    ptr = c_realloc(ptr, 5000);
+    TEST_PTR_NOT_NULL(ptr);
+
+    c_memory_stats(&stats);
+    TEST_UINT_EQ(stats.live_size, stats2.live_size + 5000 - 40);
+    TEST_UINT_EQ(stats.nb_reallocs, stats2.nb_reallocs + 1);
+    TEST_UINT_EQ(stats.realloc_copy_size, stats2.realloc_copy_size + 40);
+    TEST_TRUE(stats.peak_live_size >= stats.live_size);
+
+    c_free(ptr);
+
+    c_memory_stats(&stats2);
+    TEST_UINT_EQ(stats2.live_size, stats.live_size - 5000);
+    TEST_UINT_EQ(stats2.nb_frees, stats.nb_frees + 1);
+
+    /* Sampling counters are per thread */
+    for (size_t i = 0; i < TEST_SAMPLING_INTERVAL * 4; i++)
+        c_free(c_malloc(i + 1));
+
+    c_memory_stats(&stats);
+    TEST_UINT_EQ(stats.nb_samples, stats2.nb_samples + 4);
+    TEST_UINT_EQ(stats.live_size, stats2.live_size);
+
+    file = fopen("/dev/null", "w");
+    if (!file)
+        TEST_ABORT("cannot open /dev/null: %s", strerror(errno));
+
+    c_memory_print_stats(file);
+    fclose(file);
+}
+
+TEST(aligned) {
+    size_t alignments[] = {8, 16, 64, 4096};
+    size_t sz;
+    uint8_t *ptr;
+
+    for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+        ptr = c_aligned_alloc(alignments[i], 100);
+        TEST_PTR_NOT_NULL(ptr);
+        TEST_UINT_EQ((uintptr_t)ptr % alignments[i], 0);
+        memset(ptr, 0xff, 100);
+        c_aligned_free(ptr, 100);
+    }
+
+    TEST_PTR_NULL(c_aligned_alloc(24, 100));
+
+    /* Large blocks are mapped on huge page boundaries */
+    sz = 16 * 1024 * 1024;
+
+    ptr = c_aligned_alloc(64, sz);
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_UINT_EQ((uintptr_t)ptr % (2 * 1024 * 1024), 0);
+    memset(ptr, 0xff, sz);
+    c_aligned_free(ptr, sz);
+
+    /* The threshold cannot change once aligned blocks have been allocated,
+     * setting the current value again is harmless */
+    TEST_INT_EQ(c_memory_set_huge_page_threshold(0), -1);
+    TEST_INT_EQ(c_memory_set_huge_page_threshold(8 * 1024 * 1024), 0);
+}
+
+TEST(allocator_aligned) {
+    struct c_allocator allocator;
+    struct test_allocator_data data;
+    struct c_vector *vector;
+    uint64_t value;
+
+    /* An allocator without aligned_free cannot release blocks allocated
+     * with its aligned_alloc function, so neither of them is used. */
+    test_allocator_init(&allocator, &data);
+    allocator.aligned_alloc = test_allocator_aligned_alloc;
+
+    vector = c_vector_new_with_allocator(sizeof(uint64_t), &allocator);
+    TEST_PTR_NOT_NULL(vector);
+    TEST_INT_EQ(c_vector_set_alignment(vector, 64), 0);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        value = i;
+        TEST_INT_EQ(c_vector_append(vector, &value), 0);
+        TEST_UINT_EQ((uintptr_t)c_vector_entries(vector) % 64, 0);
+    }
+
+    TEST_UINT_EQ(*(uint64_t *)c_vector_entry(vector, 999), 999);
+
+    c_vector_delete(vector);
+
+    TEST_UINT_EQ(data.nb_aligned_allocations, 0);
+    TEST_UINT_EQ(data.size, 0);
+}
+
+TEST(threads) {
+    struct test_thread threads[TEST_NB_THREADS];
+    pthread_t thread_ids[TEST_NB_THREADS];
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        threads[i].nb_errors = 0;
+
+        if (pthread_create(&thread_ids[i], NULL, test_thread_main,
+                           &threads[i]) != 0) {
+            TEST_ABORT("cannot create thread");
+        }
+    }
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        pthread_join(thread_ids[i], NULL);
+        TEST_INT_EQ(threads[i].nb_errors, 0);
+    }
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    if (c_memory_enable_thread_cache() == -1) {
+        fprintf(stderr, "cannot enable thread cache: %s\n", c_get_error());
+        exit(1);
+    }
+
+    if (c_memory_enable_stats(TEST_SAMPLING_INTERVAL) == -1) {
+        fprintf(stderr, "cannot enable memory statistics: %s\n",
+                c_get_error());
+        exit(1);
+    }
+
+    suite = test_suite_new("memory");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, malloc);
+    TEST_RUN(suite, size_classes);
+    TEST_RUN(suite, realloc);
+    TEST_RUN(suite, depot);
+    TEST_RUN(suite, stats);
+    TEST_RUN(suite, aligned);
+    TEST_RUN(suite, allocator_aligned);
+    TEST_RUN(suite, threads);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static void *
+test_thread_main(void *arg) {
+    struct test_thread *thread;
+    uint8_t *blocks[TEST_NB_BLOCKS];
+    uint64_t rng;
+
+    thread = arg;
+    rng = (uintptr_t)thread;
+
+    for (int round = 0; round < TEST_NB_ROUNDS; round++) {
+        for (size_t i = 0; i < TEST_NB_BLOCKS; i++) {
+            size_t sz;
+
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            sz = (size_t)(rng >> 33) % 3000 + 1;
+
+            blocks[i] = c_malloc(sz);
+            if (!blocks[i]) {
+                thread->nb_errors++;
+                return NULL;
+            }
+
+            blocks[i][0] = (uint8_t)i;
+            blocks[i][sz - 1] = (uint8_t)i;
+        }
+
+        for (size_t i = 0; i < TEST_NB_BLOCKS; i++) {
+            if (blocks[i][0] != (uint8_t)i)
+                thread->nb_errors++;
+
+            c_free(blocks[i]);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_allocator_init(struct c_allocator *allocator,
+                    struct test_allocator_data *data) {
+    memset(data, 0, sizeof(struct test_allocator_data));
+
+    allocator->malloc = test_allocator_malloc;
+    allocator->free = test_allocator_free;
+    allocator->realloc = test_allocator_realloc;
+    allocator->aligned_alloc = NULL;
+    allocator->aligned_free = NULL;
+    allocator->data = data;
+}
+
+static void *
+test_allocator_malloc(void *arg, size_t sz) {
+    struct test_allocator_data *data;
+
+    data = arg;
+    data->size += sz;
+
+    return malloc(sz);
+}
+
+static void
+test_allocator_free(void *arg, void *ptr, size_t sz) {
+    struct test_allocator_data *data;
+
+    data = arg;
+    data->size -= sz;
+
+    free(ptr);
+}
+
+static void *
+test_allocator_realloc(void *arg, void *ptr, size_t old_sz, size_t sz) {
+    struct test_allocator_data *data;
+
+    data = arg;
+    data->size += sz - old_sz;
+
+    return realloc(ptr, sz);
+}
+
+static void *
+test_allocator_aligned_alloc(void *arg, size_t alignment, size_t sz) {
+    struct test_allocator_data *data;
+    void *ptr;
+
+    data = arg;
+    data->nb_aligned_allocations++;
+    data->size += sz;
+
+    if (posix_memalign(&ptr, alignment, sz) != 0)
+        return NULL;
+
+    return ptr;
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_ORDER(table_, ...)                                      \
+    do {                                                             \
+        struct c_ordered_hash_table_iterator it__;                   \
+        const char *expected__[] = {__VA_ARGS__};                    \
+        size_t nb_expected__, i__;                                   \
+        void *key__;                                                 \
+                                                                     \
+        nb_expected__ = sizeof(expected__) / sizeof(expected__[0]);  \
+        TEST_UINT_EQ(c_ordered_hash_table_nb_entries(table_),        \
+                     nb_expected__);                                 \
+                                                                     \
+        i__ = 0;                                                     \
+        c_ordered_hash_table_iterator_init(&it__, table_);           \
+        while (c_ordered_hash_table_iterator_next(&it__, &key__,     \
+                                                  NULL) == 1) {      \
+            TEST_TRUE(i__ < nb_expected__);                          \
+            TEST_STRING_EQ(key__, expected__[i__]);                  \
+            i__++;                                                   \
+        }                                                            \
+                                                                     \
+        TEST_UINT_EQ(i__, nb_expected__);                            \
+    } while (0)
+
+TEST(insert) {
+    struct c_ordered_hash_table *table;
+    const char *str;
+
+    table = c_ordered_hash_table_new(c_hash_string, c_equal_string);
+
+    TEST_TRUE(c_ordered_hash_table_is_empty(table));
+
+    TEST_INT_EQ(c_ordered_hash_table_insert(table, "d", "def"), 1);
+    TEST_INT_EQ(c_ordered_hash_table_insert(table, "a", "abc"), 1);
+    TEST_INT_EQ(c_ordered_hash_table_insert(table, "g", "ghi"), 1);
+    TEST_ORDER(table, "d", "a", "g");
+
+    TEST_INT_EQ(c_ordered_hash_table_get(table, "a", (void **)&str), 1);
+    TEST_STRING_EQ(str, "abc");
+    TEST_INT_EQ(c_ordered_hash_table_get(table, "k", (void **)&str), 0);
+    TEST_TRUE(c_ordered_hash_table_contains(table, "g"));
+    TEST_FALSE(c_ordered_hash_table_contains(table, "k"));
+
+    /* Updating an entry does not move it */
+    TEST_INT_EQ(c_ordered_hash_table_insert(table, "d", "foo"), 0);
+    TEST_ORDER(table, "d", "a", "g");
+    TEST_INT_EQ(c_ordered_hash_table_get(table, "d", (void **)&str), 1);
+    TEST_STRING_EQ(str, "foo");
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(insert2) {
+    struct c_ordered_hash_table *table;
+    const char *key, *value;
+
+    table = c_ordered_hash_table_new(c_hash_string, c_equal_string);
+
+    c_ordered_hash_table_insert2(table, "a", "abc",
+                                 (void **)&key, (void **)&value);
+    TEST_PTR_NULL(key);
+    TEST_PTR_NULL(value);
+
+    c_ordered_hash_table_insert2(table, "a", "def",
+                                 (void **)&key, (void **)&value);
+    TEST_STRING_EQ(key, "a");
+    TEST_STRING_EQ(value, "abc");
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(remove) {
+    struct c_ordered_hash_table *table;
+    const char *key, *value;
+
+    table = c_ordered_hash_table_new(c_hash_string, c_equal_string);
+
+    c_ordered_hash_table_insert(table, "a", "abc");
+    c_ordered_hash_table_insert(table, "d", "def");
+    c_ordered_hash_table_insert(table, "g", "ghi");
+
+    TEST_INT_EQ(c_ordered_hash_table_remove(table, "d"), 1);
+    TEST_INT_EQ(c_ordered_hash_table_remove(table, "d"), 0);
+    TEST_ORDER(table, "a", "g");
+
+    /* A key inserted again goes at the end */
+    c_ordered_hash_table_insert(table, "d", "def");
+    TEST_ORDER(table, "a", "g", "d");
+
+    TEST_INT_EQ(c_ordered_hash_table_remove2(table, "a", (void **)&key,
+                                             (void **)&value), 1);
+    TEST_STRING_EQ(key, "a");
+    TEST_STRING_EQ(value, "abc");
+    TEST_ORDER(table, "g", "d");
+
+    c_ordered_hash_table_remove(table, "g");
+    c_ordered_hash_table_remove(table, "d");
+    TEST_TRUE(c_ordered_hash_table_is_empty(table));
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(clear) {
+    struct c_ordered_hash_table *table;
+
+    table = c_ordered_hash_table_new(c_hash_string, c_equal_string);
+
+    c_ordered_hash_table_insert(table, "a", "abc");
+    c_ordered_hash_table_insert(table, "d", "def");
+
+    c_ordered_hash_table_clear(table);
+    TEST_TRUE(c_ordered_hash_table_is_empty(table));
+    TEST_FALSE(c_ordered_hash_table_contains(table, "a"));
+
+    c_ordered_hash_table_insert(table, "g", "ghi");
+    TEST_ORDER(table, "g");
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(order) {
+    struct c_ordered_hash_table *table;
+    struct c_ordered_hash_table_iterator it;
+    int32_t expected;
+    void *key, *value;
+
+    table = c_ordered_hash_table_new(c_hash_int32, c_equal_int32);
+
+    for (int32_t i = 0; i < 10000; i++) {
+        c_ordered_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                    C_INT32_TO_POINTER(i * 2));
+    }
+
+    /* Remove most entries to force the table to shrink and compact its
+     * entries */
+    for (int32_t i = 0; i < 10000; i++) {
+        if (i % 10 != 0)
+            c_ordered_hash_table_remove(table, C_INT32_TO_POINTER(i));
+    }
+
+    TEST_UINT_EQ(c_ordered_hash_table_nb_entries(table), 1000);
+
+    expected = 0;
+
+    c_ordered_hash_table_iterator_init(&it, table);
+    while (c_ordered_hash_table_iterator_next(&it, &key, &value) == 1) {
+        TEST_INT_EQ(C_POINTER_TO_INT32(key), expected);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), expected * 2);
+        expected += 10;
+    }
+
+    TEST_INT_EQ(expected, 10000);
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(capacity) {
+    struct c_ordered_hash_table *table;
+    size_t capacity;
+
+    table = c_ordered_hash_table_new_with_capacity(c_hash_int32,
+                                                   c_equal_int32, 1000);
+    capacity = c_ordered_hash_table_capacity(table);
+    TEST_TRUE(capacity >= 1000);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_ordered_hash_table_insert(table, C_INT32_TO_POINTER(i), NULL);
+
+    TEST_UINT_EQ(c_ordered_hash_table_capacity(table), capacity);
+
+    TEST_INT_EQ(c_ordered_hash_table_reserve(table, 10000), 0);
+    TEST_TRUE(c_ordered_hash_table_capacity(table) >= 10000);
+    TEST_TRUE(c_ordered_hash_table_contains(table, C_INT32_TO_POINTER(999)));
+
+    /* Removing entries does not shrink the table below the reserved
+     * capacity */
+    capacity = c_ordered_hash_table_capacity(table);
+
+    for (int32_t i = 0; i < 1000; i++)
+        c_ordered_hash_table_remove(table, C_INT32_TO_POINTER(i));
+
+    TEST_UINT_EQ(c_ordered_hash_table_nb_entries(table), 0);
+    TEST_UINT_EQ(c_ordered_hash_table_capacity(table), capacity);
+
+    c_ordered_hash_table_delete(table);
+}
+
+TEST(iterate_set_value) {
+    struct c_ordered_hash_table *table;
+    struct c_ordered_hash_table_iterator it;
+    const char *str;
+
+    table = c_ordered_hash_table_new(c_hash_string, c_equal_string);
+
+    c_ordered_hash_table_insert(table, "a", "abc");
+    c_ordered_hash_table_insert(table, "d", "def");
+
+    c_ordered_hash_table_iterator_init(&it, table);
+    while (c_ordered_hash_table_iterator_next(&it, NULL, NULL) == 1)
+        c_ordered_hash_table_iterator_set_value(&it, "foo");
+
+    TEST_INT_EQ(c_ordered_hash_table_get(table, "a", (void **)&str), 1);
+    TEST_STRING_EQ(str, "foo");
+    TEST_INT_EQ(c_ordered_hash_table_get(table, "d", (void **)&str), 1);
+    TEST_STRING_EQ(str, "foo");
+
+    c_ordered_hash_table_delete(table);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("ordered-hash-table");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, insert);
+    TEST_RUN(suite, insert2);
+    TEST_RUN(suite, remove);
+    TEST_RUN(suite, clear);
+    TEST_RUN(suite, order);
+    TEST_RUN(suite, capacity);
+    TEST_RUN(suite, iterate_set_value);
+
+    test_suite_print_results_and_exit(suite);
+}
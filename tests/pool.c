@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_NB_THREADS  8
+#define TEST_NB_OBJECTS  10000
+
+struct test_thread {
+    struct c_pool *pool;
+    int nb_errors;
+};
+
+static void *test_thread_main(void *);
+
+TEST(alloc) {
+    struct c_pool *pool;
+    struct c_pool_stats stats;
+    uint64_t *objects[1000];
+
+    pool = c_pool_new(sizeof(uint64_t) * 3);
+    TEST_UINT_EQ(c_pool_object_size(pool), 24);
+
+    for (size_t i = 0; i < 1000; i++) {
+        objects[i] = c_pool_alloc(pool);
+        TEST_PTR_NOT_NULL(objects[i]);
+        TEST_UINT_EQ((uintptr_t)objects[i] % sizeof(uint64_t), 0);
+
+        objects[i][0] = i;
+        objects[i][1] = i * 2;
+        objects[i][2] = i * 3;
+    }
+
+    for (size_t i = 0; i < 1000; i++) {
+        TEST_UINT_EQ(objects[i][0], i);
+        TEST_UINT_EQ(objects[i][1], i * 2);
+        TEST_UINT_EQ(objects[i][2], i * 3);
+    }
+
+    c_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.object_size, 24);
+    TEST_UINT_EQ(stats.nb_objects, 1000);
+    TEST_TRUE(stats.nb_slabs > 1);
+    TEST_UINT_EQ(stats.nb_allocations, 1000);
+    TEST_UINT_EQ(stats.nb_releases, 0);
+
+    for (size_t i = 0; i < 1000; i++)
+        c_pool_free(pool, objects[i]);
+
+    c_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_objects, 0);
+    TEST_TRUE(stats.nb_free_objects >= 1000);
+    TEST_UINT_EQ(stats.nb_releases, 1000);
+
+    c_pool_delete(pool);
+}
+
+TEST(reuse) {
+    struct c_pool *pool;
+    struct c_pool_stats stats;
+    void *object, *object2;
+    size_t nb_slabs;
+
+    pool = c_pool_new(1);
+    TEST_UINT_EQ(c_pool_object_size(pool), sizeof(void *));
+
+    object = c_pool_alloc(pool);
+    c_pool_free(pool, object);
+
+    /* Released objects are reused first */
+    object2 = c_pool_alloc(pool);
+    TEST_TRUE(object2 == object);
+    c_pool_free(pool, object2);
+
+    c_pool_stats(pool, &stats);
+    nb_slabs = stats.nb_slabs;
+
+    for (int i = 0; i < 100000; i++)
+        c_pool_free(pool, c_pool_alloc(pool));
+
+    c_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_slabs, nb_slabs);
+
+    c_pool_delete(pool);
+}
+
+TEST(large_objects) {
+    struct c_pool *pool;
+    struct c_pool_stats stats;
+    void *objects[100];
+
+    pool = c_pool_new(10000);
+
+    for (size_t i = 0; i < 100; i++) {
+        objects[i] = c_pool_alloc(pool);
+        memset(objects[i], (int)i, 10000);
+    }
+
+    for (size_t i = 0; i < 100; i++)
+        c_pool_free(pool, objects[i]);
+
+    c_pool_stats(pool, &stats);
+    TEST_TRUE(stats.nb_slabs <= 100 / 8 + 1);
+
+    c_pool_delete(pool);
+}
+
+TEST(allocator) {
+    struct c_pool *pool;
+    struct c_pool_stats stats;
+    struct c_allocator allocator;
+    struct c_queue *queue;
+    struct c_stack *stack;
+    struct c_vector *vector;
+
+    pool = c_pool_new(c_queue_entry_size());
+    c_pool_init_allocator(pool, &allocator);
+
+    queue = c_queue_new_with_allocator(&allocator);
+    stack = c_stack_new_with_allocator(&allocator);
+
+    /* Allocations larger than objects are served by c_malloc() */
+    vector = c_vector_new_with_allocator(sizeof(int), &allocator);
+
+    for (int i = 0; i < 1000; i++) {
+        c_queue_push(queue, C_INT32_TO_POINTER(i));
+        c_stack_push(stack, C_INT32_TO_POINTER(i));
+        c_vector_append(vector, &i);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        TEST_INT_EQ(C_POINTER_TO_INT32(c_queue_pop(queue)), i);
+        TEST_INT_EQ(C_POINTER_TO_INT32(c_stack_pop(stack)), 999 - i);
+        TEST_INT_EQ(*(int *)c_vector_entry(vector, (size_t)i), i);
+    }
+
+    c_pool_stats(pool, &stats);
+    TEST_TRUE(stats.nb_allocations >= 2000);
+
+    c_vector_delete(vector);
+    c_stack_delete(stack);
+    c_queue_delete(queue);
+
+    c_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_objects, 0);
+
+    c_pool_delete(pool);
+}
+
+TEST(threads) {
+    struct c_pool *pool;
+    struct c_pool_stats stats;
+    struct test_thread threads[TEST_NB_THREADS];
+    pthread_t thread_ids[TEST_NB_THREADS];
+
+    pool = c_pool_new_concurrent(sizeof(uint64_t));
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        threads[i].pool = pool;
+        threads[i].nb_errors = 0;
+
+        if (pthread_create(&thread_ids[i], NULL, test_thread_main,
+                           &threads[i]) != 0) {
+            TEST_ABORT("cannot create thread");
+        }
+    }
+
+    for (size_t i = 0; i < TEST_NB_THREADS; i++) {
+        pthread_join(thread_ids[i], NULL);
+        TEST_INT_EQ(threads[i].nb_errors, 0);
+    }
+
+    /* Caches of exited threads were returned to the pool */
+    c_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_objects, 0);
+    TEST_UINT_EQ(stats.nb_allocations, TEST_NB_THREADS * TEST_NB_OBJECTS);
+    TEST_UINT_EQ(stats.nb_releases, TEST_NB_THREADS * TEST_NB_OBJECTS);
+
+    c_pool_free(pool, c_pool_alloc(pool));
+
+    c_pool_delete(pool);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("pool");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, alloc);
+    TEST_RUN(suite, reuse);
+    TEST_RUN(suite, large_objects);
+    TEST_RUN(suite, allocator);
+    TEST_RUN(suite, threads);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static void *
+test_thread_main(void *arg) {
+    struct test_thread *thread;
+    uint64_t **objects;
+
+    thread = arg;
+
+    objects = c_calloc(TEST_NB_OBJECTS, sizeof(uint64_t *));
+    if (!objects) {
+        thread->nb_errors++;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < TEST_NB_OBJECTS; i++) {
+        objects[i] = c_pool_alloc(thread->pool);
+        if (!objects[i]) {
+            thread->nb_errors++;
+            break;
+        }
+
+        *objects[i] = (uintptr_t)thread ^ i;
+    }
+
+    for (size_t i = 0; i < TEST_NB_OBJECTS; i++) {
+        if (!objects[i])
+            break;
+
+        if (*objects[i] != ((uintptr_t)thread ^ i))
+            thread->nb_errors++;
+
+        c_pool_free(thread->pool, objects[i]);
+    }
+
+    c_free(objects);
+    return NULL;
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <pthread.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_NB_READERS  4
+#define TEST_NB_KEYS     1000
+#define TEST_NB_UPDATES  20000
+
+struct test_reader {
+    struct c_rcu_hash_table *table;
+    bool *stop;
+    int nb_errors;
+};
+
+static void *test_reader_main(void *);
+
+TEST(insert) {
+    struct c_rcu_hash_table *table;
+    struct c_rcu_hash_table_reader *reader;
+    char *old_key, *old_value;
+    const char *str;
+
+    table = c_rcu_hash_table_new(c_hash_string, c_equal_string);
+    reader = c_rcu_hash_table_register_reader(table);
+
+    TEST_TRUE(c_rcu_hash_table_is_empty(table));
+
+    TEST_INT_EQ(c_rcu_hash_table_insert(table, "a", "abc"), 1);
+    TEST_INT_EQ(c_rcu_hash_table_insert(table, "d", "def"), 1);
+    TEST_UINT_EQ(c_rcu_hash_table_nb_entries(table), 2);
+
+    TEST_INT_EQ(c_rcu_hash_table_get(reader, "a", (void **)&str), 1);
+    TEST_STRING_EQ(str, "abc");
+    TEST_INT_EQ(c_rcu_hash_table_get(reader, "d", (void **)&str), 1);
+    TEST_STRING_EQ(str, "def");
+    TEST_INT_EQ(c_rcu_hash_table_get(reader, "x", (void **)&str), 0);
+
+    TEST_INT_EQ(c_rcu_hash_table_insert2(table, "a", "foo",
+                                         (void **)&old_key,
+                                         (void **)&old_value), 0);
+    TEST_STRING_EQ(old_key, "a");
+    TEST_STRING_EQ(old_value, "abc");
+    TEST_UINT_EQ(c_rcu_hash_table_nb_entries(table), 2);
+
+    TEST_INT_EQ(c_rcu_hash_table_get(reader, "a", (void **)&str), 1);
+    TEST_STRING_EQ(str, "foo");
+
+    c_rcu_hash_table_unregister_reader(reader);
+    c_rcu_hash_table_delete(table);
+}
+
+TEST(remove) {
+    struct c_rcu_hash_table *table;
+    struct c_rcu_hash_table_reader *reader;
+    char *old_key, *old_value;
+
+    table = c_rcu_hash_table_new(c_hash_string, c_equal_string);
+    reader = c_rcu_hash_table_register_reader(table);
+
+    c_rcu_hash_table_insert(table, "a", "abc");
+    c_rcu_hash_table_insert(table, "d", "def");
+    c_rcu_hash_table_insert(table, "g", "ghi");
+
+    TEST_INT_EQ(c_rcu_hash_table_remove(table, "a"), 1);
+    TEST_INT_EQ(c_rcu_hash_table_remove(table, "a"), 0);
+    TEST_FALSE(c_rcu_hash_table_contains(reader, "a"));
+    TEST_TRUE(c_rcu_hash_table_contains(reader, "d"));
+
+    TEST_INT_EQ(c_rcu_hash_table_remove2(table, "d",
+                                         (void **)&old_key,
+                                         (void **)&old_value), 1);
+    TEST_STRING_EQ(old_key, "d");
+    TEST_STRING_EQ(old_value, "def");
+    TEST_UINT_EQ(c_rcu_hash_table_nb_entries(table), 1);
+
+    c_rcu_hash_table_clear(table);
+    TEST_TRUE(c_rcu_hash_table_is_empty(table));
+    TEST_FALSE(c_rcu_hash_table_contains(reader, "g"));
+
+    c_rcu_hash_table_unregister_reader(reader);
+    c_rcu_hash_table_delete(table);
+}
+
+TEST(grow) {
+    struct c_rcu_hash_table *table;
+    struct c_rcu_hash_table_reader *reader;
+    void *value;
+
+    table = c_rcu_hash_table_new(c_hash_int32, c_equal_int32);
+    reader = c_rcu_hash_table_register_reader(table);
+
+    for (int32_t i = 0; i < 10000; i++) {
+        TEST_INT_EQ(c_rcu_hash_table_insert(table, C_INT32_TO_POINTER(i),
+                                            C_INT32_TO_POINTER(i)), 1);
+    }
+
+    TEST_UINT_EQ(c_rcu_hash_table_nb_entries(table), 10000);
+
+    for (int32_t i = 0; i < 10000; i++) {
+        TEST_INT_EQ(c_rcu_hash_table_get(reader, C_INT32_TO_POINTER(i),
+                                         &value), 1);
+        TEST_INT_EQ(C_POINTER_TO_INT32(value), i);
+    }
+
+    for (int32_t i = 0; i < 10000; i += 2)
+        TEST_INT_EQ(c_rcu_hash_table_remove(table, C_INT32_TO_POINTER(i)), 1);
+
+    for (int32_t i = 0; i < 10000; i++) {
+        TEST_BOOL_EQ(c_rcu_hash_table_contains(reader, C_INT32_TO_POINTER(i)),
+                     i % 2 == 1);
+    }
+
+    c_rcu_hash_table_unregister_reader(reader);
+    c_rcu_hash_table_delete(table);
+}
+
+TEST(defer_free) {
+    struct c_rcu_hash_table *table;
+    struct c_rcu_hash_table_reader *reader;
+    char *value, *old_value, *str;
+
+    table = c_rcu_hash_table_new(c_hash_string, c_equal_string);
+    reader = c_rcu_hash_table_register_reader(table);
+
+    value = c_strdup("abc");
+    c_rcu_hash_table_insert(table, "a", value);
+
+    /* A reader in a critical section can keep using a value replaced and
+     * released by a writer. */
+    c_rcu_hash_table_read_lock(reader);
+    TEST_INT_EQ(c_rcu_hash_table_get(reader, "a", (void **)&str), 1);
+
+    value = c_strdup("def");
+    c_rcu_hash_table_insert2(table, "a", value, NULL, (void **)&old_value);
+    TEST_TRUE(old_value == str);
+    TEST_INT_EQ(c_rcu_hash_table_defer_free(table, old_value), 0);
+
+    TEST_STRING_EQ(str, "abc");
+    c_rcu_hash_table_read_unlock(reader);
+
+    c_rcu_hash_table_synchronize(table);
+
+    c_rcu_hash_table_remove2(table, "a", NULL, (void **)&old_value);
+    TEST_STRING_EQ(old_value, "def");
+    c_free(old_value);
+
+    c_rcu_hash_table_unregister_reader(reader);
+    c_rcu_hash_table_delete(table);
+}
+
+TEST(threads) {
+    struct c_rcu_hash_table *table;
+    struct test_reader readers[TEST_NB_READERS];
+    pthread_t thread_ids[TEST_NB_READERS];
+    bool stop;
+
+    table = c_rcu_hash_table_new(c_hash_int32, c_equal_int32);
+
+    for (int32_t i = 0; i < TEST_NB_KEYS; i++) {
+        int32_t *value;
+
+        value = c_malloc(sizeof(int32_t));
+        *value = i;
+
+        c_rcu_hash_table_insert(table, C_INT32_TO_POINTER(i), value);
+    }
+
+    stop = false;
+
+    for (size_t i = 0; i < TEST_NB_READERS; i++) {
+        readers[i].table = table;
+        readers[i].stop = &stop;
+        readers[i].nb_errors = 0;
+
+        if (pthread_create(&thread_ids[i], NULL, test_reader_main,
+                           &readers[i]) != 0) {
+            TEST_ABORT("cannot create thread");
+        }
+    }
+
+    /* Replace values, releasing the previous ones while readers are
+     * using them; readers check that values always match keys. */
+    for (int32_t n = 0; n < TEST_NB_UPDATES; n++) {
+        int32_t key, *value, *old_value;
+
+        key = n % TEST_NB_KEYS;
+
+        value = c_malloc(sizeof(int32_t));
+        *value = key;
+
+        c_rcu_hash_table_insert2(table, C_INT32_TO_POINTER(key), value,
+                                 NULL, (void **)&old_value);
+        TEST_INT_EQ(c_rcu_hash_table_defer_free(table, old_value), 0);
+    }
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < TEST_NB_READERS; i++) {
+        pthread_join(thread_ids[i], NULL);
+        TEST_INT_EQ(readers[i].nb_errors, 0);
+    }
+
+    for (int32_t i = 0; i < TEST_NB_KEYS; i++) {
+        int32_t *old_value;
+
+        c_rcu_hash_table_remove2(table, C_INT32_TO_POINTER(i),
+                                 NULL, (void **)&old_value);
+        c_free(old_value);
+    }
+
+    c_rcu_hash_table_delete(table);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("rcu-hash-table");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, insert);
+    TEST_RUN(suite, remove);
+    TEST_RUN(suite, grow);
+    TEST_RUN(suite, defer_free);
+    TEST_RUN(suite, threads);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static void *
+test_reader_main(void *arg) {
+    struct c_rcu_hash_table_reader *reader;
+    struct test_reader *thread;
+    uint32_t n;
+
+    thread = arg;
+
+    reader = c_rcu_hash_table_register_reader(thread->table);
+
+    n = 0;
+
+    while (!__atomic_load_n(thread->stop, __ATOMIC_RELAXED)) {
+        int32_t key, *value;
+
+        key = (int32_t)(n++ % TEST_NB_KEYS);
+
+        c_rcu_hash_table_read_lock(reader);
+
+        if (c_rcu_hash_table_get(reader, C_INT32_TO_POINTER(key),
+                                 (void **)&value) != 1
+         || *value != key) {
+            thread->nb_errors++;
+        }
+
+        c_rcu_hash_table_read_unlock(reader);
+    }
+
+    c_rcu_hash_table_unregister_reader(reader);
+    return NULL;
+}
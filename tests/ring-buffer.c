@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <unistd.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+TEST(base) {
+    struct c_ring_buffer *buf;
+    size_t page_sz;
+
+    page_sz = (size_t)sysconf(_SC_PAGESIZE);
+
+    buf = c_ring_buffer_new(1);
+    if (!buf)
+        TEST_ABORT("cannot create ring buffer: %s", c_get_error());
+
+    TEST_UINT_EQ(c_ring_buffer_size(buf), page_sz);
+    TEST_UINT_EQ(c_ring_buffer_length(buf), 0);
+    TEST_UINT_EQ(c_ring_buffer_free_space(buf), page_sz);
+
+    TEST_INT_EQ(c_ring_buffer_add_string(buf, "foo"), 0);
+    TEST_INT_EQ(c_ring_buffer_add_string(buf, "bar"), 0);
+    TEST_MEM_EQ(c_ring_buffer_data(buf), c_ring_buffer_length(buf),
+                "foobar", 6);
+    TEST_UINT_EQ(c_ring_buffer_free_space(buf), page_sz - 6);
+
+    c_ring_buffer_skip(buf, 2);
+    TEST_MEM_EQ(c_ring_buffer_data(buf), c_ring_buffer_length(buf),
+                "obar", 4);
+
+    c_ring_buffer_skip(buf, 10);
+    TEST_UINT_EQ(c_ring_buffer_length(buf), 0);
+
+    c_ring_buffer_delete(buf);
+}
+
+TEST(wrap) {
+    struct c_ring_buffer *buf;
+    size_t sz;
+    char *tmp;
+
+    buf = c_ring_buffer_new(0);
+    if (!buf)
+        TEST_ABORT("cannot create ring buffer: %s", c_get_error());
+
+    sz = c_ring_buffer_size(buf);
+    TEST_UINT_EQ(sz % C_RING_BUFFER_DEFAULT_SIZE, 0);
+
+    tmp = c_malloc(sz);
+    memset(tmp, 'a', sz);
+
+    /* Move the start of the buffer near its end */
+    TEST_INT_EQ(c_ring_buffer_add(buf, tmp, sz - 3), 0);
+    c_ring_buffer_skip(buf, sz - 4);
+    TEST_UINT_EQ(c_ring_buffer_length(buf), 1);
+
+    /* Data wrap around the end but are still contiguous */
+    TEST_INT_EQ(c_ring_buffer_add_string(buf, "foobar"), 0);
+    TEST_MEM_EQ(c_ring_buffer_data(buf), c_ring_buffer_length(buf),
+                "afoobar", 7);
+
+    c_ring_buffer_skip(buf, 4);
+    TEST_MEM_EQ(c_ring_buffer_data(buf), c_ring_buffer_length(buf),
+                "bar", 3);
+
+    /* The buffer can be filled entirely */
+    TEST_INT_EQ(c_ring_buffer_add(buf, tmp, sz - 3), 0);
+    TEST_UINT_EQ(c_ring_buffer_free_space(buf), 0);
+    TEST_INT_EQ(c_ring_buffer_add_string(buf, "x"), -1);
+    TEST_PTR_NULL(c_ring_buffer_reserve(buf, 1));
+
+    TEST_MEM_EQ(c_ring_buffer_data(buf), 3, "bar", 3);
+    TEST_MEM_EQ((char *)c_ring_buffer_data(buf) + 3, sz - 3, tmp, sz - 3);
+
+    c_ring_buffer_clear(buf);
+    TEST_UINT_EQ(c_ring_buffer_length(buf), 0);
+    TEST_UINT_EQ(c_ring_buffer_free_space(buf), sz);
+
+    c_free(tmp);
+    c_ring_buffer_delete(buf);
+}
+
+TEST(reserve) {
+    struct c_ring_buffer *buf;
+    size_t sz;
+    char *ptr;
+
+    buf = c_ring_buffer_new(0);
+    if (!buf)
+        TEST_ABORT("cannot create ring buffer: %s", c_get_error());
+
+    sz = c_ring_buffer_size(buf);
+
+    TEST_INT_EQ(c_ring_buffer_increase_length(buf, sz - 2), 0);
+    c_ring_buffer_skip(buf, sz - 3);
+
+    ptr = c_ring_buffer_reserve(buf, 6);
+    TEST_PTR_NOT_NULL(ptr);
+    memcpy(ptr, "foobar", 6);
+    TEST_INT_EQ(c_ring_buffer_increase_length(buf, 6), 0);
+    TEST_MEM_EQ((char *)c_ring_buffer_data(buf) + 1, 6, "foobar", 6);
+
+    TEST_INT_EQ(c_ring_buffer_increase_length(buf, sz), -1);
+
+    c_ring_buffer_delete(buf);
+}
+
+TEST(read_write) {
+    struct c_ring_buffer *buf;
+    char tmp[16];
+    int fds[2];
+    size_t sz;
+
+    if (pipe(fds) == -1)
+        TEST_ABORT("cannot create pipe: %s", strerror(errno));
+
+    buf = c_ring_buffer_new(0);
+    if (!buf)
+        TEST_ABORT("cannot create ring buffer: %s", c_get_error());
+
+    sz = c_ring_buffer_size(buf);
+
+    TEST_INT_EQ(c_ring_buffer_increase_length(buf, sz - 2), 0);
+    c_ring_buffer_skip(buf, sz - 2);
+
+    if (write(fds[1], "foobar", 6) != 6)
+        TEST_ABORT("cannot write pipe: %s", strerror(errno));
+
+    TEST_INT_EQ(c_ring_buffer_read(buf, fds[0], 16), 6);
+    TEST_MEM_EQ(c_ring_buffer_data(buf), c_ring_buffer_length(buf),
+                "foobar", 6);
+
+    TEST_INT_EQ(c_ring_buffer_write(buf, fds[1]), 6);
+    TEST_UINT_EQ(c_ring_buffer_length(buf), 0);
+
+    if (read(fds[0], tmp, sizeof(tmp)) != 6)
+        TEST_ABORT("cannot read pipe: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, 6, "foobar", 6);
+
+    /* Reading into a full buffer fails */
+    TEST_INT_EQ(c_ring_buffer_increase_length(buf, sz), 0);
+    TEST_INT_EQ(c_ring_buffer_read(buf, fds[0], 16), -1);
+
+    c_ring_buffer_delete(buf);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("ring-buffer");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, base);
+    TEST_RUN(suite, wrap);
+    TEST_RUN(suite, reserve);
+    TEST_RUN(suite, read_write);
+
+    test_suite_print_results_and_exit(suite);
+}
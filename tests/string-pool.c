@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+TEST(intern) {
+    struct c_string_pool *pool;
+    const char *foo, *bar, *str;
+    char buf[16];
+
+    pool = c_string_pool_new();
+
+    TEST_UINT_EQ(c_string_pool_nb_strings(pool), 0);
+
+    foo = c_string_pool_intern(pool, "foo");
+    TEST_STRING_EQ(foo, "foo");
+    bar = c_string_pool_intern(pool, "bar");
+    TEST_STRING_EQ(bar, "bar");
+    TEST_UINT_EQ(c_string_pool_nb_strings(pool), 2);
+
+    /* Interning the same string returns the same pointer */
+    c_strlcpy(buf, "foo", sizeof(buf));
+    TEST_TRUE(c_string_pool_intern(pool, buf) == foo);
+    TEST_TRUE(c_string_pool_intern_memory(pool, "foobar", 3) == foo);
+    TEST_TRUE(c_string_pool_intern_memory(pool, "xbar", 4) != bar);
+    TEST_UINT_EQ(c_string_pool_nb_strings(pool), 3);
+
+    str = c_string_pool_intern(pool, "");
+    TEST_STRING_EQ(str, "");
+    TEST_TRUE(c_string_pool_intern_memory(pool, "abc", 0) == str);
+
+    c_string_pool_delete(pool);
+}
+
+TEST(lookup) {
+    struct c_string_pool *pool;
+    const char *foo;
+
+    pool = c_string_pool_new();
+
+    TEST_PTR_NULL(c_string_pool_lookup(pool, "foo"));
+
+    foo = c_string_pool_intern(pool, "foo");
+
+    TEST_TRUE(c_string_pool_lookup(pool, "foo") == foo);
+    TEST_TRUE(c_string_pool_lookup_memory(pool, "food", 3) == foo);
+    TEST_PTR_NULL(c_string_pool_lookup(pool, "fo"));
+    TEST_UINT_EQ(c_string_pool_nb_strings(pool), 1);
+
+    c_string_pool_delete(pool);
+}
+
+TEST(ids) {
+    struct c_string_pool *pool;
+    const char *strings[1000];
+    char buf[32];
+
+    pool = c_string_pool_new();
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "string-%u", i);
+
+        strings[i] = c_string_pool_intern(pool, buf);
+        TEST_PTR_NOT_NULL(strings[i]);
+        TEST_UINT_EQ(c_string_pool_id(strings[i]), i);
+        TEST_UINT_EQ(c_string_pool_length(strings[i]), strlen(buf));
+    }
+
+    for (uint32_t i = 0; i < 1000; i++)
+        TEST_TRUE(c_string_pool_string(pool, i) == strings[i]);
+
+    TEST_PTR_NULL(c_string_pool_string(pool, 1000));
+
+    c_string_pool_delete(pool);
+}
+
+TEST(large_strings) {
+    struct c_string_pool *pool;
+    const char *str, *foo;
+    char *large;
+    size_t len;
+
+    pool = c_string_pool_new();
+
+    foo = c_string_pool_intern(pool, "foo");
+
+    len = 256 * 1024;
+    large = c_malloc(len + 1);
+    memset(large, 'a', len);
+    large[len] = '\0';
+
+    str = c_string_pool_intern(pool, large);
+    TEST_STRING_EQ(str, large);
+    TEST_UINT_EQ(c_string_pool_length(str), len);
+    TEST_TRUE(c_string_pool_intern(pool, large) == str);
+
+    TEST_TRUE(c_string_pool_intern(pool, "foo") == foo);
+
+    c_free(large);
+    c_string_pool_delete(pool);
+}
+
+TEST(clear) {
+    struct c_string_pool *pool;
+    struct c_string_pool_stats stats;
+    const char *str;
+
+    pool = c_string_pool_new();
+
+    c_string_pool_intern(pool, "foo");
+    c_string_pool_intern(pool, "bar");
+
+    c_string_pool_clear(pool);
+    TEST_UINT_EQ(c_string_pool_nb_strings(pool), 0);
+    TEST_PTR_NULL(c_string_pool_lookup(pool, "foo"));
+
+    c_string_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_strings, 0);
+    TEST_UINT_EQ(stats.strings_size, 0);
+    TEST_UINT_EQ(stats.nb_blocks, 0);
+
+    str = c_string_pool_intern(pool, "bar");
+    TEST_STRING_EQ(str, "bar");
+    TEST_UINT_EQ(c_string_pool_id(str), 0);
+
+    c_string_pool_delete(pool);
+}
+
+TEST(stats) {
+    struct c_string_pool *pool;
+    struct c_string_pool_stats stats;
+
+    pool = c_string_pool_new();
+
+    c_string_pool_intern(pool, "foo");
+    c_string_pool_intern(pool, "foobar");
+    c_string_pool_intern(pool, "foo");
+
+    c_string_pool_stats(pool, &stats);
+    TEST_UINT_EQ(stats.nb_strings, 2);
+    TEST_UINT_EQ(stats.strings_size, 11);
+    TEST_UINT_EQ(stats.nb_blocks, 1);
+    TEST_TRUE(stats.memory_size > stats.strings_size);
+
+    c_string_pool_delete(pool);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    suite = test_suite_new("string-pool");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, intern);
+    TEST_RUN(suite, lookup);
+    TEST_RUN(suite, ids);
+    TEST_RUN(suite, large_strings);
+    TEST_RUN(suite, clear);
+    TEST_RUN(suite, stats);
+
+    test_suite_print_results_and_exit(suite);
+}
@@ -118,6 +118,38 @@ TEST(string_search) {
 #undef C_TEST_STRING_SEARCH_NOT_FOUND
 }
 
+TEST(memory_search) {
+    unsigned char data[512];
+    unsigned char needle[3];
+    unsigned char *ptr;
+
+    /* Data and needles containing all possible byte values */
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (unsigned char)(255 - i % 256);
+
+    needle[0] = 0x02;
+    needle[1] = 0x01;
+    needle[2] = 0x00;
+    ptr = c_memory_search(data, sizeof(data), needle, 3);
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_INT_EQ(ptr - data, 253);
+
+    needle[0] = 0xff;
+    needle[1] = 0xfe;
+    ptr = c_memory_search(data, sizeof(data), needle, 2);
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_INT_EQ(ptr - data, 0);
+
+    ptr = c_memory_search(data + 1, sizeof(data) - 1, needle, 2);
+    TEST_PTR_NOT_NULL(ptr);
+    TEST_INT_EQ(ptr - data, 256);
+
+    needle[0] = 0x00;
+    needle[1] = 0xff;
+    needle[2] = 0x00;
+    TEST_PTR_NULL(c_memory_search(data, sizeof(data), needle, 3));
+}
+
 TEST(string_starts_with) {
     TEST_TRUE(c_string_starts_with("", ""));
     TEST_TRUE(c_string_starts_with("foo", "foo"));
@@ -187,6 +219,7 @@ main(int argc, char **argv) {
     TEST_RUN(suite, strndup);
     TEST_RUN(suite, asprintf);
     TEST_RUN(suite, string_search);
+    TEST_RUN(suite, memory_search);
     TEST_RUN(suite, string_starts_with);
     TEST_RUN(suite, memspn);
     TEST_RUN(suite, memcspn);
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2014-2015 Nicolas Martyanoff
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <sys/socket.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <utest.h>
+
+#include "../src/internal.h"
+
+#define TEST_DATA_SIZE 100000
+
+static char test_data[TEST_DATA_SIZE];
+
+static int test_create_file(size_t);
+static int test_read_fd(int, char *, size_t);
+static int test_transfer_all(int, int, off_t *, size_t);
+
+TEST(file_to_file) {
+    char tmp[TEST_DATA_SIZE];
+    int in_fd, out_fd;
+    off_t offset;
+
+    in_fd = test_create_file(TEST_DATA_SIZE);
+    if (in_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    out_fd = test_create_file(0);
+    if (out_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    /* With an offset, the position of the input file does not change */
+    offset = 0;
+    if (test_transfer_all(out_fd, in_fd, &offset, TEST_DATA_SIZE) == -1)
+        TEST_ABORT("cannot transfer data: %s", c_get_error());
+    TEST_INT_EQ(offset, TEST_DATA_SIZE);
+    TEST_INT_EQ(lseek(in_fd, 0, SEEK_CUR), 0);
+    TEST_INT_EQ(c_transfer(out_fd, in_fd, &offset, 100), 0);
+
+    lseek(out_fd, 0, SEEK_SET);
+    if (test_read_fd(out_fd, tmp, TEST_DATA_SIZE) == -1)
+        TEST_ABORT("cannot read data: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, TEST_DATA_SIZE, test_data, TEST_DATA_SIZE);
+
+    /* Without offset, the position of the input file is used */
+    lseek(out_fd, 0, SEEK_SET);
+    lseek(in_fd, 10, SEEK_SET);
+    if (test_transfer_all(out_fd, in_fd, NULL, 1000) == -1)
+        TEST_ABORT("cannot transfer data: %s", c_get_error());
+    TEST_INT_EQ(lseek(in_fd, 0, SEEK_CUR), 1010);
+
+    lseek(out_fd, 0, SEEK_SET);
+    if (test_read_fd(out_fd, tmp, 1000) == -1)
+        TEST_ABORT("cannot read data: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, 1000, test_data + 10, 1000);
+
+    close(in_fd);
+    close(out_fd);
+}
+
+TEST(file_to_append_file) {
+    char tmp[TEST_DATA_SIZE];
+    int in_fd, out_fd, flags;
+
+    in_fd = test_create_file(TEST_DATA_SIZE);
+    if (in_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    out_fd = test_create_file(10);
+    if (out_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    flags = fcntl(out_fd, F_GETFL);
+    if (flags == -1 || fcntl(out_fd, F_SETFL, flags | O_APPEND) == -1)
+        TEST_ABORT("cannot set O_APPEND: %s", strerror(errno));
+
+    /* copy_file_range() rejects append-only files; data must still be
+     * transferred, at the end of the file */
+    if (test_transfer_all(out_fd, in_fd, NULL, 1000) == -1)
+        TEST_ABORT("cannot transfer data: %s", c_get_error());
+    TEST_INT_EQ(lseek(in_fd, 0, SEEK_CUR), 1000);
+
+    lseek(out_fd, 0, SEEK_SET);
+    if (test_read_fd(out_fd, tmp, 1010) == -1)
+        TEST_ABORT("cannot read data: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, 10, test_data, 10);
+    TEST_MEM_EQ(tmp + 10, 1000, test_data, 1000);
+
+    close(in_fd);
+    close(out_fd);
+}
+
+TEST(file_to_pipe) {
+    char tmp[TEST_DATA_SIZE];
+    int in_fd, fds[2];
+    ssize_t ret;
+    off_t offset;
+    size_t len;
+
+    in_fd = test_create_file(TEST_DATA_SIZE);
+    if (in_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    if (pipe(fds) == -1)
+        TEST_ABORT("cannot create pipe: %s", strerror(errno));
+
+    /* A pipe buffer is smaller than the data, so we alternate */
+    offset = 0;
+    len = 0;
+    while (len < TEST_DATA_SIZE) {
+        ret = c_transfer(fds[1], in_fd, &offset, 4096);
+        if (ret == -1)
+            TEST_ABORT("cannot transfer data: %s", c_get_error());
+        TEST_TRUE(ret > 0);
+
+        if (test_read_fd(fds[0], tmp + len, (size_t)ret) == -1)
+            TEST_ABORT("cannot read data: %s", strerror(errno));
+
+        len += (size_t)ret;
+    }
+
+    TEST_MEM_EQ(tmp, TEST_DATA_SIZE, test_data, TEST_DATA_SIZE);
+
+    close(in_fd);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(pipe_to_file) {
+    char tmp[1000];
+    int out_fd, fds[2];
+    off_t offset;
+
+    if (pipe(fds) == -1)
+        TEST_ABORT("cannot create pipe: %s", strerror(errno));
+
+    out_fd = test_create_file(0);
+    if (out_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    if (write(fds[1], test_data, 1000) != 1000)
+        TEST_ABORT("cannot write pipe: %s", strerror(errno));
+    close(fds[1]);
+
+    offset = 0;
+    TEST_INT_EQ(c_transfer(out_fd, fds[0], &offset, 1000), -1);
+
+    if (test_transfer_all(out_fd, fds[0], NULL, 1000) == -1)
+        TEST_ABORT("cannot transfer data: %s", c_get_error());
+
+    TEST_INT_EQ(c_transfer(out_fd, fds[0], NULL, 1000), 0);
+
+    lseek(out_fd, 0, SEEK_SET);
+    if (test_read_fd(out_fd, tmp, 1000) == -1)
+        TEST_ABORT("cannot read data: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, 1000, test_data, 1000);
+
+    close(fds[0]);
+    close(out_fd);
+}
+
+TEST(file_to_socket) {
+    char tmp[TEST_DATA_SIZE];
+    int in_fd, fds[2];
+    ssize_t ret;
+    off_t offset;
+    size_t len;
+
+    in_fd = test_create_file(TEST_DATA_SIZE);
+    if (in_fd == -1)
+        TEST_ABORT("cannot create file: %s", strerror(errno));
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        TEST_ABORT("cannot create sockets: %s", strerror(errno));
+
+    offset = 0;
+    len = 0;
+    while (len < TEST_DATA_SIZE) {
+        ret = c_transfer(fds[0], in_fd, &offset, 8192);
+        if (ret == -1)
+            TEST_ABORT("cannot transfer data: %s", c_get_error());
+        TEST_TRUE(ret > 0);
+
+        if (test_read_fd(fds[1], tmp + len, (size_t)ret) == -1)
+            TEST_ABORT("cannot read data: %s", strerror(errno));
+
+        len += (size_t)ret;
+    }
+
+    TEST_MEM_EQ(tmp, TEST_DATA_SIZE, test_data, TEST_DATA_SIZE);
+
+    close(in_fd);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(socket_to_socket) {
+    char tmp[1000];
+    int fds[2], fds2[2];
+    ssize_t ret;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1
+     || socketpair(AF_UNIX, SOCK_STREAM, 0, fds2) == -1) {
+        TEST_ABORT("cannot create sockets: %s", strerror(errno));
+    }
+
+    if (write(fds[1], test_data, 1000) != 1000)
+        TEST_ABORT("cannot write socket: %s", strerror(errno));
+
+    /* Neither side supports zero-copy transfers: data are copied, and only
+     * the data written are consumed. */
+    ret = c_transfer(fds2[0], fds[0], NULL, 400);
+    TEST_INT_EQ(ret, 400);
+    ret = c_transfer(fds2[0], fds[0], NULL, 1000);
+    TEST_INT_EQ(ret, 600);
+
+    if (test_read_fd(fds2[1], tmp, 1000) == -1)
+        TEST_ABORT("cannot read data: %s", strerror(errno));
+    TEST_MEM_EQ(tmp, 1000, test_data, 1000);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(fds2[0]);
+    close(fds2[1]);
+}
+
+int
+main(int argc, char **argv) {
+    struct test_suite *suite;
+
+    for (size_t i = 0; i < TEST_DATA_SIZE; i++)
+        test_data[i] = (char)(i * 7 + i / 256);
+
+    suite = test_suite_new("transfer");
+    test_suite_initialize_from_args(suite, argc, argv);
+
+    test_suite_start(suite);
+
+    TEST_RUN(suite, file_to_file);
+    TEST_RUN(suite, file_to_append_file);
+    TEST_RUN(suite, file_to_pipe);
+    TEST_RUN(suite, pipe_to_file);
+    TEST_RUN(suite, file_to_socket);
+    TEST_RUN(suite, socket_to_socket);
+
+    test_suite_print_results_and_exit(suite);
+}
+
+static int
+test_create_file(size_t sz) {
+    FILE *file;
+
+    file = tmpfile();
+    if (!file)
+        return -1;
+
+    if (fwrite(test_data, 1, sz, file) != sz)
+        return -1;
+    fflush(file);
+    rewind(file);
+
+    return fileno(file);
+}
+
+static int
+test_read_fd(int fd, char *data, size_t sz) {
+    size_t len;
+
+    len = 0;
+    while (len < sz) {
+        ssize_t ret;
+
+        ret = read(fd, data + len, sz - len);
+        if (ret <= 0)
+            return -1;
+
+        len += (size_t)ret;
+    }
+
+    return 0;
+}
+
+static int
+test_transfer_all(int out_fd, int in_fd, off_t *offset, size_t sz) {
+    size_t len;
+
+    len = 0;
+    while (len < sz) {
+        ssize_t ret;
+
+        ret = c_transfer(out_fd, in_fd, offset, sz - len);
+        if (ret <= 0)
+            return -1;
+
+        len += (size_t)ret;
+    }
+
+    return 0;
+}
@@ -81,6 +81,30 @@ TEST(codepoint_read) {
 #undef C_TEST_INVALID_CODEPOINT
 }
 
+TEST(utf8_sized) {
+    size_t count;
+
+    TEST_INT_EQ(c_utf8_nb_codepoints_n("", 0, &count), 0);
+    TEST_UINT_EQ(count, 0);
+    TEST_INT_EQ(c_utf8_nb_codepoints_n("\x61\xc3\xa9\xe2\x82\xac", 6,
+                                       &count), 0);
+    TEST_UINT_EQ(count, 3);
+    TEST_INT_EQ(c_utf8_nb_codepoints_n("\x61\x00\x62", 3, &count), 0);
+    TEST_UINT_EQ(count, 3);
+
+    /* Data after the size limit are ignored */
+    TEST_INT_EQ(c_utf8_validate_n("\x61\xff", 1), 0);
+
+    /* Truncated sequences */
+    TEST_INT_EQ(c_utf8_validate_n("\xc3\xa9", 1), -1);
+    TEST_INT_EQ(c_utf8_validate_n("\x61\xe2\x82\xac", 3), -1);
+    TEST_INT_EQ(c_utf8_validate_n("\xf0\x9b\x80\x80", 3), -1);
+
+    /* Invalid sequences */
+    TEST_INT_EQ(c_utf8_validate_n("\x80", 1), -1);
+    TEST_INT_EQ(c_utf8_validate_n("\xe0\x90\x80", 3), -1);
+}
+
 TEST(utf8_decode) {
     uint32_t *ustring;
 
@@ -143,6 +167,7 @@ main(int argc, char **argv) {
     test_suite_start(suite);
 
     TEST_RUN(suite, codepoint_read);
+    TEST_RUN(suite, utf8_sized);
     TEST_RUN(suite, utf8_decode);
 
     test_suite_print_results_and_exit(suite);
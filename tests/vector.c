@@ -159,6 +159,32 @@ TEST(clear) {
     c_vector_delete(vector);
 }
 
+TEST(alignment) {
+    struct c_vector *vector;
+    int value;
+
+    vector = c_vector_new(sizeof(int));
+
+    value = 1;
+    c_vector_append(vector, &value);
+
+    TEST_INT_EQ(c_vector_set_alignment(vector, 64), 0);
+    TEST_UINT_EQ((uintptr_t)c_vector_entries(vector) % 64, 0);
+    TEST_INT_EQ(*(int *)c_vector_entry(vector, 0), 1);
+
+    for (value = 2; value <= 1000; value++) {
+        c_vector_append(vector, &value);
+        TEST_UINT_EQ((uintptr_t)c_vector_entries(vector) % 64, 0);
+    }
+
+    for (int i = 0; i < 1000; i++)
+        TEST_INT_EQ(*(int *)c_vector_entry(vector, (size_t)i), i + 1);
+
+    TEST_INT_EQ(c_vector_set_alignment(vector, 12), -1);
+
+    c_vector_delete(vector);
+}
+
 int
 main(int argc, char **argv) {
     struct test_suite *suite;
@@ -173,6 +199,7 @@ main(int argc, char **argv) {
     TEST_RUN(suite, set);
     TEST_RUN(suite, remove);
     TEST_RUN(suite, clear);
+    TEST_RUN(suite, alignment);
 
     test_suite_print_results_and_exit(suite);
 }